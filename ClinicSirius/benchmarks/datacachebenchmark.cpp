@@ -0,0 +1,126 @@
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QRandomGenerator>
+#include <QTemporaryDir>
+#include <QLoggingCategory>
+#include <QFile>
+#include <QDir>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <cstdio>
+#include "datamanager.h"
+#include "models.h"
+
+// Times getPatientById and getScheduleById on a generated data directory:
+// the way they used to work (read and parse the JSON file, then scan it, on
+// every call), the first call on a fresh DataManager, which loads the table
+// and builds its index, and calls once the cache is warm.
+//
+//   datacache_benchmark [schedule rows] [lookups]
+
+static const char* const kTables[] = {
+    "patient.json", "doctor.json", "specialization.json", "room.json", "appointment.json",
+    "appointment_schedule.json", "patient_group.json", "diagnosis.json", "recipe.json",
+    "manager.json", "admin.json", "invitation_code.json",
+};
+
+static bool writeTable(const QString& dir, const QString& name, const QJsonArray& rows) {
+    QFile file(QDir(dir).filePath(name));
+    if (!file.open(QIODevice::WriteOnly)) return false;
+    file.write(QJsonDocument(rows).toJson(QJsonDocument::Compact));
+    return true;
+}
+
+// What a lookup cost before the cache: parse the whole file, scan for the id
+static QJsonObject uncachedLookup(const QString& dir, const QString& name, const char* key, int id) {
+    QFile file(QDir(dir).filePath(name));
+    if (!file.open(QIODevice::ReadOnly)) return QJsonObject();
+    const QJsonArray rows = QJsonDocument::fromJson(file.readAll()).array();
+    for (const QJsonValue& row : rows) {
+        if (row.toObject()[key].toInt() == id) return row.toObject();
+    }
+    return QJsonObject();
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    // DataManager reports every file it loads
+    QLoggingCategory::setFilterRules("default.debug=false");
+    const QStringList args = app.arguments();
+    const int scheduleRows = args.size() > 1 ? args.at(1).toInt() : 50000;
+    const int lookups = args.size() > 2 ? args.at(2).toInt() : 100000;
+    const int patientRows = scheduleRows / 2;
+
+    QTemporaryDir dir;
+    if (!dir.isValid()) {
+        std::printf("Cannot create a temporary directory\n");
+        return 1;
+    }
+    QRandomGenerator rng(12345);
+    QJsonArray patients;
+    for (int i = 1; i <= patientRows; ++i) {
+        Patient p;
+        p.id_patient = i;
+        p.fname = QString("Имя%1").arg(i);
+        p.lname = QString("Фамилия%1").arg(i);
+        p.bdate = "1990-01-01";
+        p.phone_number = QString("+7900%1").arg(i, 7, 10, QChar('0'));
+        p.email = QString("patient%1@example.com").arg(i);
+        patients.append(p.toJson());
+    }
+    QJsonArray schedules;
+    const QDateTime start(QDate(2024, 1, 1), QTime(8, 0));
+    for (int i = 1; i <= scheduleRows; ++i) {
+        AppointmentSchedule s;
+        s.id_ap_sch = i;
+        s.id_doctor = 1 + rng.bounded(200);
+        s.id_room = 1 + rng.bounded(50);
+        s.time_from = start.addSecs(qint64(i) * 1800);
+        s.time_to = s.time_from.addSecs(1800);
+        schedules.append(s.toJson());
+    }
+    for (const char* name : kTables) {
+        const QString table = QString::fromLatin1(name);
+        const QJsonArray rows = table == "patient.json" ? patients
+                              : table == "appointment_schedule.json" ? schedules : QJsonArray();
+        if (!writeTable(dir.path(), table, rows)) {
+            std::printf("Cannot write %s\n", name);
+            return 1;
+        }
+    }
+    std::printf("%d schedule rows, %d patients, %d lookups\n", scheduleRows, patientRows, lookups);
+
+    // Uncached: a handful of calls is enough to see the cost of each
+    const int uncachedCalls = 20;
+    QElapsedTimer timer;
+    timer.start();
+    for (int i = 0; i < uncachedCalls; ++i) {
+        uncachedLookup(dir.path(), "patient.json", "id_patient", 1 + rng.bounded(patientRows));
+        uncachedLookup(dir.path(), "appointment_schedule.json", "id_ap_sch", 1 + rng.bounded(scheduleRows));
+    }
+    const double uncachedUs = timer.nsecsElapsed() / 1e3 / uncachedCalls;
+
+    DataManager data(dir.path());
+    timer.restart();
+    const Patient firstPatient = data.getPatientById(patientRows);
+    const AppointmentSchedule firstSlot = data.getScheduleById(scheduleRows);
+    const double coldUs = timer.nsecsElapsed() / 1e3;
+
+    int found = (firstPatient.id_patient == patientRows) + (firstSlot.id_ap_sch == scheduleRows);
+    timer.restart();
+    for (int i = 0; i < lookups; ++i) {
+        found += data.getPatientById(1 + rng.bounded(patientRows)).id_patient > 0;
+        found += data.getScheduleById(1 + rng.bounded(scheduleRows)).id_ap_sch > 0;
+    }
+    const double warmUs = timer.nsecsElapsed() / 1e3 / lookups;
+
+    std::printf("%-34s %12.1f us\n", "uncached, per patient+slot pair", uncachedUs);
+    std::printf("%-34s %12.1f us\n", "first pair (load + index)", coldUs);
+    std::printf("%-34s %12.3f us\n", "warm, per patient+slot pair", warmUs);
+    if (found != 2 + 2 * lookups) {
+        std::printf("MISSING rows: found %d of %d\n", found, 2 + 2 * lookups);
+        return 1;
+    }
+    return 0;
+}
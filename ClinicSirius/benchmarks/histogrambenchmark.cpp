@@ -0,0 +1,140 @@
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QRandomGenerator>
+#include <QStringList>
+#include <QMap>
+#include <QList>
+#include <QVector>
+#include <cstdio>
+#include <functional>
+#include "datamanager.h"
+#include "histogramkernels.h"
+
+// Times the day and week counts behind the statistics charts three ways: the
+// loops StatisticsWidget used to run over the Appointment list, a scalar
+// loop over the AppointmentColumns date column, and HistogramKernels over
+// the same column. The results of all three are checked against each other.
+//
+//   histogram_benchmark [appointments] [repeats]
+
+static const int kWeeks = 12;
+static const int kDays = 31;
+
+// Best of repeats runs, in milliseconds
+static double bestOf(int repeats, const std::function<void()>& run) {
+    qint64 best = -1;
+    for (int r = 0; r < repeats; ++r) {
+        QElapsedTimer timer;
+        timer.start();
+        run();
+        const qint64 elapsed = timer.nsecsElapsed();
+        if (best < 0 || elapsed < best) best = elapsed;
+    }
+    return best / 1e6;
+}
+
+static int weekKey(const QDate& d) {
+    int year = 0;
+    int week = d.weekNumber(&year);
+    return year * 100 + week;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    const QStringList args = app.arguments();
+    const int count = args.size() > 1 ? args.at(1).toInt() : 200000;
+    const int repeats = args.size() > 2 ? args.at(2).toInt() : 5;
+
+    // Appointments spread over three years, a year of them before the period
+    const QDate firstMonday = QDate(2024, 1, 1);  // a Monday
+    const QDate historyStart = firstMonday.addDays(-365);
+    QRandomGenerator rng(12345);
+    QList<Appointment> appts;
+    appts.reserve(count);
+    AppointmentColumns columns;
+    for (int i = 0; i < count; ++i) {
+        Appointment a;
+        a.id_ap = i + 1;
+        a.id_patient = rng.bounded(5000);
+        a.id_doctor = rng.bounded(200);
+        a.date = QDateTime(historyStart.addDays(rng.bounded(3 * 365)), QTime(8 + rng.bounded(10), rng.bounded(60)));
+        appts.append(a);
+        columns.append(a);
+    }
+    const qint64 mondayDay = firstMonday.toJulianDay();
+    const qint64 *minutes = columns.date.constData();
+    const qint64 n = columns.size();
+
+    std::printf("%d appointments, kernels: %s\n", count, HistogramKernels::activePath());
+
+    // Weekly counts
+    QVector<int> oldWeeks(kWeeks, 0);
+    const double oldWeekMs = bestOf(repeats, [&]() {
+        QList<int> weekKeys;
+        for (int i = 0; i < kWeeks; ++i) weekKeys.append(weekKey(firstMonday.addDays(7 * i)));
+        QMap<int,int> perWeek;
+        for (const Appointment &a : appts) {
+            if (!a.date.isValid()) continue;
+            int k = weekKey(a.date.date());
+            if (!weekKeys.contains(k)) continue;
+            perWeek[k] += 1;
+        }
+        for (int i = 0; i < kWeeks; ++i) oldWeeks[i] = perWeek.value(weekKeys[i]);
+    });
+    QVector<int> scalarWeeks(kWeeks, 0);
+    const double scalarWeekMs = bestOf(repeats, [&]() {
+        scalarWeeks.fill(0);
+        const qint64 origin = mondayDay * HistogramKernels::MinutesPerDay;
+        const qint64 width = 7 * HistogramKernels::MinutesPerDay;
+        for (qint64 i = 0; i < n; ++i) {
+            qint64 off = minutes[i] - origin;
+            if (off >= 0 && off < width * kWeeks) scalarWeeks[int(off / width)] += 1;
+        }
+    });
+    QVector<qint32> kernelWeeks(kWeeks, 0);
+    const double kernelWeekMs = bestOf(repeats, [&]() {
+        kernelWeeks.fill(0);
+        HistogramKernels::weekHistogram(minutes, n, mondayDay, kWeeks, kernelWeeks.data());
+    });
+
+    // Daily counts over one month
+    QVector<int> oldDays(kDays, 0);
+    const double oldDayMs = bestOf(repeats, [&]() {
+        for (int i = 0; i < kDays; ++i) {
+            QDate d = firstMonday.addDays(i);
+            int c = 0;
+            for (const Appointment &a : appts) {
+                if (!a.date.isValid()) continue;
+                if (a.date.date() == d) c += 1;
+            }
+            oldDays[i] = c;
+        }
+    });
+    QVector<int> scalarDays(kDays, 0);
+    const double scalarDayMs = bestOf(repeats, [&]() {
+        scalarDays.fill(0);
+        for (qint64 i = 0; i < n; ++i) {
+            qint64 day = minutes[i] / HistogramKernels::MinutesPerDay - mondayDay;
+            if (minutes[i] >= 0 && day >= 0 && day < kDays) scalarDays[int(day)] += 1;
+        }
+    });
+    QVector<qint32> kernelDays(kDays, 0);
+    const double kernelDayMs = bestOf(repeats, [&]() {
+        kernelDays.fill(0);
+        HistogramKernels::dayHistogram(minutes, n, mondayDay, kDays, kernelDays.data());
+    });
+
+    std::printf("%-8s %14s %14s %14s\n", "", "old loop, ms", "scalar, ms", "kernel, ms");
+    std::printf("%-8s %14.3f %14.3f %14.3f\n", "weeks", oldWeekMs, scalarWeekMs, kernelWeekMs);
+    std::printf("%-8s %14.3f %14.3f %14.3f\n", "days", oldDayMs, scalarDayMs, kernelDayMs);
+
+    bool same = true;
+    for (int i = 0; i < kWeeks; ++i) same = same && oldWeeks[i] == scalarWeeks[i] && scalarWeeks[i] == kernelWeeks[i];
+    for (int i = 0; i < kDays; ++i) same = same && oldDays[i] == scalarDays[i] && scalarDays[i] == kernelDays[i];
+    if (!same) {
+        std::printf("MISMATCH between the loops and the kernels\n");
+        return 1;
+    }
+    return 0;
+}
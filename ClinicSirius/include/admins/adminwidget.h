@@ -3,10 +3,12 @@
 
 #include <QWidget>
 #include <QTabWidget>
-#include <QTableWidget>
+#include <QTableView>
+#include <QHash>
 #include <QPushButton>
 #include <QLineEdit>
 #include "models.h"
+#include "recordtablemodel.h"
 
 class DataManager;
 
@@ -67,7 +69,9 @@ private:
     // Doctors tab
     QWidget *doctorsTab;
     QLineEdit *doctorsSearchEdit;
-    QTableWidget *doctorsTable;
+    QTableView *doctorsTable;
+    RecordTableModel<Doctor> *doctorsModel;
+    RecordFilterProxyModel *doctorsProxy;
     QPushButton *addDoctorBtn;
     QPushButton *editDoctorBtn;
     QPushButton *deleteDoctorBtn;
@@ -76,7 +80,9 @@ private:
     // Patients tab
     QWidget *patientsTab;
     QLineEdit *patientsSearchEdit;
-    QTableWidget *patientsTable;
+    QTableView *patientsTable;
+    RecordTableModel<Patient> *patientsModel;
+    RecordFilterProxyModel *patientsProxy;
     QPushButton *addPatientBtn;
     QPushButton *editPatientBtn;
     QPushButton *deletePatientBtn;
@@ -85,7 +91,9 @@ private:
     // Managers tab
     QWidget *managersTab;
     QLineEdit *managersSearchEdit;
-    QTableWidget *managersTable;
+    QTableView *managersTable;
+    RecordTableModel<Manager> *managersModel;
+    RecordFilterProxyModel *managersProxy;
     QPushButton *addManagerBtn;
     QPushButton *editManagerBtn;
     QPushButton *deleteManagerBtn;
@@ -98,33 +106,33 @@ private:
     QWidget *directoriesTab;
     // Specializations
     QLineEdit *specsSearchEdit;
-    QTableWidget *specsTable;
+    QTableView *specsTable;
+    RecordTableModel<Specialization> *specsModel;
+    RecordFilterProxyModel *specsProxy;
     QPushButton *addSpecBtn;
     QPushButton *editSpecBtn;
     QPushButton *deleteSpecBtn;
     // Rooms
     QLineEdit *roomsSearchEdit;
-    QTableWidget *roomsTable;
+    QTableView *roomsTable;
+    RecordTableModel<Room> *roomsModel;
+    RecordFilterProxyModel *roomsProxy;
     QPushButton *addRoomBtn;
     QPushButton *editRoomBtn;
     QPushButton *deleteRoomBtn;
     // Diagnoses
     QLineEdit *diagSearchEdit;
-    QTableWidget *diagTable;
+    QTableView *diagTable;
+    RecordTableModel<Diagnosis> *diagModel;
+    RecordFilterProxyModel *diagProxy;
     QPushButton *addDiagBtn;
     QPushButton *editDiagBtn;
     QPushButton *deleteDiagBtn;
 
     LoginUser currentUser;
     DataManager *dataManager;
-    
-    // Store full data for filtering
-    QList<Doctor> allDoctors;
-    QList<Patient> allPatients;
-    QList<Manager> allManagers;
-    QList<Specialization> allSpecializations;
-    QList<Room> allRooms;
-    QList<Diagnosis> allDiagnoses;
+    bool statisticsStale = false;  // data changed since the last refresh
+    QHash<int, QString> specializationNames;  // id_spec -> name, for the doctors table
 };
 
 #endif // ADMINWIDGET_H
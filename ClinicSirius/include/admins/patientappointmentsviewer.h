@@ -9,6 +9,7 @@
 #include <QLineEdit>
 #include <QLabel>
 #include "common/datamanager.h"
+#include "common/textsearchindex.h"
 
 class PatientAppointmentsViewer : public QWidget {
     Q_OBJECT
@@ -23,11 +24,13 @@ private slots:
 
 private:
     void buildUI();
+    void applyFilter(const QString &text);
     DataManager *m_dm;
     int m_currentPatientId = -1;
     QLineEdit *m_filterEdit = nullptr;
     QTableWidget *m_table = nullptr;
     QLabel *m_header = nullptr;
+    TextSearchIndex m_searchIndex;  // over the table rows
 };
 
 #endif // PATIENTAPPOINTMENTSVIEWER_H
@@ -0,0 +1,122 @@
+#ifndef RECORDTABLEMODEL_H
+#define RECORDTABLEMODEL_H
+
+#include <QAbstractTableModel>
+#include <QSortFilterProxyModel>
+#include <QStringList>
+#include <QVector>
+#include <QList>
+#include <QBitArray>
+#include <functional>
+#include "textsearchindex.h"
+
+// Search side of a record model, for RecordFilterProxyModel.
+class SearchableRecordModel : public QAbstractTableModel {
+public:
+    using QAbstractTableModel::QAbstractTableModel;
+    // Source rows whose search fields contain the query, ascending.
+    virtual QVector<int> matchingRows(const QString &query) = 0;
+};
+
+// Read-only table model over the rows of one DataManager table. setRows()
+// takes an implicitly shared copy of the table, so it costs O(1) whatever
+// the row count, and a cell is only formatted when a view asks for it in
+// data(). Each column is a function of the row. Searching uses the displayed
+// columns unless setSearchFields() names other fields; the search index is
+// built on the first search after the rows change.
+template <typename T>
+class RecordTableModel : public SearchableRecordModel {
+public:
+    using Column = std::function<QVariant(const T&)>;
+    using SearchFields = std::function<QStringList(const T&)>;
+
+    RecordTableModel(const QStringList &headers, const QVector<Column> &columns, QObject *parent = nullptr)
+        : SearchableRecordModel(parent), headers(headers), columns(columns) {}
+
+    void setRows(const QList<T> &newRows) {
+        beginResetModel();
+        rows = newRows;
+        searchIndexed = false;
+        searchIndex.clear();
+        endResetModel();
+    }
+
+    void setSearchFields(const SearchFields &fields) {
+        searchFields = fields;
+        searchIndexed = false;
+        searchIndex.clear();
+    }
+
+    QVector<int> matchingRows(const QString &query) override {
+        if (!searchIndexed) {
+            searchIndex.build(rows.size(), [this](int row) { return fieldsOf(rows.at(row)); });
+            searchIndexed = true;
+        }
+        return searchIndex.search(query);
+    }
+
+    const T &rowAt(int row) const { return rows.at(row); }
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override {
+        return parent.isValid() ? 0 : rows.size();
+    }
+
+    int columnCount(const QModelIndex &parent = QModelIndex()) const override {
+        return parent.isValid() ? 0 : columns.size();
+    }
+
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override {
+        if (!index.isValid() || index.row() >= rows.size() || index.column() >= columns.size()) return QVariant();
+        if (role != Qt::DisplayRole && role != Qt::ToolTipRole) return QVariant();
+        return columns.at(index.column())(rows.at(index.row()));
+    }
+
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override {
+        if (orientation == Qt::Horizontal && role == Qt::DisplayRole) return headers.value(section);
+        return QAbstractTableModel::headerData(section, orientation, role);
+    }
+
+private:
+    QStringList fieldsOf(const T &row) const {
+        if (searchFields) return searchFields(row);
+        QStringList fields;
+        for (const Column &column : columns) fields << column(row).toString();
+        return fields;
+    }
+
+    QStringList headers;
+    QVector<Column> columns;
+    QList<T> rows;
+    SearchFields searchFields;
+    TextSearchIndex searchIndex;
+    bool searchIndexed = false;
+};
+
+// Sort/filter proxy over a record model that filters through the model's
+// search index instead of comparing every cell.
+class RecordFilterProxyModel : public QSortFilterProxyModel {
+public:
+    using QSortFilterProxyModel::QSortFilterProxyModel;
+
+    void setSearchText(const QString &text) {
+        SearchableRecordModel *model = static_cast<SearchableRecordModel *>(sourceModel());
+        filtering = model && !text.isEmpty();
+        accepted.clear();
+        if (filtering) {
+            accepted.resize(model->rowCount());
+            for (int row : model->matchingRows(text)) accepted.setBit(row);
+        }
+        invalidateFilter();
+    }
+
+protected:
+    bool filterAcceptsRow(int sourceRow, const QModelIndex &) const override {
+        return !filtering || (sourceRow < accepted.size() && accepted.testBit(sourceRow));
+    }
+
+private:
+    bool filtering = false;
+    QBitArray accepted;  // by source row
+};
+
+#endif // RECORDTABLEMODEL_H
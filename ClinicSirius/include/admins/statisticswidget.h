@@ -4,29 +4,70 @@
 #include <QWidget>
 #include <QDate>
 #include <QVBoxLayout>
-
-class DataManager;
+#include <QFutureWatcher>
+#include <QSharedPointer>
+#include <atomic>
+#include "../common/datamanager.h"
 
 #ifdef USE_QT_CHARTS
 #include <QtCharts/QChartView>
 #endif
 class QLabel;
 class QPushButton;
+class QProgressBar;
+
+// Inputs of one statistics run, taken on the GUI thread. data is pinned to
+// one version of the tables, so the workers see a consistent view however
+// long they run, and edits made meanwhile never wait for them.
+struct StatisticsSnapshot {
+    QSharedPointer<const DataSnapshot> data;
+    QDate startDate;
+    QDate endDate;
+    bool customPeriod = false;
+};
+
+struct WeeklyStatistics {
+    QDate startDate;
+    QDate endDate;
+    qint64 firstMonday = 0;
+    int weeks = 0;
+    QVector<int> perWeek;
+    QVector<int> perDay;
+    bool customPeriod = false;
+    bool cancelled = false;
+};
+
+struct TopStatistics {
+    struct Entry {
+        QString label;
+        QString detail;  // tooltip text beyond the count
+        int count = 0;
+    };
+    QList<Entry> patients;  // most appointments first, at most 10
+    QList<Entry> doctors;
+    int patientTotal = 0;   // distinct patients / doctors with appointments
+    int doctorTotal = 0;
+    bool cancelled = false;
+};
 
 class StatisticsWidget : public QWidget {
     Q_OBJECT
 public:
     explicit StatisticsWidget(DataManager *dm, QWidget *parent = nullptr);
+    ~StatisticsWidget() override;
+    // Starts a background recount; a run still in progress is cancelled and
+    // its results are dropped. Charts update as each part finishes.
     void refresh();
 
 private:
     void buildUI();
-    void buildWeeklyCharts();
-    void buildTopLists();
+    void showWeeklyCharts(const WeeklyStatistics &stats);
+    void showTopLists(const TopStatistics &stats);
+    void updateBusyIndicator();
+    void showDoctorBreakdown(qint64 firstDay, qint64 lastDay, const QString &title);
 
     DataManager *dm;
     QWidget *visitsChartView;
-    QWidget *doctorsChartView;
     QWidget *topPatientsChartView;
     QWidget *topDoctorsChartView;
     QLabel *periodLabel;
@@ -38,6 +79,10 @@ private:
     bool customPeriod = false;
     int endOffsetWeeks = 0; // 0 = up to this week, >0 = shift window to past
     QVBoxLayout *chartsLayout;
+    QProgressBar *busyIndicator;
+    QFutureWatcher<WeeklyStatistics> *weeklyWatcher;
+    QFutureWatcher<TopStatistics> *topWatcher;
+    QSharedPointer<std::atomic<bool>> cancelFlag;  // of the current run
 
 private slots:
     void moveChart(QWidget *w, int direction);
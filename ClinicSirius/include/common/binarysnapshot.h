@@ -0,0 +1,32 @@
+#ifndef BINARYSNAPSHOT_H
+#define BINARYSNAPSHOT_H
+
+#include <QString>
+#include <QList>
+#include "models.h"
+
+// Binary sidecar of a JSON table (<table>.bin next to <table>.json), used to
+// skip JSON parsing and timestamp conversion at startup. Rows are stored as
+// fixed-width little-endian records with timestamps in epoch minutes and
+// strings in a shared pool; the file is memory-mapped on load.
+//
+// A sidecar is only trusted while it matches its JSON file: same size and
+// modification time, or same size and MD5 if only the time differs. The
+// JSON stays the interchange format and wins on any mismatch.
+//
+// Only the large, timestamp-heavy tables have a binary layout; other tables
+// always load from JSON.
+class BinarySnapshot {
+public:
+    static bool load(const QString& jsonPath, QList<Appointment>& rows);
+    static bool load(const QString& jsonPath, QList<AppointmentSchedule>& rows);
+
+    // Returns false (and writes nothing) if a row can't be represented,
+    // e.g. a timestamp with non-zero seconds.
+    static bool save(const QString& jsonPath, const QList<Appointment>& rows);
+    static bool save(const QString& jsonPath, const QList<AppointmentSchedule>& rows);
+
+    static QString sidecarPath(const QString& jsonPath);
+};
+
+#endif // BINARYSNAPSHOT_H
@@ -1,16 +1,523 @@
 #ifndef DATAMANAGER_H
 #define DATAMANAGER_H
 
+#include <QObject>
 #include <QString>
 #include <QList>
+#include <QHash>
+#include <QMap>
+#include <QMultiHash>
+#include <QVector>
+#include <QSet>
 #include <QJsonArray>
 #include <QJsonDocument>
 #include <QJsonObject>
+#include <QSharedPointer>
+#include <QPair>
+#include <QFuture>
+#include <QFutureInterface>
+#include <QThreadPool>
+#include <QMutex>
+#include <functional>
+#include <atomic>
 #include "models.h"
 
+class DataServiceClient;
+
+// In-memory copy of one JSON table. Rows are parsed once on first access;
+// mutations are appended to journal.log on the storage thread, and the JSON
+// file is only rewritten from these rows when the journal is compacted.
+// byId maps the primary key to the row position and is kept in sync by
+// DataManager's insert/replace/remove helpers. Rows deleted while a batch
+// of journal entries is applied only leave byId and are listed in removed;
+// they are dropped from rows in one pass when the batch is done. stamp is
+// the version of the table on disk the rows were built on;
+// journalGeneration and journalPos tell up to where the journal has been
+// read into them.
+template <typename T>
+struct TableCache {
+    QString filename;
+    QList<T> rows;
+    QHash<int, int> byId;
+    QVector<int> removed;
+    bool loaded = false;
+    quint64 stamp = 0;
+    QString journalGeneration;
+    qint64 journalPos = 0;
+};
+
+// Schedule intervals of one doctor or one room, sorted by start time
+// (seconds since epoch). maxLength bounds how far before a query window an
+// overlapping interval can start, so an overlap check is a binary search
+// plus a short forward scan.
+struct IntervalIndex {
+    struct Entry {
+        qint64 from;
+        qint64 to;
+        int id;
+    };
+    QVector<Entry> entries;
+    qint64 maxLength = 0;
+
+    void insert(qint64 from, qint64 to, int id);
+    void remove(qint64 from, int id);
+    bool overlaps(qint64 from, qint64 to, int ignoreId = -1) const;
+    QList<int> idsStartingAt(qint64 from) const;
+};
+
+// Column copy of the appointment table for analytics scans, in row order.
+// Dates are local wall-clock minutes counted from the start of Julian day 0,
+// so minutes / 1440 is the date's Julian day number and bucketing by day,
+// week or month needs no QDateTime conversion.
+struct AppointmentColumns {
+    static const qint64 NoDate = -1;
+
+    QVector<qint32> patient;
+    QVector<qint32> doctor;
+    QVector<qint64> date;
+    QVector<quint64> completed;  // bitset, one bit per row
+
+    int size() const { return patient.size(); }
+    bool isCompleted(int row) const { return (completed.at(row >> 6) >> (row & 63)) & 1; }
+    void append(const Appointment& a);
+    void clear();
+
+    static qint64 toMinutes(const QDateTime& dt);
+};
+
+// Dimensions of one statistics rollup cell. Specialization and room are
+// those of the appointment's doctor and schedule slot; -1 when unknown.
+struct RollupKey {
+    qint32 doctor = -1;
+    qint32 spec = -1;
+    qint32 room = -1;
+    bool completed = false;
+
+    bool operator==(const RollupKey& other) const {
+        return doctor == other.doctor && spec == other.spec && room == other.room
+               && completed == other.completed;
+    }
+};
+
+inline size_t qHash(const RollupKey& key, size_t seed = 0) {
+    quint64 ids = (quint64(quint32(key.doctor)) << 32) | quint32(key.spec);
+    quint64 rest = (quint64(quint32(key.room)) << 1) | (key.completed ? 1 : 0);
+    return size_t(qHash(ids, uint(seed)) ^ (qHash(rest, uint(seed)) * 31));
+}
+
+// Per-day counts over a dense range of Julian days, with a Fenwick tree on
+// top so the count of any day range takes O(log n). The range grows by
+// doubling to take in days outside it, but never past the years 1900 to
+// 2199: days beyond, such as a mistyped year, are kept apart in outside
+// rather than stretching every tree across centuries.
+struct DayFenwick {
+    static const qint64 FirstDenseDay = 2415021;  // 1900-01-01
+    static const qint64 LastDenseDay = 2524593;   // 2199-12-31
+
+    qint64 firstDay = 0;
+    QVector<int> values;  // count per day from firstDay
+    QVector<int> tree;    // Fenwick sums over values, 1-based
+    QMap<qint64, int> outside;  // count per day beyond the dense limits
+
+    void add(qint64 day, int delta);
+    // Replaces the counts with counts.size() days starting at first, such
+    // as a day histogram; the tree is built in linear time.
+    void assign(qint64 first, const QVector<int>& counts);
+    // Appointments on days before day.
+    int prefix(qint64 day) const;
+    // Inclusive range of Julian days.
+    int count(qint64 fromDay, qint64 lastDay) const;
+    bool isEmpty() const { return values.isEmpty() && outside.isEmpty(); }
+
+private:
+    void cover(qint64 day);
+    void buildTree();
+};
+
+// Appointment counts per Julian day and RollupKey. Totals per day, overall
+// and per doctor, are also kept in Fenwick trees, so range counts for any
+// period take O(log n) whatever the length of the history. Days are local
+// calendar days of the appointment time; undated appointments are left out.
+struct StatisticsRollup {
+    QMap<qint64, QHash<RollupKey, int>> days;
+    DayFenwick totals;
+    QHash<int, DayFenwick> doctorTotals;
+
+    void add(qint64 day, const RollupKey& key, int delta);
+    // Like add(), but leaves totals to the caller, who fills them in one go.
+    void addCell(qint64 day, const RollupKey& key, int delta);
+    void clear();
+
+    // Ranges are inclusive Julian days.
+    int count(qint64 firstDay, qint64 lastDay) const;
+    int countForDoctor(int doctorId, qint64 firstDay, qint64 lastDay) const;
+    // Totals of buckets consecutive bucketDays-long ranges from firstDay.
+    QVector<int> perBucket(qint64 firstDay, int buckets, int bucketDays) const;
+    // Drill-down of a range into one dimension: id -> appointments.
+    QHash<int, int> countByDoctor(qint64 firstDay, qint64 lastDay) const;
+    QHash<int, int> countBySpecialization(qint64 firstDay, qint64 lastDay) const;
+    QHash<int, int> countByRoom(qint64 firstDay, qint64 lastDay) const;
+    int countCompleted(qint64 firstDay, qint64 lastDay) const;
+};
+
+// Login record of one account in any of the four role tables.
+struct Credential {
+    LoginUser::UserType role = LoginUser::PATIENT;
+    int id = -1;
+    QString hash;  // stored password hash
+};
+
+// Free slots of one doctor, bucketed by day (Julian day number) and sorted
+// by start time within a day. Queries start at today's bucket, so past
+// schedule history is never scanned.
+struct AvailabilityIndex {
+    struct Slot {
+        qint64 from;
+        int id;
+    };
+    QMap<qint64, QVector<Slot>> days;
+
+    void insert(qint64 day, qint64 from, int id);
+    void remove(qint64 day, qint64 from, int id);
+};
+
+// One mutation read back from the data directory's journal.log.
+struct JournalEntry {
+    QString op;          // "put" or "del"
+    int id = -1;
+    QJsonObject record;  // full row for "put"
+};
+
+// One table of a DataSnapshot: the rows and their primary key index.
+template <typename T>
+struct SnapshotTable {
+    QList<T> rows;
+    QHash<int, int> byId;
+
+    // Row with the primary key, or a default row.
+    T find(int id) const {
+        auto it = byId.constFind(id);
+        return it == byId.constEnd() ? T() : rows.at(it.value());
+    }
+    bool contains(int id) const { return byId.contains(id); }
+};
+
+// Every table of a data directory, plus the statistics structures, as of
+// one version of the data. Immutable once published, so any number of
+// threads may read it without locking. The containers are implicitly
+// shared with the live tables: taking a snapshot copies no rows, and a later
+// write detaches from it instead of waiting for its readers.
+struct DataSnapshot {
+    quint64 version = 0;
+    SnapshotTable<Patient> patients;
+    SnapshotTable<Doctor> doctors;
+    SnapshotTable<Specialization> specializations;
+    SnapshotTable<Room> rooms;
+    SnapshotTable<Appointment> appointments;
+    SnapshotTable<AppointmentSchedule> schedules;
+    SnapshotTable<PatientGroup> patientGroups;
+    SnapshotTable<Diagnosis> diagnoses;
+    SnapshotTable<Recipe> recipes;
+    SnapshotTable<Manager> managers;
+    SnapshotTable<Admin> admins;
+    SnapshotTable<InvitationCode> invitationCodes;
+    StatisticsRollup rollup;
+    AppointmentColumns appointmentColumns;
+};
+
+// Row change staged for the journal, with the row as it was before (empty
+// when it did not exist), so that the batch can be undone and checked
+// against what another process wrote meanwhile.
+struct StagedRow {
+    QString table;
+    QString op;
+    int id = -1;
+    QJsonObject record;
+    QJsonObject base;
+};
+
+// One batch on its way to the journal. The storage thread sets status; the
+// GUI thread resolves result once the batch is written or given up.
+struct JournalWrite {
+    enum Status { Queued, Written, Failed, Conflict };
+
+    QList<StagedRow> rows;
+    QHash<QString, quint64> stamps;  // table -> stamp the batch was built on
+    std::atomic<int> status{Queued};
+    int attempts = 0;      // failed appends
+    int stampRetries = 0;  // appends another process got ahead of
+    bool report = true;  // emit writeFailed/writeConflict if given up
+    QFutureInterface<bool> result;
+
+    void finish(bool ok) {
+        result.reportResult(ok);
+        result.reportFinished();
+    }
+};
+
+// Change notifications of one data directory, emitted once a mutation has
+// been committed to the journal. Views connect to the typed signals to
+// refresh only what changed; every other table reports through rowChanged.
+// writesPendingChanged and writeFailed follow the storage thread, for busy
+// indicators and for reporting writes that did not reach disk; writeConflict
+// reports a write given up because another process changed the same rows.
+class DataEvents : public QObject {
+    Q_OBJECT
+public:
+    using QObject::QObject;
+
+signals:
+    void patientChanged(int id);
+    void doctorChanged(int id);
+    void appointmentChanged(int id);
+    void scheduleChanged(int id);
+    void rowChanged(const QString& table, int id);
+    void writesPendingChanged(bool pending);
+    void writeFailed();
+    void writeConflict();
+};
+
+// All tables of one data directory. DataManager instances that resolve to
+// the same directory share a single DataStore, so a change made through one
+// widget's DataManager is immediately visible to every other one.
+struct DataStore {
+    TableCache<Patient> patients{"patient.json"};
+    TableCache<Doctor> doctors{"doctor.json"};
+    TableCache<Specialization> specializations{"specialization.json"};
+    TableCache<Room> rooms{"room.json"};
+    TableCache<Appointment> appointments{"appointment.json"};
+    TableCache<AppointmentSchedule> schedules{"appointment_schedule.json"};
+    TableCache<PatientGroup> patientGroups{"patient_group.json"};
+    TableCache<Diagnosis> diagnoses{"diagnosis.json"};
+    TableCache<Recipe> recipes{"recipe.json"};
+    TableCache<Manager> managers{"manager.json"};
+    TableCache<Admin> admins{"admin.json"};
+    TableCache<InvitationCode> invitationCodes{"invitation_code.json"};
+
+    // Foreign key -> primary keys of the referencing rows. Maintained
+    // together with the owning table's byId index.
+    QMultiHash<int, int> schedulesByDoctor;
+    QMultiHash<int, int> schedulesByRoom;
+    QMultiHash<int, int> appointmentsByPatient;
+    QMultiHash<int, int> appointmentsByDoctor;
+    QMultiHash<int, int> appointmentsBySchedule;
+    QMultiHash<int, int> recipesByAppointment;
+
+    // Slot intervals per doctor and per room, for canAddSchedule().
+    QHash<int, IntervalIndex> doctorIntervals;
+    QHash<int, IntervalIndex> roomIntervals;
+
+    // Free slots per doctor plus the number of appointments starting at each
+    // (doctor, time). Built on the first availability query and then kept
+    // current by the foreign-key hooks; reloading either table drops it.
+    QHash<int, AvailabilityIndex> freeSlots;
+    QHash<QPair<int, qint64>, int> appointmentStarts;
+    bool availabilityBuilt = false;
+
+    // Normalized email -> accounts using it, across patients, doctors,
+    // managers and admins (ordered by role). Built on the first login or
+    // email check and kept current by the same hooks; reloading any of the
+    // role tables drops it.
+    QHash<QString, QVector<Credential>> credentials;
+    bool credentialsBuilt = false;
+
+    // Appointments as columns. Inserts are appended as they happen; updates,
+    // deletes and reloads mark it stale and the next read rebuilds it.
+    AppointmentColumns appointmentColumns;
+    bool appointmentColumnsValid = false;
+
+    // Statistics rollup. Loaded from statistics_rollup.json when that file
+    // still matches the tables, otherwise rebuilt from the appointments;
+    // kept current by the foreign-key hooks of appointments, doctors and
+    // schedules, and dropped when any of those tables reloads.
+    StatisticsRollup rollup;
+    bool rollupBuilt = false;
+
+    // Write-ahead journal. Mutations are staged in pendingRows and
+    // appended to journal.log on commit; compaction rewrites the JSON
+    // snapshots of dirtyTables and truncates the journal. Entries not yet
+    // read into a table (left by a previous run, or appended by another
+    // process) wait in unreplayed until it is loaded. journalGeneration
+    // names the journal file read up to journalOffset; it changes whenever
+    // a compaction replaces the file.
+    QList<StagedRow> pendingRows;
+    QHash<QString, QList<JournalEntry>> unreplayed;
+    QSet<QString> dirtyTables;
+    qint64 journalSize = 0;
+    bool journalRead = false;
+    QString journalGeneration;
+    qint64 journalOffset = 0;
+
+    // Other processes may work on the same directory. Every table has an
+    // advisory lock file (<table>.lock), held while a batch for it is
+    // checked and appended or its snapshot is read or rewritten, and a
+    // stamp file (<table>.version) that every batch changing the table
+    // replaces with a new random stamp. A batch carries the stamps its
+    // tables had in memory; if one has moved on disk, another process wrote
+    // the table first, and the batch is not appended but waits in
+    // unconfirmed for settleWrites(). writerId marks this process's batches
+    // in the journal.
+    QString writerId;
+    QList<QSharedPointer<JournalWrite>> unconfirmed;
+
+    // Next free primary key per table, keyed by filename. Seeded on load
+    // from the rows, the journal and sequence.json, and never decreases, so
+    // an id is not handed out twice even if its row is deleted or a
+    // transaction rolls back. Ids are claimed from sequence.json in blocks
+    // up to idLimits, so processes sharing the directory never hand out
+    // the same one; compact() persists the rest.
+    QHash<QString, int> nextIds;
+    QHash<QString, int> idLimits;
+    QHash<QString, int> savedIds;
+    bool sequencesRead = false;
+    bool sequencesDirty = false;
+
+    // Rows (table filename, id) staged since the last commit; announced
+    // through events once they reach the journal.
+    DataEvents events;
+    QList<QPair<QString, int>> pendingChanges;
+
+    // Open transaction: nesting depth, and the sizes of pendingRows and
+    // pendingChanges when it began. Rolling back restores the bases of the
+    // rows staged since, so only the rows it touched are copied.
+    int transactionDepth = 0;
+    int transactionMark = 0;
+    int transactionChangeMark = 0;
+
+    // Storage thread: journal appends and snapshot rewrites run there one
+    // at a time, in the order they were queued, on data captured when they
+    // were queued (serialized batches, implicitly shared row lists), so the
+    // tables in memory never wait for the disk. writesInFlight counts the
+    // queued writes.
+    QThreadPool storage;
+    int writesInFlight = 0;
+
+    // Snapshot isolation. The tables are written on one thread only (the
+    // GUI thread); version counts the changes made there, and root is the
+    // last DataSnapshot published by DataManager::snapshot(). Other threads
+    // read root under rootLock, which guards nothing but the pointer.
+    quint64 version = 0;
+    QMutex rootLock;
+    QSharedPointer<const DataSnapshot> root;
+
+    // Client mode: set when the tables are served by clinicsiriusd instead
+    // of being read from the directory. Tables are fetched from it, ids
+    // claimed from it, and batches sent to it in place of journal appends;
+    // there is no compaction. Changes other clients made are pushed and
+    // applied like those read from another process's journal.
+    QSharedPointer<DataServiceClient> service;
+
+    template <typename F>
+    void forEachTable(F&& f) {
+        f(patients);
+        f(doctors);
+        f(specializations);
+        f(rooms);
+        f(appointments);
+        f(schedules);
+        f(patientGroups);
+        f(diagnoses);
+        f(recipes);
+        f(managers);
+        f(admins);
+        f(invitationCodes);
+    }
+};
+
+// Outcome of one requested slot in DataManager::addSchedules().
+struct ScheduleBatchResult {
+    enum Status { Accepted, InvalidTime, DoctorOverlap, RoomOverlap, BatchOverlap };
+
+    AppointmentSchedule schedule;  // carries the assigned id when accepted
+    Status status = Accepted;
+};
+
+// Outcome of DataManager::bookSlot() and moveToSlot().
+struct BookingResult {
+    enum Status { Booked, NoSuchSlot, NoSuchAppointment, SlotTaken, WriteFailed };
+
+    Appointment appointment{};  // as saved when booked
+    Status status = Booked;
+
+    bool ok() const { return status == Booked; }
+};
+
 class DataManager {
 public:
     DataManager(const QString& dataPath = QString());
+
+    // Process-wide instance on the default data directory, resolved on first
+    // use. Widgets take it instead of guessing a path of their own.
+    static DataManager& shared();
+
+    DataEvents* events() const;
+
+    // Rewrite the JSON snapshots from memory and truncate the journal.
+    void compact();
+    QFuture<bool> compactAsync();
+    static void compactAll();
+
+    // Group several mutations, possibly across tables: they reach the
+    // journal in one atomic append on commitTransaction(), or are undone in
+    // memory by rollbackTransaction(). Transactions may nest.
+    void beginTransaction();
+    bool commitTransaction();
+    void rollbackTransaction();
+
+    // Asynchronous writes. The changes are applied to memory at once, so
+    // every read sees them and change events go out immediately; the disk
+    // write runs on the storage thread and the future tells whether it got
+    // there. A batch that another process got ahead of is applied again on
+    // top of that process's rows and retried, unless it changes a row that
+    // process changed too; a batch that conflicts or keeps failing is
+    // undone in memory and reported through DataEvents::writeConflict or
+    // writeFailed. The synchronous calls above wait for their write instead.
+    // writeAsync() runs mutations as one transaction.
+    QFuture<bool> writeAsync(const std::function<void()>& mutations);
+    QFuture<bool> commitTransactionAsync();
+    bool hasPendingWrites() const;
+    void waitForWrites() const;
+
+    // Reads in what other processes sharing the data directory have written
+    // since the last call and announces the changed rows. Tables nobody
+    // else changed are left alone. Does nothing while writes are pending.
+    void refresh();
+
+    // Consistent read-only view of all tables for long scans and for
+    // readers on other threads. Publishes a new root when the tables have
+    // changed since the last one, so it must be called on the thread that
+    // writes; the snapshot taken stays as it is while writes go on.
+    QSharedPointer<const DataSnapshot> snapshot() const;
+    // The last published root, from any thread; null before the first
+    // snapshot(), and behind the tables if they changed since.
+    QSharedPointer<const DataSnapshot> publishedSnapshot() const;
+    quint64 version() const;
+
+    // Client mode: serve this data directory's tables from the clinicsiriusd
+    // instance listening on serverName, so that many processes share one
+    // parsed copy. Call before anything is read; false (and the directory
+    // is used as before) if the service does not answer.
+    bool connectToService(const QString& serverName);
+    bool isServiceClient() const;
+
+    // Tables by file name, for clinicsiriusd. applyRows() applies rows a
+    // client wrote if each one is still what the client based it on, and
+    // queues them as one batch for the storage thread: it returns Queued
+    // with written set to that write's future, or Conflict or Failed at
+    // once. Once written has come back false, failedWriteStatus() tells
+    // whether another writer got to the rows first.
+    bool tableRecords(const QString& table, QJsonArray& records) const;
+    QJsonObject currentRecord(const QString& table, int id) const;
+    int claimTableIds(const QString& table, int count);
+    JournalWrite::Status applyRows(const QList<StagedRow>& batch, QFuture<bool>& written);
+    JournalWrite::Status failedWriteStatus(const QList<StagedRow>& batch) const;
+
+    // getNext*Id() reserve a single id from the table's sequence, so two
+    // callers never receive the same one even before either row is added:
+    // every call uses up an id, whether or not a row gets it. Reserve count
+    // consecutive ids for a bulk insert; returns the first.
+    int reserveScheduleIds(int count);
+    int reserveAppointmentIds(int count);
     
     QList<Patient> getAllPatients() const;
     Patient getPatientById(int id) const;
@@ -18,10 +525,10 @@ public:
     void updatePatient(const Patient& patient);
     void deletePatient(int id);
     bool patientExists(int id) const;
-    bool emailExists(const QString& email) const;
+    bool emailExists(const QString& email) const;  // used by any role
     bool snilsExists(const QString& snils) const;
     bool omsExists(const QString& oms) const;
-    int getNextPatientId() const;
+    int getNextPatientId();
     
     QList<Doctor> getAllDoctors() const;
     Doctor getDoctorById(int id) const;
@@ -37,16 +544,33 @@ public:
     bool isRoomUsed(int id) const;
     
     QList<Appointment> getAllAppointments() const;
+    // Read-only column view for statistics; valid until the next mutation.
+    const AppointmentColumns& getAppointmentColumns() const;
+    // Appointment counts by day, doctor, specialization, room and completion,
+    // maintained on every appointment, doctor and schedule change.
+    const StatisticsRollup& getStatisticsRollup() const;
     QList<Appointment> getPatientAppointments(int patientId) const;
     Appointment getAppointmentById(int id) const;
+    Appointment getAppointmentByScheduleId(int scheduleId) const;
     void addAppointment(const Appointment& appointment);
     void updateAppointment(const Appointment& appointment);
     void deleteAppointment(int id);
-    int getNextAppointmentId() const;
+    int getNextAppointmentId();
+    // Check that the slot is free, create the appointment and mark the slot
+    // booked as one journal batch; if another process booked the slot
+    // before the batch reached disk, nothing is kept and SlotTaken is
+    // returned. moveToSlot() does the same for an existing appointment and
+    // frees its old slot. Inside a transaction the outermost commit writes
+    // the batch, so only the checks made here are reported.
+    BookingResult bookSlot(int scheduleId, int patientId);
+    BookingResult moveToSlot(int appointmentId, int scheduleId);
     
     QList<AppointmentSchedule> getAllSchedules() const;
     QList<AppointmentSchedule> getDoctorSchedules(int doctorId) const;
+    // Free future slots in start order: all of them, or those of one day.
     QList<AppointmentSchedule> getAvailableSchedules(int doctorId) const;
+    QList<AppointmentSchedule> getAvailableSchedules(int doctorId, const QDate& day) const;
+    QSet<QDate> getAvailableDays(int doctorId) const;
     QList<AppointmentSchedule> getSchedulesByRoom(int roomId) const;
     QList<Appointment> getAppointmentsByDoctor(int doctorId) const;
     
@@ -57,17 +581,17 @@ public:
     void removeFamilyMember(int id_patient_group);
     bool isFamilyMember(int parentId, int childId) const;
     bool isPatientInAnyFamily(int patientId) const;
-    int getNextPatientGroupId() const;
+    int getNextPatientGroupId();
     
     QList<Diagnosis> getAllDiagnoses() const;
     Diagnosis getDiagnosisById(int id) const;
     void addDiagnosis(const Diagnosis& diagnosis);
-    int getNextDiagnosisId() const;
+    int getNextDiagnosisId();
     
     QList<Recipe> getAllRecipes() const;
     Recipe getRecipeByAppointmentId(int appointmentId) const;
     void addRecipe(const Recipe& recipe);
-    int getNextRecipeId() const;
+    int getNextRecipeId();
     
     bool doctorExists(int id) const;
     
@@ -78,27 +602,30 @@ public:
     void addManager(const Manager& manager);
     void updateManager(const Manager& manager);
     void deleteManager(int id);
-    int getNextManagerId() const;
+    int getNextManagerId();
     
     void addDoctor(const Doctor& doctor);
     void updateDoctor(const Doctor& doctor);
     void deleteDoctor(int id);
-    int getNextDoctorId() const;
+    int getNextDoctorId();
     
     AppointmentSchedule getScheduleById(int id) const;
     void addSchedule(const AppointmentSchedule& schedule);
+    QList<ScheduleBatchResult> addSchedules(const QList<AppointmentSchedule>& schedules);
     bool canAddSchedule(const AppointmentSchedule& schedule) const;
+    bool doctorHasOverlap(int doctorId, const QDateTime& from, const QDateTime& to, int ignoreScheduleId = -1) const;
+    bool roomHasOverlap(int roomId, const QDateTime& from, const QDateTime& to, int ignoreScheduleId = -1) const;
     void updateSchedule(const AppointmentSchedule& schedule);
     void deleteSchedule(int id);
-    int getNextScheduleId() const;
+    int getNextScheduleId();
     
     void addSpecialization(const Specialization& spec);
     void deleteSpecialization(int id);
-    int getNextSpecializationId() const;
+    int getNextSpecializationId();
     
     void addRoom(const Room& room);
     void deleteRoom(int id);
-    int getNextRoomId() const;
+    int getNextRoomId();
     
     void updateDiagnosis(const Diagnosis& diagnosis);
     bool isDiagnosisUsed(int id) const;
@@ -111,6 +638,9 @@ public:
     bool adminLoginByEmail(const QString& email, const QString& password) const;
     void updateAdmin(const Admin& admin);
     
+    // Account of any role matching email and password; id is -1 on failure.
+    Credential authenticate(const QString& email, const QString& password) const;
+
     bool patientLoginByEmail(const QString& email, const QString& password) const;
     bool doctorLoginByEmail(const QString& email, const QString& password) const;
     bool managerLoginByEmail(const QString& email, const QString& password) const;
@@ -122,13 +652,71 @@ public:
     QList<InvitationCode> getInvitationCodes(int parentId) const;
     InvitationCode getInvitationCodeByCode(const QString& code) const;
     void useInvitationCode(const QString& code, int invitedUserId);
-    int getNextInvitationCodeId() const;
+    int getNextInvitationCodeId();
 
 private:
     QString dataPath;
+    QSharedPointer<DataStore> store;
     
     QJsonArray loadJson(const QString& filename) const;
-    void saveJson(const QString& filename, const QJsonArray& data);
+    QString journalPath() const;
+    void readJournal() const;
+    void stageJournal(const QString& table, const QString& op, int id, const QJsonObject& record,
+                      const QJsonObject& base);
+    bool commit(bool reportFailure = true);
+    QFuture<bool> writeJournal(bool reportFailure);
+    QFuture<bool> writeBatch(const QSharedPointer<JournalWrite>& write);
+    QFuture<bool> sendBatch(const QSharedPointer<JournalWrite>& write);
+    void finishWrite(const QSharedPointer<JournalWrite>& write);
+    void settleWrites();
+    void pullChanges();
+    void applyEntry(const QString& table, const QString& op, int id, const QJsonObject& record);
+    void dropRemovedRows();
+    QFuture<bool> writeSnapshots(bool reportFailure);
+    QFuture<bool> enqueueWrite(const std::function<bool()>& job, const std::function<void(bool)>& done) const;
+    void emitChanges();
+    void readSequences() const;
+    bool loadRollup() const;
+    void saveRollup() const;
+    const AvailabilityIndex& availability(int doctorId) const;
+    const QVector<Credential>& credentialsFor(const QString& email) const;
+    bool loginAs(LoginUser::UserType role, const QString& email, const QString& password) const;
+    int accountIdByEmail(LoginUser::UserType role, const QString& email) const;
+    QList<AppointmentSchedule> availableBetween(int doctorId, const QDate& first, const QDate& last) const;
+
+    template <typename T>
+    const QList<T>& rows(TableCache<T>& table) const;
+    template <typename T>
+    T rowById(TableCache<T>& table, int id) const;
+    template <typename T>
+    bool hasRow(TableCache<T>& table, int id) const;
+    template <typename T>
+    QList<T> rowsByKey(TableCache<T>& table, const QMultiHash<int, int>& index, int key) const;
+    template <typename T>
+    int reserveIds(TableCache<T>& table, int count);
+    template <typename T>
+    void insertRow(TableCache<T>& table, const T& row);
+    template <typename T>
+    bool replaceRow(TableCache<T>& table, const T& row);
+    template <typename T, typename Pred>
+    int removeRowsIf(TableCache<T>& table, Pred pred);
+    template <typename T>
+    void applyRow(TableCache<T>& table, int id, const QJsonObject& record);
+    template <typename T>
+    std::function<bool()> snapshotWriter(const TableCache<T>& table) const;
+};
+
+// Scoped transaction: rolls back on destruction unless committed.
+class DataTransaction {
+public:
+    explicit DataTransaction(DataManager& dm);
+    ~DataTransaction();
+    bool commit();
+    QFuture<bool> commitAsync();
+
+private:
+    DataManager& dm;
+    bool finished = false;
 };
 
 #endif
@@ -0,0 +1,89 @@
+#ifndef DATASERVICE_H
+#define DATASERVICE_H
+
+#include <QObject>
+#include <QLocalSocket>
+#include <QByteArray>
+#include <QCborArray>
+#include <QHash>
+#include <QList>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <functional>
+#include "datamanager.h"
+
+// Wire format between clinicsiriusd and its clients over a local socket.
+// A message is a CBOR array [type, request id, arguments...], preceded by
+// its size as a big-endian quint32. A reply carries the id of its request;
+// a Write is answered once its batch is on disk, so its reply may come
+// after those of later requests. Changed is pushed unasked, with request
+// id 0.
+namespace DataProtocol {
+
+enum Message {
+    FetchTable = 1,  // [table] -> Reply [ok, rows]
+    ClaimIds,        // [table, count] -> Reply [first id, -1 on failure]
+    Write,           // [[table, op, id, record, base]...] -> Reply [JournalWrite::Status]
+    Reply,
+    Changed          // [table, id, record]; an empty record means deleted
+};
+
+const char* const kDefaultServerName = "clinicsirius";
+
+void appendFrame(QByteArray& out, const QCborArray& message);
+// Takes the next whole message off the front of buffer; false while only
+// part of one has arrived.
+bool takeFrame(QByteArray& buffer, QCborArray& message);
+
+QCborArray encodeRows(const QList<StagedRow>& rows);
+QList<StagedRow> decodeRows(const QCborArray& rows);
+
+}  // namespace DataProtocol
+
+// One row another client changed, as pushed by the server.
+struct ServiceChange {
+    QString table;
+    int id = -1;
+    QJsonObject record;  // empty when the row was deleted
+};
+
+// Client end of the data service, used by DataManager in client mode.
+// Reads block until answered, like the file reads they replace; a write is
+// answered through its callback, from the event loop or from inside any of
+// the blocking calls. Pushed changes are kept until takeChanges(), and
+// changesAvailable() tells the owner to apply them where that is safe.
+class DataServiceClient : public QObject {
+    Q_OBJECT
+public:
+    explicit DataServiceClient(QObject* parent = nullptr);
+
+    bool connectToServer(const QString& name, int timeoutMs = 1000);
+    bool isConnected() const;
+
+    bool fetchTable(const QString& table, QJsonArray& rows);
+    int claimIds(const QString& table, int count);
+    void write(const QList<StagedRow>& rows, const std::function<void(int status)>& done);
+    // Blocks until every write sent so far is answered or the connection
+    // is gone.
+    void waitForWrites();
+    QList<ServiceChange> takeChanges();
+
+signals:
+    void changesAvailable();
+
+private:
+    int send(DataProtocol::Message type, const QCborArray& args);
+    bool waitForReply(int request, QCborArray& reply);
+    void readMessages();
+    void dispatch(const QCborArray& message);
+    void dropConnection();
+
+    QLocalSocket socket;
+    QByteArray buffer;
+    int lastRequest = 0;
+    QHash<int, std::function<void(int)>> writes;
+    QHash<int, QCborArray> replies;  // answers to blocking requests, by request id
+    QList<ServiceChange> changes;
+};
+
+#endif // DATASERVICE_H
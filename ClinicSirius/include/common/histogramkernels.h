@@ -0,0 +1,39 @@
+#ifndef HISTOGRAMKERNELS_H
+#define HISTOGRAMKERNELS_H
+
+#include <QtGlobal>
+
+// Counting kernels over contiguous timestamp arrays, such as the date column
+// of AppointmentColumns (local minutes from Julian day 0). Every kernel makes
+// a single pass over the input. On x86 builds with GCC or Clang an AVX2 or
+// SSE4.2 path is picked at runtime, otherwise a scalar loop runs; all paths
+// give identical results. Define CLINIC_NO_SIMD to force the scalar path.
+class HistogramKernels {
+public:
+    static const qint64 MinutesPerDay = 1440;
+
+    // Number of values in [from, to).
+    static qint64 countInRange(const qint64 *values, qint64 n, qint64 from, qint64 to);
+
+    // counts[i] += number of values in [origin + i*width, origin + (i+1)*width)
+    // for 0 <= i < buckets; values outside that span are ignored.
+    static void fixedWidthHistogram(const qint64 *values, qint64 n, qint64 origin, qint64 width,
+                                    qint32 *counts, int buckets);
+
+    // Calendar histograms over minute timestamps. Days and weeks are given as
+    // Julian day numbers (firstMonday must be a Monday); monthStarts holds
+    // months + 1 ascending Julian days, the last one ending the final month.
+    static void dayHistogram(const qint64 *minutes, qint64 n, qint64 firstDay, int days, qint32 *counts);
+    static void weekHistogram(const qint64 *minutes, qint64 n, qint64 firstMonday, int weeks, qint32 *counts);
+    static void monthHistogram(const qint64 *minutes, qint64 n, const qint64 *monthStarts, int months,
+                               qint32 *counts);
+
+    // "avx2", "sse4.2" or "scalar": the path the kernels run on this CPU.
+    static const char *activePath();
+    // Runs the kernels on the named path from now on, for comparing the
+    // paths in tests; false, and nothing changes, if this build or CPU
+    // cannot run it. Not to be called while kernels run on other threads.
+    static bool usePath(const char *name);
+};
+
+#endif // HISTOGRAMKERNELS_H
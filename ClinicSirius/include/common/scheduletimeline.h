@@ -0,0 +1,112 @@
+#ifndef SCHEDULETIMELINE_H
+#define SCHEDULETIMELINE_H
+
+#include <QAbstractScrollArea>
+#include <QDate>
+#include <QDateTime>
+#include <QColor>
+#include <QStringList>
+#include <QVector>
+#include <functional>
+#include "models.h"
+
+// One slot on the timeline. lane picks the column inside a day when several
+// schedules are shown side by side (e.g. one lane per doctor).
+struct ScheduleBlock {
+    int scheduleId = -1;
+    int lane = 0;
+    QDateTime from;
+    QDateTime to;
+    QString text;
+    QColor color;
+};
+
+// Week/month schedule grid: days left to right, time of day top to bottom.
+// Blocks are painted straight from a sorted list, so nothing is rebuilt on
+// scrolling, zooming or changing the grid step, and painting and hit tests
+// only touch the blocks of the visible days (found by binary search).
+// Ctrl+wheel zooms the time axis, Ctrl+Shift+wheel the number of visible days.
+class ScheduleTimeline : public QAbstractScrollArea {
+    Q_OBJECT
+
+public:
+    explicit ScheduleTimeline(QWidget *parent = nullptr);
+
+    // Text and color of a slot by its status, as all schedule views show it.
+    static ScheduleBlock blockFor(const AppointmentSchedule &schedule, int lane = 0);
+
+    // Replaces the blocks. The scrollable range covers all of them plus a few
+    // weeks around today; the visible dates do not move.
+    void setBlocks(QVector<ScheduleBlock> blocks);
+    // Names of the lanes inside a day; one unnamed lane if empty.
+    void setLanes(const QStringList &names);
+    // Shown instead of the grid, e.g. while nothing is selected; empty hides it.
+    void setPlaceholderText(const QString &text);
+    // Tooltip of a block, asked for only when the tooltip is shown.
+    void setToolTipProvider(const std::function<QString(int scheduleId)> &provider);
+
+    // Grid step in minutes; a step is one row high.
+    void setMinutesPerRow(int minutes);
+    void setVisibleDays(int days);
+    void scrollToDate(const QDate &date);
+    QDate firstVisibleDate() const;
+    int visibleDays() const { return daysVisible; }
+
+    int selectedScheduleId() const { return selectedId; }
+
+signals:
+    void blockClicked(int scheduleId);
+    void blockDoubleClicked(int scheduleId);
+    void blockContextMenuRequested(int scheduleId, const QPoint &globalPos);
+    void firstVisibleDateChanged(const QDate &date);
+
+protected:
+    void paintEvent(QPaintEvent *event) override;
+    void resizeEvent(QResizeEvent *event) override;
+    void scrollContentsBy(int dx, int dy) override;
+    void mousePressEvent(QMouseEvent *event) override;
+    void mouseDoubleClickEvent(QMouseEvent *event) override;
+    void contextMenuEvent(QContextMenuEvent *event) override;
+    void wheelEvent(QWheelEvent *event) override;
+    bool viewportEvent(QEvent *event) override;
+
+private:
+    // A block in grid coordinates; sorted by (day, lane, start)
+    struct Cell {
+        int day;     // days from rangeStart
+        int lane;
+        int start;   // minutes from midnight
+        int end;
+        int index;   // into blocks
+    };
+
+    QRect gridRect() const;
+    int dayWidth() const;
+    int laneCount() const { return qMax(1, laneNames.size()); }
+    double minuteHeight() const { return double(rowHeight) / minutesPerRow; }
+    int yForMinute(int minute) const;
+    int blockAt(const QPoint &pos) const;
+    void cellRange(int day, int lane, const Cell *&first, const Cell *&last) const;
+    void extendRange(const QDate &first, const QDate &last);
+    void updateScrollBars();
+    void notifyFirstVisibleDate();
+
+    QVector<ScheduleBlock> blocks;
+    QVector<Cell> cells;
+    int longestBlockMinutes = 0;
+    QStringList laneNames;
+    QString placeholder;
+    std::function<QString(int)> toolTipProvider;
+
+    QDate rangeStart;            // a Monday
+    int rangeDays = 0;
+    int daysVisible = 7;
+    int minutesPerRow = 20;
+    int rowHeight = 32;
+    int dayStartMinute = 6 * 60;
+    int dayEndMinute = 22 * 60;
+    int selectedId = -1;
+    QDate lastNotifiedDate;
+};
+
+#endif // SCHEDULETIMELINE_H
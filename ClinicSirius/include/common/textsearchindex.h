@@ -0,0 +1,45 @@
+#ifndef TEXTSEARCHINDEX_H
+#define TEXTSEARCHINDEX_H
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QByteArray>
+#include <functional>
+
+// Substring search over the text fields of a table (patients by name, email,
+// phone, SNILS, OMS, ...). Both sides are folded (case, ё -> е), so "ПЕТР"
+// finds "Пётр". Every one-, two- and three-character gram of the text is
+// indexed; a query is looked up by its trigrams (or by itself when shorter)
+// and only the documents holding all of them are checked on the text. When
+// the query extends the previous one, only the previous matches are checked.
+class TextSearchIndex {
+public:
+    // Indexes count documents; fieldsOf(i) returns the fields of document i.
+    void build(int count, const std::function<QStringList(int)> &fieldsOf);
+    void clear();
+    int size() const { return textStarts.isEmpty() ? 0 : textStarts.size() - 1; }
+
+    // Documents whose fields contain the query, ascending. An empty query
+    // matches every document.
+    QVector<int> search(const QString &query);
+
+    static QString fold(const QString &text);
+
+private:
+    int postingBytes(int bucket) const { return postingStarts[bucket + 1] - postingStarts[bucket]; }
+    QVector<int> decodePostings(int bucket) const;
+    void intersectPostings(QVector<int> &candidates, int bucket) const;
+    bool documentContains(int doc, const QByteArray &needle) const;
+
+    QByteArray texts;            // folded fields as UTF-8, '\n' between fields
+    QVector<int> textStarts;     // offsets into texts, size() + 1 entries
+    int bucketBits = 0;          // trigrams are hashed into 2^bucketBits buckets
+    QVector<int> postingStarts;  // offsets into postings, one per bucket + 1
+    QVector<quint64> bucketKeys; // the gram of each bucket, or a marker if none or several
+    QByteArray postings;         // ascending document numbers, delta + varint coded
+    QString lastQuery;           // folded
+    QVector<int> lastMatches;
+};
+
+#endif // TEXTSEARCHINDEX_H
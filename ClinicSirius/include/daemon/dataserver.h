@@ -0,0 +1,40 @@
+#ifndef DATASERVER_H
+#define DATASERVER_H
+
+#include <QObject>
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QCborArray>
+#include <QHash>
+#include <QSet>
+#include <QPair>
+#include "datamanager.h"
+
+// Server end of the data service: answers DataServiceClient requests from
+// one DataManager and pushes every committed row to the other clients.
+// All clients share the tables parsed once here, and the journal in the
+// data directory stays the only thing written to disk.
+class DataServer : public QObject {
+    Q_OBJECT
+public:
+    explicit DataServer(DataManager& data, QObject* parent = nullptr);
+
+    bool listen(const QString& name);
+
+private:
+    void onNewConnection();
+    void readMessages(QLocalSocket* client);
+    void handle(QLocalSocket* client, const QCborArray& message);
+    void reply(QLocalSocket* client, int request, const QCborArray& args);
+    void broadcast(const QString& table, int id);
+
+    DataManager& data;
+    QLocalServer server;
+    QHash<QLocalSocket*, QByteArray> buffers;
+    // Client whose batch is being committed and the rows in it: it has
+    // them already, so they are not pushed back to it
+    QLocalSocket* writer = nullptr;
+    QSet<QPair<QString, int>> writerRows;
+};
+
+#endif // DATASERVER_H
@@ -29,7 +29,7 @@ private:
     void loadRooms();
 
     int doctorId;
-    DataManager dataManager;
+    DataManager& dataManager;
 
     QDateEdit *dateEdit;
     QTimeEdit *startTimeEdit;
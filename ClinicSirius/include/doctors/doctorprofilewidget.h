@@ -32,7 +32,7 @@ private:
     void loadProfile();
 
     LoginUser currentUser;
-    DataManager dataManager;
+    DataManager& dataManager;
 
     QTabWidget *tabs;
 
@@ -44,7 +44,7 @@ private:
     int mode; // 0 = visit, 1 = booking
     int currentAppointmentId = -1;
 
-    DataManager dataManager;
+    DataManager& dataManager;
 
     // Visit mode widgets
     QComboBox *patientCombo = nullptr;
@@ -3,7 +3,6 @@
 
 #include <QWidget>
 #include <QStackedWidget>
-#include <QTableWidget>
 #include <QPushButton>
 #include <QDate>
 #include <QVBoxLayout>
@@ -11,6 +10,7 @@
 #include <QSpinBox>
 #include "models.h"
 #include "datamanager.h"
+#include "scheduletimeline.h"
 
 class DoctorVisitDialog;
 
@@ -31,15 +31,17 @@ private slots:
     void onProfileClicked();
     void onSettingsClicked();
 
-    void onCellClicked(int row, int column);
-    void onCellDoubleClicked(int row, int column);
+    void onBlockClicked(int scheduleId);
+    void onBlockDoubleClicked(int scheduleId);
     void loadSchedule();
     void onBackFromSchedule();
     void onPrevWeek();
     void onNextWeek();
     void onToday();
+    void onFirstVisibleDateChanged(const QDate &date);
 
     void onVisitCompleted();
+    void onScheduleChanged(int scheduleId);
 
 private:
     void buildMainPage();
@@ -49,7 +51,7 @@ private:
     void populateScheduleTable();
 
     LoginUser currentUser;
-    DataManager dataManager;
+    DataManager& dataManager;
 
     QStackedWidget *stackedWidget;
     int mainPageIndex;
@@ -61,10 +63,10 @@ private:
     QPushButton *bookAppointmentButton;
 
     QSpinBox *timeSlotDurationSpinBox = nullptr;
-    int selectedIntervalMinutes = 20;
+    bool scheduleReloadQueued = false;
 
     QLabel *scheduleTitleLabel;
-    QTableWidget *scheduleTable;
+    ScheduleTimeline *scheduleTimeline;
     QPushButton *bookFromScheduleButton;
     QPushButton *backButton;
     QPushButton *deleteSlotButton;
@@ -73,7 +75,6 @@ private:
     QPushButton *nextWeekButton;
     QPushButton *todayButton;
     QLabel *weekLabel;
-    QDate scheduleStartDate;
 };
 
 #endif
@@ -22,7 +22,7 @@ private:
     void populateCompleter();
     void openAppointmentDetails(int appointmentId);
 
-    DataManager m_dataManager;
+    DataManager& m_dataManager;
     QLineEdit *m_searchEdit;
     QPushButton *m_searchButton;
     QListWidget *m_patientsList;
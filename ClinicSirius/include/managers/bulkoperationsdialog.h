@@ -26,7 +26,7 @@ private:
     void loadDoctors();
     void loadRooms();
     
-    DataManager m_dataManager;
+    DataManager& m_dataManager;
     QLineEdit* m_doctorEdit;
     QCompleter* m_doctorCompleter;
     QComboBox* m_roomCombo;
@@ -25,7 +25,7 @@ private:
     void loadManagerInfo();
 
     LoginUser m_user;
-    DataManager m_dataManager;
+    DataManager& m_dataManager;
     
     QLabel* m_userIdLabel;
     QLineEdit* m_firstNameEdit;
@@ -3,7 +3,6 @@
 
 #include <QWidget>
 #include <QLineEdit>
-#include <QTableWidget>
 #include <QCompleter>
 #include <QDate>
 #include <QLabel>
@@ -11,6 +10,7 @@
 #include <QSpinBox>
 #include <QList>
 #include "common/datamanager.h"
+#include "common/scheduletimeline.h"
 
 class ManagerScheduleViewer : public QWidget {
     Q_OBJECT
@@ -27,28 +27,34 @@ private slots:
     void onNextWeek();
     void onToday();
     void onIntervalChanged(int value);
-    void onTableContextMenu(const QPoint &pos);
+    void onBlockClicked(int scheduleId);
+    void onBlockContextMenu(int scheduleId, const QPoint &globalPos);
+    void onFirstVisibleDateChanged(const QDate &date);
+    void onScheduleChanged(int scheduleId);
 
 private:
     void buildUI();
     void loadDoctors();
-    void loadScheduleForDoctor(int doctorId);
+    void loadSchedules();
     void applyDoctorFilter(const QString &text);
+    QString scheduleToolTip(int scheduleId) const;
     QDate getMondayOfWeek(const QDate &date) const;
 
     // Use pointer to shared DataManager so viewers share the same data source
     DataManager *m_dataManager = nullptr;
     QLineEdit *m_filterEdit;
     QCompleter *m_doctorCompleter;
-    QTableWidget *m_scheduleTable;
+    ScheduleTimeline *m_timeline;
     QPushButton *m_prevBtn;
     QPushButton *m_nextBtn;
     QPushButton *m_todayBtn;
     QSpinBox *m_intervalSpin;
     QLabel *m_weekLabel;
-    QDate m_startDate;
     QList<Doctor> m_allDoctors;
-    int m_currentDoctorId = -1;
+    // Doctors whose schedules are shown, one lane each
+    QList<int> m_doctorIds;
+    static const int kMaxDoctorLanes = 8;
+    bool m_reloadQueued = false;
     int m_timeIntervalMinutes = 20;
 };
 
@@ -43,7 +43,7 @@ private:
     QWidget* createSidebarWidget();
     void updateSidebarHighlight(int pageIndex);
 
-    DataManager m_dataManager;
+    DataManager& m_dataManager;
     LoginUser m_user;
 
     // Main layout and stacked pages
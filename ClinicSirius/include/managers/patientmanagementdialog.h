@@ -26,7 +26,7 @@ private:
     void buildUI();
     void showAddToFamilyDialog();
 
-    DataManager m_dataManager;
+    DataManager& m_dataManager;
     QLineEdit* m_searchEdit;
     QTableWidget* m_patientTable;
     QPushButton* m_createBtn;
@@ -3,7 +3,6 @@
 
 #include <QWidget>
 #include <QLineEdit>
-#include <QTableWidget>
 #include <QCompleter>
 #include <QDate>
 #include <QLabel>
@@ -11,6 +10,7 @@
 #include <QSpinBox>
 #include <QList>
 #include "common/datamanager.h"
+#include "common/scheduletimeline.h"
 
 class RoomScheduleViewer : public QWidget {
     Q_OBJECT
@@ -23,27 +23,31 @@ private slots:
     void onNextWeek();
     void onToday();
     void onIntervalChanged(int value);
-    void onTableContextMenu(const QPoint &pos);
+    void onBlockClicked(int scheduleId);
+    void onBlockContextMenu(int scheduleId, const QPoint &globalPos);
+    void onFirstVisibleDateChanged(const QDate &date);
+    void onScheduleChanged(int scheduleId);
 
 private:
     void buildUI();
     void loadRooms();
     void loadScheduleForRoom(int roomId);
     void applyRoomFilter(const QString &text);
+    QString scheduleToolTip(int scheduleId) const;
     QDate getMondayOfWeek(const QDate &date) const;
 
-    DataManager m_dataManager;
+    DataManager& m_dataManager;
     QLineEdit *m_filterEdit;
     QCompleter *m_roomCompleter;
-    QTableWidget *m_scheduleTable;
+    ScheduleTimeline *m_timeline;
     QPushButton *m_prevBtn;
     QPushButton *m_nextBtn;
     QPushButton *m_todayBtn;
     QSpinBox *m_intervalSpin;
     QLabel *m_weekLabel;
-    QDate m_startDate;
     QList<Room> m_allRooms;
     int m_currentRoomId = -1;
+    bool m_reloadQueued = false;
     int m_timeIntervalMinutes = 20;
 };
 
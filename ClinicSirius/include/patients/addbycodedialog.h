@@ -35,7 +35,7 @@ private slots:
 private:
     void setupUI();
 
-    DataManager dataManager;
+    DataManager& dataManager;
     int patientId;              // ID пациента, который присоединяется
     int headPatientId;          // ID главы семьи
 
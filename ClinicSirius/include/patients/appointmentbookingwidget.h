@@ -75,7 +75,7 @@ private:
     void showPatientSelection();
     void showConfirmation();
 
-    DataManager m_dataManager;
+    DataManager& m_dataManager;
     QStackedWidget* m_stackedWidget;
     QLabel* m_titleLabel;
     QLabel* m_progressLabel;
@@ -93,7 +93,6 @@ private:
     // REQ-017: Reschedule mode
     bool m_isRescheduleMode = false;
     int m_rescheduleAppointmentId = -1;
-    int m_oldScheduleId = -1;
 };
 
 #endif // APPOINTMENTBOOKINGWIDGET_H
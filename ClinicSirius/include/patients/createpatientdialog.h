@@ -28,7 +28,7 @@ private:
     bool editMode = false;
     int editingPatientId = 0;
 
-    DataManager dataManager;
+    DataManager& dataManager;
     Patient createdPatient;
 
     QLineEdit *firstNameEdit;
@@ -32,7 +32,7 @@ private:
     void populatePatientSelector();
     void updatePatientSelector(int selectedPatientId = -1);
 
-    DataManager m_dataManager;
+    DataManager& m_dataManager;
     LoginUser m_currentUser;
     int m_selectedPatientId = -1;
 
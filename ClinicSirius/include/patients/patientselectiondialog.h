@@ -24,7 +24,7 @@ private:
     void buildUI();
     void updatePatientList(const QString &filter = QString());
 
-    DataManager m_dataManager;
+    DataManager& m_dataManager;
     QLineEdit *m_searchEdit = nullptr;
     QListWidget *m_patientList = nullptr;
     QPushButton *m_createBtn = nullptr;
@@ -44,7 +44,7 @@ private:
     void connectSignals();
 
     LoginUser currentUser;
-    DataManager dataManager;
+    DataManager& dataManager;
 
     QTabWidget *tabs;
 
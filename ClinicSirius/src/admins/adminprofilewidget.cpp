@@ -6,7 +6,7 @@
 #include <QIcon>
 
 AdminProfileWidget::AdminProfileWidget(QWidget *parent)
-    : QWidget(parent), m_dataManager(QString()) {
+    : QWidget(parent), m_dataManager(DataManager::shared()) {
     buildUI();
 }
 
@@ -12,6 +12,7 @@
 #include <QMessageBox>
 #include <QCoreApplication>
 #include <QHeaderView>
+#include <QTimer>
 #include <QScrollArea>
 #include <QIcon>
 #include <QGroupBox>
@@ -19,12 +20,50 @@
 #include "admins/patientappointmentsviewer.h"
 #include "managers/managerscheduleviewer.h"
 
+// Shared setup of the read-only record tables: sorting and filtering go
+// through a proxy, and rows have a fixed height so the view never measures
+// rows it does not show.
+static RecordFilterProxyModel *setupRecordView(QTableView *view, SearchableRecordModel *model) {
+    RecordFilterProxyModel *proxy = new RecordFilterProxyModel(view);
+    proxy->setSourceModel(model);
+    view->setModel(proxy);
+    view->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    view->setSelectionBehavior(QAbstractItemView::SelectRows);
+    view->setSelectionMode(QAbstractItemView::SingleSelection);
+    view->setSortingEnabled(true);
+    view->sortByColumn(0, Qt::AscendingOrder);
+    view->verticalHeader()->setSectionResizeMode(QHeaderView::Fixed);
+    // ID and text columns sized to contents (sampled, not every row), last column stretches
+    QHeaderView *header = view->horizontalHeader();
+    header->setResizeContentsPrecision(500);
+    for (int col = 0; col < model->columnCount(); ++col) {
+        header->setSectionResizeMode(col, col + 1 < model->columnCount() ? QHeaderView::ResizeToContents
+                                                                         : QHeaderView::Stretch);
+    }
+    return proxy;
+}
+
+// Applies a search box once typing pauses rather than on every keystroke.
+static void connectDebouncedSearch(QLineEdit *edit, const std::function<void(const QString &)> &apply) {
+    QTimer *timer = new QTimer(edit);
+    timer->setSingleShot(true);
+    timer->setInterval(150);
+    QObject::connect(edit, &QLineEdit::textChanged, timer, [timer]() { timer->start(); });
+    QObject::connect(timer, &QTimer::timeout, edit, [edit, apply]() { apply(edit->text()); });
+}
+
+// ID of the selected row, or -1; column 0 of every record table holds the ID.
+static int currentRecordId(const QTableView *view) {
+    QModelIndex index = view->currentIndex();
+    if (!index.isValid()) return -1;
+    return index.sibling(index.row(), 0).data().toInt();
+}
+
 // Implementation of AdminWidget
 AdminWidget::AdminWidget(QWidget *parent)
     : QWidget(parent)
 {
-    QString dataPath = QCoreApplication::applicationDirPath() + "/../data";
-    dataManager = new DataManager(dataPath);
+    dataManager = &DataManager::shared();
     buildUI();
 
     loadDoctors();
@@ -52,10 +91,18 @@ void AdminWidget::buildUI() {
     doctorsSearchEdit = new QLineEdit();
     doctorsSearchEdit->setPlaceholderText("Поиск врачей по имени, email, ID...");
     dlay->addWidget(doctorsSearchEdit);
-    doctorsTable = new QTableWidget();
-    doctorsTable->setEditTriggers(QAbstractItemView::NoEditTriggers); // CHANGED: Make table read-only
-    doctorsTable->setColumnCount(4);
-    doctorsTable->setHorizontalHeaderLabels({"ID", "ФИО", "Email", "Специализация"});
+    doctorsModel = new RecordTableModel<Doctor>({"ID", "ФИО", "Email", "Специализация"}, {
+        [](const Doctor &d) { return QVariant(d.id_doctor); },
+        [](const Doctor &d) { return QVariant(d.fullName()); },
+        [](const Doctor &d) { return QVariant(d.email); },
+        [this](const Doctor &d) { return QVariant(specializationNames.value(d.id_spec)); }
+    }, this);
+    doctorsModel->setSearchFields([this](const Doctor &d) {
+        return QStringList{QString::number(d.id_doctor), d.fullName(), d.email, d.phone_number,
+                           specializationNames.value(d.id_spec)};
+    });
+    doctorsTable = new QTableView();
+    doctorsProxy = setupRecordView(doctorsTable, doctorsModel);
     dlay->addWidget(doctorsTable);
     QHBoxLayout *dActions = new QHBoxLayout();
     addDoctorBtn = new QPushButton("Добавить");
@@ -82,12 +129,19 @@ void AdminWidget::buildUI() {
     patientsTab = new QWidget();
     QVBoxLayout *play = new QVBoxLayout(patientsTab);
     patientsSearchEdit = new QLineEdit();
-    patientsSearchEdit->setPlaceholderText("Поиск пациентов по имени, email, ID...");
+    patientsSearchEdit->setPlaceholderText("Поиск пациентов по имени, email, телефону, СНИЛС, ОМС, ID...");
     play->addWidget(patientsSearchEdit);
-    patientsTable = new QTableWidget();
-    patientsTable->setEditTriggers(QAbstractItemView::NoEditTriggers); // CHANGED: Make table read-only
-    patientsTable->setColumnCount(4);
-    patientsTable->setHorizontalHeaderLabels({"ID", "ФИО", "Email", "Телефон"});
+    patientsModel = new RecordTableModel<Patient>({"ID", "ФИО", "Email", "Телефон"}, {
+        [](const Patient &p) { return QVariant(p.id_patient); },
+        [](const Patient &p) { return QVariant(p.fullName()); },
+        [](const Patient &p) { return QVariant(p.email); },
+        [](const Patient &p) { return QVariant(p.phone_number); }
+    }, this);
+    patientsModel->setSearchFields([](const Patient &p) {
+        return QStringList{QString::number(p.id_patient), p.fullName(), p.email, p.phone_number, p.snils, p.oms};
+    });
+    patientsTable = new QTableView();
+    patientsProxy = setupRecordView(patientsTable, patientsModel);
     play->addWidget(patientsTable);
     QHBoxLayout *pActions = new QHBoxLayout();
     addPatientBtn = new QPushButton("Добавить");
@@ -116,10 +170,13 @@ void AdminWidget::buildUI() {
     managersSearchEdit = new QLineEdit();
     managersSearchEdit->setPlaceholderText("Поиск менеджеров по имени, email, ID...");
     mlay->addWidget(managersSearchEdit);
-    managersTable = new QTableWidget();
-    managersTable->setEditTriggers(QAbstractItemView::NoEditTriggers); // CHANGED: Make table read-only
-    managersTable->setColumnCount(3);
-    managersTable->setHorizontalHeaderLabels({"ID", "ФИО", "Email"});
+    managersModel = new RecordTableModel<Manager>({"ID", "ФИО", "Email"}, {
+        [](const Manager &m) { return QVariant(m.id); },
+        [](const Manager &m) { return QVariant(m.fullName()); },
+        [](const Manager &m) { return QVariant(m.email); }
+    }, this);
+    managersTable = new QTableView();
+    managersProxy = setupRecordView(managersTable, managersModel);
     mlay->addWidget(managersTable);
     QHBoxLayout *mActions = new QHBoxLayout();
     addManagerBtn = new QPushButton("Добавить");
@@ -155,12 +212,12 @@ void AdminWidget::buildUI() {
     specsSearchEdit->setPlaceholderText("Поиск специализаций...");
     specsSearchEdit->addAction(QIcon(":/images/icon-specialization.svg"), QLineEdit::LeadingPosition);
     specLayout->addWidget(specsSearchEdit);
-    specsTable = new QTableWidget();
-    specsTable->setEditTriggers(QAbstractItemView::NoEditTriggers);
-    specsTable->setSelectionBehavior(QAbstractItemView::SelectRows);
-    specsTable->setSelectionMode(QAbstractItemView::SingleSelection);
-    specsTable->setColumnCount(2);
-    specsTable->setHorizontalHeaderLabels({"ID", "Название"});
+    specsModel = new RecordTableModel<Specialization>({"ID", "Название"}, {
+        [](const Specialization &s) { return QVariant(s.id_spec); },
+        [](const Specialization &s) { return QVariant(s.name); }
+    }, this);
+    specsTable = new QTableView();
+    specsProxy = setupRecordView(specsTable, specsModel);
     specLayout->addWidget(specsTable);
     QHBoxLayout *specActions = new QHBoxLayout();
     addSpecBtn = new QPushButton("Добавить");
@@ -191,12 +248,12 @@ void AdminWidget::buildUI() {
     roomsSearchEdit->setPlaceholderText("Поиск кабинетов...");
     roomsSearchEdit->addAction(QIcon(":/images/icon-room.svg"), QLineEdit::LeadingPosition);
     roomLayout->addWidget(roomsSearchEdit);
-    roomsTable = new QTableWidget();
-    roomsTable->setEditTriggers(QAbstractItemView::NoEditTriggers);
-    roomsTable->setSelectionBehavior(QAbstractItemView::SelectRows);
-    roomsTable->setSelectionMode(QAbstractItemView::SingleSelection);
-    roomsTable->setColumnCount(2);
-    roomsTable->setHorizontalHeaderLabels({"ID", "Номер"});
+    roomsModel = new RecordTableModel<Room>({"ID", "Номер"}, {
+        [](const Room &r) { return QVariant(r.id_room); },
+        [](const Room &r) { return QVariant(r.room_number); }
+    }, this);
+    roomsTable = new QTableView();
+    roomsProxy = setupRecordView(roomsTable, roomsModel);
     roomLayout->addWidget(roomsTable);
     QHBoxLayout *roomActions = new QHBoxLayout();
     addRoomBtn = new QPushButton("Добавить");
@@ -227,12 +284,12 @@ void AdminWidget::buildUI() {
     diagSearchEdit->setPlaceholderText("Поиск диагнозов...");
     diagSearchEdit->addAction(QIcon(":/images/icon-diagnosis.svg"), QLineEdit::LeadingPosition);
     diagLayout->addWidget(diagSearchEdit);
-    diagTable = new QTableWidget();
-    diagTable->setEditTriggers(QAbstractItemView::NoEditTriggers);
-    diagTable->setSelectionBehavior(QAbstractItemView::SelectRows);
-    diagTable->setSelectionMode(QAbstractItemView::SingleSelection);
-    diagTable->setColumnCount(2);
-    diagTable->setHorizontalHeaderLabels({"ID", "Название"});
+    diagModel = new RecordTableModel<Diagnosis>({"ID", "Название"}, {
+        [](const Diagnosis &d) { return QVariant(d.id_diagnosis); },
+        [](const Diagnosis &d) { return QVariant(d.name); }
+    }, this);
+    diagTable = new QTableView();
+    diagProxy = setupRecordView(diagTable, diagModel);
     diagLayout->addWidget(diagTable);
     QHBoxLayout *diagActions = new QHBoxLayout();
     addDiagBtn = new QPushButton("Добавить");
@@ -274,61 +331,58 @@ void AdminWidget::buildUI() {
     connect(editDoctorBtn, &QPushButton::clicked, this, &AdminWidget::onEditDoctor);
     connect(deleteDoctorBtn, &QPushButton::clicked, this, &AdminWidget::onDeleteDoctor);
     connect(manageScheduleBtn, &QPushButton::clicked, this, &AdminWidget::onManageDoctorSchedule);
-    connect(doctorsSearchEdit, &QLineEdit::textChanged, this, &AdminWidget::onDoctorsFilterChanged);
+    connectDebouncedSearch(doctorsSearchEdit, [this](const QString &text) { onDoctorsFilterChanged(text); });
 
     connect(addPatientBtn, &QPushButton::clicked, this, &AdminWidget::onAddPatient);
     connect(editPatientBtn, &QPushButton::clicked, this, &AdminWidget::onEditPatient);
     connect(deletePatientBtn, &QPushButton::clicked, this, &AdminWidget::onDeletePatient);
     connect(viewAppointmentsBtn, &QPushButton::clicked, this, &AdminWidget::onViewPatientAppointments);
-    connect(patientsSearchEdit, &QLineEdit::textChanged, this, &AdminWidget::onPatientsFilterChanged);
+    connectDebouncedSearch(patientsSearchEdit, [this](const QString &text) { onPatientsFilterChanged(text); });
 
     connect(addManagerBtn, &QPushButton::clicked, this, &AdminWidget::onAddManager);
     connect(editManagerBtn, &QPushButton::clicked, this, &AdminWidget::onEditManager);
     connect(deleteManagerBtn, &QPushButton::clicked, this, &AdminWidget::onDeleteManager);
-    connect(managersSearchEdit, &QLineEdit::textChanged, this, &AdminWidget::onManagersFilterChanged);
+    connectDebouncedSearch(managersSearchEdit, [this](const QString &text) { onManagersFilterChanged(text); });
     
     connect(addSpecBtn, &QPushButton::clicked, this, &AdminWidget::onAddSpecialization);
     connect(editSpecBtn, &QPushButton::clicked, this, &AdminWidget::onEditSpecialization);
     connect(deleteSpecBtn, &QPushButton::clicked, this, &AdminWidget::onDeleteSpecialization);
-    connect(specsSearchEdit, &QLineEdit::textChanged, this, &AdminWidget::onSpecializationsFilterChanged);
+    connectDebouncedSearch(specsSearchEdit, [this](const QString &text) { onSpecializationsFilterChanged(text); });
 
     connect(addRoomBtn, &QPushButton::clicked, this, &AdminWidget::onAddRoom);
     connect(editRoomBtn, &QPushButton::clicked, this, &AdminWidget::onEditRoom);
     connect(deleteRoomBtn, &QPushButton::clicked, this, &AdminWidget::onDeleteRoom);
-    connect(roomsSearchEdit, &QLineEdit::textChanged, this, &AdminWidget::onRoomsFilterChanged);
+    connectDebouncedSearch(roomsSearchEdit, [this](const QString &text) { onRoomsFilterChanged(text); });
 
     connect(addDiagBtn, &QPushButton::clicked, this, &AdminWidget::onAddDiagnosis);
     connect(editDiagBtn, &QPushButton::clicked, this, &AdminWidget::onEditDiagnosis);
     connect(deleteDiagBtn, &QPushButton::clicked, this, &AdminWidget::onDeleteDiagnosis);
-    connect(diagSearchEdit, &QLineEdit::textChanged, this, &AdminWidget::onDiagnosesFilterChanged);
+    connectDebouncedSearch(diagSearchEdit, [this](const QString &text) { onDiagnosesFilterChanged(text); });
     
-    // Auto-refresh statistics on tab switch
+    // Refresh statistics on tab switch, but only after the data changed
+    auto markStale = [this]() { statisticsStale = true; };
+    DataEvents *events = dataManager->events();
+    connect(events, &DataEvents::appointmentChanged, this, markStale);
+    connect(events, &DataEvents::scheduleChanged, this, markStale);
+    connect(events, &DataEvents::patientChanged, this, markStale);
+    connect(events, &DataEvents::doctorChanged, this, markStale);
     connect(tabs, QOverload<int>::of(&QTabWidget::currentChanged), this, [this](int idx) {
-        if (tabs->widget(idx) == statisticsTab) {
+        if (tabs->widget(idx) == statisticsTab && statisticsStale) {
+            statisticsStale = false;
             statisticsWidget->refresh();
         }
     });
 }
 
 void AdminWidget::loadDoctors() {
-    doctorsTable->setRowCount(0);
-    allDoctors = dataManager->getAllDoctors();
-    doctorsTable->setRowCount(allDoctors.size());
-    int r = 0;
-    for (const Doctor &d : allDoctors) {
-        doctorsTable->setItem(r, 0, new QTableWidgetItem(QString::number(d.id_doctor)));
-        doctorsTable->setItem(r, 1, new QTableWidgetItem(d.fullName()));
-        doctorsTable->setItem(r, 2, new QTableWidgetItem(d.email));
-        Specialization s = dataManager->getSpecializationById(d.id_spec);
-        doctorsTable->setItem(r, 3, new QTableWidgetItem(s.name));
-        ++r;
+    // Specialization names once per load instead of a lookup per row
+    specializationNames.clear();
+    const QList<Specialization> specs = dataManager->getAllSpecializations();
+    for (const Specialization &s : specs) {
+        specializationNames.insert(s.id_spec, s.name);
     }
-    // Scale columns to content: ID and text columns sized to contents, last column stretches if space remains
-    doctorsTable->resizeColumnsToContents();
-    doctorsTable->horizontalHeader()->setSectionResizeMode(0, QHeaderView::ResizeToContents);
-    doctorsTable->horizontalHeader()->setSectionResizeMode(1, QHeaderView::ResizeToContents);
-    doctorsTable->horizontalHeader()->setSectionResizeMode(2, QHeaderView::ResizeToContents);
-    doctorsTable->horizontalHeader()->setSectionResizeMode(3, QHeaderView::Stretch);
+    doctorsProxy->setSearchText(QString());
+    doctorsModel->setRows(dataManager->getAllDoctors());
     // Clear search
     doctorsSearchEdit->blockSignals(true);
     doctorsSearchEdit->clear();
@@ -402,10 +456,8 @@ void AdminWidget::onAddDoctor() {
 }
 
 void AdminWidget::onEditDoctor() {
-    QTableWidgetItem *it = doctorsTable->currentItem();
-    if (!it) { QMessageBox::warning(this, "Ошибка", "Выберите врача"); return; }
-    int row = it->row();
-    int id = doctorsTable->item(row, 0)->text().toInt();
+    int id = currentRecordId(doctorsTable);
+    if (id < 0) { QMessageBox::warning(this, "Ошибка", "Выберите врача"); return; }
     Doctor d = dataManager->getDoctorById(id);
     QDialog dlg(this);
     dlg.setWindowTitle("Редактировать врача");
@@ -471,10 +523,8 @@ void AdminWidget::onEditDoctor() {
 }
 
 void AdminWidget::onDeleteDoctor() {
-    QTableWidgetItem *it = doctorsTable->currentItem();
-    if (!it) { QMessageBox::warning(this, "Ошибка", "Выберите врача"); return; }
-    int row = it->row();
-    int id = doctorsTable->item(row, 0)->text().toInt();
+    int id = currentRecordId(doctorsTable);
+    if (id < 0) { QMessageBox::warning(this, "Ошибка", "Выберите врача"); return; }
     
     // Check for associated schedules and appointments
     QList<AppointmentSchedule> schedules = dataManager->getDoctorSchedules(id);
@@ -511,10 +561,8 @@ void AdminWidget::onDeleteDoctor() {
 }
 
 void AdminWidget::onManageDoctorSchedule() {
-    QTableWidgetItem *it = doctorsTable->currentItem();
-    if (!it) { QMessageBox::warning(this, "Ошибка", "Выберите врача"); return; }
-    int row = it->row();
-    int id = doctorsTable->item(row, 0)->text().toInt();
+    int id = currentRecordId(doctorsTable);
+    if (id < 0) { QMessageBox::warning(this, "Ошибка", "Выберите врача"); return; }
     // Open the ManagerScheduleViewer as a dialog-like popup and preselect the chosen doctor
     ManagerScheduleViewer *viewer = new ManagerScheduleViewer(dataManager, this);
     viewer->setAttribute(Qt::WA_DeleteOnClose);
@@ -527,22 +575,8 @@ void AdminWidget::onManageDoctorSchedule() {
 }
 
 void AdminWidget::loadPatients() {
-    patientsTable->setRowCount(0);
-    allPatients = dataManager->getAllPatients();
-    patientsTable->setRowCount(allPatients.size());
-    int r = 0;
-    for (const Patient &p : allPatients) {
-        patientsTable->setItem(r, 0, new QTableWidgetItem(QString::number(p.id_patient)));
-        patientsTable->setItem(r, 1, new QTableWidgetItem(p.fullName()));
-        patientsTable->setItem(r, 2, new QTableWidgetItem(p.email));
-        patientsTable->setItem(r, 3, new QTableWidgetItem(p.phone_number));
-        ++r;
-    }
-    patientsTable->resizeColumnsToContents();
-    patientsTable->horizontalHeader()->setSectionResizeMode(0, QHeaderView::ResizeToContents);
-    patientsTable->horizontalHeader()->setSectionResizeMode(1, QHeaderView::ResizeToContents);
-    patientsTable->horizontalHeader()->setSectionResizeMode(2, QHeaderView::ResizeToContents);
-    patientsTable->horizontalHeader()->setSectionResizeMode(3, QHeaderView::Stretch);
+    patientsProxy->setSearchText(QString());
+    patientsModel->setRows(dataManager->getAllPatients());
     // Clear search
     patientsSearchEdit->blockSignals(true);
     patientsSearchEdit->clear();
@@ -616,10 +650,8 @@ void AdminWidget::onAddPatient() {
 }
 
 void AdminWidget::onEditPatient() {
-    QTableWidgetItem *it = patientsTable->currentItem();
-    if (!it) { QMessageBox::warning(this, "Ошибка", "Выберите пациента"); return; }
-    int row = it->row();
-    int id = patientsTable->item(row, 0)->text().toInt();
+    int id = currentRecordId(patientsTable);
+    if (id < 0) { QMessageBox::warning(this, "Ошибка", "Выберите пациента"); return; }
     Patient p = dataManager->getPatientById(id);
     QDialog dlg(this);
     dlg.setWindowTitle("Редактировать пациента");
@@ -685,10 +717,8 @@ void AdminWidget::onEditPatient() {
 }
 
 void AdminWidget::onDeletePatient() {
-    QTableWidgetItem *it = patientsTable->currentItem();
-    if (!it) { QMessageBox::warning(this, "Ошибка", "Выберите пациента"); return; }
-    int row = it->row();
-    int id = patientsTable->item(row, 0)->text().toInt();
+    int id = currentRecordId(patientsTable);
+    if (id < 0) { QMessageBox::warning(this, "Ошибка", "Выберите пациента"); return; }
     
     // Check for associated appointments
     QList<Appointment> appointments = dataManager->getPatientAppointments(id);
@@ -704,10 +734,8 @@ void AdminWidget::onDeletePatient() {
 }
 
 void AdminWidget::onViewPatientAppointments() {
-    QTableWidgetItem *it = patientsTable->currentItem();
-    if (!it) { QMessageBox::warning(this, "Ошибка", "Выберите пациента"); return; }
-    int row = it->row();
-    int id = patientsTable->item(row, 0)->text().toInt();
+    int id = currentRecordId(patientsTable);
+    if (id < 0) { QMessageBox::warning(this, "Ошибка", "Выберите пациента"); return; }
     // Open patient appointments viewer as a popup dialog
     PatientAppointmentsViewer *viewer = new PatientAppointmentsViewer(dataManager, this);
     viewer->setAttribute(Qt::WA_DeleteOnClose);
@@ -720,20 +748,8 @@ void AdminWidget::onViewPatientAppointments() {
 }
 
 void AdminWidget::loadManagers() {
-    managersTable->setRowCount(0);
-    allManagers = dataManager->getAllManagers();
-    managersTable->setRowCount(allManagers.size());
-    int r = 0;
-    for (const Manager &m : allManagers) {
-        managersTable->setItem(r, 0, new QTableWidgetItem(QString::number(m.id)));
-        managersTable->setItem(r, 1, new QTableWidgetItem(m.fullName()));
-        managersTable->setItem(r, 2, new QTableWidgetItem(m.email));
-        ++r;
-    }
-    managersTable->resizeColumnsToContents();
-    managersTable->horizontalHeader()->setSectionResizeMode(0, QHeaderView::ResizeToContents);
-    managersTable->horizontalHeader()->setSectionResizeMode(1, QHeaderView::ResizeToContents);
-    managersTable->horizontalHeader()->setSectionResizeMode(2, QHeaderView::Stretch);
+    managersProxy->setSearchText(QString());
+    managersModel->setRows(dataManager->getAllManagers());
     // Clear search
     managersSearchEdit->blockSignals(true);
     managersSearchEdit->clear();
@@ -790,10 +806,8 @@ void AdminWidget::onAddManager() {
 }
 
 void AdminWidget::onEditManager() {
-    QTableWidgetItem *it = managersTable->currentItem();
-    if (!it) { QMessageBox::warning(this, "Ошибка", "Выберите менеджера"); return; }
-    int row = it->row();
-    int id = managersTable->item(row, 0)->text().toInt();
+    int id = currentRecordId(managersTable);
+    if (id < 0) { QMessageBox::warning(this, "Ошибка", "Выберите менеджера"); return; }
     Manager m = dataManager->getManagerById(id);
     QDialog dlg(this);
     dlg.setWindowTitle("Редактировать менеджера");
@@ -842,10 +856,8 @@ void AdminWidget::onEditManager() {
 }
 
 void AdminWidget::onDeleteManager() {
-    QTableWidgetItem *it = managersTable->currentItem();
-    if (!it) { QMessageBox::warning(this, "Ошибка", "Выберите менеджера"); return; }
-    int row = it->row();
-    int id = managersTable->item(row, 0)->text().toInt();
+    int id = currentRecordId(managersTable);
+    if (id < 0) { QMessageBox::warning(this, "Ошибка", "Выберите менеджера"); return; }
     QMessageBox::StandardButton reply = QMessageBox::question(this, "Подтвердите", "Удалить менеджера?");
     if (reply != QMessageBox::Yes) return;
     dataManager->deleteManager(id);
@@ -853,108 +865,36 @@ void AdminWidget::onDeleteManager() {
 }
 
 void AdminWidget::onDoctorsFilterChanged(const QString &text) {
-    for (int row = 0; row < doctorsTable->rowCount(); ++row) {
-        bool match = false;
-        if (text.isEmpty()) {
-            match = true;
-        } else {
-            // Search in ID, Full Name, Email, Specialization
-            for (int col = 0; col < doctorsTable->columnCount(); ++col) {
-                QTableWidgetItem *item = doctorsTable->item(row, col);
-                if (item && item->text().contains(text, Qt::CaseInsensitive)) {
-                    match = true;
-                    break;
-                }
-            }
-        }
-        doctorsTable->setRowHidden(row, !match);
-    }
+    doctorsProxy->setSearchText(text);
 }
 
 void AdminWidget::onPatientsFilterChanged(const QString &text) {
-    for (int row = 0; row < patientsTable->rowCount(); ++row) {
-        bool match = false;
-        if (text.isEmpty()) {
-            match = true;
-        } else {
-            // Search in ID, Full Name, Email, Phone
-            for (int col = 0; col < patientsTable->columnCount(); ++col) {
-                QTableWidgetItem *item = patientsTable->item(row, col);
-                if (item && item->text().contains(text, Qt::CaseInsensitive)) {
-                    match = true;
-                    break;
-                }
-            }
-        }
-        patientsTable->setRowHidden(row, !match);
-    }
+    patientsProxy->setSearchText(text);
 }
 
 void AdminWidget::onManagersFilterChanged(const QString &text) {
-    for (int row = 0; row < managersTable->rowCount(); ++row) {
-        bool match = false;
-        if (text.isEmpty()) {
-            match = true;
-        } else {
-            // Search in ID, Full Name, Email
-            for (int col = 0; col < managersTable->columnCount(); ++col) {
-                QTableWidgetItem *item = managersTable->item(row, col);
-                if (item && item->text().contains(text, Qt::CaseInsensitive)) {
-                    match = true;
-                    break;
-                }
-            }
-        }
-        managersTable->setRowHidden(row, !match);
-    }
+    managersProxy->setSearchText(text);
 }
 
 void AdminWidget::loadSpecializations() {
-    specsTable->setRowCount(0);
-    allSpecializations = dataManager->getAllSpecializations();
-    specsTable->setRowCount(allSpecializations.size());
-    for (int i = 0; i < allSpecializations.size(); ++i) {
-        const Specialization &s = allSpecializations[i];
-        specsTable->setItem(i, 0, new QTableWidgetItem(QString::number(s.id_spec)));
-        specsTable->setItem(i, 1, new QTableWidgetItem(s.name));
-    }
-    specsTable->resizeColumnsToContents();
-    specsTable->horizontalHeader()->setSectionResizeMode(0, QHeaderView::ResizeToContents);
-    specsTable->horizontalHeader()->setSectionResizeMode(1, QHeaderView::Stretch);
+    specsProxy->setSearchText(QString());
+    specsModel->setRows(dataManager->getAllSpecializations());
     specsSearchEdit->blockSignals(true);
     specsSearchEdit->clear();
     specsSearchEdit->blockSignals(false);
 }
 
 void AdminWidget::loadRooms() {
-    roomsTable->setRowCount(0);
-    allRooms = dataManager->getAllRooms();
-    roomsTable->setRowCount(allRooms.size());
-    for (int i = 0; i < allRooms.size(); ++i) {
-        const Room &r = allRooms[i];
-        roomsTable->setItem(i, 0, new QTableWidgetItem(QString::number(r.id_room)));
-        roomsTable->setItem(i, 1, new QTableWidgetItem(r.room_number));
-    }
-    roomsTable->resizeColumnsToContents();
-    roomsTable->horizontalHeader()->setSectionResizeMode(0, QHeaderView::ResizeToContents);
-    roomsTable->horizontalHeader()->setSectionResizeMode(1, QHeaderView::Stretch);
+    roomsProxy->setSearchText(QString());
+    roomsModel->setRows(dataManager->getAllRooms());
     roomsSearchEdit->blockSignals(true);
     roomsSearchEdit->clear();
     roomsSearchEdit->blockSignals(false);
 }
 
 void AdminWidget::loadDiagnoses() {
-    diagTable->setRowCount(0);
-    allDiagnoses = dataManager->getAllDiagnoses();
-    diagTable->setRowCount(allDiagnoses.size());
-    for (int i = 0; i < allDiagnoses.size(); ++i) {
-        const Diagnosis &d = allDiagnoses[i];
-        diagTable->setItem(i, 0, new QTableWidgetItem(QString::number(d.id_diagnosis)));
-        diagTable->setItem(i, 1, new QTableWidgetItem(d.name));
-    }
-    diagTable->resizeColumnsToContents();
-    diagTable->horizontalHeader()->setSectionResizeMode(0, QHeaderView::ResizeToContents);
-    diagTable->horizontalHeader()->setSectionResizeMode(1, QHeaderView::Stretch);
+    diagProxy->setSearchText(QString());
+    diagModel->setRows(dataManager->getAllDiagnoses());
     diagSearchEdit->blockSignals(true);
     diagSearchEdit->clear();
     diagSearchEdit->blockSignals(false);
@@ -990,9 +930,8 @@ void AdminWidget::onAddSpecialization() {
 }
 
 void AdminWidget::onEditSpecialization() {
-    QTableWidgetItem *it = specsTable->currentItem();
-    if (!it) { QMessageBox::warning(this, "Ошибка", "Выберите специализацию"); return; }
-    int id = specsTable->item(it->row(), 0)->text().toInt();
+    int id = currentRecordId(specsTable);
+    if (id < 0) { QMessageBox::warning(this, "Ошибка", "Выберите специализацию"); return; }
     Specialization spec = dataManager->getSpecializationById(id);
     QDialog dlg(this);
     dlg.setWindowTitle("Изменить специализацию");
@@ -1019,9 +958,8 @@ void AdminWidget::onEditSpecialization() {
 }
 
 void AdminWidget::onDeleteSpecialization() {
-    QTableWidgetItem *it = specsTable->currentItem();
-    if (!it) { QMessageBox::warning(this, "Ошибка", "Выберите специализацию"); return; }
-    int id = specsTable->item(it->row(), 0)->text().toInt();
+    int id = currentRecordId(specsTable);
+    if (id < 0) { QMessageBox::warning(this, "Ошибка", "Выберите специализацию"); return; }
     if (dataManager->isSpecializationUsed(id)) {
         QMessageBox::warning(this, "Нельзя удалить", "Специализация назначена врачам. Снимите назначение перед удалением.");
         return;
@@ -1053,9 +991,8 @@ void AdminWidget::onAddRoom() {
 }
 
 void AdminWidget::onEditRoom() {
-    QTableWidgetItem *it = roomsTable->currentItem();
-    if (!it) { QMessageBox::warning(this, "Ошибка", "Выберите кабинет"); return; }
-    int id = roomsTable->item(it->row(), 0)->text().toInt();
+    int id = currentRecordId(roomsTable);
+    if (id < 0) { QMessageBox::warning(this, "Ошибка", "Выберите кабинет"); return; }
     Room room = dataManager->getRoomById(id);
     QDialog dlg(this);
     dlg.setWindowTitle("Изменить кабинет");
@@ -1081,9 +1018,8 @@ void AdminWidget::onEditRoom() {
 }
 
 void AdminWidget::onDeleteRoom() {
-    QTableWidgetItem *it = roomsTable->currentItem();
-    if (!it) { QMessageBox::warning(this, "Ошибка", "Выберите кабинет"); return; }
-    int id = roomsTable->item(it->row(), 0)->text().toInt();
+    int id = currentRecordId(roomsTable);
+    if (id < 0) { QMessageBox::warning(this, "Ошибка", "Выберите кабинет"); return; }
     if (dataManager->isRoomUsed(id)) {
         QMessageBox::warning(this, "Нельзя удалить", "Кабинет используется в расписаниях. Освободите слоты перед удалением.");
         return;
@@ -1115,9 +1051,8 @@ void AdminWidget::onAddDiagnosis() {
 }
 
 void AdminWidget::onEditDiagnosis() {
-    QTableWidgetItem *it = diagTable->currentItem();
-    if (!it) { QMessageBox::warning(this, "Ошибка", "Выберите диагноз"); return; }
-    int id = diagTable->item(it->row(), 0)->text().toInt();
+    int id = currentRecordId(diagTable);
+    if (id < 0) { QMessageBox::warning(this, "Ошибка", "Выберите диагноз"); return; }
     Diagnosis d = dataManager->getDiagnosisById(id);
     QDialog dlg(this);
     dlg.setWindowTitle("Изменить диагноз");
@@ -1143,9 +1078,8 @@ void AdminWidget::onEditDiagnosis() {
 }
 
 void AdminWidget::onDeleteDiagnosis() {
-    QTableWidgetItem *it = diagTable->currentItem();
-    if (!it) { QMessageBox::warning(this, "Ошибка", "Выберите диагноз"); return; }
-    int id = diagTable->item(it->row(), 0)->text().toInt();
+    int id = currentRecordId(diagTable);
+    if (id < 0) { QMessageBox::warning(this, "Ошибка", "Выберите диагноз"); return; }
     if (dataManager->isDiagnosisUsed(id)) {
         QMessageBox::warning(this, "Нельзя удалить", "Диагноз уже используется в рецептах. Удалите или обновите связанные записи.");
         return;
@@ -1156,42 +1090,15 @@ void AdminWidget::onDeleteDiagnosis() {
 }
 
 void AdminWidget::onSpecializationsFilterChanged(const QString &text) {
-    for (int row = 0; row < specsTable->rowCount(); ++row) {
-        bool match = text.isEmpty();
-        if (!match) {
-            for (int col = 0; col < specsTable->columnCount(); ++col) {
-                QTableWidgetItem *item = specsTable->item(row, col);
-                if (item && item->text().contains(text, Qt::CaseInsensitive)) { match = true; break; }
-            }
-        }
-        specsTable->setRowHidden(row, !match);
-    }
+    specsProxy->setSearchText(text);
 }
 
 void AdminWidget::onRoomsFilterChanged(const QString &text) {
-    for (int row = 0; row < roomsTable->rowCount(); ++row) {
-        bool match = text.isEmpty();
-        if (!match) {
-            for (int col = 0; col < roomsTable->columnCount(); ++col) {
-                QTableWidgetItem *item = roomsTable->item(row, col);
-                if (item && item->text().contains(text, Qt::CaseInsensitive)) { match = true; break; }
-            }
-        }
-        roomsTable->setRowHidden(row, !match);
-    }
+    roomsProxy->setSearchText(text);
 }
 
 void AdminWidget::onDiagnosesFilterChanged(const QString &text) {
-    for (int row = 0; row < diagTable->rowCount(); ++row) {
-        bool match = text.isEmpty();
-        if (!match) {
-            for (int col = 0; col < diagTable->columnCount(); ++col) {
-                QTableWidgetItem *item = diagTable->item(row, col);
-                if (item && item->text().contains(text, Qt::CaseInsensitive)) { match = true; break; }
-            }
-        }
-        diagTable->setRowHidden(row, !match);
-    }
+    diagProxy->setSearchText(text);
 }
 
 #include "admins/adminwidget.moc"
@@ -9,6 +9,8 @@
 #include "../patients/createpatientdialog.h" // CHANGED: Include for patient edit dialog
 #include <QPushButton> // CHANGED: For add button
 #include <QIcon>
+#include <QTimer>
+#include <QBitArray>
 
 // CHANGED: For slot declaration
 void PatientAppointmentsViewer::onAddAppointmentClicked() {
@@ -70,16 +72,22 @@ void PatientAppointmentsViewer::buildUI() {
     main->addWidget(m_table, 1);
 
     connect(m_table, &QTableWidget::customContextMenuRequested, this, &PatientAppointmentsViewer::onTableContextMenu);
-    connect(m_filterEdit, &QLineEdit::textChanged, this, [this](const QString &txt){
-        for (int r = 0; r < m_table->rowCount(); ++r) {
-            bool match = txt.isEmpty();
-            for (int c = 0; c < m_table->columnCount(); ++c) {
-                QTableWidgetItem *it = m_table->item(r, c);
-                if (it && it->text().contains(txt, Qt::CaseInsensitive)) { match = true; break; }
-            }
-            m_table->setRowHidden(r, !match);
-        }
-    });
+    // Filter once typing pauses
+    QTimer *filterTimer = new QTimer(this);
+    filterTimer->setSingleShot(true);
+    filterTimer->setInterval(150);
+    connect(m_filterEdit, &QLineEdit::textChanged, filterTimer, [filterTimer]() { filterTimer->start(); });
+    connect(filterTimer, &QTimer::timeout, this, [this]() { applyFilter(m_filterEdit->text()); });
+}
+
+void PatientAppointmentsViewer::applyFilter(const QString &text) {
+    QBitArray visible(m_table->rowCount(), text.isEmpty());
+    if (!text.isEmpty()) {
+        for (int row : m_searchIndex.search(text)) visible.setBit(row);
+    }
+    for (int r = 0; r < m_table->rowCount(); ++r) {
+        m_table->setRowHidden(r, !visible.testBit(r));
+    }
 }
 
 void PatientAppointmentsViewer::setCurrentPatient(int patientId) {
@@ -91,6 +99,8 @@ void PatientAppointmentsViewer::loadAppointmentsForPatient(int patientId) {
     m_table->clearContents();
     QList<Appointment> list = m_dm->getPatientAppointments(patientId);
     m_table->setRowCount(list.size());
+    QVector<QStringList> rowTexts;
+    rowTexts.reserve(list.size());
     int r = 0;
     for (const Appointment &a : list) {
         QTableWidgetItem *idItem = new QTableWidgetItem(QString::number(a.id_ap));
@@ -119,8 +129,11 @@ void PatientAppointmentsViewer::loadAppointmentsForPatient(int patientId) {
         }
         m_table->setItem(r, 4, new QTableWidgetItem(roomStr));
 
+        rowTexts.append({QString::number(a.id_ap), dt, docName, specName, roomStr});
         ++r;
     }
+    m_searchIndex.build(rowTexts.size(), [&rowTexts](int row) { return rowTexts.at(row); });
+    applyFilter(m_filterEdit->text());
 }
 
 void PatientAppointmentsViewer::onTableContextMenu(const QPoint &pos) {
@@ -16,6 +16,7 @@
 #endif
 #include <QDateTime>
 #include <QMap>
+#include <QHash>
 #include <QColor>
 #include <functional>
 #include <QScrollArea>
@@ -37,6 +38,8 @@
 #include <algorithm>
 #include <QSizeGrip>
 #include <QMouseEvent>
+#include <QProgressBar>
+#include <QtConcurrent/QtConcurrent>
 static QString medicalPrimaryColor() { return "#0b6fa4"; }
 static QString medicalAccentColor() { return "#2aa198"; }
 
@@ -179,12 +182,29 @@ private:
 };
 
 StatisticsWidget::StatisticsWidget(DataManager *dm, QWidget *parent)
-    : QWidget(parent), dm(dm), visitsChartView(nullptr), doctorsChartView(nullptr), topPatientsChartView(nullptr), topDoctorsChartView(nullptr)
+    : QWidget(parent), dm(dm), visitsChartView(nullptr), topPatientsChartView(nullptr), topDoctorsChartView(nullptr)
 {
+    weeklyWatcher = new QFutureWatcher<WeeklyStatistics>(this);
+    topWatcher = new QFutureWatcher<TopStatistics>(this);
+    connect(weeklyWatcher, &QFutureWatcherBase::finished, this, [this]() {
+        WeeklyStatistics stats = weeklyWatcher->result();
+        if (!stats.cancelled) showWeeklyCharts(stats);
+        updateBusyIndicator();
+    });
+    connect(topWatcher, &QFutureWatcherBase::finished, this, [this]() {
+        TopStatistics stats = topWatcher->result();
+        if (!stats.cancelled) showTopLists(stats);
+        updateBusyIndicator();
+    });
     buildUI();
     refresh();
 }
 
+StatisticsWidget::~StatisticsWidget() {
+    // Workers only hold their snapshot, so they may finish after we are gone
+    if (cancelFlag) cancelFlag->store(true);
+}
+
 void StatisticsWidget::buildUI() {
     // Outer layout holds a scroll area so charts can expand vertically
     QVBoxLayout *outer = new QVBoxLayout(this);
@@ -215,6 +235,13 @@ void StatisticsWidget::buildUI() {
     header->addWidget(periodLabel);
     header->addWidget(nextBtn);
     header->addWidget(choosePeriodBtn);
+    busyIndicator = new QProgressBar();
+    busyIndicator->setRange(0, 0);  // indeterminate
+    busyIndicator->setTextVisible(false);
+    busyIndicator->setFixedWidth(90);
+    busyIndicator->setToolTip("Идёт подсчёт статистики");
+    busyIndicator->hide();
+    header->addWidget(busyIndicator);
     header->addStretch();
     main->addLayout(header);
     // Initialize chart widgets (or QLabel fallbacks) and stack them vertically
@@ -236,9 +263,8 @@ void StatisticsWidget::buildUI() {
     visitsChartView = new ResizableWidget(innerVisits, false, "Посещения по неделям");
     static_cast<ResizableWidget*>(visitsChartView)->setMoveCallback([this](int dir){ this->moveChart(static_cast<QWidget*>(visitsChartView), dir); });
 
-    // Note: the detailed weekly aggregated doctors bar chart was removed to reduce redundancy.
-    // The visits chart (line series) remains; doctorsChartView is left null and not added to layout.
-    doctorsChartView = nullptr;
+    // The weekly bar chart of the same totals was dropped as redundant; the
+    // visits chart carries the per-week drill-down on its points.
 
     QChartView *innerTopPatients = new QChartView(new QChart());
     innerTopPatients->setMinimumHeight(470);
@@ -257,10 +283,6 @@ void StatisticsWidget::buildUI() {
         v1->setAlignment(Qt::AlignCenter);
         v1->setMinimumHeight(140);
         visitsChartView = v1;
-        QLabel *v2 = new QLabel("Общее количество приёмов по неделям (Charts не установлен)");
-        v2->setAlignment(Qt::AlignCenter);
-        v2->setMinimumHeight(140);
-        doctorsChartView = v2;
         QLabel *v3 = new QLabel("Топ пациентов (Charts не установлен)");
         v3->setAlignment(Qt::AlignCenter);
         v3->setMinimumHeight(140);
@@ -333,9 +355,146 @@ void StatisticsWidget::buildUI() {
     outer->addWidget(scroll);
 }
 
+// Julian day of the Monday of the given day's week (Julian day 0 is a Monday)
+static qint64 mondayOf(qint64 julianDay) {
+    return julianDay - julianDay % 7;
+}
+
+// Worker side of refresh(): both run on the thread pool and only read their
+// snapshot. Cancellation is checked between chunks of work.
+static const int kTopLimit = 10;
+static const int kCancelCheckRows = 1 << 16;
+
+static WeeklyStatistics computeWeekly(const StatisticsSnapshot &snap, const std::atomic<bool> &cancelled) {
+    WeeklyStatistics stats;
+    stats.startDate = snap.startDate;
+    stats.endDate = snap.endDate;
+    stats.customPeriod = snap.customPeriod;
+    if (cancelled.load()) {
+        stats.cancelled = true;
+        return stats;
+    }
+    // Weeks covering the selected period (one per 7-day step), as consecutive
+    // Monday Julian days starting at the week of startDate
+    int days = snap.startDate.daysTo(snap.endDate);
+    stats.weeks = qMax(1, days / 7 + 1);
+    stats.firstMonday = mondayOf(snap.startDate.toJulianDay());
+    const qint64 startDay = snap.startDate.toJulianDay();
+    const qint64 endDay = snap.endDate.toJulianDay();
+
+    // Per-week, per-day and period totals are lookups in the rollup
+    stats.perWeek = snap.data->rollup.perBucket(stats.firstMonday, stats.weeks, 7);
+    stats.perDay = snap.data->rollup.perBucket(startDay, int(endDay - startDay) + 1, 1);
+    stats.cancelled = cancelled.load();
+    return stats;
+}
+
+// Ids with the most appointments first; equal counts by ascending id.
+static QList<QPair<int,int>> rankByCount(const QHash<int,int> &counts) {
+    QList<QPair<int,int>> list;
+    list.reserve(counts.size());
+    for (auto it = counts.begin(); it != counts.end(); ++it) list.append({it.key(), it.value()});
+    std::sort(list.begin(), list.end(), [](const QPair<int,int>& a, const QPair<int,int>& b) {
+        return a.second != b.second ? a.second > b.second : a.first < b.first;
+    });
+    return list;
+}
+
+static TopStatistics computeTopLists(const StatisticsSnapshot &snap, const std::atomic<bool> &cancelled) {
+    TopStatistics stats;
+    QHash<int,int> countByPatient;
+    QHash<int,int> countByDoctor;
+    const AppointmentColumns &cols = snap.data->appointmentColumns;
+    for (int i = 0, n = cols.size(); i < n; ++i) {
+        if ((i % kCancelCheckRows) == 0 && cancelled.load()) {
+            stats.cancelled = true;
+            return stats;
+        }
+        countByPatient[cols.patient[i]] += 1;
+        countByDoctor[cols.doctor[i]] += 1;
+    }
+    QList<QPair<int,int>> patientList = rankByCount(countByPatient);
+    QList<QPair<int,int>> doctorList = rankByCount(countByDoctor);
+    stats.patientTotal = patientList.size();
+    stats.doctorTotal = doctorList.size();
+    patientList = patientList.mid(0, kTopLimit);
+    doctorList = doctorList.mid(0, kTopLimit);
+    if (cancelled.load()) {
+        stats.cancelled = true;
+        return stats;
+    }
+
+    // Names only for the ranked ids, in one pass over each table
+    QHash<int,int> rank;
+    for (int i = 0; i < patientList.size(); ++i) rank.insert(patientList[i].first, i);
+    QVector<QString> patientLabels(patientList.size());
+    for (const Patient &p : snap.data->patients.rows) {
+        int i = rank.value(p.id_patient, -1);
+        if (i >= 0 && patientLabels[i].isEmpty() && !p.fullName().trimmed().isEmpty()) {
+            patientLabels[i] = formatShortPerson(p.lname, p.fname, p.tname, p.id_patient);
+        }
+    }
+    for (int i = 0; i < patientList.size(); ++i) {
+        TopStatistics::Entry e;
+        e.label = patientLabels[i].isEmpty() ? QString("Пациент %1").arg(patientList[i].first) : patientLabels[i];
+        e.count = patientList[i].second;
+        stats.patients.append(e);
+    }
+
+    QHash<int,QString> specNames;
+    for (const Specialization &sp : snap.data->specializations.rows) specNames.insert(sp.id_spec, sp.name);
+    rank.clear();
+    for (int i = 0; i < doctorList.size(); ++i) rank.insert(doctorList[i].first, i);
+    QVector<QString> doctorLabels(doctorList.size());
+    QVector<QString> doctorSpecs(doctorList.size());
+    for (const Doctor &d : snap.data->doctors.rows) {
+        int i = rank.value(d.id_doctor, -1);
+        if (i >= 0 && doctorLabels[i].isEmpty() && !d.fullName().trimmed().isEmpty()) {
+            doctorLabels[i] = formatShortPerson(d.lname, d.fname, d.tname, d.id_doctor);
+            doctorSpecs[i] = specNames.value(d.id_spec);
+        }
+    }
+    for (int i = 0; i < doctorList.size(); ++i) {
+        TopStatistics::Entry e;
+        e.label = doctorLabels[i].isEmpty() ? QString("Врач %1").arg(doctorList[i].first) : doctorLabels[i];
+        if (!doctorLabels[i].isEmpty()) e.detail = QString("Специальность: %1").arg(doctorSpecs[i]);
+        e.count = doctorList[i].second;
+        stats.doctors.append(e);
+    }
+    stats.cancelled = cancelled.load();
+    return stats;
+}
+
 void StatisticsWidget::refresh() {
-    buildWeeklyCharts();
-    buildTopLists();
+    StatisticsSnapshot snap;
+    // Determine date range: either a custom period selected via calendar, or default last 12 weeks
+    snap.customPeriod = this->customPeriod && this->periodStart.isValid() && this->periodEnd.isValid();
+    if (snap.customPeriod) {
+        snap.startDate = this->periodStart;
+        snap.endDate = this->periodEnd;
+    } else {
+        QDate today = QDate::currentDate();
+        // default period: current month (start = 1st of month), end = today shifted by endOffsetWeeks
+        snap.endDate = today.addDays(-7 * endOffsetWeeks);
+        snap.startDate = QDate(snap.endDate.year(), snap.endDate.month(), 1);
+    }
+    periodLabel->setText(QString("Период: %1 — %2").arg(snap.startDate.toString("yyyy-MM-dd"), snap.endDate.toString("yyyy-MM-dd")));
+
+    // The workers read this snapshot only, never DataManager itself
+    snap.data = dm->snapshot();
+
+    // Supersede the previous run: its workers stop at their next check and
+    // the watchers no longer report its futures
+    if (cancelFlag) cancelFlag->store(true);
+    QSharedPointer<std::atomic<bool>> cancelled(new std::atomic<bool>(false));
+    cancelFlag = cancelled;
+    weeklyWatcher->setFuture(QtConcurrent::run([snap, cancelled]() { return computeWeekly(snap, *cancelled); }));
+    topWatcher->setFuture(QtConcurrent::run([snap, cancelled]() { return computeTopLists(snap, *cancelled); }));
+    updateBusyIndicator();
+}
+
+void StatisticsWidget::updateBusyIndicator() {
+    busyIndicator->setVisible(weeklyWatcher->isRunning() || topWatcher->isRunning());
 }
 
 void StatisticsWidget::moveChart(QWidget *w, int direction) {
@@ -360,53 +519,18 @@ void StatisticsWidget::moveChart(QWidget *w, int direction) {
     chartsLayout->insertWidget(newIdx, w);
 }
 
-static int weekKey(const QDateTime &dt) {
-    // Represent weeks as year*100 + weekNumber
-    int year = 0;
-    int week = dt.date().weekNumber(&year);
-    return year * 100 + week;
-}
-
-void StatisticsWidget::buildWeeklyCharts() {
-    QList<Appointment> appts = dm->getAllAppointments();
-
-    // Determine date range: either a custom period selected via calendar, or default last 12 weeks
-    QDate startDate;
-    QDate endDate;
-    if (this->customPeriod && this->periodStart.isValid() && this->periodEnd.isValid()) {
-        startDate = this->periodStart;
-        endDate = this->periodEnd;
-    } else {
-        QDate today = QDate::currentDate();
-        // default period: current month (start = 1st of month), end = today shifted by endOffsetWeeks
-        endDate = today.addDays(-7 * endOffsetWeeks);
-        startDate = QDate(endDate.year(), endDate.month(), 1);
-    }
-
-    // Build list of week keys covering the selected period (one key per 7-day step)
-    QList<int> weekKeys;
-    int days = startDate.daysTo(endDate);
-    int weeks = qMax(1, days / 7 + 1);
-    for (int i = 0; i < weeks; ++i) {
-        QDate d = startDate.addDays(7 * i);
-        int year = 0;
-        int week = d.weekNumber(&year);
-        weekKeys.append(year * 100 + week);
-    }
-
-    // Update period label
-    periodLabel->setText(QString("Период: %1 — %2").arg(startDate.toString("yyyy-MM-dd"), endDate.toString("yyyy-MM-dd")));
-
-    QMap<int,int> patientsPerWeek;
-    QMap<int,int> doctorsPerWeek;
-    for (const Appointment &a : appts) {
-        if (!a.date.isValid()) continue;
-        int k = weekKey(a.date);
-        // only include weeks in the range
-        if (!weekKeys.contains(k)) continue;
-        patientsPerWeek[k] += 1; // counts appointments (proxy for patient visits)
-        doctorsPerWeek[k] += 1;
-    }
+void StatisticsWidget::showWeeklyCharts(const WeeklyStatistics &stats) {
+    const QDate startDate = stats.startDate;
+    const QDate endDate = stats.endDate;
+    const int weeks = stats.weeks;
+    const qint64 firstMonday = stats.firstMonday;
+    const qint64 startDay = startDate.toJulianDay();
+    const QVector<int> &perWeek = stats.perWeek;
+    const QVector<int> &perDay = stats.perDay;
+    const bool customRange = stats.customPeriod;
+    // Appointments count both as patient and as doctor visits
+    const QVector<int> &patientsPerWeek = perWeek;
+    const QVector<int> &doctorsPerWeek = perWeek;
 
     // Line/Bar series for charts (or text summaries when Qt Charts not available)
     QStringList categories;
@@ -423,36 +547,21 @@ void StatisticsWidget::buildWeeklyCharts() {
     doctorsSeries->setColor(QColor(medicalAccentColor()));
 
     // If a custom period is selected, show results split by day across the period
-    if (this->customPeriod) {
+    if (customRange) {
         int totalDays = startDate.daysTo(endDate) + 1;
         for (int i = 0; i < totalDays; ++i) {
             QDate d = startDate.addDays(i);
-            int countP = 0, countD = 0;
-            for (const Appointment &a : appts) {
-                if (!a.date.isValid()) continue;
-                if (a.date.date() == d) {
-                    countP += 1;
-                    countD += 1;
-                }
-            }
-            patientsSeries->append(i, countP);
-            doctorsSeries->append(i, countD);
+            patientsSeries->append(i, perDay[i]);
+            doctorsSeries->append(i, perDay[i]);
             categories << d.toString("dd.MM");
         }
     } else {
         // populate series and categories by week (default behavior)
-        for (int i = 0; i < weekKeys.size(); ++i) {
-            int k = weekKeys[i];
-            int valP = patientsPerWeek.value(k, 0);
-            int valD = doctorsPerWeek.value(k, 0);
-            patientsSeries->append(i, valP);
-            doctorsSeries->append(i, valD);
+        for (int i = 0; i < weeks; ++i) {
+            patientsSeries->append(i, patientsPerWeek[i]);
+            doctorsSeries->append(i, doctorsPerWeek[i]);
             // label by week start date
-            int wk = k % 100;
-            int yr = k / 100;
-            QDate d = QDate::fromString(QString("%1-W%2-1").arg(yr).arg(wk, 2, 10, QChar('0')), "yyyy-'W'ww-'1'");
-            QString label = d.isValid() ? d.toString("dd.MM") : QString::number(wk);
-            categories << label;
+            categories << QDate::fromJulianDay(firstMonday + 7 * i).toString("dd.MM");
         }
     }
 
@@ -460,7 +569,7 @@ void StatisticsWidget::buildWeeklyCharts() {
     chart->addSeries(patientsSeries);
     chart->addSeries(doctorsSeries);
     chart->legend()->setVisible(true);
-    if (this->customPeriod) chart->setTitle(QString("Посещения за период %1 — %2").arg(startDate.toString("dd.MM.yyyy"), endDate.toString("dd.MM.yyyy")));
+    if (customRange) chart->setTitle(QString("Посещения за период %1 — %2").arg(startDate.toString("dd.MM.yyyy"), endDate.toString("dd.MM.yyyy")));
     else chart->setTitle("Посещения по неделям (последние 12 недель)");
 
     QValueAxis *axisY = new QValueAxis();
@@ -474,7 +583,7 @@ void StatisticsWidget::buildWeeklyCharts() {
     // restore: append every category so each point on chart 1 has a label
     for (int i = 0; i < categories.size(); ++i) axisX->append(categories[i], i);
     axisX->setLabelsPosition(QCategoryAxis::AxisLabelsPositionOnValue);
-    axisX->setTitleText(this->customPeriod ? "Дни (левее — ранее)" : "Недели (левая — более ранняя)");
+    axisX->setTitleText(customRange ? "Дни (левее — ранее)" : "Недели (левая — более ранняя)");
     chart->addAxis(axisX, Qt::AlignBottom);
     patientsSeries->attachAxis(axisX);
     doctorsSeries->attachAxis(axisX);
@@ -487,6 +596,17 @@ void StatisticsWidget::buildWeeklyCharts() {
                 v->setRenderHint(QPainter::Antialiasing);
                 // enable hover tooltips for line points
                 patientsSeries->setPointsVisible(true);
+                // click on a point: appointments of that week (or day) per doctor
+                connect(patientsSeries, &QXYSeries::clicked, this, [=](const QPointF &point){
+                    int idx = qRound(point.x());
+                    if (idx < 0 || idx >= categories.size()) return;
+                    if (customRange) {
+                        showDoctorBreakdown(startDay + idx, startDay + idx, QString("Приёмы за %1").arg(QDate::fromJulianDay(startDay + idx).toString("dd.MM.yyyy")));
+                    } else {
+                        qint64 monday = firstMonday + 7 * idx;
+                        showDoctorBreakdown(monday, monday + 6, QString("Приёмы за неделю %1 — %2").arg(QDate::fromJulianDay(monday).toString("dd.MM.yyyy"), QDate::fromJulianDay(monday + 6).toString("dd.MM.yyyy")));
+                    }
+                });
                 connect(patientsSeries, &QXYSeries::hovered, this, [=](const QPointF &point, bool state){
                     if (!state) return;
                     // only show tooltip for exact data points (integer X)
@@ -509,150 +629,85 @@ void StatisticsWidget::buildWeeklyCharts() {
                 });
             }
     }
-
-    // Doctor-specific aggregated weekly chart (bar chart per week showing total visits)
-    QBarSeries *barSeries = new QBarSeries();
-    QBarSet *set = new QBarSet("Приёмы");
-    set->setColor(QColor(medicalAccentColor()));
-    QChart *chart2 = new QChart();
-    // If custom period selected, aggregate into a single bar for the period
-    if (this->customPeriod) {
-        int total = 0;
-        for (const Appointment &a : appts) {
-            if (!a.date.isValid()) continue;
-            if (a.date.date() < startDate || a.date.date() > endDate) continue;
-            total += 1;
-        }
-        *set << total;
-        barSeries->append(set);
-        chart2->addSeries(barSeries);
-        chart2->setTitle(QString("Общее количество приёмов: %1 — %2").arg(startDate.toString("dd.MM.yyyy"), endDate.toString("dd.MM.yyyy")));
-        QBarCategoryAxis *axisX2 = new QBarCategoryAxis();
-        axisX2->append(QStringList{QString("%1 — %2").arg(startDate.toString("dd.MM"), endDate.toString("dd.MM"))});
-        chart2->addAxis(axisX2, Qt::AlignBottom);
-        barSeries->attachAxis(axisX2);
-        QValueAxis *axisY2 = new QValueAxis();
-        axisY2->setTitleText("Кол-во приёмов");
-        chart2->addAxis(axisY2, Qt::AlignLeft);
-        barSeries->attachAxis(axisY2);
-    } else {
-        for (int i = 0; i < weekKeys.size(); ++i) {
-            int v = patientsPerWeek.value(weekKeys[i], 0);
-            *set << v;
-        }
-        barSeries->append(set);
-        chart2->addSeries(barSeries);
-        chart2->setTitle("Общее количество приёмов по неделям");
-        QBarCategoryAxis *axisX2 = new QBarCategoryAxis();
-        QStringList cat2;
-        for (int i = 0; i < categories.size(); ++i) cat2 << categories[i];
-        axisX2->append(cat2);
-        chart2->addAxis(axisX2, Qt::AlignBottom);
-        barSeries->attachAxis(axisX2);
-        QValueAxis *axisY2 = new QValueAxis();
-        axisY2->setTitleText("Кол-во приёмов");
-        chart2->addAxis(axisY2, Qt::AlignLeft);
-        barSeries->attachAxis(axisY2);
-    }
-    {
-        ResizableWidget *wrap = static_cast<ResizableWidget*>(doctorsChartView);
-        QChartView *v = wrap ? wrap->inner<QChartView>() : nullptr;
-        if (v) {
-                v->setChart(chart2);
-                v->setRenderHint(QPainter::Antialiasing);
-                // enable hover on bars (use QBarSet::hovered)
-                connect(set, &QBarSet::hovered, this, [=](int index, bool status){
-                    if (!status) return;
-                    QString label = index >=0 && index < categories.size() ? categories[index] : QString();
-                    QString periodType = this->customPeriod ? "Дата: " : "Неделя: ";
-                    QString txt = QString("%1%2\nВсего приёмов: %3").arg(periodType).arg(label).arg(set->at(index));
-                    QToolTip::showText(QCursor::pos(), txt);
-                });
-            }
-    }
 #else
+    Q_UNUSED(startDay) Q_UNUSED(perDay) Q_UNUSED(customRange) Q_UNUSED(doctorsPerWeek)
     // Charts not available: build categories and show simple summaries
-    for (int i = 0; i < weekKeys.size(); ++i) {
-        int k = weekKeys[i];
+    for (int i = 0; i < weeks; ++i) {
         // label by week start date
-        int wk = k % 100;
-        int yr = k / 100;
-        QDate d = QDate::fromString(QString("%1-W%2-1").arg(yr).arg(wk, 2, 10, QChar('0')), "yyyy-'W'ww-'1'");
-        QString label = d.isValid() ? d.toString("dd.MM") : QString::number(wk);
-        categories << label;
+        categories << QDate::fromJulianDay(firstMonday + 7 * i).toString("dd.MM");
     }
     QString visitsSummary = "Посещения по неделям:\n";
-    for (int i = 0; i < weekKeys.size(); ++i) {
-        visitsSummary += QString("%1: %2\n").arg(categories.value(i)).arg(patientsPerWeek.value(weekKeys[i],0));
+    for (int i = 0; i < weeks; ++i) {
+        visitsSummary += QString("%1: %2\n").arg(categories.value(i)).arg(patientsPerWeek[i]);
     }
     static_cast<QLabel*>(visitsChartView)->setText(visitsSummary);
-    QString doctorsSummary = "Приёмы по неделям:\n";
-    for (int i = 0; i < weekKeys.size(); ++i) {
-        doctorsSummary += QString("%1: %2\n").arg(categories.value(i)).arg(doctorsPerWeek.value(weekKeys[i],0));
-    }
-    static_cast<QLabel*>(doctorsChartView)->setText(doctorsSummary);
 #endif
 }
 
-void StatisticsWidget::buildTopLists() {
-    QList<Appointment> appts = dm->getAllAppointments();
-    QMap<int,int> countByPatient;
-    QMap<int,int> countByDoctor;
-    for (const Appointment &a : appts) {
-        countByPatient[a.id_patient] += 1;
-        countByDoctor[a.id_doctor] += 1;
+// Per-doctor drill-down of a day range, answered from the rollup.
+void StatisticsWidget::showDoctorBreakdown(qint64 firstDay, qint64 lastDay, const QString &title) {
+    const QList<QPair<int,int>> doctorList = rankByCount(dm->getStatisticsRollup().countByDoctor(firstDay, lastDay));
+
+    QDialog dlg(this);
+    dlg.setWindowTitle(title);
+    QVBoxLayout *l = new QVBoxLayout(&dlg);
+    QTableWidget *table = new QTableWidget(doctorList.size(), 3, &dlg);
+    table->setHorizontalHeaderLabels(QStringList{"Врач", "Специальность", "Приёмов"});
+    table->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    for (int row = 0; row < doctorList.size(); ++row) {
+        Doctor doc = dm->getDoctorById(doctorList[row].first);
+        QString label = doc.fullName().trimmed().isEmpty() ? QString("Врач %1").arg(doctorList[row].first) : formatShortPerson(doc.lname, doc.fname, doc.tname, doc.id_doctor);
+        table->setItem(row, 0, new QTableWidgetItem(label));
+        table->setItem(row, 1, new QTableWidgetItem(dm->getSpecializationById(doc.id_spec).name));
+        table->setItem(row, 2, new QTableWidgetItem(QString::number(doctorList[row].second)));
     }
+    table->resizeColumnsToContents();
+    l->addWidget(table);
+    if (doctorList.isEmpty()) l->addWidget(new QLabel("Нет приёмов за выбранный период"));
+    QPushButton *close = new QPushButton("Закрыть");
+    connect(close, &QPushButton::clicked, &dlg, &QDialog::accept);
+    l->addWidget(close, 0, Qt::AlignRight);
+    dlg.resize(520, 360);
+    dlg.exec();
+}
+
+void StatisticsWidget::showTopLists(const TopStatistics &stats) {
+#ifdef USE_QT_CHARTS
     // Top patients
-    QList<QPair<int,int>> patientList;
-    for (auto it = countByPatient.begin(); it != countByPatient.end(); ++it) patientList.append({it.key(), it.value()});
-    std::stable_sort(patientList.begin(), patientList.end(), [](const QPair<int,int>& a, const QPair<int,int>& b){ return a.second > b.second; });
-
-    #ifdef USE_QT_CHARTS
-        QPieSeries *ps = new QPieSeries();
-        int added = 0;
-        for (const auto &p : patientList) {
-            if (added >= 5) break; // show only top 5
-            Patient pat = dm->getPatientById(p.first);
-            QString label = pat.fullName().isEmpty() ? QString("Пациент %1").arg(p.first) : formatShortPerson(pat.lname, pat.fname, pat.tname, pat.id_patient);
-            QPieSlice *slice = ps->append(label, p.second);
-            ++added;
+    QPieSeries *ps = new QPieSeries();
+    for (int i = 0; i < stats.patients.size() && i < 5; ++i) { // show only top 5
+        ps->append(stats.patients[i].label, stats.patients[i].count);
+    }
+    QChart *chart = new QChart();
+    chart->addSeries(ps);
+    chart->setTitle("Топ пациентов по количеству приёмов");
+    {
+        ResizableWidget *wrap = static_cast<ResizableWidget*>(topPatientsChartView);
+        QChartView *v = wrap ? wrap->inner<QChartView>() : nullptr;
+        if (v) {
+            v->setChart(chart);
+            v->setRenderHint(QPainter::Antialiasing);
+            // enable hover tooltips + подсветка как у диаграммы врачей
+            for (QPieSlice *s : ps->slices()) {
+                s->setLabelVisible(false);
+                connect(s, &QPieSlice::hovered, this, [=](bool state){
+                    s->setLabelVisible(state);
+                    s->setExploded(state);
+                    if (!state) { QToolTip::hideText(); return; }
+                    QString txt = QString("%1 — %2 приёмов").arg(s->label()).arg((int)s->value());
+                    QToolTip::showText(QCursor::pos(), txt);
+                });
+            }
         }
-                    QChart *chart = new QChart();
-                    chart->addSeries(ps);
-                chart->setTitle("Топ пациентов по количеству приёмов");
-                {
-                    ResizableWidget *wrap = static_cast<ResizableWidget*>(topPatientsChartView);
-                    QChartView *v = wrap ? wrap->inner<QChartView>() : nullptr;
-                    if (v) {
-                        v->setChart(chart);
-                        v->setRenderHint(QPainter::Antialiasing);
-                        // enable hover tooltips + подсветка как у диаграммы врачей
-                        for (QPieSlice *s : ps->slices()) {
-                            s->setLabelVisible(false);
-                            connect(s, &QPieSlice::hovered, this, [=](bool state){
-                                s->setLabelVisible(state);
-                                s->setExploded(state);
-                                if (!state) { QToolTip::hideText(); return; }
-                                QString txt = QString("%1 — %2 приёмов").arg(s->label()).arg((int)s->value());
-                                QToolTip::showText(QCursor::pos(), txt);
-                            });
-                        }
-                    }
-                }
+    }
 
     // Top doctors - show as a pie chart (hover shows slice label + details)
-    QList<QPair<int,int>> doctorList;
-    for (auto it = countByDoctor.begin(); it != countByDoctor.end(); ++it) doctorList.append({it.key(), it.value()});
-    std::stable_sort(doctorList.begin(), doctorList.end(), [](const QPair<int,int>& a, const QPair<int,int>& b){ return a.second > b.second; });
     QPieSeries *dps = new QPieSeries();
-    int dadded = 0;
-    for (const auto &d : doctorList) {
-        if (dadded >= 8) break; // show top 8 as pie slices
-        Doctor doc = dm->getDoctorById(d.first);
-        QString label = doc.fullName().isEmpty() ? QString("Врач %1").arg(d.first) : formatShortPerson(doc.lname, doc.fname, doc.tname, doc.id_doctor);
-        QPieSlice *slice = dps->append(label, d.second);
+    QHash<QPieSlice*, QString> details;
+    for (int i = 0; i < stats.doctors.size() && i < 8; ++i) { // show top 8 as pie slices
+        QPieSlice *slice = dps->append(stats.doctors[i].label, stats.doctors[i].count);
         slice->setLabelVisible(false);
-        ++dadded;
+        details.insert(slice, stats.doctors[i].detail);
     }
     QChart *chartD = new QChart();
     chartD->addSeries(dps);
@@ -665,6 +720,7 @@ void StatisticsWidget::buildTopLists() {
             v->setRenderHint(QPainter::Antialiasing);
             // show tooltip and toggle slice label on hover
             for (QPieSlice *s : dps->slices()) {
+                const QString detail = details.value(s);
                 connect(s, &QPieSlice::hovered, this, [=](bool state){
                     if (!state) {
                         s->setLabelVisible(false);
@@ -672,19 +728,9 @@ void StatisticsWidget::buildTopLists() {
                     }
                     s->setLabelVisible(true);
                     int val = (int)s->value();
-                    QString label = s->label();
-                    // attempt to find doctor id from label by searching doctorList: fallback info will be label only
-                    QString extra = QString("Приёмов: %1").arg(val);
-                    // try to find specialization for nicer tooltip (best-effort)
-                    for (const auto &dp : doctorList) {
-                        Doctor doc2 = dm->getDoctorById(dp.first);
-                        QString shortLabel = doc2.fullName().isEmpty() ? QString("Врач %1").arg(doc2.id_doctor) : formatShortPerson(doc2.lname, doc2.fname, doc2.tname, doc2.id_doctor);
-                        if (shortLabel == label) {
-                            Specialization spec = dm->getSpecializationById(doc2.id_spec);
-                            extra = QString("%1\nСпециальность: %2\nПриёмов: %3").arg(label).arg(spec.name).arg(val);
-                            break;
-                        }
-                    }
+                    QString extra = detail.isEmpty()
+                        ? QString("Приёмов: %1").arg(val)
+                        : QString("%1\n%2\nПриёмов: %3").arg(s->label(), detail).arg(val);
                     QToolTip::showText(QCursor::pos(), extra);
                 });
             }
@@ -693,32 +739,20 @@ void StatisticsWidget::buildTopLists() {
 #else
     // Charts not available: show text summaries with limits
     QString topPatientsText = "Топ пациентов:\n";
-    int maxDisplay = 10;
-    int count = 0;
-    for (const auto &p : patientList) {
-        if (count++ >= maxDisplay) {
-            topPatientsText += "... (и еще " + QString::number(patientList.size() - maxDisplay) + ")\n";
-            break;
-        }
-        Patient pat = dm->getPatientById(p.first);
-        QString label = pat.fullName().isEmpty() ? QString("Пациент %1").arg(p.first) : formatShortPerson(pat.lname, pat.fname, pat.tname, pat.id_patient);
-        topPatientsText += QString("%1 — %2\n").arg(label).arg(p.second);
+    for (const TopStatistics::Entry &e : stats.patients) {
+        topPatientsText += QString("%1 — %2\n").arg(e.label).arg(e.count);
+    }
+    if (stats.patientTotal > stats.patients.size()) {
+        topPatientsText += "... (и еще " + QString::number(stats.patientTotal - stats.patients.size()) + ")\n";
     }
     static_cast<QLabel*>(topPatientsChartView)->setText(topPatientsText);
 
     QString topDoctorsText = "Топ врачей:\n";
-    count = 0;
-    QList<QPair<int,int>> doctorList;
-    for (auto it = countByDoctor.begin(); it != countByDoctor.end(); ++it) doctorList.append({it.key(), it.value()});
-    std::stable_sort(doctorList.begin(), doctorList.end(), [](const QPair<int,int>& a, const QPair<int,int>& b){ return a.second > b.second; });
-    for (const auto &d : doctorList) {
-        if (count++ >= maxDisplay) {
-            topDoctorsText += "... (и еще " + QString::number(doctorList.size() - maxDisplay) + ")\n";
-            break;
-        }
-        Doctor doc = dm->getDoctorById(d.first);
-        QString label = doc.fullName().isEmpty() ? QString("Врач %1").arg(d.first) : formatShortPerson(doc.lname, doc.fname, doc.tname, doc.id_doctor);
-        topDoctorsText += QString("%1 — %2\n").arg(label).arg(d.second);
+    for (const TopStatistics::Entry &e : stats.doctors) {
+        topDoctorsText += QString("%1 — %2\n").arg(e.label).arg(e.count);
+    }
+    if (stats.doctorTotal > stats.doctors.size()) {
+        topDoctorsText += "... (и еще " + QString::number(stats.doctorTotal - stats.doctors.size()) + ")\n";
     }
     static_cast<QLabel*>(topDoctorsChartView)->setText(topDoctorsText);
 #endif
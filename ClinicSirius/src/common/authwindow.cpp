@@ -68,8 +68,7 @@ void AuthWindow::onLoginSuccess(int userId, int userType) {
     currentUserType = userType;
 
     // Собираем данные пользователя для передачи дальше
-    QString dataPath = QCoreApplication::applicationDirPath() + "/../data";
-    DataManager dm(dataPath);
+    DataManager& dm = DataManager::shared();
     LoginUser user;
     user.id = userId;
 
@@ -0,0 +1,260 @@
+#include "binarysnapshot.h"
+#include <QFile>
+#include <QFileInfo>
+#include <QDir>
+#include <QSaveFile>
+#include <QCryptographicHash>
+#include <QHash>
+#include <QVector>
+#include <QtEndian>
+#include <QDebug>
+#include <cstring>
+#include <limits>
+
+// File layout (all integers little-endian):
+//   0  char[4] magic "CSBS"     4  u32 version      8  u32 table kind
+//  12  u32 row count           16  i64 JSON size   24  i64 JSON mtime (ms)
+//  32  u8[16] JSON MD5         48  u32 record size 52  u32 pool entries
+//  56  u32 pool offset         60  u32 reserved
+//  64  records, then the pool: per string u32 byte length + UTF-8 bytes.
+static const char kMagic[4] = {'C', 'S', 'B', 'S'};
+static const quint32 kVersion = 1;
+static const int kHeaderSize = 64;
+static const qint32 kNoTime = std::numeric_limits<qint32>::min();
+
+static const quint32 kAppointmentKind = 1;
+static const quint32 kScheduleKind = 2;
+static const quint32 kAppointmentRecord = 6 * 4;  // id, patient, doctor, slot, date, completed
+static const quint32 kScheduleRecord = 6 * 4;     // id, doctor, room, from, to, status
+
+static void putU32(QByteArray& out, quint32 value) {
+    uchar bytes[4];
+    qToLittleEndian(value, bytes);
+    out.append(reinterpret_cast<const char*>(bytes), 4);
+}
+
+static void putI32(QByteArray& out, qint32 value) {
+    putU32(out, static_cast<quint32>(value));
+}
+
+static void putI64(QByteArray& out, qint64 value) {
+    uchar bytes[8];
+    qToLittleEndian(value, bytes);
+    out.append(reinterpret_cast<const char*>(bytes), 8);
+}
+
+static quint32 getU32(const uchar* p) { return qFromLittleEndian<quint32>(p); }
+static qint32 getI32(const uchar* p) { return qFromLittleEndian<qint32>(p); }
+static qint64 getI64(const uchar* p) { return qFromLittleEndian<qint64>(p); }
+
+// Timestamps are whole minutes since the epoch; a row with seconds can't be
+// stored and keeps its table on JSON.
+static bool toMinutes(const QDateTime& dt, qint32& minutes) {
+    if (!dt.isValid()) {
+        minutes = kNoTime;
+        return true;
+    }
+    qint64 secs = dt.toSecsSinceEpoch();
+    if (secs % 60 != 0 || dt.time().msec() != 0) return false;
+    qint64 value = secs / 60;
+    if (value <= kNoTime || value > std::numeric_limits<qint32>::max()) return false;
+    minutes = static_cast<qint32>(value);
+    return true;
+}
+
+static QDateTime fromMinutes(qint32 minutes) {
+    return minutes == kNoTime ? QDateTime() : QDateTime::fromSecsSinceEpoch(qint64(minutes) * 60);
+}
+
+static QByteArray fileMd5(const QString& path) {
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) return QByteArray();
+    QCryptographicHash hash(QCryptographicHash::Md5);
+    hash.addData(&file);
+    return hash.result();
+}
+
+static bool writeSidecar(const QString& jsonPath, quint32 kind, quint32 rowCount, quint32 recordSize,
+                         const QByteArray& records, const QStringList& pool) {
+    QFileInfo info(jsonPath);
+    QByteArray md5 = fileMd5(jsonPath);
+    if (!info.exists() || md5.size() != 16) return false;
+
+    QByteArray out;
+    out.reserve(kHeaderSize + records.size());
+    out.append(kMagic, 4);
+    putU32(out, kVersion);
+    putU32(out, kind);
+    putU32(out, rowCount);
+    putI64(out, info.size());
+    putI64(out, info.lastModified().toMSecsSinceEpoch());
+    out.append(md5);
+    putU32(out, recordSize);
+    putU32(out, static_cast<quint32>(pool.size()));
+    putU32(out, static_cast<quint32>(kHeaderSize + records.size()));
+    putU32(out, 0);
+    out.append(records);
+    for (const QString& s : pool) {
+        QByteArray utf8 = s.toUtf8();
+        putU32(out, static_cast<quint32>(utf8.size()));
+        out.append(utf8);
+    }
+
+    QSaveFile file(BinarySnapshot::sidecarPath(jsonPath));
+    if (!file.open(QIODevice::WriteOnly) || file.write(out) != out.size() || !file.commit()) {
+        qWarning() << "BinarySnapshot: cannot write" << file.fileName() << file.errorString();
+        return false;
+    }
+    return true;
+}
+
+// Read-only mapping of a sidecar that has been checked against its JSON.
+class MappedSidecar {
+public:
+    ~MappedSidecar() {
+        if (base) file.unmap(base);
+    }
+
+    bool open(const QString& jsonPath, quint32 kind, quint32 recordSize) {
+        QFileInfo json(jsonPath);
+        if (!json.exists()) return false;
+        file.setFileName(BinarySnapshot::sidecarPath(jsonPath));
+        if (!file.open(QIODevice::ReadOnly)) return false;
+        qint64 size = file.size();
+        if (size < kHeaderSize) return false;
+        base = file.map(0, size);
+        if (!base) return false;
+
+        if (std::memcmp(base, kMagic, 4) != 0 || getU32(base + 4) != kVersion
+                || getU32(base + 8) != kind || getU32(base + 48) != recordSize) {
+            return false;
+        }
+        if (getI64(base + 16) != json.size()) return false;
+        if (getI64(base + 24) != json.lastModified().toMSecsSinceEpoch()) {
+            // Touched or copied without changes: accept if the content matches
+            QByteArray stored(reinterpret_cast<const char*>(base + 32), 16);
+            if (fileMd5(jsonPath) != stored) return false;
+        }
+
+        rowCount = getU32(base + 12);
+        qint64 poolOffset = getU32(base + 56);
+        if (poolOffset != kHeaderSize + qint64(rowCount) * recordSize || poolOffset > size) {
+            qWarning() << "BinarySnapshot: corrupt" << file.fileName();
+            return false;
+        }
+        quint32 poolCount = getU32(base + 52);
+        qint64 pos = poolOffset;
+        pool.reserve(poolCount);
+        for (quint32 i = 0; i < poolCount; ++i) {
+            if (pos + 4 > size) return false;
+            quint32 length = getU32(base + pos);
+            pos += 4;
+            if (pos + length > size) return false;
+            pool.append(QString::fromUtf8(reinterpret_cast<const char*>(base + pos), int(length)));
+            pos += length;
+        }
+        records = base + kHeaderSize;
+        this->recordSize = recordSize;
+        return true;
+    }
+
+    const uchar* record(quint32 i) const { return records + qint64(i) * recordSize; }
+
+    QFile file;
+    uchar* base = nullptr;
+    const uchar* records = nullptr;
+    quint32 recordSize = 0;
+    quint32 rowCount = 0;
+    QVector<QString> pool;
+};
+
+QString BinarySnapshot::sidecarPath(const QString& jsonPath) {
+    QFileInfo info(jsonPath);
+    return info.dir().filePath(info.completeBaseName() + ".bin");
+}
+
+bool BinarySnapshot::load(const QString& jsonPath, QList<Appointment>& rows) {
+    MappedSidecar map;
+    if (!map.open(jsonPath, kAppointmentKind, kAppointmentRecord)) return false;
+
+    rows.clear();
+    rows.reserve(int(map.rowCount));
+    for (quint32 i = 0; i < map.rowCount; ++i) {
+        const uchar* r = map.record(i);
+        Appointment a;
+        a.id_ap = getI32(r);
+        a.id_patient = getI32(r + 4);
+        a.id_doctor = getI32(r + 8);
+        a.id_ap_sch = getI32(r + 12);
+        a.date = fromMinutes(getI32(r + 16));
+        a.completed = getI32(r + 20) != 0;
+        rows.append(a);
+    }
+    return true;
+}
+
+bool BinarySnapshot::load(const QString& jsonPath, QList<AppointmentSchedule>& rows) {
+    MappedSidecar map;
+    if (!map.open(jsonPath, kScheduleKind, kScheduleRecord)) return false;
+
+    rows.clear();
+    rows.reserve(int(map.rowCount));
+    for (quint32 i = 0; i < map.rowCount; ++i) {
+        const uchar* r = map.record(i);
+        qint32 status = getI32(r + 20);
+        if (status < 0 || status >= map.pool.size()) {
+            qWarning() << "BinarySnapshot: bad string index in" << map.file.fileName();
+            rows.clear();
+            return false;
+        }
+        AppointmentSchedule s;
+        s.id_ap_sch = getI32(r);
+        s.id_doctor = getI32(r + 4);
+        s.id_room = getI32(r + 8);
+        s.time_from = fromMinutes(getI32(r + 12));
+        s.time_to = fromMinutes(getI32(r + 16));
+        s.status = map.pool.at(status);
+        rows.append(s);
+    }
+    return true;
+}
+
+bool BinarySnapshot::save(const QString& jsonPath, const QList<Appointment>& rows) {
+    QByteArray records;
+    records.reserve(rows.size() * int(kAppointmentRecord));
+    for (const Appointment& a : rows) {
+        qint32 date;
+        if (!toMinutes(a.date, date)) return false;
+        putI32(records, a.id_ap);
+        putI32(records, a.id_patient);
+        putI32(records, a.id_doctor);
+        putI32(records, a.id_ap_sch);
+        putI32(records, date);
+        putI32(records, a.completed ? 1 : 0);
+    }
+    return writeSidecar(jsonPath, kAppointmentKind, quint32(rows.size()), kAppointmentRecord, records, QStringList());
+}
+
+bool BinarySnapshot::save(const QString& jsonPath, const QList<AppointmentSchedule>& rows) {
+    QByteArray records;
+    records.reserve(rows.size() * int(kScheduleRecord));
+    QStringList pool;
+    QHash<QString, int> poolIndex;
+    for (const AppointmentSchedule& s : rows) {
+        qint32 from, to;
+        if (!toMinutes(s.time_from, from) || !toMinutes(s.time_to, to)) return false;
+        int status = poolIndex.value(s.status, -1);
+        if (status < 0) {
+            status = pool.size();
+            poolIndex.insert(s.status, status);
+            pool.append(s.status);
+        }
+        putI32(records, s.id_ap_sch);
+        putI32(records, s.id_doctor);
+        putI32(records, s.id_room);
+        putI32(records, from);
+        putI32(records, to);
+        putI32(records, status);
+    }
+    return writeSidecar(jsonPath, kScheduleKind, quint32(rows.size()), kScheduleRecord, records, pool);
+}
@@ -1,13 +1,73 @@
 #include "datamanager.h"
 #include "models.h"
+#include "binarysnapshot.h"
+#include "histogramkernels.h"
+#include "dataservice.h"
 #include <QFile>
+#include <QSaveFile>
 #include <QDir>
+#include <QFileInfo>
 #include <QJsonDocument>
+#include <QCryptographicHash>
 #include <QCoreApplication>
 #include <QDebug>
+#include <QHash>
+#include <QSet>
+#include <QPair>
+#include <QFutureInterface>
+#include <QLockFile>
+#include <QUuid>
+#include <QRandomGenerator>
+#include <QtConcurrent/QtConcurrent>
+#include <algorithm>
 #include <cstdlib>
 #include <ctime>
 
+// Journal size after which a commit triggers compaction.
+static const qint64 kJournalCompactThreshold = 4 * 1024 * 1024;
+static const char* const kSequenceFile = "sequence.json";
+static const char* const kRollupFile = "statistics_rollup.json";
+static const int kRollupVersion = 1;
+static const char* const kJournalFile = "journal.log";
+// How long to wait for another process to release a lock.
+static const int kLockTimeoutMs = 10000;
+// Attempts at writing one batch before it is given up.
+static const int kMaxWriteAttempts = 3;
+// A batch that only lost the race for its tables' stamps is retried on top
+// of the other process's rows without counting as a failed attempt: each
+// such loss means that process got its batch in. This bound only stops a
+// stamp that reading the journal never catches up with.
+static const int kMaxStampRetries = 100;
+// Ids claimed from sequence.json at a time.
+static const int kIdBlock = 16;
+
+// One DataStore per resolved data directory, shared by all DataManager
+// instances that point at it.
+static QHash<QString, QSharedPointer<DataStore>>& sharedStores() {
+    static QHash<QString, QSharedPointer<DataStore>> stores;
+    return stores;
+}
+
+static QSharedPointer<DataStore> sharedStoreFor(const QString& path) {
+    QSharedPointer<DataStore>& s = sharedStores()[path];
+    if (!s) {
+        s = QSharedPointer<DataStore>::create();
+        // One storage thread per directory keeps its writes in order
+        s->storage.setMaxThreadCount(1);
+        s->storage.setExpiryTimeout(-1);
+        s->writerId = QUuid::createUuid().toString(QUuid::WithoutBraces);
+    }
+    return s;
+}
+
+static QFuture<bool> readyFuture(bool value) {
+    QFutureInterface<bool> result;
+    result.reportStarted();
+    result.reportResult(value);
+    result.reportFinished();
+    return result.future();
+}
+
 DataManager::DataManager(const QString& requestedPath) {
     // Resolve the data path: prefer the requested path, otherwise try
     // several sensible fallbacks so the app works when run from build dirs.
@@ -48,6 +108,17 @@ DataManager::DataManager(const QString& requestedPath) {
         qWarning() << "Tried:" << candidates;
         qWarning() << "Falling back to" << dataPath << "(may fail to open files).";
     }
+
+    store = sharedStoreFor(dataPath);
+}
+
+DataManager& DataManager::shared() {
+    static DataManager instance;
+    return instance;
+}
+
+DataEvents* DataManager::events() const {
+    return &store->events;
 }
 
 QJsonArray DataManager::loadJson(const QString& filename) const {
@@ -91,148 +162,1978 @@ QJsonArray DataManager::loadJson(const QString& filename) const {
     return QJsonArray();
 }
 
-void DataManager::saveJson(const QString& filename, const QJsonArray& data) {
-    QDir dir(dataPath);
+// The write helpers below run on the storage thread and only touch what
+// they are given.
+static bool writeJsonFile(const QString& filePath, const QJsonArray& data) {
+    QDir dir = QFileInfo(filePath).dir();
     if (!dir.exists()) {
         dir.mkpath("."); // Ensure data directory exists before writing
     }
 
-    QString filePath = dir.filePath(filename);
-    QFile file(filePath);
+    // QSaveFile writes to a temporary file and renames it on commit, so a
+    // crash mid-write never leaves a truncated table behind.
+    QSaveFile file(filePath);
 
     if (!file.open(QIODevice::WriteOnly)) {
         qWarning() << "Cannot write to file:" << filePath;
-        return;
+        return false;
     }
 
     QJsonDocument doc(data);
     file.write(doc.toJson());
-    file.close();
+    if (!file.commit()) {
+        qWarning() << "Cannot commit file:" << filePath << file.errorString();
+        return false;
+    }
+    return true;
 }
 
-// Patient operations
-QList<Patient> DataManager::getAllPatients() const {
-    QList<Patient> patients;
-    QJsonArray array = loadJson("patient.json");
+// Journal format: one entry per line, "<md5 of payload> <compact JSON>\n".
+// The checksum lets replay detect a torn or corrupted tail. A batch ends
+// with a "commit" marker naming the writing process, its entry count and
+// its tables' new stamps; a new file starts with a "begin" line naming its
+// generation.
+static QByteArray journalLine(const QJsonObject& obj) {
+    QByteArray payload = QJsonDocument(obj).toJson(QJsonDocument::Compact);
+    return QCryptographicHash::hash(payload, QCryptographicHash::Md5).toHex() + ' ' + payload + '\n';
+}
 
-    for (const QJsonValue& value : array) {
-        patients.append(Patient::fromJson(value.toObject()));
+static bool parseJournalLine(const QByteArray& line, QJsonObject& obj) {
+    int sep = line.indexOf(' ');
+    QByteArray payload = line.mid(sep + 1);
+    if (sep <= 0 || QCryptographicHash::hash(payload, QCryptographicHash::Md5).toHex() != line.left(sep)) {
+        return false;
     }
-    return patients;
+    obj = QJsonDocument::fromJson(payload).object();
+    return true;
 }
 
-Patient DataManager::getPatientById(int id) const {
-    QJsonArray array = loadJson("patient.json");
+static bool appendJournal(const QString& path, const QByteArray& batch) {
+    QDir dir = QFileInfo(path).dir();
+    if (!dir.exists()) {
+        dir.mkpath(".");
+    }
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Append)) {
+        qWarning() << "Cannot append to journal:" << file.fileName() << file.errorString();
+        return false;
+    }
+    QByteArray data = batch;
+    if (file.size() == 0) {
+        // A new journal starts with its generation, so that readers notice
+        // when a compaction has replaced the file they were reading
+        QJsonObject header;
+        header["op"] = "begin";
+        header["generation"] = QUuid::createUuid().toString(QUuid::WithoutBraces);
+        data.prepend(journalLine(header));
+    }
+    if (file.write(data) != data.size() || !file.flush()) {
+        qWarning() << "Cannot write journal:" << file.fileName() << file.errorString();
+        return false;
+    }
+    return true;
+}
 
-    for (const QJsonValue& value : array) {
-        Patient p = Patient::fromJson(value.toObject());
-        if (p.id_patient == id) {
-            return p;
+// A committed batch read back from the journal: its entries, the process
+// that wrote it, the new stamps of its tables and its offset in the file.
+struct JournalBatch {
+    qint64 start = 0;
+    QString writer;
+    QHash<QString, quint64> stamps;
+    QList<QPair<QString, JournalEntry>> entries;
+};
+
+struct JournalRead {
+    QString generation;
+    bool replaced = false;  // not the generation asked for; read from the start
+    qint64 end = 0;         // just past the last committed batch
+    QList<JournalBatch> batches;
+};
+
+// Batches committed to the journal past offset from, or all of them if the
+// file is no longer of the given generation. Entries only take effect once
+// their batch's "commit" marker is read, and only if the marker counts all
+// of them: a batch cut short by a crash is dropped as a whole, and one still
+// being appended by another process is left for the next read.
+static JournalRead readJournalFrom(const QString& path, const QString& generation, qint64 from) {
+    JournalRead read;
+    QFile file(path);
+    if (!file.exists()) {
+        // Absent between a compaction and the next commit
+        read.replaced = !generation.isEmpty() || from > 0;
+        return read;
+    }
+    if (!file.open(QIODevice::ReadOnly)) {
+        qWarning() << "Cannot open journal:" << file.fileName() << file.errorString();
+        read.generation = generation;
+        read.end = from;
+        return read;
+    }
+    qint64 start = 0;
+    const QByteArray head = file.readLine();
+    QJsonObject header;
+    if (head.endsWith('\n') && parseJournalLine(head.chopped(1), header) && header["op"].toString() == "begin") {
+        read.generation = header["generation"].toString();
+        start = head.size();
+    }
+    if (read.generation != generation || from > file.size()) {
+        read.replaced = true;
+        from = 0;
+    }
+    from = std::max(from, start);
+    read.end = from;
+    if (!file.seek(from)) return read;
+    const QByteArray data = file.readAll();
+
+    JournalBatch batch;
+    bool inBatch = false;
+    int pos = 0;
+    for (int next = data.indexOf('\n'); next >= 0; pos = next + 1, next = data.indexOf('\n', pos)) {
+        const QByteArray line = data.mid(pos, next - pos);
+        if (line.isEmpty()) continue;
+        QJsonObject obj;
+        if (!parseJournalLine(line, obj)) {
+            qWarning() << "Journal: checksum mismatch in" << file.fileName() << "- dropping its batch";
+            batch = JournalBatch();
+            inBatch = false;
+            continue;
+        }
+        if (!inBatch) {
+            batch.start = from + pos;
+            inBatch = true;
+        }
+        if (obj["op"].toString() == "commit") {
+            if (obj.contains("count") && obj["count"].toInt() != batch.entries.size()) {
+                qWarning() << "Journal: dropping an incomplete batch of" << file.fileName();
+            } else {
+                batch.writer = obj["writer"].toString();
+                const QJsonObject stamps = obj["stamps"].toObject();
+                for (auto it = stamps.constBegin(); it != stamps.constEnd(); ++it) {
+                    batch.stamps.insert(it.key(), it.value().toString().toULongLong());
+                }
+                read.batches.append(batch);
+            }
+            read.end = from + next + 1;
+            batch = JournalBatch();
+            inBatch = false;
+            continue;
         }
+        JournalEntry entry;
+        entry.op = obj["op"].toString();
+        entry.id = obj["id"].toInt(-1);
+        entry.record = obj["record"].toObject();
+        batch.entries.append(qMakePair(obj["table"].toString(), entry));
     }
-    return Patient();
+    return read;
 }
 
-void DataManager::addPatient(const Patient& patient) {
-    QJsonArray array = loadJson("patient.json");
-    array.append(patient.toJson());
-    saveJson("patient.json", array);
+// Stamp of a table's current version on disk; 0 until a batch changes it.
+static QString stampPath(const QString& dir, const QString& table) {
+    return QDir(dir).filePath(table + ".version");
 }
 
-void DataManager::updatePatient(const Patient& patient) {
-    QJsonArray array = loadJson("patient.json");
+static quint64 readStamp(const QString& dir, const QString& table) {
+    QFile file(stampPath(dir, table));
+    if (!file.open(QIODevice::ReadOnly)) return 0;
+    return file.readAll().trimmed().toULongLong();
+}
 
-    for (int i = 0; i < array.size(); ++i) {
-        QJsonObject obj = array[i].toObject();
-        if (obj["id_patient"].toInt() == patient.id_patient) {
-            array[i] = patient.toJson();
-            saveJson("patient.json", array);
+static bool writeStamp(const QString& dir, const QString& table, quint64 stamp) {
+    QSaveFile file(stampPath(dir, table));
+    const QByteArray data = QByteArray::number(stamp) + '\n';
+    if (!file.open(QIODevice::WriteOnly) || file.write(data) != data.size() || !file.commit()) {
+        qWarning() << "Cannot write stamp:" << file.fileName() << file.errorString();
+        return false;
+    }
+    return true;
+}
+
+// Stamps are random rather than counted, so two processes that both built
+// on the same version never produce the same next one.
+static quint64 newStamp() {
+    quint64 stamp = 0;
+    while (stamp == 0) {
+        stamp = QRandomGenerator::global()->generate64();
+    }
+    return stamp;
+}
+
+// Advisory locks on files of the data directory (<name>.lock), taken in name
+// order so that two processes never wait for each other, and released on
+// destruction. Whoever holds several also takes them all at once.
+class DirectoryLocks {
+public:
+    DirectoryLocks(const QString& dir, QStringList names) {
+        std::sort(names.begin(), names.end());
+        for (const QString& name : names) {
+            QSharedPointer<QLockFile> lock(new QLockFile(QDir(dir).filePath(name + ".lock")));
+            if (!lock->tryLock(kLockTimeoutMs)) {
+                qWarning() << "Cannot lock" << name << "in" << dir << "- error" << lock->error();
+                acquired = false;
+                return;
+            }
+            locks.append(lock);
+        }
+    }
+
+    bool ok() const { return acquired; }
+
+private:
+    QList<QSharedPointer<QLockFile>> locks;
+    bool acquired = true;
+};
+
+// Appends one batch under the locks of its tables, unless another process
+// wrote one of them since the batch was built (its stamp moved). The journal
+// has a lock of its own, taken last, since batches of different tables
+// append to it at the same time.
+static int appendBatch(const QString& dir, const QString& journal, const QByteArray& batch,
+                       const QHash<QString, quint64>& expected, const QHash<QString, quint64>& stamps) {
+    DirectoryLocks tables(dir, expected.keys());
+    if (!tables.ok()) return JournalWrite::Failed;
+    for (auto it = expected.constBegin(); it != expected.constEnd(); ++it) {
+        if (readStamp(dir, it.key()) != it.value()) return JournalWrite::Conflict;
+    }
+    {
+        DirectoryLocks appending(dir, {kJournalFile});
+        if (!appending.ok() || !appendJournal(journal, batch)) return JournalWrite::Failed;
+    }
+    // The batch is in the journal either way; a stamp left behind only
+    // costs the next writer of that table a retry
+    for (auto it = stamps.constBegin(); it != stamps.constEnd(); ++it) {
+        writeStamp(dir, it.key(), it.value());
+    }
+    return JournalWrite::Written;
+}
+
+// sequence.json is shared by every process on the directory: ids are
+// claimed from it, and the rest of the counters merged into it, under its
+// lock, and it only ever moves forward.
+static QHash<QString, int> readSequenceFile(const QString& dir) {
+    QHash<QString, int> next;
+    // Optional: absent until the first claim or compaction
+    QFile file(QDir(dir).filePath(kSequenceFile));
+    if (!file.open(QIODevice::ReadOnly)) return next;
+    const QJsonArray sequences = QJsonDocument::fromJson(file.readAll()).array();
+    for (const QJsonValue& value : sequences) {
+        QJsonObject obj = value.toObject();
+        next.insert(obj["table"].toString(), obj["next_id"].toInt());
+    }
+    return next;
+}
+
+static bool writeSequenceFile(const QString& dir, const QHash<QString, int>& next) {
+    QJsonArray sequences;
+    for (auto it = next.constBegin(); it != next.constEnd(); ++it) {
+        QJsonObject obj;
+        obj["table"] = it.key();
+        obj["next_id"] = it.value();
+        sequences.append(obj);
+    }
+    return writeJsonFile(QDir(dir).filePath(kSequenceFile), sequences);
+}
+
+static bool storeSequences(const QString& dir, const QHash<QString, int>& next) {
+    DirectoryLocks lock(dir, {kSequenceFile});
+    if (!lock.ok()) return false;
+    QHash<QString, int> merged = readSequenceFile(dir);
+    for (auto it = next.constBegin(); it != next.constEnd(); ++it) {
+        merged[it.key()] = std::max(merged.value(it.key()), it.value());
+    }
+    return writeSequenceFile(dir, merged);
+}
+
+// First of count ids of the table claimed for this process, from at least
+// from; -1 if sequence.json could not be updated.
+static int claimIds(const QString& dir, const QString& table, int from, int count) {
+    DirectoryLocks lock(dir, {kSequenceFile});
+    if (!lock.ok()) return -1;
+    QHash<QString, int> next = readSequenceFile(dir);
+    const int first = std::max(next.value(table), from);
+    next[table] = first + count;
+    return writeSequenceFile(dir, next) ? first : -1;
+}
+
+// Size and modification time of the JSON files the rollup is derived from.
+// A saved rollup is only trusted while these still match and none of the
+// tables has changes that are not in its JSON yet.
+static QStringList rollupTables(const DataStore& s) {
+    return {s.appointments.filename, s.doctors.filename, s.schedules.filename};
+}
+
+static QJsonObject rollupSources(const QString& dataPath, const QStringList& tables) {
+    QJsonObject sources;
+    for (const QString& name : tables) {
+        QFileInfo info(QDir(dataPath).filePath(name));
+        QJsonArray stamp;
+        stamp.append(info.exists() ? double(info.size()) : -1.0);
+        stamp.append(info.exists() ? double(info.lastModified().toMSecsSinceEpoch()) : -1.0);
+        sources[name] = stamp;
+    }
+    return sources;
+}
+
+static bool writeRollup(const QString& dataPath, const QStringList& tables, const StatisticsRollup& rollup) {
+    QJsonArray cells;
+    for (auto day = rollup.days.constBegin(); day != rollup.days.constEnd(); ++day) {
+        for (auto it = day->constBegin(); it != day->constEnd(); ++it) {
+            QJsonArray cell;
+            cell.append(double(day.key()));
+            cell.append(it.key().doctor);
+            cell.append(it.key().spec);
+            cell.append(it.key().room);
+            cell.append(it.key().completed ? 1 : 0);
+            cell.append(it.value());
+            cells.append(cell);
+        }
+    }
+    QJsonObject root;
+    root["version"] = kRollupVersion;
+    root["sources"] = rollupSources(dataPath, tables);
+    root["cells"] = cells;
+
+    QSaveFile file(QDir(dataPath).filePath(kRollupFile));
+    QByteArray data = QJsonDocument(root).toJson(QJsonDocument::Compact);
+    if (!file.open(QIODevice::WriteOnly) || file.write(data) != data.size() || !file.commit()) {
+        qWarning() << "Rollup: cannot write" << file.fileName() << file.errorString();
+        return false;
+    }
+    return true;
+}
+
+QString DataManager::journalPath() const {
+    return QDir(dataPath).filePath(kJournalFile);
+}
+
+void DataManager::readJournal() const {
+    if (store->journalRead || store->service) return;
+    store->journalRead = true;
+
+    const JournalRead read = readJournalFrom(journalPath(), QString(), 0);
+    int replayed = 0;
+    for (const JournalBatch& batch : read.batches) {
+        for (const auto& entry : batch.entries) {
+            store->unreplayed[entry.first].append(entry.second);
+        }
+        replayed += batch.entries.size();
+    }
+    store->journalGeneration = read.generation;
+    store->journalOffset = read.end;
+    store->journalSize = read.end;
+    if (replayed > 0) {
+        qDebug() << "Journal: found" << replayed << "entries to replay";
+    }
+}
+
+void DataManager::stageJournal(const QString& table, const QString& op, int id, const QJsonObject& record,
+                               const QJsonObject& base) {
+    StagedRow row;
+    row.table = table;
+    row.op = op;
+    row.id = id;
+    row.record = record;
+    row.base = base;
+    store->pendingRows.append(row);
+    store->pendingChanges.append(qMakePair(table, id));
+    store->dirtyTables.insert(table);
+    ++store->version;
+}
+
+void DataManager::emitChanges() {
+    const QList<QPair<QString, int>> changes = store->pendingChanges;
+    store->pendingChanges.clear();
+
+    QSet<QPair<QString, int>> seen;
+    DataEvents& events = store->events;
+    for (const auto& change : changes) {
+        if (seen.contains(change)) continue;
+        seen.insert(change);
+
+        const QString& table = change.first;
+        int id = change.second;
+        if (table == store->patients.filename) {
+            emit events.patientChanged(id);
+        } else if (table == store->doctors.filename) {
+            emit events.doctorChanged(id);
+        } else if (table == store->appointments.filename) {
+            emit events.appointmentChanged(id);
+        } else if (table == store->schedules.filename) {
+            emit events.scheduleChanged(id);
+        }
+        emit events.rowChanged(table, id);
+    }
+}
+
+QFuture<bool> DataManager::enqueueWrite(const std::function<bool()>& job,
+                                        const std::function<void(bool)>& done) const {
+    DataStore* s = store.data();
+    if (s->writesInFlight++ == 0) {
+        emit s->events.writesPendingChanged(true);
+    }
+    return QtConcurrent::run(&s->storage, [s, job, done]() {
+        const bool ok = job();
+        // The store belongs to the GUI thread, like its events object
+        QMetaObject::invokeMethod(&s->events, [s, ok, done]() {
+            if (done) done(ok);
+            if (--s->writesInFlight == 0) {
+                emit s->events.writesPendingChanged(false);
+            }
+        }, Qt::QueuedConnection);
+        return ok;
+    });
+}
+
+// Queues the staged rows for the journal as one batch. A journal past the
+// compaction threshold is folded into fresh snapshots right after.
+QFuture<bool> DataManager::writeJournal(bool reportFailure) {
+    if (store->transactionDepth > 0 || store->pendingRows.isEmpty()) return readyFuture(true);
+    readJournal();
+
+    QSharedPointer<JournalWrite> write(new JournalWrite);
+    write->rows = store->pendingRows;
+    write->report = reportFailure;
+    write->result.reportStarted();
+    store->pendingRows.clear();
+    QFuture<bool> written = writeBatch(write);
+    if (store->journalSize > kJournalCompactThreshold) {
+        writeSnapshots(reportFailure);
+    }
+    return written;
+}
+
+// Serializes a batch with the current stamps of its tables and queues it.
+// The tables take the batch's new stamps at once, so a batch queued after
+// it is built on it.
+QFuture<bool> DataManager::writeBatch(const QSharedPointer<JournalWrite>& write) {
+    if (store->service) return sendBatch(write);
+    QByteArray batch;
+    QHash<QString, quint64> expected;
+    QHash<QString, quint64> stamps;
+    QJsonObject stampsJson;
+    for (const StagedRow& row : write->rows) {
+        QJsonObject obj;
+        obj["table"] = row.table;
+        obj["op"] = row.op;
+        obj["id"] = row.id;
+        if (!row.record.isEmpty()) obj["record"] = row.record;
+        batch += journalLine(obj);
+        if (expected.contains(row.table)) continue;
+        store->forEachTable([&](auto& table) {
+            if (table.filename != row.table) return;
+            expected.insert(table.filename, table.stamp);
+            table.stamp = newStamp();
+            stamps.insert(table.filename, table.stamp);
+            // As a string: JSON numbers do not hold 64 bits
+            stampsJson[table.filename] = QString::number(table.stamp);
+        });
+    }
+    QJsonObject marker;
+    marker["op"] = "commit";
+    marker["writer"] = store->writerId;
+    marker["count"] = write->rows.size();
+    marker["stamps"] = stampsJson;
+    batch += journalLine(marker);
+    store->journalSize += batch.size();
+
+    write->stamps = expected;
+    write->status = JournalWrite::Queued;
+    store->unconfirmed.append(write);
+
+    const QString dir = dataPath;
+    const QString path = journalPath();
+    DataManager self = *this;
+    enqueueWrite([dir, path, batch, expected, stamps, write]() {
+        write->status = appendBatch(dir, path, batch, expected, stamps);
+        return write->status == JournalWrite::Written;
+    }, [self, write](bool) mutable {
+        self.finishWrite(write);
+    });
+    return write->result.future();
+}
+
+// Client mode: the service checks each row against the base it was built
+// on instead of table stamps, and answers like the storage thread would.
+QFuture<bool> DataManager::sendBatch(const QSharedPointer<JournalWrite>& write) {
+    DataStore* s = store.data();
+    write->stamps.clear();
+    write->status = JournalWrite::Queued;
+    s->unconfirmed.append(write);
+    if (s->writesInFlight++ == 0) {
+        emit s->events.writesPendingChanged(true);
+    }
+    DataManager self = *this;
+    s->service->write(write->rows, [self, write](int status) {
+        write->status = status;
+        QMetaObject::invokeMethod(&self.store->events, [self, write]() mutable {
+            self.finishWrite(write);
+            if (--self.store->writesInFlight == 0) {
+                emit self.store->events.writesPendingChanged(false);
+                // Rows pushed while the write was pending
+                self.refresh();
+            }
+        }, Qt::QueuedConnection);
+    });
+    return write->result.future();
+}
+
+void DataManager::finishWrite(const QSharedPointer<JournalWrite>& write) {
+    // A synchronous commit may have settled it already
+    if (write->status == JournalWrite::Written && store->unconfirmed.removeOne(write)) {
+        write->finish(true);
+    }
+    if (store->unconfirmed.isEmpty()) return;
+    // The rest waits until the storage thread is idle, which this write's
+    // completion has not counted yet
+    DataManager self = *this;
+    QMetaObject::invokeMethod(&store->events, [self]() mutable {
+        if (self.store->writesInFlight == 0 && !self.store->unconfirmed.isEmpty()) {
+            self.settleWrites();
+        }
+    }, Qt::QueuedConnection);
+}
+
+// Resolves the batches the storage thread is done with. Those that did not
+// reach the journal (another process wrote their tables first, or the disk
+// failed) are undone in memory, newest first; then the other processes'
+// changes are read in, and each undone batch is applied again on top and
+// requeued, unless a row it changes is no longer what it was built on. That
+// one is given up and the other process's rows stay.
+void DataManager::settleWrites() {
+    DataStore& s = *store;
+    if (s.transactionDepth > 0) return;
+    for (const auto& write : s.unconfirmed) {
+        if (write->status == JournalWrite::Queued) return;
+    }
+    QList<QSharedPointer<JournalWrite>> undone;
+    for (const auto& write : s.unconfirmed) {
+        if (write->status == JournalWrite::Written) {
+            write->finish(true);
+        } else {
+            undone.append(write);
+        }
+    }
+    s.unconfirmed.clear();
+    if (undone.isEmpty()) return;
+
+    for (int i = undone.size() - 1; i >= 0; --i) {
+        const QSharedPointer<JournalWrite>& write = undone[i];
+        for (int r = write->rows.size() - 1; r >= 0; --r) {
+            const StagedRow& row = write->rows[r];
+            applyEntry(row.table, row.base.isEmpty() ? "del" : "put", row.id, row.base);
+        }
+        s.forEachTable([&write](auto& table) {
+            auto it = write->stamps.constFind(table.filename);
+            if (it != write->stamps.constEnd()) table.stamp = it.value();
+        });
+    }
+    dropRemovedRows();
+    pullChanges();
+
+    for (const QSharedPointer<JournalWrite>& write : undone) {
+        bool unchanged = true;
+        QSet<QPair<QString, int>> checked;
+        for (const StagedRow& row : write->rows) {
+            const QPair<QString, int> key(row.table, row.id);
+            if (checked.contains(key)) continue;
+            checked.insert(key);
+            if (currentRecord(row.table, row.id) != row.base) {
+                unchanged = false;
+                break;
+            }
+        }
+        const bool stampOnly = write->status == JournalWrite::Conflict;
+        const bool retry = stampOnly ? ++write->stampRetries < kMaxStampRetries
+                                     : ++write->attempts < kMaxWriteAttempts;
+        if (unchanged && retry) {
+            for (const StagedRow& row : write->rows) {
+                applyEntry(row.table, row.op, row.id, row.record);
+            }
+            dropRemovedRows();
+            writeBatch(write);
+            continue;
+        }
+        qWarning() << "Journal: giving up a batch of" << write->rows.size() << "rows,"
+                   << (!unchanged ? "another process changed them"
+                       : stampOnly ? "its tables keep changing" : "the disk keeps failing");
+        for (const StagedRow& row : write->rows) {
+            s.pendingChanges.append(qMakePair(row.table, row.id));
+        }
+        write->finish(false);
+        if (!write->report) continue;
+        if (unchanged) {
+            emit s.events.writeFailed();
+        } else {
+            emit s.events.writeConflict();
+        }
+    }
+    emitChanges();
+}
+
+bool DataManager::commit(bool reportFailure) {
+    // Inside a transaction the outermost commitTransaction() flushes
+    if (store->transactionDepth > 0) return true;
+    QFuture<bool> written = writeJournal(reportFailure);
+    // Settled here rather than by the queued completions, so that a batch
+    // to retry is on disk, or given up, when this returns
+    while (!written.isFinished()) {
+        waitForWrites();
+        settleWrites();
+    }
+    emitChanges();
+    return written.result();
+}
+
+void DataManager::beginTransaction() {
+    if (store->transactionDepth++ == 0) {
+        store->transactionMark = store->pendingRows.size();
+        store->transactionChangeMark = store->pendingChanges.size();
+    }
+}
+
+bool DataManager::commitTransaction() {
+    if (store->transactionDepth == 0) return false;
+    if (--store->transactionDepth > 0) return true;
+
+    // A batch that cannot be written is undone row by row when it is
+    // settled, which keeps what other processes wrote meanwhile
+    return commit();
+}
+
+QFuture<bool> DataManager::commitTransactionAsync() {
+    if (store->transactionDepth == 0) return readyFuture(false);
+    if (--store->transactionDepth > 0) return readyFuture(true);
+
+    QFuture<bool> written = writeJournal(true);
+    emitChanges();
+    return written;
+}
+
+QFuture<bool> DataManager::writeAsync(const std::function<void()>& mutations) {
+    beginTransaction();
+    mutations();
+    return commitTransactionAsync();
+}
+
+bool DataManager::hasPendingWrites() const {
+    return store->writesInFlight > 0;
+}
+
+void DataManager::waitForWrites() const {
+    if (store->service) {
+        store->service->waitForWrites();
+    } else {
+        store->storage.waitForDone();
+    }
+}
+
+void DataManager::refresh() {
+    // Pending writes read the journal when they are settled
+    if (store->transactionDepth > 0 || store->writesInFlight > 0 || !store->unconfirmed.isEmpty()) return;
+    pullChanges();
+    emitChanges();
+}
+
+bool DataManager::connectToService(const QString& serverName) {
+    if (store->service) return true;
+    QSharedPointer<DataServiceClient> client(new DataServiceClient);
+    if (!client->connectToServer(serverName)) {
+        qWarning() << "Data service" << serverName << "is not running, using" << dataPath;
+        return false;
+    }
+    store->service = client;
+    // Pushed rows are applied once nothing is pending, as refresh() would
+    const QString path = dataPath;
+    QObject::connect(client.data(), &DataServiceClient::changesAvailable, &store->events, [path]() {
+        DataManager(path).refresh();
+    }, Qt::QueuedConnection);
+    qDebug() << "Serving" << dataPath << "through data service" << serverName;
+    return true;
+}
+
+bool DataManager::isServiceClient() const {
+    return !store->service.isNull();
+}
+
+bool DataManager::tableRecords(const QString& table, QJsonArray& records) const {
+    bool found = false;
+    store->forEachTable([&](auto& cache) {
+        if (cache.filename != table) return;
+        found = true;
+        for (const auto& row : rows(cache)) {
+            records.append(row.toJson());
+        }
+    });
+    return found;
+}
+
+int DataManager::claimTableIds(const QString& table, int count) {
+    int first = -1;
+    store->forEachTable([&](auto& cache) {
+        if (cache.filename == table) first = reserveIds(cache, count);
+    });
+    return first;
+}
+
+JournalWrite::Status DataManager::applyRows(const QList<StagedRow>& batch, QFuture<bool>& written) {
+    if (store->transactionDepth > 0 || batch.isEmpty()) return JournalWrite::Failed;
+    QSet<QPair<QString, int>> checked;
+    for (const StagedRow& row : batch) {
+        bool known = false;
+        store->forEachTable([&](auto& cache) {
+            if (cache.filename != row.table) return;
+            rows(cache);
+            known = true;
+        });
+        if (!known) return JournalWrite::Failed;
+        // A row changed twice in the batch was based on the first base
+        const QPair<QString, int> key(row.table, row.id);
+        if (checked.contains(key)) continue;
+        checked.insert(key);
+        if (currentRecord(row.table, row.id) != row.base) return JournalWrite::Conflict;
+    }
+
+    for (const StagedRow& row : batch) {
+        applyEntry(row.table, row.op, row.id, row.record);
+        stageJournal(row.table, row.op, row.id, row.record, row.base);
+        int& next = store->nextIds[row.table];
+        if (row.op == "put" && row.id >= next) {
+            next = row.id + 1;
+            store->sequencesDirty = true;
+        }
+    }
+    dropRemovedRows();
+    // Not commit(): the service keeps answering other clients while the
+    // storage thread appends the batch
+    written = writeJournal(false);
+    emitChanges();
+    return JournalWrite::Queued;
+}
+
+JournalWrite::Status DataManager::failedWriteStatus(const QList<StagedRow>& batch) const {
+    // A batch given up is undone, so its rows are back at their first bases
+    // unless another writer changed them
+    QSet<QPair<QString, int>> checked;
+    for (const StagedRow& row : batch) {
+        const QPair<QString, int> key(row.table, row.id);
+        if (checked.contains(key)) continue;
+        checked.insert(key);
+        if (currentRecord(row.table, row.id) != row.base) return JournalWrite::Conflict;
+    }
+    return JournalWrite::Failed;
+}
+
+void DataManager::rollbackTransaction() {
+    if (store->transactionDepth == 0) return;
+    // Put back what each staged row replaced, newest first; rows the
+    // transaction did not touch are left as they are
+    for (int i = store->pendingRows.size() - 1; i >= store->transactionMark; --i) {
+        const StagedRow& row = store->pendingRows.at(i);
+        applyEntry(row.table, row.base.isEmpty() ? "del" : "put", row.id, row.base);
+    }
+    dropRemovedRows();
+    store->pendingRows.erase(store->pendingRows.begin() + store->transactionMark, store->pendingRows.end());
+    store->pendingChanges.erase(store->pendingChanges.begin() + store->transactionChangeMark,
+                                store->pendingChanges.end());
+    store->transactionDepth = 0;
+    ++store->version;
+    // Batches that finished while the transaction was open
+    if (store->writesInFlight == 0 && !store->unconfirmed.isEmpty()) {
+        settleWrites();
+    }
+}
+
+DataTransaction::DataTransaction(DataManager& dm) : dm(dm) {
+    dm.beginTransaction();
+}
+
+DataTransaction::~DataTransaction() {
+    if (!finished) {
+        dm.rollbackTransaction();
+    }
+}
+
+bool DataTransaction::commit() {
+    finished = true;
+    return dm.commitTransaction();
+}
+
+QFuture<bool> DataTransaction::commitAsync() {
+    finished = true;
+    return dm.commitTransactionAsync();
+}
+
+void DataManager::compact() {
+    // Snapshots must not capture the uncommitted state of a transaction
+    if (store->transactionDepth > 0) return;
+    writeSnapshots(false).waitForFinished();
+    emitChanges();
+}
+
+QFuture<bool> DataManager::compactAsync() {
+    if (store->transactionDepth > 0) return readyFuture(false);
+    QFuture<bool> written = writeSnapshots(true);
+    emitChanges();
+    return written;
+}
+
+// Captures the dirty tables, the sequences and the rollup as they are now
+// and queues rewriting their files and truncating the journal. The tables
+// count as clean from here on; if the write fails they are marked dirty
+// again. Truncating drops every table's entries, so the compaction holds
+// all table locks and is put off if another process has written any table
+// since this one last read it.
+QFuture<bool> DataManager::writeSnapshots(bool reportFailure) {
+    // The service owns the files of a client
+    if (store->service) {
+        store->dirtyTables.clear();
+        return readyFuture(true);
+    }
+    readJournal();
+
+    QList<std::function<bool()>> writers;
+    QHash<QString, quint64> stamps;
+    store->forEachTable([this, &writers, &stamps](auto& table) {
+        // Every table is loaded (which replays its journal entries) so that
+        // its stamp is known
+        rows(table);
+        stamps.insert(table.filename, table.stamp);
+        if (store->dirtyTables.contains(table.filename)) {
+            writers.append(snapshotWriter(table));
+        }
+    });
+    const QSet<QString> tables = store->dirtyTables;
+    const bool withSequences = store->sequencesDirty;
+    const QHash<QString, int> sequences = store->nextIds;
+    store->dirtyTables.clear();
+    store->sequencesDirty = false;
+    store->journalSize = 0;
+
+    // The JSON will hold every change, so the rollup can be stored with it
+    const bool withRollup = store->rollupBuilt;
+    const StatisticsRollup rollup = withRollup ? store->rollup : StatisticsRollup();
+    const QStringList sources = rollupTables(*store);
+    const QString dir = dataPath;
+    const QString journal = journalPath();
+    QSharedPointer<std::atomic<bool>> postponed(new std::atomic<bool>(false));
+
+    DataStore* s = store.data();
+    return enqueueWrite([=]() {
+        DirectoryLocks locks(dir, stamps.keys());
+        if (!locks.ok()) return false;
+        for (auto it = stamps.constBegin(); it != stamps.constEnd(); ++it) {
+            if (readStamp(dir, it.key()) != it.value()) {
+                qDebug() << "Journal: another process changed" << it.key() << "- compaction put off";
+                postponed->store(true);
+                return false;
+            }
+        }
+        bool ok = true;
+        for (const auto& write : writers) {
+            ok = write() && ok;
+        }
+        if (withSequences) {
+            ok = storeSequences(dir, sequences) && ok;
+        }
+        if (!ok) {
+            qWarning() << "Journal: compaction incomplete, keeping" << journal;
+            return false;
+        }
+        QFile::remove(journal);
+        if (withRollup) {
+            writeRollup(dir, sources, rollup);
+        }
+        return true;
+    }, [s, tables, withSequences, reportFailure, postponed](bool ok) {
+        if (ok) return;
+        // The journal still holds everything; the next compaction retries
+        s->dirtyTables.unite(tables);
+        s->sequencesDirty = s->sequencesDirty || withSequences;
+        if (reportFailure && !postponed->load()) emit s->events.writeFailed();
+    });
+}
+
+void DataManager::readSequences() const {
+    if (store->sequencesRead || store->service) return;
+    store->sequencesRead = true;
+    store->savedIds = readSequenceFile(dataPath);
+}
+
+static bool rollupSourcesClean(const DataStore& s) {
+    return !s.dirtyTables.contains(s.appointments.filename) && !s.dirtyTables.contains(s.doctors.filename)
+           && !s.dirtyTables.contains(s.schedules.filename);
+}
+
+bool DataManager::loadRollup() const {
+    // A client has no JSON of its own to match the rollup against
+    if (store->service || !rollupSourcesClean(*store)) return false;
+    QFile file(QDir(dataPath).filePath(kRollupFile));
+    if (!file.open(QIODevice::ReadOnly)) return false;
+    QJsonObject root = QJsonDocument::fromJson(file.readAll()).object();
+    if (root["version"].toInt() != kRollupVersion || root["sources"].toObject() != rollupSources(dataPath, rollupTables(*store))) {
+        return false;
+    }
+
+    // Cells are [day, doctor, specialization, room, completed, count]
+    store->rollup.clear();
+    const QJsonArray cells = root["cells"].toArray();
+    for (const QJsonValue& value : cells) {
+        QJsonArray cell = value.toArray();
+        if (cell.size() != 6) {
+            qWarning() << "Rollup: malformed" << file.fileName();
+            store->rollup.clear();
+            return false;
+        }
+        RollupKey key;
+        key.doctor = cell[1].toInt();
+        key.spec = cell[2].toInt();
+        key.room = cell[3].toInt();
+        key.completed = cell[4].toInt() != 0;
+        store->rollup.add(qint64(cell[0].toDouble()), key, cell[5].toInt());
+    }
+    qDebug() << "Loaded statistics rollup for" << store->rollup.days.size() << "days";
+    return true;
+}
+
+void DataManager::saveRollup() const {
+    // Counts that include changes not yet in the JSON would not match it,
+    // and neither would stamps taken behind snapshots still being written
+    if (store->service || !rollupSourcesClean(*store) || store->writesInFlight > 0) return;
+    const StatisticsRollup rollup = store->rollup;
+    const QStringList sources = rollupTables(*store);
+    const QString dir = dataPath;
+    enqueueWrite([dir, sources, rollup]() { return writeRollup(dir, sources, rollup); }, nullptr);
+}
+
+void DataManager::compactAll() {
+    const QList<QString> paths = sharedStores().keys();
+    for (const QString& path : paths) {
+        DataManager(path).compact();
+    }
+}
+
+void IntervalIndex::insert(qint64 from, qint64 to, int id) {
+    auto pos = std::upper_bound(entries.begin(), entries.end(), from,
+                                [](qint64 value, const Entry& e) { return value < e.from; });
+    entries.insert(pos, Entry{from, to, id});
+    maxLength = std::max(maxLength, to - from);
+}
+
+void IntervalIndex::remove(qint64 from, int id) {
+    auto it = std::lower_bound(entries.begin(), entries.end(), from,
+                               [](const Entry& e, qint64 value) { return e.from < value; });
+    for (; it != entries.end() && it->from == from; ++it) {
+        if (it->id == id) {
+            entries.erase(it);
             return;
         }
     }
 }
 
-void DataManager::deletePatient(int id) {
-    QJsonArray array = loadJson("patient.json");
-
-    for (int i = 0; i < array.size(); ++i) {
-        if (array[i].toObject()["id_patient"].toInt() == id) {
-            array.removeAt(i);
-            saveJson("patient.json", array);
-
-            // Also remove family relations
-            QJsonArray groupArray = loadJson("patient_group.json");
-            for (int j = groupArray.size() - 1; j >= 0; --j) {
-                QJsonObject obj = groupArray[j].toObject();
-                if (obj["id_parent"].toInt() == id || obj["id_child"].toInt() == id) {
-                    groupArray.removeAt(j);
+bool IntervalIndex::overlaps(qint64 from, qint64 to, int ignoreId) const {
+    // An interval [f, t) overlaps [from, to) iff f < to && from < t. Since
+    // t <= f + maxLength, only entries with f > from - maxLength qualify.
+    auto it = std::upper_bound(entries.cbegin(), entries.cend(), from - maxLength,
+                               [](qint64 value, const Entry& e) { return value < e.from; });
+    for (; it != entries.cend() && it->from < to; ++it) {
+        if (it->to > from && it->id != ignoreId) {
+            return true;
+        }
+    }
+    return false;
+}
+
+QList<int> IntervalIndex::idsStartingAt(qint64 from) const {
+    QList<int> ids;
+    auto it = std::lower_bound(entries.cbegin(), entries.cend(), from,
+                               [](const Entry& e, qint64 value) { return e.from < value; });
+    for (; it != entries.cend() && it->from == from; ++it) {
+        ids.append(it->id);
+    }
+    return ids;
+}
+
+qint64 AppointmentColumns::toMinutes(const QDateTime& dt) {
+    if (!dt.isValid()) return NoDate;
+    QTime t = dt.time();
+    return dt.date().toJulianDay() * 1440 + t.hour() * 60 + t.minute();
+}
+
+void AppointmentColumns::append(const Appointment& a) {
+    int row = patient.size();
+    patient.append(a.id_patient);
+    doctor.append(a.id_doctor);
+    date.append(toMinutes(a.date));
+    if ((row & 63) == 0) completed.append(0);
+    if (a.completed) completed[row >> 6] |= quint64(1) << (row & 63);
+}
+
+void AppointmentColumns::clear() {
+    patient.clear();
+    doctor.clear();
+    date.clear();
+    completed.clear();
+}
+
+const qint64 DayFenwick::FirstDenseDay;
+const qint64 DayFenwick::LastDenseDay;
+
+void DayFenwick::cover(qint64 day) {
+    const qint64 end = firstDay + values.size();
+    if (!values.isEmpty() && day >= firstDay && day < end) return;
+
+    // Grow at least twofold, on the side the new day lies, within the limits
+    qint64 first = values.isEmpty() ? day : std::min(firstDay, day);
+    qint64 last = values.isEmpty() ? day : std::max(end - 1, day);
+    const qint64 size = std::max(last - first + 1, std::max<qint64>(64, 2 * qint64(values.size())));
+    if (!values.isEmpty() && day < firstDay) {
+        first = std::max(last + 1 - size, FirstDenseDay);
+    } else {
+        last = std::min(first + size - 1, LastDenseDay);
+    }
+    QVector<int> grown(int(last - first + 1), 0);
+    if (!values.isEmpty()) {
+        std::copy(values.cbegin(), values.cend(), grown.begin() + (firstDay - first));
+    }
+    values = grown;
+    firstDay = first;
+    buildTree();
+}
+
+void DayFenwick::assign(qint64 first, const QVector<int>& counts) {
+    values = counts;
+    firstDay = first;
+    outside.clear();
+    buildTree();
+}
+
+void DayFenwick::buildTree() {
+    // Linear time: each node passes its sum on to its parent
+    tree.fill(0, values.size() + 1);
+    for (int i = 1; i <= values.size(); ++i) {
+        tree[i] += values[i - 1];
+        int parent = i + (i & -i);
+        if (parent <= values.size()) tree[parent] += tree[i];
+    }
+}
+
+void DayFenwick::add(qint64 day, int delta) {
+    if (day < FirstDenseDay || day > LastDenseDay) {
+        int& n = outside[day];
+        n += delta;
+        if (n == 0) outside.remove(day);
+        return;
+    }
+    cover(day);
+    int pos = int(day - firstDay);
+    values[pos] += delta;
+    for (int i = pos + 1; i <= values.size(); i += i & -i) {
+        tree[i] += delta;
+    }
+}
+
+int DayFenwick::prefix(qint64 day) const {
+    int sum = 0;
+    for (auto it = outside.constBegin(); it != outside.constEnd() && it.key() < day; ++it) {
+        sum += it.value();
+    }
+    if (values.isEmpty() || day <= firstDay) return sum;
+    for (int i = int(std::min<qint64>(day - firstDay, values.size())); i > 0; i -= i & -i) {
+        sum += tree[i];
+    }
+    return sum;
+}
+
+int DayFenwick::count(qint64 fromDay, qint64 lastDay) const {
+    return fromDay > lastDay ? 0 : prefix(lastDay + 1) - prefix(fromDay);
+}
+
+void StatisticsRollup::add(qint64 day, const RollupKey& key, int delta) {
+    addCell(day, key, delta);
+    totals.add(day, delta);
+}
+
+void StatisticsRollup::addCell(qint64 day, const RollupKey& key, int delta) {
+    QHash<RollupKey, int>& cells = days[day];
+    int& cell = cells[key];
+    cell += delta;
+    if (cell == 0) {
+        cells.remove(key);
+    }
+    if (cells.isEmpty()) {
+        days.remove(day);
+    }
+    doctorTotals[key.doctor].add(day, delta);
+}
+
+void StatisticsRollup::clear() {
+    days.clear();
+    totals = DayFenwick();
+    doctorTotals.clear();
+}
+
+int StatisticsRollup::count(qint64 firstDay, qint64 lastDay) const {
+    return totals.count(firstDay, lastDay);
+}
+
+int StatisticsRollup::countForDoctor(int doctorId, qint64 firstDay, qint64 lastDay) const {
+    auto it = doctorTotals.constFind(doctorId);
+    return it == doctorTotals.constEnd() ? 0 : it->count(firstDay, lastDay);
+}
+
+QVector<int> StatisticsRollup::perBucket(qint64 firstDay, int buckets, int bucketDays) const {
+    QVector<int> result(std::max(buckets, 0), 0);
+    if (buckets <= 0 || bucketDays <= 0) return result;
+    int before = totals.prefix(firstDay);
+    for (int i = 0; i < buckets; ++i) {
+        int upTo = totals.prefix(firstDay + qint64(i + 1) * bucketDays);
+        result[i] = upTo - before;
+        before = upTo;
+    }
+    return result;
+}
+
+// Sums the cells of the days in [firstDay, lastDay] by one key dimension.
+template <typename F>
+static QHash<int, int> rollupByDimension(const StatisticsRollup& rollup, qint64 firstDay, qint64 lastDay, F dimension) {
+    QHash<int, int> result;
+    for (auto day = rollup.days.lowerBound(firstDay); day != rollup.days.constEnd() && day.key() <= lastDay; ++day) {
+        for (auto cell = day->constBegin(); cell != day->constEnd(); ++cell) {
+            result[dimension(cell.key())] += cell.value();
+        }
+    }
+    return result;
+}
+
+QHash<int, int> StatisticsRollup::countByDoctor(qint64 firstDay, qint64 lastDay) const {
+    QHash<int, int> result;
+    for (auto it = doctorTotals.constBegin(); it != doctorTotals.constEnd(); ++it) {
+        int n = it->count(firstDay, lastDay);
+        if (n != 0) result.insert(it.key(), n);
+    }
+    return result;
+}
+
+QHash<int, int> StatisticsRollup::countBySpecialization(qint64 firstDay, qint64 lastDay) const {
+    return rollupByDimension(*this, firstDay, lastDay, [](const RollupKey& k) { return int(k.spec); });
+}
+
+QHash<int, int> StatisticsRollup::countByRoom(qint64 firstDay, qint64 lastDay) const {
+    return rollupByDimension(*this, firstDay, lastDay, [](const RollupKey& k) { return int(k.room); });
+}
+
+int StatisticsRollup::countCompleted(qint64 firstDay, qint64 lastDay) const {
+    return rollupByDimension(*this, firstDay, lastDay, [](const RollupKey& k) { return k.completed ? 1 : 0; }).value(1);
+}
+
+void AvailabilityIndex::insert(qint64 day, qint64 from, int id) {
+    QVector<Slot>& bucket = days[day];
+    auto pos = std::upper_bound(bucket.begin(), bucket.end(), from,
+                                [](qint64 value, const Slot& s) { return value < s.from; });
+    bucket.insert(pos, Slot{from, id});
+}
+
+void AvailabilityIndex::remove(qint64 day, qint64 from, int id) {
+    auto bucket = days.find(day);
+    if (bucket == days.end()) return;
+    auto it = std::lower_bound(bucket->begin(), bucket->end(), from,
+                               [](const Slot& s, qint64 value) { return s.from < value; });
+    for (; it != bucket->end() && it->from == from; ++it) {
+        if (it->id == id) {
+            bucket->erase(it);
+            break;
+        }
+    }
+    if (bucket->isEmpty()) {
+        days.erase(bucket);
+    }
+}
+
+// Primary key of each entity, used by the per-table id index.
+static int rowId(const Patient& p) { return p.id_patient; }
+static int rowId(const Doctor& d) { return d.id_doctor; }
+static int rowId(const Specialization& s) { return s.id_spec; }
+static int rowId(const Room& r) { return r.id_room; }
+static int rowId(const Appointment& a) { return a.id_ap; }
+static int rowId(const AppointmentSchedule& s) { return s.id_ap_sch; }
+static int rowId(const PatientGroup& pg) { return pg.id_patient_group; }
+static int rowId(const Diagnosis& d) { return d.id_diagnosis; }
+static int rowId(const Recipe& r) { return r.id; }
+static int rowId(const Manager& m) { return m.id; }
+static int rowId(const Admin& a) { return a.id; }
+static int rowId(const InvitationCode& ic) { return ic.id; }
+
+template <typename T>
+static void reindex(TableCache<T>& table) {
+    table.byId.clear();
+    table.byId.reserve(table.rows.size());
+    // Walk backwards so the first row wins on duplicate ids, as the old
+    // linear scans did.
+    for (int i = table.rows.size() - 1; i >= 0; --i) {
+        table.byId.insert(rowId(table.rows.at(i)), i);
+    }
+}
+
+// Drops the rows listed in removed, all in one pass.
+template <typename T>
+static void dropRemoved(TableCache<T>& table) {
+    if (table.removed.isEmpty()) return;
+    QVector<bool> gone(table.rows.size(), false);
+    for (int pos : table.removed) {
+        gone[pos] = true;
+    }
+    table.removed.clear();
+    int kept = 0;
+    for (int i = 0; i < table.rows.size(); ++i) {
+        if (gone[i]) continue;
+        if (kept != i) table.rows[kept] = std::move(table.rows[i]);
+        ++kept;
+    }
+    table.rows.erase(table.rows.begin() + kept, table.rows.end());
+    reindex(table);
+}
+
+// Foreign-key index maintenance. Tables without secondary indexes fall
+// through to the no-op templates.
+template <typename T>
+static void indexForeignKeys(DataStore&, const T&) {}
+template <typename T>
+static void unindexForeignKeys(DataStore&, const T&) {}
+template <typename T>
+static void clearForeignKeys(DataStore&, const TableCache<T>&) {}
+
+// Availability maintenance. A slot is free when its status is open and no
+// appointment of the same doctor starts at the same time.
+static bool isOpenSlot(const AppointmentSchedule& row) {
+    QString st = row.status.trimmed().toLower();
+    return row.time_from.isValid() && (st.isEmpty() || st == "free" || st == "available");
+}
+
+static void addFreeSlot(DataStore& s, const AppointmentSchedule& row) {
+    if (!isOpenSlot(row)) return;
+    qint64 from = row.time_from.toSecsSinceEpoch();
+    if (s.appointmentStarts.value(qMakePair(row.id_doctor, from)) > 0) return;
+    s.freeSlots[row.id_doctor].insert(row.time_from.date().toJulianDay(), from, row.id_ap_sch);
+}
+
+static void removeFreeSlot(DataStore& s, const AppointmentSchedule& row) {
+    if (!row.time_from.isValid()) return;
+    auto it = s.freeSlots.find(row.id_doctor);
+    if (it != s.freeSlots.end()) {
+        it->remove(row.time_from.date().toJulianDay(), row.time_from.toSecsSinceEpoch(), row.id_ap_sch);
+    }
+}
+
+// Re-evaluate the doctor's slots starting at from after an appointment there
+// was added (occupied) or removed.
+static void refreshSlotsAt(DataStore& s, int doctorId, qint64 from, bool occupied) {
+    const QList<int> ids = s.doctorIntervals.value(doctorId).idsStartingAt(from);
+    for (int id : ids) {
+        auto pos = s.schedules.byId.constFind(id);
+        if (pos == s.schedules.byId.constEnd()) continue;
+        const AppointmentSchedule& row = s.schedules.rows.at(pos.value());
+        if (occupied) {
+            removeFreeSlot(s, row);
+        } else {
+            addFreeSlot(s, row);
+        }
+    }
+}
+
+// Statistics rollup maintenance. An appointment is counted under its
+// doctor's current specialization and its slot's current room, so doctor and
+// schedule changes move their appointments from one cell to another.
+static qint32 specOf(const DataStore& s, int doctorId) {
+    auto it = s.doctors.byId.constFind(doctorId);
+    return it == s.doctors.byId.constEnd() ? -1 : s.doctors.rows.at(it.value()).id_spec;
+}
+
+static qint32 roomOf(const DataStore& s, int scheduleId) {
+    auto it = s.schedules.byId.constFind(scheduleId);
+    return it == s.schedules.byId.constEnd() ? -1 : s.schedules.rows.at(it.value()).id_room;
+}
+
+static void countInRollup(DataStore& s, const Appointment& a, qint32 spec, qint32 room, int delta,
+                          bool withTotals = true) {
+    qint64 minutes = AppointmentColumns::toMinutes(a.date);
+    if (minutes == AppointmentColumns::NoDate) return;
+    RollupKey key;
+    key.doctor = a.id_doctor;
+    key.spec = spec;
+    key.room = room;
+    key.completed = a.completed;
+    if (withTotals) {
+        s.rollup.add(minutes / 1440, key, delta);
+    } else {
+        s.rollup.addCell(minutes / 1440, key, delta);
+    }
+}
+
+// Counts every appointment into an empty rollup. The per-day totals, which
+// the weekly and daily charts read, come from one day histogram over the
+// date column rather than from a Fenwick update per row.
+static void rebuildRollup(DataStore& s, const QList<Appointment>& appointments, const AppointmentColumns& columns) {
+    s.rollup.clear();
+    for (const Appointment& a : appointments) {
+        countInRollup(s, a, specOf(s, a.id_doctor), roomOf(s, a.id_ap_sch), 1, false);
+    }
+    if (s.rollup.days.isEmpty()) return;
+    const qint64 first = std::max(s.rollup.days.firstKey(), DayFenwick::FirstDenseDay);
+    const qint64 last = std::min(s.rollup.days.lastKey(), DayFenwick::LastDenseDay);
+    if (first <= last) {
+        QVector<int> perDay(int(last - first + 1), 0);
+        HistogramKernels::dayHistogram(columns.date.constData(), columns.size(), first, perDay.size(), perDay.data());
+        s.rollup.totals.assign(first, perDay);
+    }
+    // Days past the limits were left out of the histogram
+    for (auto day = s.rollup.days.constBegin(); day != s.rollup.days.constEnd(); ++day) {
+        if (day.key() >= DayFenwick::FirstDenseDay && day.key() <= DayFenwick::LastDenseDay) continue;
+        int n = 0;
+        for (int cell : *day) n += cell;
+        s.rollup.totals.add(day.key(), n);
+    }
+}
+
+// Re-file the appointments of a doctor (byDoctor) or slot (bySchedule)
+// after its specialization or room changed from one value to another.
+static void moveInRollup(DataStore& s, const QMultiHash<int, int>& index, int key, bool bySchedule,
+                         qint32 from, qint32 to) {
+    if (from == to) return;
+    for (auto it = index.constFind(key); it != index.constEnd() && it.key() == key; ++it) {
+        auto pos = s.appointments.byId.constFind(it.value());
+        if (pos == s.appointments.byId.constEnd()) continue;
+        const Appointment& a = s.appointments.rows.at(pos.value());
+        if (bySchedule) {
+            qint32 spec = specOf(s, a.id_doctor);
+            countInRollup(s, a, spec, from, -1);
+            countInRollup(s, a, spec, to, 1);
+        } else {
+            qint32 room = roomOf(s, a.id_ap_sch);
+            countInRollup(s, a, from, room, -1);
+            countInRollup(s, a, to, room, 1);
+        }
+    }
+}
+
+static void indexForeignKeys(DataStore& s, const AppointmentSchedule& row) {
+    s.schedulesByDoctor.insert(row.id_doctor, row.id_ap_sch);
+    s.schedulesByRoom.insert(row.id_room, row.id_ap_sch);
+    if (row.time_from.isValid() && row.time_to.isValid()) {
+        qint64 from = row.time_from.toSecsSinceEpoch();
+        qint64 to = row.time_to.toSecsSinceEpoch();
+        s.doctorIntervals[row.id_doctor].insert(from, to, row.id_ap_sch);
+        s.roomIntervals[row.id_room].insert(from, to, row.id_ap_sch);
+    }
+    if (s.availabilityBuilt) addFreeSlot(s, row);
+    if (s.rollupBuilt) moveInRollup(s, s.appointmentsBySchedule, row.id_ap_sch, true, -1, row.id_room);
+}
+
+static void unindexForeignKeys(DataStore& s, const AppointmentSchedule& row) {
+    s.schedulesByDoctor.remove(row.id_doctor, row.id_ap_sch);
+    s.schedulesByRoom.remove(row.id_room, row.id_ap_sch);
+    if (row.time_from.isValid() && row.time_to.isValid()) {
+        qint64 from = row.time_from.toSecsSinceEpoch();
+        s.doctorIntervals[row.id_doctor].remove(from, row.id_ap_sch);
+        s.roomIntervals[row.id_room].remove(from, row.id_ap_sch);
+    }
+    if (s.availabilityBuilt) removeFreeSlot(s, row);
+    if (s.rollupBuilt) moveInRollup(s, s.appointmentsBySchedule, row.id_ap_sch, true, row.id_room, -1);
+}
+
+static void clearForeignKeys(DataStore& s, const TableCache<AppointmentSchedule>&) {
+    s.schedulesByDoctor.clear();
+    s.schedulesByRoom.clear();
+    s.doctorIntervals.clear();
+    s.roomIntervals.clear();
+    s.availabilityBuilt = false;
+    s.rollupBuilt = false;
+}
+
+static void indexForeignKeys(DataStore& s, const Appointment& row) {
+    s.appointmentsByPatient.insert(row.id_patient, row.id_ap);
+    s.appointmentsByDoctor.insert(row.id_doctor, row.id_ap);
+    if (row.id_ap_sch > 0) s.appointmentsBySchedule.insert(row.id_ap_sch, row.id_ap);
+    // insertRow() appends, so the new row is also the last column entry
+    if (s.appointmentColumnsValid) s.appointmentColumns.append(row);
+    if (s.rollupBuilt) countInRollup(s, row, specOf(s, row.id_doctor), roomOf(s, row.id_ap_sch), 1);
+    if (s.availabilityBuilt && row.date.isValid()) {
+        qint64 from = row.date.toSecsSinceEpoch();
+        if (s.appointmentStarts[qMakePair(row.id_doctor, from)]++ == 0) {
+            refreshSlotsAt(s, row.id_doctor, from, true);
+        }
+    }
+}
+
+static void unindexForeignKeys(DataStore& s, const Appointment& row) {
+    s.appointmentsByPatient.remove(row.id_patient, row.id_ap);
+    s.appointmentsByDoctor.remove(row.id_doctor, row.id_ap);
+    s.appointmentsBySchedule.remove(row.id_ap_sch, row.id_ap);
+    s.appointmentColumnsValid = false;
+    if (s.rollupBuilt) countInRollup(s, row, specOf(s, row.id_doctor), roomOf(s, row.id_ap_sch), -1);
+    if (s.availabilityBuilt && row.date.isValid()) {
+        qint64 from = row.date.toSecsSinceEpoch();
+        auto it = s.appointmentStarts.find(qMakePair(row.id_doctor, from));
+        if (it != s.appointmentStarts.end() && --it.value() == 0) {
+            s.appointmentStarts.erase(it);
+            refreshSlotsAt(s, row.id_doctor, from, false);
+        }
+    }
+}
+
+static void clearForeignKeys(DataStore& s, const TableCache<Appointment>&) {
+    s.appointmentsByPatient.clear();
+    s.appointmentsByDoctor.clear();
+    s.appointmentsBySchedule.clear();
+    s.availabilityBuilt = false;
+    s.appointmentColumnsValid = false;
+    s.rollupBuilt = false;
+}
+
+static void indexForeignKeys(DataStore& s, const Recipe& row) {
+    s.recipesByAppointment.insert(row.id_ap, row.id);
+}
+
+static void unindexForeignKeys(DataStore& s, const Recipe& row) {
+    s.recipesByAppointment.remove(row.id_ap, row.id);
+}
+
+static void clearForeignKeys(DataStore& s, const TableCache<Recipe>&) {
+    s.recipesByAppointment.clear();
+}
+
+// Binary sidecars for the tables that have a binary layout; the others
+// always load from JSON. saveSidecar() is false only if a sidecar for the
+// table could not be written.
+template <typename T>
+static bool loadSidecar(const QString&, QList<T>&) { return false; }
+template <typename T>
+static bool saveSidecar(const QString&, const QList<T>&) { return true; }
+
+static bool loadSidecar(const QString& path, QList<Appointment>& rows) { return BinarySnapshot::load(path, rows); }
+static bool saveSidecar(const QString& path, const QList<Appointment>& rows) { return BinarySnapshot::save(path, rows); }
+static bool loadSidecar(const QString& path, QList<AppointmentSchedule>& rows) { return BinarySnapshot::load(path, rows); }
+static bool saveSidecar(const QString& path, const QList<AppointmentSchedule>& rows) { return BinarySnapshot::save(path, rows); }
+
+// Credential index maintenance for the four role tables.
+static QString normalizedEmail(const QString& email) {
+    return email.trimmed().toLower();
+}
+
+static void addCredential(DataStore& s, LoginUser::UserType role, int id, const QString& email, const QString& hash) {
+    if (email.trimmed().isEmpty()) return;
+    QVector<Credential>& accounts = s.credentials[normalizedEmail(email)];
+    auto pos = std::upper_bound(accounts.begin(), accounts.end(), role,
+                                [](LoginUser::UserType value, const Credential& c) { return value < c.role; });
+    Credential credential;
+    credential.role = role;
+    credential.id = id;
+    credential.hash = hash;
+    accounts.insert(pos, credential);
+}
+
+static void removeCredential(DataStore& s, LoginUser::UserType role, int id, const QString& email) {
+    auto it = s.credentials.find(normalizedEmail(email));
+    if (it == s.credentials.end()) return;
+    for (int i = 0; i < it->size(); ++i) {
+        if (it->at(i).role == role && it->at(i).id == id) {
+            it->removeAt(i);
+            break;
+        }
+    }
+    if (it->isEmpty()) {
+        s.credentials.erase(it);
+    }
+}
+
+static void indexForeignKeys(DataStore& s, const Patient& row) {
+    if (s.credentialsBuilt) addCredential(s, LoginUser::PATIENT, row.id_patient, row.email, row.password);
+}
+static void unindexForeignKeys(DataStore& s, const Patient& row) {
+    if (s.credentialsBuilt) removeCredential(s, LoginUser::PATIENT, row.id_patient, row.email);
+}
+static void clearForeignKeys(DataStore& s, const TableCache<Patient>&) { s.credentialsBuilt = false; }
+
+static void indexForeignKeys(DataStore& s, const Doctor& row) {
+    if (s.credentialsBuilt) addCredential(s, LoginUser::DOCTOR, row.id_doctor, row.email, row.password);
+    if (s.rollupBuilt) moveInRollup(s, s.appointmentsByDoctor, row.id_doctor, false, -1, row.id_spec);
+}
+static void unindexForeignKeys(DataStore& s, const Doctor& row) {
+    if (s.credentialsBuilt) removeCredential(s, LoginUser::DOCTOR, row.id_doctor, row.email);
+    if (s.rollupBuilt) moveInRollup(s, s.appointmentsByDoctor, row.id_doctor, false, row.id_spec, -1);
+}
+static void clearForeignKeys(DataStore& s, const TableCache<Doctor>&) {
+    s.credentialsBuilt = false;
+    s.rollupBuilt = false;
+}
+
+static void indexForeignKeys(DataStore& s, const Manager& row) {
+    if (s.credentialsBuilt) addCredential(s, LoginUser::MANAGER, row.id, row.email, row.password);
+}
+static void unindexForeignKeys(DataStore& s, const Manager& row) {
+    if (s.credentialsBuilt) removeCredential(s, LoginUser::MANAGER, row.id, row.email);
+}
+static void clearForeignKeys(DataStore& s, const TableCache<Manager>&) { s.credentialsBuilt = false; }
+
+static void indexForeignKeys(DataStore& s, const Admin& row) {
+    if (s.credentialsBuilt) addCredential(s, LoginUser::ADMIN, row.id, row.email, row.password);
+}
+static void unindexForeignKeys(DataStore& s, const Admin& row) {
+    if (s.credentialsBuilt) removeCredential(s, LoginUser::ADMIN, row.id, row.email);
+}
+static void clearForeignKeys(DataStore& s, const TableCache<Admin>&) { s.credentialsBuilt = false; }
+
+template <typename T>
+const QList<T>& DataManager::rows(TableCache<T>& table) const {
+    if (!table.loaded) {
+        int nextId = 1;
+        if (store->service) {
+            QJsonArray array;
+            if (!store->service->fetchTable(table.filename, array)) {
+                qWarning() << "Cannot fetch" << table.filename << "from the data service";
+            }
+            table.rows.clear();
+            table.rows.reserve(array.size());
+            for (const QJsonValue& value : array) {
+                table.rows.append(T::fromJson(value.toObject()));
+            }
+            reindex(table);
+        } else {
+            // Keep other processes from writing or compacting the table while
+            // its stamp, snapshot and journal entries are read; without the lock
+            // the load goes ahead anyway
+            DirectoryLocks lock(dataPath, {table.filename});
+            readJournal();
+            table.stamp = readStamp(dataPath, table.filename);
+
+            QString jsonPath = QDir(dataPath).filePath(table.filename);
+            table.rows.clear();
+            if (loadSidecar(jsonPath, table.rows)) {
+                qDebug() << "Loaded" << table.rows.size() << "rows from binary snapshot of" << table.filename;
+            } else {
+                QJsonArray array = loadJson(table.filename);
+                table.rows.reserve(array.size());
+                for (const QJsonValue& value : array) {
+                    table.rows.append(T::fromJson(value.toObject()));
                 }
+                // Let the next start skip the JSON parse
+                saveSidecar(jsonPath, table.rows);
             }
-            saveJson("patient_group.json", groupArray);
-
-            // Also remove appointments
-            QJsonArray apArray = loadJson("appointment.json");
-            for (int j = apArray.size() - 1; j >= 0; --j) {
-                QJsonObject apObj = apArray[j].toObject();
-                if (apObj["id_patient"].toInt() == id) {
-                    int apId = apObj["id_ap"].toInt();
-                    int scheduleId = apObj["id_ap_sch"].toInt(-1);
-                    apArray.removeAt(j);
-
-                    // Remove recipe if exists
-                    QJsonArray recipeArray = loadJson("recipe.json");
-                    for (int k = recipeArray.size() - 1; k >= 0; --k) {
-                        if (recipeArray[k].toObject()["id_ap"].toInt() == apId) {
-                            recipeArray.removeAt(k);
-                        }
-                    }
-                    saveJson("recipe.json", recipeArray);
-
-                    // Free linked schedule slot
-                    if (scheduleId > 0) {
-                        QJsonArray scheduleArray = loadJson("appointment_schedule.json");
-                        for (int s = 0; s < scheduleArray.size(); ++s) {
-                            QJsonObject schObj = scheduleArray[s].toObject();
-                            if (schObj["id_ap_sch"].toInt() == scheduleId) {
-                                schObj["status"] = "free";
-                                scheduleArray[s] = schObj;
-                                break;
-                            }
-                        }
-                        saveJson("appointment_schedule.json", scheduleArray);
+            reindex(table);
+
+            // Replay journal entries written after the last snapshot: those of
+            // the last read, then whatever has been appended since
+            QList<JournalEntry> entries = store->unreplayed.take(table.filename);
+            const JournalRead tail = readJournalFrom(journalPath(), store->journalGeneration, store->journalOffset);
+            if (tail.replaced) {
+                // Compacted meanwhile: the snapshot just read holds them
+                entries.clear();
+            }
+            for (const JournalBatch& batch : tail.batches) {
+                for (const auto& entry : batch.entries) {
+                    if (entry.first == table.filename) entries.append(entry.second);
+                }
+            }
+            table.journalGeneration = tail.generation;
+            table.journalPos = tail.end;
+            for (const JournalEntry& entry : entries) {
+                auto it = table.byId.constFind(entry.id);
+                if (entry.op == "put") {
+                    nextId = std::max(nextId, entry.id + 1);
+                    if (it != table.byId.constEnd()) {
+                        table.rows[it.value()] = T::fromJson(entry.record);
+                    } else {
+                        table.rows.append(T::fromJson(entry.record));
+                        table.byId.insert(entry.id, table.rows.size() - 1);
                     }
+                } else if (entry.op == "del" && it != table.byId.constEnd()) {
+                    table.removed.append(it.value());
+                    table.byId.remove(entry.id);
                 }
             }
-            saveJson("appointment.json", apArray);
-            return;
+            dropRemoved(table);
+            if (!entries.isEmpty()) {
+                store->dirtyTables.insert(table.filename);
+            }
         }
+
+        // Seed the id sequence once; it only moves forward afterwards
+        readSequences();
+        for (auto it = table.byId.constBegin(); it != table.byId.constEnd(); ++it) {
+            nextId = std::max(nextId, it.key() + 1);
+        }
+        nextId = std::max(nextId, store->savedIds.value(table.filename));
+        int& next = store->nextIds[table.filename];
+        next = std::max(next, nextId);
+
+        clearForeignKeys(*store, table);
+        for (const T& row : table.rows) {
+            indexForeignKeys(*store, row);
+        }
+        table.loaded = true;
     }
+    return table.rows;
 }
 
-bool DataManager::patientExists(int id) const {
-    QJsonArray array = loadJson("patient.json");
-    for (const QJsonValue& value : array) {
-        if (value.toObject()["id_patient"].toInt() == id) {
-            return true;
+// Rows whose foreign key equals key, in file order.
+template <typename T>
+QList<T> DataManager::rowsByKey(TableCache<T>& table, const QMultiHash<int, int>& index, int key) const {
+    rows(table);
+    QList<int> positions;
+    for (auto it = index.constFind(key); it != index.constEnd() && it.key() == key; ++it) {
+        auto pos = table.byId.constFind(it.value());
+        if (pos != table.byId.constEnd()) {
+            positions.append(pos.value());
         }
     }
-    return false;
+    std::sort(positions.begin(), positions.end());
+    positions.erase(std::unique(positions.begin(), positions.end()), positions.end());
+
+    QList<T> result;
+    result.reserve(positions.size());
+    for (int pos : positions) {
+        result.append(table.rows.at(pos));
+    }
+    return result;
+}
+
+template <typename T>
+T DataManager::rowById(TableCache<T>& table, int id) const {
+    rows(table);
+    auto it = table.byId.constFind(id);
+    if (it == table.byId.constEnd()) {
+        return T();
+    }
+    return table.rows.at(it.value());
+}
+
+template <typename T>
+bool DataManager::hasRow(TableCache<T>& table, int id) const {
+    rows(table);
+    return table.byId.contains(id);
+}
+
+template <typename T>
+int DataManager::reserveIds(TableCache<T>& table, int count) {
+    rows(table);
+    count = std::max(count, 1);
+    int& next = store->nextIds[table.filename];
+    int& limit = store->idLimits[table.filename];
+    if (next + count > limit) {
+        const int block = std::max(count, kIdBlock);
+        const int claimed = store->service ? store->service->claimIds(table.filename, block)
+                                           : claimIds(dataPath, table.filename, next, block);
+        if (claimed < 0) {
+            qWarning() << "Cannot claim ids of" << table.filename << "- another process may hand out the same ones";
+            limit = next + count;
+            store->sequencesDirty = true;
+        } else {
+            next = claimed;
+            limit = claimed + block;
+        }
+    }
+    int first = next;
+    next += count;
+    return first;
+}
+
+template <typename T>
+void DataManager::insertRow(TableCache<T>& table, const T& row) {
+    rows(table);
+    // An id that is already taken replaces its row, as replaying the "put"
+    // from the journal would
+    auto existing = table.byId.constFind(rowId(row));
+    QJsonObject base;
+    if (existing != table.byId.constEnd()) {
+        base = table.rows.at(existing.value()).toJson();
+        unindexForeignKeys(*store, table.rows.at(existing.value()));
+        table.rows[existing.value()] = row;
+    } else {
+        table.rows.append(row);
+        table.byId.insert(rowId(row), table.rows.size() - 1);
+    }
+    indexForeignKeys(*store, row);
+    int& next = store->nextIds[table.filename];
+    if (rowId(row) >= next) {
+        next = rowId(row) + 1;
+        store->sequencesDirty = true;
+    }
+    stageJournal(table.filename, "put", rowId(row), row.toJson(), base);
+}
+
+template <typename T>
+bool DataManager::replaceRow(TableCache<T>& table, const T& row) {
+    rows(table);
+    auto it = table.byId.constFind(rowId(row));
+    if (it == table.byId.constEnd()) {
+        return false;
+    }
+    const QJsonObject base = table.rows.at(it.value()).toJson();
+    unindexForeignKeys(*store, table.rows.at(it.value()));
+    table.rows[it.value()] = row;
+    indexForeignKeys(*store, row);
+    stageJournal(table.filename, "put", rowId(row), row.toJson(), base);
+    return true;
+}
+
+template <typename T, typename Pred>
+int DataManager::removeRowsIf(TableCache<T>& table, Pred pred) {
+    const QList<T>& current = rows(table);
+    if (std::none_of(current.cbegin(), current.cend(), pred)) {
+        return 0;
+    }
+    for (const T& row : current) {
+        if (pred(row)) {
+            unindexForeignKeys(*store, row);
+            stageJournal(table.filename, "del", rowId(row), QJsonObject(), row.toJson());
+        }
+    }
+    int before = table.rows.size();
+    table.rows.erase(std::remove_if(table.rows.begin(), table.rows.end(), pred), table.rows.end());
+    reindex(table);
+    return before - table.rows.size();
+}
+
+template <typename T>
+std::function<bool()> DataManager::snapshotWriter(const TableCache<T>& table) const {
+    const QString jsonPath = QDir(dataPath).filePath(table.filename);
+    const QList<T> rows = table.rows;
+    return [jsonPath, rows]() {
+        QJsonArray array;
+        for (const T& row : rows) {
+            array.append(row.toJson());
+        }
+        if (!writeJsonFile(jsonPath, array)) {
+            return false;
+        }
+        if (!saveSidecar(jsonPath, rows)) {
+            // Don't leave a sidecar that describes the previous JSON
+            QFile::remove(BinarySnapshot::sidecarPath(jsonPath));
+        }
+        return true;
+    };
+}
+
+// Puts (record) or deletes (empty record) a row without journaling it,
+// keeping the indexes current: for rows another process wrote, and for
+// undoing a batch that did not reach the journal. Deleted rows stay in
+// rows until the caller is done with the batch and calls
+// dropRemovedRows().
+template <typename T>
+void DataManager::applyRow(TableCache<T>& table, int id, const QJsonObject& record) {
+    auto it = table.byId.constFind(id);
+    if (record.isEmpty()) {
+        if (it == table.byId.constEnd()) return;
+        unindexForeignKeys(*store, table.rows.at(it.value()));
+        // Positions stay valid until dropRemovedRows()
+        table.removed.append(it.value());
+        table.byId.remove(id);
+    } else {
+        const T row = T::fromJson(record);
+        if (it != table.byId.constEnd()) {
+            unindexForeignKeys(*store, table.rows.at(it.value()));
+            table.rows[it.value()] = row;
+        } else {
+            table.rows.append(row);
+            table.byId.insert(id, table.rows.size() - 1);
+        }
+        indexForeignKeys(*store, row);
+    }
+    ++store->version;
+}
+
+void DataManager::applyEntry(const QString& table, const QString& op, int id, const QJsonObject& record) {
+    store->forEachTable([&](auto& cache) {
+        if (cache.filename == table && cache.loaded) {
+            applyRow(cache, id, op == "put" ? record : QJsonObject());
+        }
+    });
+}
+
+void DataManager::dropRemovedRows() {
+    store->forEachTable([](auto& cache) { dropRemoved(cache); });
+}
+
+QJsonObject DataManager::currentRecord(const QString& table, int id) const {
+    QJsonObject record;
+    store->forEachTable([&](auto& cache) {
+        if (cache.filename != table) return;
+        auto it = cache.byId.constFind(id);
+        if (it != cache.byId.constEnd()) record = cache.rows.at(it.value()).toJson();
+    });
+    return record;
+}
+
+// Ids of the rows that differ between two versions of a table.
+template <typename T>
+static void collectChangedRows(const QString& table, const QList<T>& before, const QList<T>& after,
+                               QList<QPair<QString, int>>& changes) {
+    QHash<int, QJsonObject> old;
+    for (const T& row : before) {
+        old.insert(rowId(row), row.toJson());
+    }
+    for (const T& row : after) {
+        auto it = old.find(rowId(row));
+        if (it == old.end() || it.value() != row.toJson()) {
+            changes.append(qMakePair(table, rowId(row)));
+        }
+        if (it != old.end()) old.erase(it);
+    }
+    for (auto it = old.constBegin(); it != old.constEnd(); ++it) {
+        changes.append(qMakePair(table, it.key()));
+    }
+}
+
+// Reads the batches other processes appended to the journal since the last
+// read. Their rows go straight into loaded tables (and are announced by the
+// next emitChanges()), or wait in unreplayed for tables not loaded yet. If
+// another process compacted meanwhile, the journal read so far is gone:
+// tables whose stamp moved are reloaded instead, the others only take what
+// the new journal adds. Only call this with no batch pending.
+void DataManager::pullChanges() {
+    DataStore& s = *store;
+    if (s.service) {
+        // Tables not loaded yet get these rows when they are fetched
+        for (const ServiceChange& change : s.service->takeChanges()) {
+            s.forEachTable([&](auto& table) {
+                if (table.filename != change.table || !table.loaded) return;
+                applyRow(table, change.id, change.record);
+                s.pendingChanges.append(qMakePair(table.filename, change.id));
+            });
+        }
+        dropRemovedRows();
+        return;
+    }
+    readJournal();
+    JournalRead read = readJournalFrom(journalPath(), s.journalGeneration, s.journalOffset);
+    QSet<QString> stale;
+    if (read.replaced) {
+        // Stamps first: a batch appended after they are read is in the
+        // journal read after them
+        QHash<QString, quint64> stamps;
+        s.forEachTable([&](auto& table) {
+            if (table.loaded) stamps.insert(table.filename, readStamp(dataPath, table.filename));
+        });
+        read = readJournalFrom(journalPath(), QString(), 0);
+        s.forEachTable([&](auto& table) {
+            if (table.loaded && stamps.value(table.filename) != table.stamp) stale.insert(table.filename);
+        });
+        s.unreplayed.clear();
+    }
+
+    for (const JournalBatch& batch : read.batches) {
+        s.forEachTable([&](auto& table) {
+            const bool reloading = !table.loaded || stale.contains(table.filename);
+            if (!reloading) {
+                // This process's own batches are in memory already, and so
+                // is whatever the table read when it was loaded
+                if (batch.writer == s.writerId) return;
+                if (table.journalGeneration == read.generation && batch.start < table.journalPos) return;
+            }
+            bool touched = false;
+            for (const auto& entry : batch.entries) {
+                if (entry.first != table.filename) continue;
+                touched = true;
+                if (reloading) {
+                    s.unreplayed[table.filename].append(entry.second);
+                    continue;
+                }
+                applyRow(table, entry.second.id, entry.second.op == "put" ? entry.second.record : QJsonObject());
+                s.pendingChanges.append(qMakePair(table.filename, entry.second.id));
+            }
+            if (touched && !reloading) {
+                // The snapshot on disk lacks these rows until it is rewritten
+                s.dirtyTables.insert(table.filename);
+                table.stamp = batch.stamps.value(table.filename, table.stamp);
+            }
+        });
+    }
+    dropRemovedRows();
+    s.journalGeneration = read.generation;
+    s.journalOffset = read.end;
+    s.journalSize = read.end;
+
+    s.forEachTable([&](auto& table) {
+        if (!table.loaded) return;
+        if (stale.contains(table.filename)) {
+            const auto before = table.rows;
+            table.loaded = false;
+            rows(table);
+            collectChangedRows(table.filename, before, table.rows, s.pendingChanges);
+            ++s.version;
+            qDebug() << "Reloaded" << table.filename << "after a compaction by another process";
+        } else {
+            table.journalGeneration = read.generation;
+            table.journalPos = read.end;
+        }
+    });
+}
+
+// Patient operations
+QList<Patient> DataManager::getAllPatients() const {
+    return rows(store->patients);
+}
+
+Patient DataManager::getPatientById(int id) const {
+    return rowById(store->patients, id);
+}
+
+void DataManager::addPatient(const Patient& patient) {
+    insertRow(store->patients, patient);
+    commit();
+}
+
+void DataManager::updatePatient(const Patient& patient) {
+    if (replaceRow(store->patients, patient)) {
+        commit();
+    }
+}
+
+void DataManager::deletePatient(int id) {
+    if (!hasRow(store->patients, id)) {
+        return;
+    }
+
+    beginTransaction();
+    removeRowsIf(store->patients, [id](const Patient& p) { return p.id_patient == id; });
+
+    // Also remove family relations
+    removeRowsIf(store->patientGroups, [id](const PatientGroup& pg) {
+        return pg.id_parent == id || pg.id_child == id;
+    });
+
+    // Also remove appointments, their recipes, and free linked slots
+    QSet<int> appointmentIds;
+    QList<int> scheduleIds;
+    for (const Appointment& a : getPatientAppointments(id)) {
+        appointmentIds.insert(a.id_ap);
+        if (a.id_ap_sch > 0) scheduleIds.append(a.id_ap_sch);
+    }
+    removeRowsIf(store->appointments, [id](const Appointment& a) { return a.id_patient == id; });
+
+    removeRowsIf(store->recipes, [&appointmentIds](const Recipe& r) {
+        return appointmentIds.contains(r.id_ap);
+    });
+
+    for (int scheduleId : scheduleIds) {
+        AppointmentSchedule s = rowById(store->schedules, scheduleId);
+        if (s.id_ap_sch == scheduleId) {
+            s.status = "free";
+            replaceRow(store->schedules, s);
+        }
+    }
+    commitTransaction();
+}
+
+bool DataManager::patientExists(int id) const {
+    return hasRow(store->patients, id);
 }
 
 bool DataManager::emailExists(const QString& email) const {
-    QJsonArray array = loadJson("patient.json");
-    for (const QJsonValue& value : array) {
-        if (value.toObject()["email"].toString() == email) {
-            return true;
-        }
-    }
-    return false;
+    return !credentialsFor(email).isEmpty();
 }
 
 bool DataManager::snilsExists(const QString& snils) const {
-    QJsonArray array = loadJson("patient.json");
-    for (const QJsonValue& value : array) {
-        if (value.toObject()["snils"].toString() == snils) {
+    for (const Patient& p : rows(store->patients)) {
+        if (p.snils == snils) {
             return true;
         }
     }
@@ -240,90 +2141,45 @@ bool DataManager::snilsExists(const QString& snils) const {
 }
 
 bool DataManager::omsExists(const QString& oms) const {
-    QJsonArray array = loadJson("patient.json");
-    for (const QJsonValue& value : array) {
-        if (value.toObject()["oms"].toString() == oms) {
+    for (const Patient& p : rows(store->patients)) {
+        if (p.oms == oms) {
             return true;
         }
     }
     return false;
 }
 
-int DataManager::getNextPatientId() const {
-    QJsonArray array = loadJson("patient.json");
-    int maxId = 0;
-
-    for (const QJsonValue& value : array) {
-        int id = value.toObject()["id_patient"].toInt();
-        if (id > maxId) {
-            maxId = id;
-        }
-    }
-    return maxId + 1;
+int DataManager::getNextPatientId() {
+    return reserveIds(store->patients, 1);
 }
 
 // Doctor operations
 QList<Doctor> DataManager::getAllDoctors() const {
-    QList<Doctor> doctors;
-    QJsonArray array = loadJson("doctor.json");
-
-    for (const QJsonValue& value : array) {
-        doctors.append(Doctor::fromJson(value.toObject()));
-    }
-    return doctors;
+    return rows(store->doctors);
 }
 
 Doctor DataManager::getDoctorById(int id) const {
-    QJsonArray array = loadJson("doctor.json");
-
-    for (const QJsonValue& value : array) {
-        Doctor d = Doctor::fromJson(value.toObject());
-        if (d.id_doctor == id) {
-            return d;
-        }
-    }
-    return Doctor();
+    return rowById(store->doctors, id);
 }
 
 // Specialization operations
 QList<Specialization> DataManager::getAllSpecializations() const {
-    QList<Specialization> specs;
-    QJsonArray array = loadJson("specialization.json");
-
-    for (const QJsonValue& value : array) {
-        specs.append(Specialization::fromJson(value.toObject()));
-    }
-    return specs;
+    return rows(store->specializations);
 }
 
 Specialization DataManager::getSpecializationById(int id) const {
-    QJsonArray array = loadJson("specialization.json");
-
-    for (const QJsonValue& value : array) {
-        Specialization s = Specialization::fromJson(value.toObject());
-        if (s.id_spec == id) {
-            return s;
-        }
-    }
-    return Specialization();
+    return rowById(store->specializations, id);
 }
 
 void DataManager::updateSpecialization(const Specialization& spec) {
-    QJsonArray array = loadJson("specialization.json");
-    for (int i = 0; i < array.size(); ++i) {
-        Specialization cur = Specialization::fromJson(array[i].toObject());
-        if (cur.id_spec == spec.id_spec) {
-            array[i] = spec.toJson();
-            saveJson("specialization.json", array);
-            return;
-        }
+    if (replaceRow(store->specializations, spec)) {
+        commit();
     }
 }
 
 bool DataManager::isSpecializationUsed(int id) const {
-    QJsonArray doctors = loadJson("doctor.json");
-    for (const QJsonValue& v : doctors) {
-        if (v.toObject()["id_spec"].toInt() == id) {
+    for (const Doctor& d : rows(store->doctors)) {
+        if (d.id_spec == id) {
             return true;
         }
     }
@@ -332,227 +2188,325 @@ bool DataManager::isSpecializationUsed(int id) const {
 
 // Room operations
 QList<Room> DataManager::getAllRooms() const {
-    QList<Room> rooms;
-    QJsonArray array = loadJson("room.json");
-
-    for (const QJsonValue& value : array) {
-        rooms.append(Room::fromJson(value.toObject()));
-    }
-    return rooms;
+    return rows(store->rooms);
 }
 
 Room DataManager::getRoomById(int id) const {
-    QJsonArray array = loadJson("room.json");
-
-    for (const QJsonValue& value : array) {
-        Room r = Room::fromJson(value.toObject());
-        if (r.id_room == id) {
-            return r;
-        }
-    }
-    return Room();
+    return rowById(store->rooms, id);
 }
 
 void DataManager::updateRoom(const Room& room) {
-    QJsonArray array = loadJson("room.json");
-    for (int i = 0; i < array.size(); ++i) {
-        Room cur = Room::fromJson(array[i].toObject());
-        if (cur.id_room == room.id_room) {
-            array[i] = room.toJson();
-            saveJson("room.json", array);
-            return;
-        }
+    if (replaceRow(store->rooms, room)) {
+        commit();
     }
 }
 
 bool DataManager::isRoomUsed(int id) const {
-    QJsonArray schedules = loadJson("appointment_schedule.json");
-    for (const QJsonValue& v : schedules) {
-        if (v.toObject()["id_room"].toInt() == id) {
-            return true;
-        }
-    }
-    return false;
+    rows(store->schedules);
+    return store->schedulesByRoom.contains(id);
 }
 
 // Appointment operations
 QList<Appointment> DataManager::getAllAppointments() const {
-    QList<Appointment> appointments;
-    QJsonArray array = loadJson("appointment.json");
+    return rows(store->appointments);
+}
 
-    for (const QJsonValue& value : array) {
-        appointments.append(Appointment::fromJson(value.toObject()));
+const AppointmentColumns& DataManager::getAppointmentColumns() const {
+    const QList<Appointment>& appointments = rows(store->appointments);
+    if (!store->appointmentColumnsValid) {
+        AppointmentColumns& cols = store->appointmentColumns;
+        cols.clear();
+        cols.patient.reserve(appointments.size());
+        cols.doctor.reserve(appointments.size());
+        cols.date.reserve(appointments.size());
+        cols.completed.reserve(appointments.size() / 64 + 1);
+        for (const Appointment& a : appointments) {
+            cols.append(a);
+        }
+        store->appointmentColumnsValid = true;
     }
-    return appointments;
+    return store->appointmentColumns;
 }
 
-QList<Appointment> DataManager::getPatientAppointments(int patientId) const {
-    QList<Appointment> appointments;
-    QJsonArray array = loadJson("appointment.json");
-
-    for (const QJsonValue& value : array) {
-        Appointment a = Appointment::fromJson(value.toObject());
-        if (a.id_patient == patientId) {
-            appointments.append(a);
+const StatisticsRollup& DataManager::getStatisticsRollup() const {
+    // The hooks need all three tables, and loading one drops the rollup
+    rows(store->doctors);
+    rows(store->schedules);
+    const QList<Appointment>& appointments = rows(store->appointments);
+    if (!store->rollupBuilt) {
+        if (!loadRollup()) {
+            rebuildRollup(*store, appointments, getAppointmentColumns());
+            saveRollup();
         }
+        store->rollupBuilt = true;
     }
-    return appointments;
+    return store->rollup;
 }
 
-Appointment DataManager::getAppointmentById(int id) const {
-    QJsonArray array = loadJson("appointment.json");
+template <typename T>
+static SnapshotTable<T> snapshotOf(const TableCache<T>& table) {
+    SnapshotTable<T> copy;
+    copy.rows = table.rows;
+    copy.byId = table.byId;
+    return copy;
+}
 
-    for (const QJsonValue& value : array) {
-        Appointment a = Appointment::fromJson(value.toObject());
-        if (a.id_ap == id) {
-            return a;
-        }
+QSharedPointer<const DataSnapshot> DataManager::snapshot() const {
+    DataStore& s = *store;
+    // Loading a table does not count as a change, so every table is loaded
+    // before the version is compared
+    s.forEachTable([this](auto& table) { rows(table); });
+    const StatisticsRollup& rollup = getStatisticsRollup();
+    const AppointmentColumns& columns = getAppointmentColumns();
+    // Only this thread replaces root, so reading it needs no lock
+    if (s.root && s.root->version == s.version) {
+        return s.root;
     }
-    return Appointment();
+
+    QSharedPointer<DataSnapshot> snap(new DataSnapshot);
+    snap->version = s.version;
+    snap->patients = snapshotOf(s.patients);
+    snap->doctors = snapshotOf(s.doctors);
+    snap->specializations = snapshotOf(s.specializations);
+    snap->rooms = snapshotOf(s.rooms);
+    snap->appointments = snapshotOf(s.appointments);
+    snap->schedules = snapshotOf(s.schedules);
+    snap->patientGroups = snapshotOf(s.patientGroups);
+    snap->diagnoses = snapshotOf(s.diagnoses);
+    snap->recipes = snapshotOf(s.recipes);
+    snap->managers = snapshotOf(s.managers);
+    snap->admins = snapshotOf(s.admins);
+    snap->invitationCodes = snapshotOf(s.invitationCodes);
+    snap->rollup = rollup;
+    snap->appointmentColumns = columns;
+
+    QMutexLocker locker(&s.rootLock);
+    s.root = snap;
+    return s.root;
+}
+
+QSharedPointer<const DataSnapshot> DataManager::publishedSnapshot() const {
+    QMutexLocker locker(&store->rootLock);
+    return store->root;
+}
+
+quint64 DataManager::version() const {
+    return store->version;
+}
+
+QList<Appointment> DataManager::getPatientAppointments(int patientId) const {
+    return rowsByKey(store->appointments, store->appointmentsByPatient, patientId);
+}
+
+Appointment DataManager::getAppointmentById(int id) const {
+    return rowById(store->appointments, id);
+}
+
+Appointment DataManager::getAppointmentByScheduleId(int scheduleId) const {
+    QList<Appointment> linked = rowsByKey(store->appointments, store->appointmentsBySchedule, scheduleId);
+    return linked.isEmpty() ? Appointment() : linked.first();
 }
 
 void DataManager::addAppointment(const Appointment& appointment) {
-    QJsonArray array = loadJson("appointment.json");
-    array.append(appointment.toJson());
-    saveJson("appointment.json", array);
+    insertRow(store->appointments, appointment);
+    commit();
 }
 
 void DataManager::updateAppointment(const Appointment& appointment) {
-    QJsonArray array = loadJson("appointment.json");
-
-    for (int i = 0; i < array.size(); ++i) {
-        QJsonObject obj = array[i].toObject();
-        if (obj["id_ap"].toInt() == appointment.id_ap) {
-            array[i] = appointment.toJson();
-            saveJson("appointment.json", array);
-            return;
-        }
+    if (replaceRow(store->appointments, appointment)) {
+        commit();
     }
 }
 
 void DataManager::deleteAppointment(int id) {
-    QJsonArray array = loadJson("appointment.json");
-
-    for (int i = 0; i < array.size(); ++i) {
-        QJsonObject obj = array[i].toObject();
-        if (obj["id_ap"].toInt() == id) {
-            int scheduleId = obj["id_ap_sch"].toInt(-1);
-            array.removeAt(i);
-            saveJson("appointment.json", array);
-
-            // Also remove recipe if exists
-            QJsonArray recipeArray = loadJson("recipe.json");
-            for (int j = recipeArray.size() - 1; j >= 0; --j) {
-                if (recipeArray[j].toObject()["id_ap"].toInt() == id) {
-                    recipeArray.removeAt(j);
-                }
-            }
-            saveJson("recipe.json", recipeArray);
-
-            // Free the corresponding schedule slot if it exists
-            if (scheduleId > 0) {
-                QJsonArray scheduleArray = loadJson("appointment_schedule.json");
-                for (int s = 0; s < scheduleArray.size(); ++s) {
-                    QJsonObject schObj = scheduleArray[s].toObject();
-                    if (schObj["id_ap_sch"].toInt() == scheduleId) {
-                        schObj["status"] = "free";
-                        scheduleArray[s] = schObj;
-                        break;
-                    }
-                }
-                saveJson("appointment_schedule.json", scheduleArray);
-            }
-            return;
+    if (!hasRow(store->appointments, id)) {
+        return;
+    }
+
+    int scheduleId = rowById(store->appointments, id).id_ap_sch;
+    beginTransaction();
+    removeRowsIf(store->appointments, [id](const Appointment& a) { return a.id_ap == id; });
+
+    // Also remove recipe if exists
+    removeRowsIf(store->recipes, [id](const Recipe& r) { return r.id_ap == id; });
+
+    // Free the corresponding schedule slot if it exists
+    if (scheduleId > 0) {
+        AppointmentSchedule s = rowById(store->schedules, scheduleId);
+        if (s.id_ap_sch == scheduleId) {
+            s.status = "free";
+            replaceRow(store->schedules, s);
         }
     }
+    commitTransaction();
+}
+
+int DataManager::reserveAppointmentIds(int count) {
+    return reserveIds(store->appointments, count);
+}
+
+int DataManager::getNextAppointmentId() {
+    return reserveIds(store->appointments, 1);
+}
+
+// A slot can be booked while it is open and no appointment holds it.
+static bool slotIsFree(const DataStore& s, const AppointmentSchedule& slot) {
+    return isOpenSlot(slot) && !s.appointmentsBySchedule.contains(slot.id_ap_sch);
+}
+
+BookingResult DataManager::bookSlot(int scheduleId, int patientId) {
+    BookingResult result;
+    rows(store->appointments);
+    AppointmentSchedule slot = rowById(store->schedules, scheduleId);
+    if (slot.id_ap_sch != scheduleId) {
+        result.status = BookingResult::NoSuchSlot;
+        return result;
+    }
+    if (!slotIsFree(*store, slot)) {
+        result.status = BookingResult::SlotTaken;
+        return result;
+    }
+
+    Appointment& appointment = result.appointment;
+    appointment.id_ap = reserveIds(store->appointments, 1);
+    appointment.id_patient = patientId;
+    appointment.id_doctor = slot.id_doctor;
+    appointment.id_ap_sch = scheduleId;
+    appointment.date = slot.time_from;
+    appointment.completed = false;
+    slot.status = "booked";
+
+    // Both rows go into one batch built on the slot as read above; the
+    // journal takes it only if no other process wrote the slot meanwhile
+    insertRow(store->appointments, appointment);
+    replaceRow(store->schedules, slot);
+    if (!commit(false)) {
+        // Undone already; tell a lost race from a disk failure
+        AppointmentSchedule now = rowById(store->schedules, scheduleId);
+        result.status = now.id_ap_sch == scheduleId && !slotIsFree(*store, now)
+                            ? BookingResult::SlotTaken : BookingResult::WriteFailed;
+    }
+    return result;
 }
 
-int DataManager::getNextAppointmentId() const {
-    QJsonArray array = loadJson("appointment.json");
-    int maxId = 0;
+BookingResult DataManager::moveToSlot(int appointmentId, int scheduleId) {
+    BookingResult result;
+    Appointment appointment = rowById(store->appointments, appointmentId);
+    if (appointment.id_ap != appointmentId) {
+        result.status = BookingResult::NoSuchAppointment;
+        return result;
+    }
+    AppointmentSchedule slot = rowById(store->schedules, scheduleId);
+    if (slot.id_ap_sch != scheduleId) {
+        result.status = BookingResult::NoSuchSlot;
+        return result;
+    }
+    if (appointment.id_ap_sch == scheduleId) {
+        result.appointment = appointment;
+        return result;
+    }
+    if (!slotIsFree(*store, slot)) {
+        result.status = BookingResult::SlotTaken;
+        return result;
+    }
+
+    const int oldScheduleId = appointment.id_ap_sch;
+    appointment.id_doctor = slot.id_doctor;
+    appointment.id_ap_sch = scheduleId;
+    appointment.date = slot.time_from;
+    slot.status = "booked";
+    result.appointment = appointment;
 
-    for (const QJsonValue& value : array) {
-        int id = value.toObject()["id_ap"].toInt();
-        if (id > maxId) {
-            maxId = id;
+    if (oldScheduleId > 0) {
+        AppointmentSchedule oldSlot = rowById(store->schedules, oldScheduleId);
+        if (oldSlot.id_ap_sch == oldScheduleId) {
+            oldSlot.status = "free";
+            replaceRow(store->schedules, oldSlot);
         }
     }
-    return maxId + 1;
+    replaceRow(store->appointments, appointment);
+    replaceRow(store->schedules, slot);
+    if (!commit(false)) {
+        AppointmentSchedule now = rowById(store->schedules, scheduleId);
+        result.status = now.id_ap_sch == scheduleId && !slotIsFree(*store, now)
+                            ? BookingResult::SlotTaken : BookingResult::WriteFailed;
+    }
+    return result;
 }
 
 // Appointment Schedule operations
 QList<AppointmentSchedule> DataManager::getAllSchedules() const {
-    QList<AppointmentSchedule> schedules;
-    QJsonArray array = loadJson("appointment_schedule.json");
+    return rows(store->schedules);
+}
 
-    for (const QJsonValue& value : array) {
-        schedules.append(AppointmentSchedule::fromJson(value.toObject()));
+QList<AppointmentSchedule> DataManager::getDoctorSchedules(int doctorId) const {
+    return rowsByKey(store->schedules, store->schedulesByDoctor, doctorId);
+}
+
+const AvailabilityIndex& DataManager::availability(int doctorId) const {
+    if (!store->availabilityBuilt) {
+        const QList<AppointmentSchedule>& schedules = rows(store->schedules);
+        const QList<Appointment>& appointments = rows(store->appointments);
+        store->freeSlots.clear();
+        store->appointmentStarts.clear();
+        for (const Appointment& a : appointments) {
+            if (a.date.isValid()) {
+                ++store->appointmentStarts[qMakePair(a.id_doctor, a.date.toSecsSinceEpoch())];
+            }
+        }
+        for (const AppointmentSchedule& s : schedules) {
+            addFreeSlot(*store, s);
+        }
+        store->availabilityBuilt = true;
     }
-    return schedules;
+    return store->freeSlots[doctorId];
 }
 
-QList<AppointmentSchedule> DataManager::getDoctorSchedules(int doctorId) const {
-    QList<AppointmentSchedule> schedules;
-    QJsonArray array = loadJson("appointment_schedule.json");
+// Free slots from first to last (inclusive; open-ended if last is invalid),
+// never earlier than now.
+QList<AppointmentSchedule> DataManager::availableBetween(int doctorId, const QDate& first, const QDate& last) const {
+    const AvailabilityIndex& index = availability(doctorId);
+    qint64 now = QDateTime::currentDateTime().toSecsSinceEpoch();
+    qint64 firstDay = std::max(first.toJulianDay(), QDate::currentDate().toJulianDay());
 
-    for (const QJsonValue& value : array) {
-        AppointmentSchedule s = AppointmentSchedule::fromJson(value.toObject());
-        if (s.id_doctor == doctorId) {
-            schedules.append(s);
+    QList<AppointmentSchedule> available;
+    for (auto it = index.days.lowerBound(firstDay); it != index.days.end(); ++it) {
+        if (last.isValid() && it.key() > last.toJulianDay()) break;
+        for (const AvailabilityIndex::Slot& slot : it.value()) {
+            if (slot.from >= now) {
+                available.append(rowById(store->schedules, slot.id));
+            }
         }
     }
-    return schedules;
+    return available;
 }
 
 QList<AppointmentSchedule> DataManager::getAvailableSchedules(int doctorId) const {
-    QList<AppointmentSchedule> available;
-    QList<AppointmentSchedule> schedules = getDoctorSchedules(doctorId);
-    QDateTime now = QDateTime::currentDateTime();
+    return availableBetween(doctorId, QDate::currentDate(), QDate());
+}
 
-    qDebug() << "getAvailableSchedules for doctor" << doctorId << "- Total schedules:" << schedules.size();
-    
-    for (const AppointmentSchedule& schedule : schedules) {
-        qDebug() << "  Schedule" << schedule.id_ap_sch << ":" 
-                 << schedule.time_from.toString("yyyy-MM-dd HH:mm") 
-                 << "Status:" << schedule.status
-                 << "isPast:" << (schedule.time_from < now);
-        
-        // Пропускаем прошедшие слоты
-        if (schedule.time_from < now) {
-            continue;
-        }
+QList<AppointmentSchedule> DataManager::getAvailableSchedules(int doctorId, const QDate& day) const {
+    return availableBetween(doctorId, day, day);
+}
 
-        // Если для этого слота уже есть запись (даже если статус не обновлён), исключаем его.
-        // Сравниваем по врачу и точному времени начала.
-        bool occupiedByAppointment = false;
-        QList<Appointment> appts = getAppointmentsByDoctor(schedule.id_doctor);
-        for (const Appointment &a : appts) {
-            if (a.date.isValid() && schedule.time_from.isValid() && a.date == schedule.time_from) {
-                occupiedByAppointment = true;
-                qDebug() << "    Excluding schedule" << schedule.id_ap_sch << "because appointment" << a.id_ap << "exists at same time";
-                break;
-            }
-        }
-        if (occupiedByAppointment) continue;
+QSet<QDate> DataManager::getAvailableDays(int doctorId) const {
+    const AvailabilityIndex& index = availability(doctorId);
+    qint64 now = QDateTime::currentDateTime().toSecsSinceEpoch();
+    qint64 today = QDate::currentDate().toJulianDay();
 
-        // Возвращаем только свободные слоты (по умолчанию "free" если не указано)
-        QString st = schedule.status.trimmed().toLower();
-        if (st.isEmpty() || st == "free" || st == "available") {
-            available.append(schedule);
-        }
+    QSet<QDate> days;
+    for (auto it = index.days.lowerBound(today); it != index.days.end(); ++it) {
+        // Today's bucket may hold nothing but slots that already started
+        if (it.key() == today && it.value().last().from < now) continue;
+        days.insert(QDate::fromJulianDay(it.key()));
     }
-    
-    qDebug() << "Available schedules count:" << available.size();
-    return available;
+    return days;
 }
 
 // Patient Group operations
 QList<PatientGroup> DataManager::getPatientFamilyMembers(int parentId) const {
     QList<PatientGroup> members;
-    QJsonArray array = loadJson("patient_group.json");
-
-    for (const QJsonValue& value : array) {
-        PatientGroup pg = PatientGroup::fromJson(value.toObject());
+    for (const PatientGroup& pg : rows(store->patientGroups)) {
         if (pg.id_parent == parentId) {
             members.append(pg);
         }
@@ -562,10 +2516,7 @@ QList<PatientGroup> DataManager::getPatientFamilyMembers(int parentId) const {
 
 QList<PatientGroup> DataManager::getPatientParents(int childId) const {
     QList<PatientGroup> parents;
-    QJsonArray array = loadJson("patient_group.json");
-
-    for (const QJsonValue& value : array) {
-        PatientGroup pg = PatientGroup::fromJson(value.toObject());
+    for (const PatientGroup& pg : rows(store->patientGroups)) {
         if (pg.id_child == childId) {
             parents.append(pg);
         }
@@ -574,42 +2525,27 @@ QList<PatientGroup> DataManager::getPatientParents(int childId) const {
 }
 
 void DataManager::addFamilyMember(const PatientGroup& group) {
-    QJsonArray array = loadJson("patient_group.json");
-    array.append(group.toJson());
-    saveJson("patient_group.json", array);
+    insertRow(store->patientGroups, group);
+    commit();
 }
 
 void DataManager::updateFamilyGroup(const PatientGroup& group) {
-    QJsonArray array = loadJson("patient_group.json");
-
-    for (int i = 0; i < array.size(); ++i) {
-        if (array[i].toObject()["id_patient_group"].toInt() == group.id_patient_group) {
-            array[i] = group.toJson();
-            saveJson("patient_group.json", array);
-            return;
-        }
+    if (replaceRow(store->patientGroups, group)) {
+        commit();
     }
 }
 
 void DataManager::removeFamilyMember(int id_patient_group) {
-    QJsonArray array = loadJson("patient_group.json");
-
-    for (int i = 0; i < array.size(); ++i) {
-        if (array[i].toObject()["id_patient_group"].toInt() == id_patient_group) {
-            array.removeAt(i);
-            saveJson("patient_group.json", array);
-            return;
-        }
+    if (removeRowsIf(store->patientGroups, [id_patient_group](const PatientGroup& pg) {
+            return pg.id_patient_group == id_patient_group;
+        }) > 0) {
+        commit();
     }
 }
 
 bool DataManager::isFamilyMember(int parentId, int childId) const {
-    QJsonArray array = loadJson("patient_group.json");
-
-    for (const QJsonValue& value : array) {
-        QJsonObject obj = value.toObject();
-        if (obj["id_parent"].toInt() == parentId &&
-            obj["id_child"].toInt() == childId) {
+    for (const PatientGroup& pg : rows(store->patientGroups)) {
+        if (pg.id_parent == parentId && pg.id_child == childId) {
             return true;
         }
     }
@@ -617,125 +2553,65 @@ bool DataManager::isFamilyMember(int parentId, int childId) const {
 }
 
 bool DataManager::isPatientInAnyFamily(int patientId) const {
-    QJsonArray array = loadJson("patient_group.json");
-
-    for (const QJsonValue& value : array) {
-        QJsonObject obj = value.toObject();
+    for (const PatientGroup& pg : rows(store->patientGroups)) {
         // Проверяем, состоит ли пациент в семье как parent или как child
-        if (obj["id_parent"].toInt() == patientId || obj["id_child"].toInt() == patientId) {
+        if (pg.id_parent == patientId || pg.id_child == patientId) {
             return true;
         }
     }
     return false;
 }
 
-int DataManager::getNextPatientGroupId() const {
-    QJsonArray array = loadJson("patient_group.json");
-    int maxId = 0;
-
-    for (const QJsonValue& value : array) {
-        int id = value.toObject()["id_patient_group"].toInt();
-        if (id > maxId) {
-            maxId = id;
-        }
-    }
-    return maxId + 1;
+int DataManager::getNextPatientGroupId() {
+    return reserveIds(store->patientGroups, 1);
 }
 
 // Recipe operations
 QList<Recipe> DataManager::getAllRecipes() const {
-    QList<Recipe> recipes;
-    QJsonArray array = loadJson("recipe.json");
-
-    for (const QJsonValue& value : array) {
-        recipes.append(Recipe::fromJson(value.toObject()));
-    }
-    return recipes;
+    return rows(store->recipes);
 }
 
 Recipe DataManager::getRecipeByAppointmentId(int appointmentId) const {
-    QJsonArray array = loadJson("recipe.json");
-
-    for (const QJsonValue& value : array) {
-        Recipe r = Recipe::fromJson(value.toObject());
-        if (r.id_ap == appointmentId) {
-            return r;
-        }
-    }
-    return Recipe();
+    QList<Recipe> linked = rowsByKey(store->recipes, store->recipesByAppointment, appointmentId);
+    return linked.isEmpty() ? Recipe() : linked.first();
 }
 
 void DataManager::addRecipe(const Recipe& recipe) {
-    QJsonArray array = loadJson("recipe.json");
-    array.append(recipe.toJson());
-    saveJson("recipe.json", array);
+    insertRow(store->recipes, recipe);
+    commit();
 }
 
-int DataManager::getNextRecipeId() const {
-    QJsonArray array = loadJson("recipe.json");
-    int maxId = 0;
-    for (const QJsonValue& value : array) {
-        int id = value.toObject()["id"].toInt();
-        if (id > maxId) maxId = id;
-    }
-    return maxId + 1;
+int DataManager::getNextRecipeId() {
+    return reserveIds(store->recipes, 1);
 }
 
 // Diagnosis operations
 QList<Diagnosis> DataManager::getAllDiagnoses() const {
-    QList<Diagnosis> diagnoses;
-    QJsonArray array = loadJson("diagnosis.json");
-
-    for (const QJsonValue& value : array) {
-        diagnoses.append(Diagnosis::fromJson(value.toObject()));
-    }
-    return diagnoses;
+    return rows(store->diagnoses);
 }
 
 Diagnosis DataManager::getDiagnosisById(int id) const {
-    QJsonArray array = loadJson("diagnosis.json");
-
-    for (const QJsonValue& value : array) {
-        Diagnosis d = Diagnosis::fromJson(value.toObject());
-        if (d.id_diagnosis == id) {
-            return d;
-        }
-    }
-    return Diagnosis();
+    return rowById(store->diagnoses, id);
 }
 
 void DataManager::addDiagnosis(const Diagnosis& diagnosis) {
-    QJsonArray array = loadJson("diagnosis.json");
-    array.append(diagnosis.toJson());
-    saveJson("diagnosis.json", array);
+    insertRow(store->diagnoses, diagnosis);
+    commit();
 }
 
-int DataManager::getNextDiagnosisId() const {
-    QJsonArray array = loadJson("diagnosis.json");
-    int maxId = 0;
-    for (const QJsonValue& value : array) {
-        int id = value.toObject()["id_diagnosis"].toInt();
-        if (id > maxId) maxId = id;
-    }
-    return maxId + 1;
+int DataManager::getNextDiagnosisId() {
+    return reserveIds(store->diagnoses, 1);
 }
 
 void DataManager::updateDiagnosis(const Diagnosis& diagnosis) {
-    QJsonArray array = loadJson("diagnosis.json");
-    for (int i = 0; i < array.size(); ++i) {
-        Diagnosis cur = Diagnosis::fromJson(array[i].toObject());
-        if (cur.id_diagnosis == diagnosis.id_diagnosis) {
-            array[i] = diagnosis.toJson();
-            saveJson("diagnosis.json", array);
-            return;
-        }
+    if (replaceRow(store->diagnoses, diagnosis)) {
+        commit();
     }
 }
 
 bool DataManager::isDiagnosisUsed(int id) const {
-    QJsonArray recipes = loadJson("recipe.json");
-    for (const QJsonValue& v : recipes) {
-        if (v.toObject()["id_diagnosis"].toInt() == id) {
+    for (const Recipe& r : rows(store->recipes)) {
+        if (r.id_diagnosis == id) {
             return true;
         }
     }
@@ -743,204 +2619,105 @@ bool DataManager::isDiagnosisUsed(int id) const {
 }
 
 QList<Appointment> DataManager::getAppointmentsByDoctor(int doctorId) const {
-    QList<Appointment> appointments;
-    QJsonArray array = loadJson("appointment.json");
-
-    for (const QJsonValue& value : array) {
-        Appointment apt = Appointment::fromJson(value.toObject());
-        if (apt.id_doctor == doctorId) {
-            appointments.append(apt);
-        }
-    }
-    return appointments;
+    return rowsByKey(store->appointments, store->appointmentsByDoctor, doctorId);
 }
 
 QList<AppointmentSchedule> DataManager::getSchedulesByRoom(int roomId) const {
-    QList<AppointmentSchedule> schedules;
-    QJsonArray array = loadJson("appointment_schedule.json");
-
-    for (const QJsonValue& value : array) {
-        AppointmentSchedule s = AppointmentSchedule::fromJson(value.toObject());
-        if (s.id_room == roomId) {
-            schedules.append(s);
-        }
-    }
-    return schedules;
+    return rowsByKey(store->schedules, store->schedulesByRoom, roomId);
 }
 
 bool DataManager::doctorExists(int id) const {
-    QJsonArray array = loadJson("doctor.json");
-
-    for (const QJsonValue& value : array) {
-        Doctor d = Doctor::fromJson(value.toObject());
-        if (d.id_doctor == id) {
-            return true;
-        }
-    }
-    return false;
+    return hasRow(store->doctors, id);
 }
 
 QList<Manager> DataManager::getAllManagers() const {
-    QList<Manager> managers;
-    QJsonArray array = loadJson("manager.json");
-
-    for (const QJsonValue& value : array) {
-        managers.append(Manager::fromJson(value.toObject()));
-    }
-    return managers;
+    return rows(store->managers);
 }
 
 Manager DataManager::getManagerById(int id) const {
-    QJsonArray array = loadJson("manager.json");
-
-    for (const QJsonValue& value : array) {
-        Manager m = Manager::fromJson(value.toObject());
-        if (m.id == id) {
-            return m;
-        }
-    }
-    return Manager();
+    return rowById(store->managers, id);
 }
 
 bool DataManager::managerExists(int id) const {
-    QJsonArray array = loadJson("manager.json");
-
-    for (const QJsonValue& value : array) {
-        Manager m = Manager::fromJson(value.toObject());
-        if (m.id == id) {
-            return true;
-        }
-    }
-    return false;
+    return hasRow(store->managers, id);
 }
 
 bool DataManager::managerLogin(int id, const QString& password) const {
-    QJsonArray array = loadJson("manager.json");
-
-    for (const QJsonValue& value : array) {
-        Manager m = Manager::fromJson(value.toObject());
-        if (m.id == id && verifyPassword(password, m.password)) {
-            return true;
-        }
+    if (!hasRow(store->managers, id)) {
+        return false;
     }
-    return false;
+    return verifyPassword(password, rowById(store->managers, id).password);
 }
 
 void DataManager::addManager(const Manager& manager) {
-    QJsonArray array = loadJson("manager.json");
-    array.append(manager.toJson());
-    saveJson("manager.json", array);
+    insertRow(store->managers, manager);
+    commit();
 }
 
 void DataManager::updateManager(const Manager& manager) {
-    QJsonArray array = loadJson("manager.json");
-    for (int i = 0; i < array.size(); ++i) {
-        Manager m = Manager::fromJson(array[i].toObject());
-        if (m.id == manager.id) {
-            array[i] = manager.toJson();
-            break;
-        }
+    if (replaceRow(store->managers, manager)) {
+        commit();
     }
-    saveJson("manager.json", array);
 }
 
 void DataManager::deleteManager(int id) {
-    QJsonArray array = loadJson("manager.json");
-    QJsonArray newArray;
-    for (const QJsonValue& value : array) {
-        Manager m = Manager::fromJson(value.toObject());
-        if (m.id != id) {
-            newArray.append(value);
-        }
+    if (removeRowsIf(store->managers, [id](const Manager& m) { return m.id == id; }) > 0) {
+        commit();
     }
-    saveJson("manager.json", newArray);
 }
 
-int DataManager::getNextManagerId() const {
-    QJsonArray array = loadJson("manager.json");
-    int maxId = 0;
-    for (const QJsonValue& value : array) {
-        Manager m = Manager::fromJson(value.toObject());
-        if (m.id > maxId) maxId = m.id;
-    }
-    return maxId + 1;
+int DataManager::getNextManagerId() {
+    return reserveIds(store->managers, 1);
 }
 
 // Admin Doctor operations
 void DataManager::addDoctor(const Doctor& doctor) {
-    QJsonArray array = loadJson("doctor.json");
-    array.append(doctor.toJson());
-    saveJson("doctor.json", array);
+    insertRow(store->doctors, doctor);
+    commit();
 }
 
 void DataManager::updateDoctor(const Doctor& doctor) {
-    QJsonArray array = loadJson("doctor.json");
-    for (int i = 0; i < array.size(); ++i) {
-        Doctor d = Doctor::fromJson(array[i].toObject());
-        if (d.id_doctor == doctor.id_doctor) {
-            array[i] = doctor.toJson();
-            break;
-        }
+    if (replaceRow(store->doctors, doctor)) {
+        commit();
     }
-    saveJson("doctor.json", array);
 }
 
 void DataManager::deleteDoctor(int id) {
-    QJsonArray array = loadJson("doctor.json");
-    QJsonArray newArray;
-    for (const QJsonValue& value : array) {
-        Doctor d = Doctor::fromJson(value.toObject());
-        if (d.id_doctor != id) {
-            newArray.append(value);
-        }
+    if (removeRowsIf(store->doctors, [id](const Doctor& d) { return d.id_doctor == id; }) > 0) {
+        commit();
     }
-    saveJson("doctor.json", newArray);
 }
 
-int DataManager::getNextDoctorId() const {
-    QJsonArray array = loadJson("doctor.json");
-    int maxId = 0;
-    for (const QJsonValue& value : array) {
-        Doctor d = Doctor::fromJson(value.toObject());
-        if (d.id_doctor > maxId) maxId = d.id_doctor;
-    }
-    return maxId + 1;
+int DataManager::getNextDoctorId() {
+    return reserveIds(store->doctors, 1);
 }
 
 // Admin Schedule operations
 AppointmentSchedule DataManager::getScheduleById(int id) const {
-    QJsonArray array = loadJson("appointment_schedule.json");
-    for (const QJsonValue& value : array) {
-        AppointmentSchedule s = AppointmentSchedule::fromJson(value.toObject());
-        if (s.id_ap_sch == id) {
-            return s;
-        }
-    }
-    return AppointmentSchedule();
+    return rowById(store->schedules, id);
 }
 
 bool DataManager::canAddSchedule(const AppointmentSchedule& schedule) const {
     // Validate that the new schedule does not overlap with existing schedules
     // for the same doctor or in the same room. Touching endpoints are allowed.
-    QList<AppointmentSchedule> doctorSchedules = getDoctorSchedules(schedule.id_doctor);
-    for (const AppointmentSchedule &s : doctorSchedules) {
-        if (s.time_from.isValid() && s.time_to.isValid()) {
-            if (schedule.time_from < s.time_to && s.time_from < schedule.time_to) {
-                return false;
-            }
-        }
-    }
+    return !doctorHasOverlap(schedule.id_doctor, schedule.time_from, schedule.time_to)
+        && !roomHasOverlap(schedule.id_room, schedule.time_from, schedule.time_to);
+}
 
-    QList<AppointmentSchedule> allSchedules = getAllSchedules();
-    for (const AppointmentSchedule &s : allSchedules) {
-        if (s.id_room == schedule.id_room && s.time_from.isValid() && s.time_to.isValid()) {
-            if (schedule.time_from < s.time_to && s.time_from < schedule.time_to) {
-                return false;
-            }
-        }
-    }
+bool DataManager::doctorHasOverlap(int doctorId, const QDateTime& from, const QDateTime& to, int ignoreScheduleId) const {
+    if (!from.isValid() || !to.isValid()) return false;
+    rows(store->schedules);
+    auto it = store->doctorIntervals.constFind(doctorId);
+    if (it == store->doctorIntervals.constEnd()) return false;
+    return it->overlaps(from.toSecsSinceEpoch(), to.toSecsSinceEpoch(), ignoreScheduleId);
+}
 
-    return true;
+bool DataManager::roomHasOverlap(int roomId, const QDateTime& from, const QDateTime& to, int ignoreScheduleId) const {
+    if (!from.isValid() || !to.isValid()) return false;
+    rows(store->schedules);
+    auto it = store->roomIntervals.constFind(roomId);
+    if (it == store->roomIntervals.constEnd()) return false;
+    return it->overlaps(from.toSecsSinceEpoch(), to.toSecsSinceEpoch(), ignoreScheduleId);
 }
 
 void DataManager::addSchedule(const AppointmentSchedule& schedule) {
@@ -949,253 +2726,230 @@ void DataManager::addSchedule(const AppointmentSchedule& schedule) {
         return;
     }
 
-    QJsonArray array = loadJson("appointment_schedule.json");
-    array.append(schedule.toJson());
-    saveJson("appointment_schedule.json", array);
+    insertRow(store->schedules, schedule);
+    commit();
 }
 
-void DataManager::updateSchedule(const AppointmentSchedule& schedule) {
-    QJsonArray array = loadJson("appointment_schedule.json");
-    for (int i = 0; i < array.size(); ++i) {
-        AppointmentSchedule s = AppointmentSchedule::fromJson(array[i].toObject());
-        if (s.id_ap_sch == schedule.id_ap_sch) {
-            array[i] = schedule.toJson();
-            break;
+QList<ScheduleBatchResult> DataManager::addSchedules(const QList<AppointmentSchedule>& schedules) {
+    // Validate the whole batch in one sweep: each slot is checked against the
+    // existing intervals and against slots accepted earlier in the batch.
+    QList<ScheduleBatchResult> results;
+    results.reserve(schedules.size());
+    QHash<int, IntervalIndex> batchDoctors;
+    QHash<int, IntervalIndex> batchRooms;
+    int accepted = 0;
+
+    for (const AppointmentSchedule& schedule : schedules) {
+        ScheduleBatchResult result;
+        result.schedule = schedule;
+
+        if (!schedule.time_from.isValid() || !schedule.time_to.isValid()
+            || schedule.time_to <= schedule.time_from) {
+            result.status = ScheduleBatchResult::InvalidTime;
+        } else if (doctorHasOverlap(schedule.id_doctor, schedule.time_from, schedule.time_to)) {
+            result.status = ScheduleBatchResult::DoctorOverlap;
+        } else if (roomHasOverlap(schedule.id_room, schedule.time_from, schedule.time_to)) {
+            result.status = ScheduleBatchResult::RoomOverlap;
+        } else {
+            qint64 from = schedule.time_from.toSecsSinceEpoch();
+            qint64 to = schedule.time_to.toSecsSinceEpoch();
+            if (batchDoctors[schedule.id_doctor].overlaps(from, to)
+                || batchRooms[schedule.id_room].overlaps(from, to)) {
+                result.status = ScheduleBatchResult::BatchOverlap;
+            } else {
+                batchDoctors[schedule.id_doctor].insert(from, to, -1);
+                batchRooms[schedule.id_room].insert(from, to, -1);
+                result.status = ScheduleBatchResult::Accepted;
+                ++accepted;
+            }
         }
+        results.append(result);
     }
-    saveJson("appointment_schedule.json", array);
+
+    if (accepted == 0) {
+        return results;
+    }
+
+    // Allocate a contiguous id range for the accepted slots and persist once
+    int nextId = reserveIds(store->schedules, accepted);
+    for (ScheduleBatchResult& result : results) {
+        if (result.status != ScheduleBatchResult::Accepted) continue;
+        result.schedule.id_ap_sch = nextId++;
+        insertRow(store->schedules, result.schedule);
+    }
+    commit();
+    return results;
 }
 
-void DataManager::deleteSchedule(int id) {
-    QJsonArray array = loadJson("appointment_schedule.json");
-    QJsonArray newArray;
-    for (const QJsonValue& value : array) {
-        AppointmentSchedule s = AppointmentSchedule::fromJson(value.toObject());
-        if (s.id_ap_sch != id) {
-            newArray.append(value);
-        }
+void DataManager::updateSchedule(const AppointmentSchedule& schedule) {
+    if (replaceRow(store->schedules, schedule)) {
+        commit();
     }
-    saveJson("appointment_schedule.json", newArray);
 }
 
-int DataManager::getNextScheduleId() const {
-    QJsonArray array = loadJson("appointment_schedule.json");
-    int maxId = 0;
-    for (const QJsonValue& value : array) {
-        AppointmentSchedule s = AppointmentSchedule::fromJson(value.toObject());
-        if (s.id_ap_sch > maxId) maxId = s.id_ap_sch;
+void DataManager::deleteSchedule(int id) {
+    if (removeRowsIf(store->schedules, [id](const AppointmentSchedule& s) { return s.id_ap_sch == id; }) > 0) {
+        commit();
     }
-    return maxId + 1;
+}
+
+int DataManager::reserveScheduleIds(int count) {
+    return reserveIds(store->schedules, count);
+}
+
+int DataManager::getNextScheduleId() {
+    return reserveIds(store->schedules, 1);
 }
 
 // Admin Specialization operations
 void DataManager::addSpecialization(const Specialization& spec) {
-    QJsonArray array = loadJson("specialization.json");
-    array.append(spec.toJson());
-    saveJson("specialization.json", array);
+    insertRow(store->specializations, spec);
+    commit();
 }
 
 void DataManager::deleteSpecialization(int id) {
-    QJsonArray array = loadJson("specialization.json");
-    QJsonArray newArray;
-    for (const QJsonValue& value : array) {
-        Specialization s = Specialization::fromJson(value.toObject());
-        if (s.id_spec != id) {
-            newArray.append(value);
-        }
+    if (removeRowsIf(store->specializations, [id](const Specialization& s) { return s.id_spec == id; }) > 0) {
+        commit();
     }
-    saveJson("specialization.json", newArray);
 }
 
-int DataManager::getNextSpecializationId() const {
-    QJsonArray array = loadJson("specialization.json");
-    int maxId = 0;
-    for (const QJsonValue& value : array) {
-        Specialization s = Specialization::fromJson(value.toObject());
-        if (s.id_spec > maxId) maxId = s.id_spec;
-    }
-    return maxId + 1;
+int DataManager::getNextSpecializationId() {
+    return reserveIds(store->specializations, 1);
 }
 
 // Admin Room operations
 void DataManager::addRoom(const Room& room) {
-    QJsonArray array = loadJson("room.json");
-    array.append(room.toJson());
-    saveJson("room.json", array);
+    insertRow(store->rooms, room);
+    commit();
 }
 
 void DataManager::deleteRoom(int id) {
-    QJsonArray array = loadJson("room.json");
-    QJsonArray newArray;
-    for (const QJsonValue& value : array) {
-        Room r = Room::fromJson(value.toObject());
-        if (r.id_room != id) {
-            newArray.append(value);
-        }
+    if (removeRowsIf(store->rooms, [id](const Room& r) { return r.id_room == id; }) > 0) {
+        commit();
     }
-    saveJson("room.json", newArray);
 }
 
-int DataManager::getNextRoomId() const {
-    QJsonArray array = loadJson("room.json");
-    int maxId = 0;
-    for (const QJsonValue& value : array) {
-        Room r = Room::fromJson(value.toObject());
-        if (r.id_room > maxId) maxId = r.id_room;
-    }
-    return maxId + 1;
+int DataManager::getNextRoomId() {
+    return reserveIds(store->rooms, 1);
 }
 
 // Admin Diagnosis operations
 void DataManager::deleteDiagnosis(int id) {
-    QJsonArray array = loadJson("diagnosis.json");
-    QJsonArray newArray;
-    for (const QJsonValue& value : array) {
-        Diagnosis d = Diagnosis::fromJson(value.toObject());
-        if (d.id_diagnosis != id) {
-            newArray.append(value);
-        }
+    if (removeRowsIf(store->diagnoses, [id](const Diagnosis& d) { return d.id_diagnosis == id; }) > 0) {
+        commit();
     }
-    saveJson("diagnosis.json", newArray);
 }
 
 // Admin login
 bool DataManager::adminLogin(int id, const QString& password) const {
-    QJsonArray array = loadJson("admin.json");
-    for (const QJsonValue& value : array) {
-        QJsonObject obj = value.toObject();
-        if (obj["id"].toInt() == id && verifyPassword(password, obj["password"].toString())) {
-            return true;
-        }
+    if (!hasRow(store->admins, id)) {
+        return false;
     }
-    return false;
+    return verifyPassword(password, rowById(store->admins, id).password);
 }
 
 // Admin helpers
 QList<Admin> DataManager::getAllAdmins() const {
-    QList<Admin> list;
-    QJsonArray array = loadJson("admin.json");
-    for (const QJsonValue &v : array) {
-        list.append(Admin::fromJson(v.toObject()));
-    }
-    return list;
+    return rows(store->admins);
 }
 
 Admin DataManager::getAdminById(int id) const {
-    QJsonArray array = loadJson("admin.json");
-    for (const QJsonValue &v : array) {
-        Admin a = Admin::fromJson(v.toObject());
-        if (a.id == id) return a;
-    }
-    return Admin();
+    return rowById(store->admins, id);
 }
 
 Admin DataManager::getAdminByEmail(const QString &email) const {
-    QJsonArray array = loadJson("admin.json");
-    for (const QJsonValue &v : array) {
-        Admin a = Admin::fromJson(v.toObject());
-        if (a.email == email) return a;
-    }
-    return Admin();
+    return rowById(store->admins, accountIdByEmail(LoginUser::ADMIN, email));
 }
 
 bool DataManager::adminLoginByEmail(const QString &email, const QString &password) const {
-    Admin a = getAdminByEmail(email);
-    if (a.id <= 0) return false;
-    return verifyPassword(password, a.password);
+    return loginAs(LoginUser::ADMIN, email, password);
 }
 
 // CHANGED: Add updateAdmin method
 void DataManager::updateAdmin(const Admin& admin) {
-    QJsonArray array = loadJson("admin.json");
-    QJsonArray newArray;
-    bool found = false;
-    
-    for (const QJsonValue &v : array) {
-        QJsonObject obj = v.toObject();
-        if (obj["id"].toInt() == admin.id) {
-            newArray.append(admin.toJson());
-            found = true;
-        } else {
-            newArray.append(obj);
-        }
-    }
-    
-    if (found) {
-        saveJson("admin.json", newArray);
+    if (replaceRow(store->admins, admin)) {
+        commit();
     }
 }
 
 // Authentication by email + password
-bool DataManager::patientLoginByEmail(const QString& email, const QString& password) const {
-    const QList<Patient>& patients = getAllPatients();
-    qDebug() << "Checking" << patients.size() << "patients for email:" << email;
-    for (const Patient& p : patients) {
-        if (p.email == email) {
-            qDebug() << "Found patient with email:" << email;
-            bool verified = verifyPassword(password, p.password);
-            qDebug() << "Password verification result:" << verified;
-            if (verified) {
-                return true;
-            }
+const QVector<Credential>& DataManager::credentialsFor(const QString& email) const {
+    if (!store->credentialsBuilt) {
+        store->credentials.clear();
+        for (const Patient& p : rows(store->patients)) {
+            addCredential(*store, LoginUser::PATIENT, p.id_patient, p.email, p.password);
         }
+        for (const Doctor& d : rows(store->doctors)) {
+            addCredential(*store, LoginUser::DOCTOR, d.id_doctor, d.email, d.password);
+        }
+        for (const Manager& m : rows(store->managers)) {
+            addCredential(*store, LoginUser::MANAGER, m.id, m.email, m.password);
+        }
+        for (const Admin& a : rows(store->admins)) {
+            addCredential(*store, LoginUser::ADMIN, a.id, a.email, a.password);
+        }
+        store->credentialsBuilt = true;
     }
-    return false;
+    static const QVector<Credential> none;
+    auto it = store->credentials.constFind(normalizedEmail(email));
+    return it != store->credentials.constEnd() ? it.value() : none;
 }
 
-bool DataManager::doctorLoginByEmail(const QString& email, const QString& password) const {
-    const QList<Doctor>& doctors = getAllDoctors();
-    for (const Doctor& d : doctors) {
-        if (d.email == email && verifyPassword(password, d.password)) {
-            return true;
+Credential DataManager::authenticate(const QString& email, const QString& password) const {
+    // Usually a single account; roles are tried patient, doctor, manager, admin
+    for (const Credential& c : credentialsFor(email)) {
+        if (verifyPassword(password, c.hash)) {
+            return c;
         }
     }
-    return false;
+    return Credential();
 }
 
-bool DataManager::managerLoginByEmail(const QString& email, const QString& password) const {
-    const QList<Manager>& managers = getAllManagers();
-    for (const Manager& m : managers) {
-        if (m.email == email && verifyPassword(password, m.password)) {
+bool DataManager::loginAs(LoginUser::UserType role, const QString& email, const QString& password) const {
+    for (const Credential& c : credentialsFor(email)) {
+        if (c.role == role && verifyPassword(password, c.hash)) {
             return true;
         }
     }
     return false;
 }
 
-Patient DataManager::getPatientByEmail(const QString& email) const {
-    const QList<Patient>& patients = getAllPatients();
-    for (const Patient& p : patients) {
-        if (p.email == email) {
-            return p;
+int DataManager::accountIdByEmail(LoginUser::UserType role, const QString& email) const {
+    for (const Credential& c : credentialsFor(email)) {
+        if (c.role == role) {
+            return c.id;
         }
     }
-    return Patient();
+    return -1;
+}
+
+bool DataManager::patientLoginByEmail(const QString& email, const QString& password) const {
+    return loginAs(LoginUser::PATIENT, email, password);
+}
+
+bool DataManager::doctorLoginByEmail(const QString& email, const QString& password) const {
+    return loginAs(LoginUser::DOCTOR, email, password);
+}
+
+bool DataManager::managerLoginByEmail(const QString& email, const QString& password) const {
+    return loginAs(LoginUser::MANAGER, email, password);
+}
+
+Patient DataManager::getPatientByEmail(const QString& email) const {
+    return rowById(store->patients, accountIdByEmail(LoginUser::PATIENT, email));
 }
 
 Doctor DataManager::getDoctorByEmail(const QString& email) const {
-    const QList<Doctor>& doctors = getAllDoctors();
-    for (const Doctor& d : doctors) {
-        if (d.email == email) {
-            return d;
-        }
-    }
-    return Doctor();
+    return rowById(store->doctors, accountIdByEmail(LoginUser::DOCTOR, email));
 }
 
 Manager DataManager::getManagerByEmail(const QString& email) const {
-    const QList<Manager>& managers = getAllManagers();
-    for (const Manager& m : managers) {
-        if (m.email == email) {
-            return m;
-        }
-    }
-    return Manager();
+    return rowById(store->managers, accountIdByEmail(LoginUser::MANAGER, email));
 }
 
 QString DataManager::generateInvitationCode(int parentId) {
     // Генерируем уникальный 6-символный код
-    QJsonArray codes = loadJson("invitation_code.json");
+    const QList<InvitationCode>& codes = rows(store->invitationCodes);
     QString code;
     bool codeExists = true;
     
@@ -1211,8 +2965,7 @@ QString DataManager::generateInvitationCode(int parentId) {
         
         // Проверяем, существует ли уже такой код
         codeExists = false;
-        for (const QJsonValue& v : codes) {
-            InvitationCode ic = InvitationCode::fromJson(v.toObject());
+        for (const InvitationCode& ic : codes) {
             if (ic.code == code) {
                 codeExists = true;
                 break;
@@ -1230,17 +2983,15 @@ QString DataManager::generateInvitationCode(int parentId) {
     ic.id_invited = -1;
 
     // Сохраняем код
-    codes.append(ic.toJson());
-    saveJson("invitation_code.json", codes);
+    insertRow(store->invitationCodes, ic);
+    commit();
 
     return code;
 }
 
 QList<InvitationCode> DataManager::getInvitationCodes(int parentId) const {
     QList<InvitationCode> result;
-    QJsonArray codes = loadJson("invitation_code.json");
-    for (const QJsonValue& v : codes) {
-        InvitationCode ic = InvitationCode::fromJson(v.toObject());
+    for (const InvitationCode& ic : rows(store->invitationCodes)) {
         if (ic.id_parent == parentId) {
             result.append(ic);
         }
@@ -1249,9 +3000,7 @@ QList<InvitationCode> DataManager::getInvitationCodes(int parentId) const {
 }
 
 InvitationCode DataManager::getInvitationCodeByCode(const QString& code) const {
-    QJsonArray codes = loadJson("invitation_code.json");
-    for (const QJsonValue& v : codes) {
-        InvitationCode ic = InvitationCode::fromJson(v.toObject());
+    for (const InvitationCode& ic : rows(store->invitationCodes)) {
         if (ic.code == code) {
             return ic;
         }
@@ -1260,26 +3009,17 @@ InvitationCode DataManager::getInvitationCodeByCode(const QString& code) const {
 }
 
 void DataManager::useInvitationCode(const QString& code, int invitedUserId) {
-    QJsonArray codes = loadJson("invitation_code.json");
-    for (int i = 0; i < codes.size(); ++i) {
-        InvitationCode ic = InvitationCode::fromJson(codes[i].toObject());
-        if (ic.code == code) {
-            ic.used = true;
-            ic.id_invited = invitedUserId;
-            codes[i] = ic.toJson();
-            break;
-        }
+    InvitationCode ic = getInvitationCodeByCode(code);
+    if (ic.code != code) {
+        return;
     }
-    saveJson("invitation_code.json", codes);
-}
-
-int DataManager::getNextInvitationCodeId() const {
-    QJsonArray codes = loadJson("invitation_code.json");
-    int maxId = 0;
-    for (const QJsonValue& v : codes) {
-        int id = v.toObject()["id"].toInt();
-        if (id > maxId) maxId = id;
+    ic.used = true;
+    ic.id_invited = invitedUserId;
+    if (replaceRow(store->invitationCodes, ic)) {
+        commit();
     }
-    return maxId + 1;
 }
 
+int DataManager::getNextInvitationCodeId() {
+    return reserveIds(store->invitationCodes, 1);
+}
@@ -0,0 +1,191 @@
+#include "dataservice.h"
+#include <QCborMap>
+#include <QCborValue>
+#include <QtEndian>
+#include <QDebug>
+
+// How long a blocking request waits for the server.
+static const int kRequestTimeoutMs = 10000;
+
+namespace DataProtocol {
+
+void appendFrame(QByteArray& out, const QCborArray& message) {
+    const QByteArray payload = QCborValue(message).toCbor();
+    uchar size[4];
+    qToBigEndian<quint32>(quint32(payload.size()), size);
+    out.append(reinterpret_cast<const char*>(size), 4);
+    out.append(payload);
+}
+
+bool takeFrame(QByteArray& buffer, QCborArray& message) {
+    if (buffer.size() < 4) return false;
+    const quint32 size = qFromBigEndian<quint32>(reinterpret_cast<const uchar*>(buffer.constData()));
+    if (quint32(buffer.size() - 4) < size) return false;
+    message = QCborValue::fromCbor(buffer.mid(4, int(size))).toArray();
+    buffer.remove(0, 4 + int(size));
+    return true;
+}
+
+QCborArray encodeRows(const QList<StagedRow>& rows) {
+    QCborArray encoded;
+    for (const StagedRow& row : rows) {
+        QCborArray entry;
+        entry.append(row.table);
+        entry.append(row.op);
+        entry.append(row.id);
+        entry.append(QCborMap::fromJsonObject(row.record));
+        entry.append(QCborMap::fromJsonObject(row.base));
+        encoded.append(entry);
+    }
+    return encoded;
+}
+
+QList<StagedRow> decodeRows(const QCborArray& rows) {
+    QList<StagedRow> decoded;
+    decoded.reserve(int(rows.size()));
+    for (const QCborValue& value : rows) {
+        const QCborArray entry = value.toArray();
+        StagedRow row;
+        row.table = entry.at(0).toString();
+        row.op = entry.at(1).toString();
+        row.id = int(entry.at(2).toInteger(-1));
+        row.record = entry.at(3).toMap().toJsonObject();
+        row.base = entry.at(4).toMap().toJsonObject();
+        decoded.append(row);
+    }
+    return decoded;
+}
+
+}  // namespace DataProtocol
+
+DataServiceClient::DataServiceClient(QObject* parent) : QObject(parent) {
+    connect(&socket, &QLocalSocket::readyRead, this, &DataServiceClient::readMessages);
+    connect(&socket, &QLocalSocket::disconnected, this, &DataServiceClient::dropConnection);
+}
+
+bool DataServiceClient::connectToServer(const QString& name, int timeoutMs) {
+    socket.connectToServer(name);
+    return socket.waitForConnected(timeoutMs);
+}
+
+bool DataServiceClient::isConnected() const {
+    return socket.state() == QLocalSocket::ConnectedState;
+}
+
+int DataServiceClient::send(DataProtocol::Message type, const QCborArray& args) {
+    QCborArray message;
+    message.append(int(type));
+    message.append(++lastRequest);
+    for (const QCborValue& arg : args) {
+        message.append(arg);
+    }
+    QByteArray frame;
+    DataProtocol::appendFrame(frame, message);
+    socket.write(frame);
+    socket.flush();
+    return lastRequest;
+}
+
+bool DataServiceClient::waitForReply(int request, QCborArray& reply) {
+    while (!replies.contains(request)) {
+        if (!isConnected() || !socket.waitForReadyRead(kRequestTimeoutMs)) {
+            qWarning() << "Data service: no answer to request" << request << socket.errorString();
+            return false;
+        }
+        readMessages();
+    }
+    reply = replies.take(request);
+    return true;
+}
+
+bool DataServiceClient::fetchTable(const QString& table, QJsonArray& rows) {
+    if (!isConnected()) return false;
+    QCborArray reply;
+    if (!waitForReply(send(DataProtocol::FetchTable, {table}), reply) || !reply.at(2).toBool()) {
+        return false;
+    }
+    rows = reply.at(3).toArray().toJsonArray();
+    return true;
+}
+
+int DataServiceClient::claimIds(const QString& table, int count) {
+    if (!isConnected()) return -1;
+    QCborArray reply;
+    if (!waitForReply(send(DataProtocol::ClaimIds, {table, count}), reply)) return -1;
+    return int(reply.at(2).toInteger(-1));
+}
+
+void DataServiceClient::write(const QList<StagedRow>& rows, const std::function<void(int)>& done) {
+    if (!isConnected()) {
+        done(JournalWrite::Failed);
+        return;
+    }
+    // Not a braced list: one QCborArray in braces would be copied, not wrapped
+    QCborArray args;
+    args.append(DataProtocol::encodeRows(rows));
+    writes.insert(send(DataProtocol::Write, args), done);
+}
+
+void DataServiceClient::waitForWrites() {
+    while (!writes.isEmpty()) {
+        if (!isConnected() || !socket.waitForReadyRead(kRequestTimeoutMs)) {
+            qWarning() << "Data service: writes not answered" << socket.errorString();
+            socket.abort();
+            dropConnection();
+            return;
+        }
+        readMessages();
+    }
+}
+
+QList<ServiceChange> DataServiceClient::takeChanges() {
+    QList<ServiceChange> taken;
+    taken.swap(changes);
+    return taken;
+}
+
+void DataServiceClient::readMessages() {
+    buffer += socket.readAll();
+    QCborArray message;
+    while (DataProtocol::takeFrame(buffer, message)) {
+        dispatch(message);
+    }
+}
+
+void DataServiceClient::dispatch(const QCborArray& message) {
+    const int type = int(message.at(0).toInteger());
+    const int request = int(message.at(1).toInteger());
+    if (type == DataProtocol::Reply) {
+        auto it = writes.find(request);
+        if (it != writes.end()) {
+            const std::function<void(int)> done = it.value();
+            writes.erase(it);
+            done(int(message.at(2).toInteger(JournalWrite::Failed)));
+        } else {
+            replies.insert(request, message);
+        }
+    } else if (type == DataProtocol::Changed) {
+        ServiceChange change;
+        change.table = message.at(2).toString();
+        change.id = int(message.at(3).toInteger(-1));
+        change.record = message.at(4).toMap().toJsonObject();
+        const bool first = changes.isEmpty();
+        changes.append(change);
+        if (first) emit changesAvailable();
+    } else {
+        qWarning() << "Data service: unexpected message" << type;
+    }
+}
+
+// Writes still waiting for an answer are failed, so that DataManager
+// undoes them; reads of tables already loaded keep working.
+void DataServiceClient::dropConnection() {
+    const QHash<int, std::function<void(int)>> failed = writes;
+    writes.clear();
+    if (!failed.isEmpty()) {
+        qWarning() << "Data service: connection lost with" << failed.size() << "writes unanswered";
+    }
+    for (const auto& done : failed) {
+        done(JournalWrite::Failed);
+    }
+}
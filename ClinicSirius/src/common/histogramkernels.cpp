@@ -0,0 +1,224 @@
+#include "histogramkernels.h"
+#include <cstddef>
+#include <cstring>
+#include <vector>
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__) && !defined(CLINIC_NO_SIMD)
+#define HISTOGRAM_X86_SIMD 1
+#include <immintrin.h>
+#endif
+
+// The SIMD histogram computes bucket indices in 32-bit lanes, so the
+// covered span must stay below 2^31 (about 4000 years of minutes).
+static const qint64 kMaxSimdSpan = qint64(1) << 31;
+
+enum class KernelPath { Scalar, Sse42, Avx2 };
+
+static KernelPath detectPath() {
+#ifdef HISTOGRAM_X86_SIMD
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) return KernelPath::Avx2;
+    if (__builtin_cpu_supports("sse4.2")) return KernelPath::Sse42;
+#endif
+    return KernelPath::Scalar;
+}
+
+static KernelPath &selectedPath() {
+    static KernelPath path = detectPath();
+    return path;
+}
+
+static KernelPath kernelPath() {
+    return selectedPath();
+}
+
+// Scalar reference implementations; also used for the tails of SIMD loops.
+static qint64 countInRangeScalar(const qint64 *v, qint64 n, qint64 from, qint64 to) {
+    qint64 count = 0;
+    for (qint64 i = 0; i < n; ++i) {
+        count += (v[i] >= from && v[i] < to) ? 1 : 0;
+    }
+    return count;
+}
+
+static void histogramScalar(const qint64 *v, qint64 n, qint64 origin, qint64 width, qint32 *counts, int buckets) {
+    const qint64 span = width * buckets;
+    for (qint64 i = 0; i < n; ++i) {
+        qint64 off = v[i] - origin;
+        if (off >= 0 && off < span) {
+            counts[off / width] += 1;
+        }
+    }
+}
+
+#ifdef HISTOGRAM_X86_SIMD
+__attribute__((target("sse4.2")))
+static qint64 countInRangeSse42(const qint64 *v, qint64 n, qint64 from, qint64 to) {
+    const __m128i vFrom = _mm_set1_epi64x(from);
+    const __m128i vTo = _mm_set1_epi64x(to);
+    __m128i acc = _mm_setzero_si128();
+    qint64 i = 0;
+    for (; i + 2 <= n; i += 2) {
+        __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i *>(v + i));
+        // x >= from && x < to; matching lanes are -1, so subtracting counts them
+        __m128i in = _mm_andnot_si128(_mm_cmpgt_epi64(vFrom, x), _mm_cmpgt_epi64(vTo, x));
+        acc = _mm_sub_epi64(acc, in);
+    }
+    alignas(16) qint64 lanes[2];
+    _mm_store_si128(reinterpret_cast<__m128i *>(lanes), acc);
+    return lanes[0] + lanes[1] + countInRangeScalar(v + i, n - i, from, to);
+}
+
+__attribute__((target("avx2")))
+static qint64 countInRangeAvx2(const qint64 *v, qint64 n, qint64 from, qint64 to) {
+    const __m256i vFrom = _mm256_set1_epi64x(from);
+    const __m256i vTo = _mm256_set1_epi64x(to);
+    __m256i acc = _mm256_setzero_si256();
+    qint64 i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(v + i));
+        __m256i in = _mm256_andnot_si256(_mm256_cmpgt_epi64(vFrom, x), _mm256_cmpgt_epi64(vTo, x));
+        acc = _mm256_sub_epi64(acc, in);
+    }
+    alignas(32) qint64 lanes[4];
+    _mm256_store_si256(reinterpret_cast<__m256i *>(lanes), acc);
+    return lanes[0] + lanes[1] + lanes[2] + lanes[3] + countInRangeScalar(v + i, n - i, from, to);
+}
+
+// Range test for two lanes at a time; the division only runs for hits.
+__attribute__((target("sse4.2")))
+static void histogramSse42(const qint64 *v, qint64 n, qint64 origin, qint64 width, qint32 *counts, int buckets) {
+    const __m128i vOrigin = _mm_set1_epi64x(origin);
+    const __m128i vSpan = _mm_set1_epi64x(width * buckets);
+    const __m128i zero = _mm_setzero_si128();
+    qint64 i = 0;
+    for (; i + 2 <= n; i += 2) {
+        __m128i off = _mm_sub_epi64(_mm_loadu_si128(reinterpret_cast<const __m128i *>(v + i)), vOrigin);
+        __m128i in = _mm_andnot_si128(_mm_cmpgt_epi64(zero, off), _mm_cmpgt_epi64(vSpan, off));
+        int mask = _mm_movemask_pd(_mm_castsi128_pd(in));
+        if (mask & 1) counts[(v[i] - origin) / width] += 1;
+        if (mask & 2) counts[(v[i + 1] - origin) / width] += 1;
+    }
+    histogramScalar(v + i, n - i, origin, width, counts, buckets);
+}
+
+// Four lanes at a time: range test in 64 bits, then the bucket index in
+// 32 bits as trunc(offset * (1 / width)) with one correction step for the
+// rounding of the reciprocal. Only the increments are scalar.
+__attribute__((target("avx2")))
+static void histogramAvx2(const qint64 *v, qint64 n, qint64 origin, qint64 width, qint32 *counts, int buckets) {
+    const __m256i vOrigin = _mm256_set1_epi64x(origin);
+    const __m256i vSpan = _mm256_set1_epi64x(width * buckets);
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i lowHalves = _mm256_setr_epi32(0, 2, 4, 6, 0, 2, 4, 6);
+    const __m256d vInverse = _mm256_set1_pd(1.0 / double(width));
+    const __m128i vWidth = _mm_set1_epi32(qint32(width));
+    const __m128i vWidthMinus1 = _mm_set1_epi32(qint32(width - 1));
+    alignas(16) qint32 index[4];
+    qint64 i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256i off = _mm256_sub_epi64(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(v + i)), vOrigin);
+        __m256i in = _mm256_andnot_si256(_mm256_cmpgt_epi64(zero, off), _mm256_cmpgt_epi64(vSpan, off));
+        int mask = _mm256_movemask_pd(_mm256_castsi256_pd(in));
+        if (!mask) continue;
+
+        // In-range offsets are below 2^31, so their low halves are exact
+        __m128i off32 = _mm256_castsi256_si128(_mm256_permutevar8x32_epi32(off, lowHalves));
+        __m128i q = _mm256_cvttpd_epi32(_mm256_mul_pd(_mm256_cvtepi32_pd(off32), vInverse));
+        __m128i r = _mm_sub_epi32(off32, _mm_mullo_epi32(q, vWidth));
+        __m128i under = _mm_cmpgt_epi32(_mm_setzero_si128(), r);  // q one too high
+        q = _mm_add_epi32(q, under);
+        r = _mm_add_epi32(r, _mm_and_si128(under, vWidth));
+        __m128i over = _mm_cmpgt_epi32(r, vWidthMinus1);           // q one too low
+        q = _mm_sub_epi32(q, over);
+        _mm_store_si128(reinterpret_cast<__m128i *>(index), q);
+
+        if (mask & 1) counts[index[0]] += 1;
+        if (mask & 2) counts[index[1]] += 1;
+        if (mask & 4) counts[index[2]] += 1;
+        if (mask & 8) counts[index[3]] += 1;
+    }
+    histogramScalar(v + i, n - i, origin, width, counts, buckets);
+}
+#endif
+
+qint64 HistogramKernels::countInRange(const qint64 *values, qint64 n, qint64 from, qint64 to) {
+    if (n <= 0 || from >= to) return 0;
+#ifdef HISTOGRAM_X86_SIMD
+    switch (kernelPath()) {
+    case KernelPath::Avx2: return countInRangeAvx2(values, n, from, to);
+    case KernelPath::Sse42: return countInRangeSse42(values, n, from, to);
+    case KernelPath::Scalar: break;
+    }
+#endif
+    return countInRangeScalar(values, n, from, to);
+}
+
+void HistogramKernels::fixedWidthHistogram(const qint64 *values, qint64 n, qint64 origin, qint64 width,
+                                           qint32 *counts, int buckets) {
+    if (n <= 0 || width <= 0 || buckets <= 0) return;
+#ifdef HISTOGRAM_X86_SIMD
+    switch (kernelPath()) {
+    case KernelPath::Avx2:
+        if (width * buckets < kMaxSimdSpan) {
+            histogramAvx2(values, n, origin, width, counts, buckets);
+            return;
+        }
+        break;
+    case KernelPath::Sse42:
+        histogramSse42(values, n, origin, width, counts, buckets);
+        return;
+    case KernelPath::Scalar:
+        break;
+    }
+#endif
+    histogramScalar(values, n, origin, width, counts, buckets);
+}
+
+void HistogramKernels::dayHistogram(const qint64 *minutes, qint64 n, qint64 firstDay, int days, qint32 *counts) {
+    fixedWidthHistogram(minutes, n, firstDay * MinutesPerDay, MinutesPerDay, counts, days);
+}
+
+void HistogramKernels::weekHistogram(const qint64 *minutes, qint64 n, qint64 firstMonday, int weeks, qint32 *counts) {
+    fixedWidthHistogram(minutes, n, firstMonday * MinutesPerDay, 7 * MinutesPerDay, counts, weeks);
+}
+
+void HistogramKernels::monthHistogram(const qint64 *minutes, qint64 n, const qint64 *monthStarts, int months,
+                                      qint32 *counts) {
+    if (months <= 0) return;
+    // Months differ in length: count per day, then fold the days into months
+    const qint64 firstDay = monthStarts[0];
+    std::vector<qint32> perDay(std::size_t(monthStarts[months] - firstDay), 0);
+    dayHistogram(minutes, n, firstDay, int(perDay.size()), perDay.data());
+    for (int m = 0; m < months; ++m) {
+        for (qint64 d = monthStarts[m]; d < monthStarts[m + 1]; ++d) {
+            counts[m] += perDay[std::size_t(d - firstDay)];
+        }
+    }
+}
+
+const char *HistogramKernels::activePath() {
+    switch (kernelPath()) {
+    case KernelPath::Avx2: return "avx2";
+    case KernelPath::Sse42: return "sse4.2";
+    case KernelPath::Scalar: break;
+    }
+    return "scalar";
+}
+
+bool HistogramKernels::usePath(const char *name) {
+    KernelPath wanted;
+    if (std::strcmp(name, "avx2") == 0) {
+        wanted = KernelPath::Avx2;
+    } else if (std::strcmp(name, "sse4.2") == 0) {
+        wanted = KernelPath::Sse42;
+    } else if (std::strcmp(name, "scalar") == 0) {
+        wanted = KernelPath::Scalar;
+    } else {
+        return false;
+    }
+    // Every CPU with AVX2 has SSE4.2 as well
+    if (int(wanted) > int(detectPath())) return false;
+    selectedPath() = wanted;
+    return true;
+}
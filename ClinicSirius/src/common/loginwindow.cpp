@@ -213,66 +213,14 @@ void LoginWindow::onLoginClicked() {
 
     qDebug() << "Login attempt for email:" << email;
     
-    QString dataPath = QCoreApplication::applicationDirPath() + "/../data";
-    DataManager dm(dataPath);
-    qDebug() << "Using data path:" << dataPath;
-    int userId = -1;
-    int userType = -1;
-    bool authenticated = false;
-
-    qDebug() << "Checking patient...";
-    if (dm.patientLoginByEmail(email, password)) {
-        Patient patient = dm.getPatientByEmail(email);
-        qDebug() << "Patient found:" << patient.id_patient << patient.email;
-        if (patient.id_patient > 0) {
-            userId = patient.id_patient;
-            userType = 0;
-            authenticated = true;
-        }
-    }
-    
-    if (!authenticated) {
-        qDebug() << "Checking doctor...";
-        if (dm.doctorLoginByEmail(email, password)) {
-            Doctor doctor = dm.getDoctorByEmail(email);
-            qDebug() << "Doctor found:" << doctor.id_doctor << doctor.email;
-            if (doctor.id_doctor > 0) {
-                userId = doctor.id_doctor;
-                userType = 1;
-                authenticated = true;
-            }
-        }
-    }
-    
-    if (!authenticated) {
-        qDebug() << "Checking manager...";
-        if (dm.managerLoginByEmail(email, password)) {
-            Manager manager = dm.getManagerByEmail(email);
-            qDebug() << "Manager found:" << manager.id << manager.email;
-            if (manager.id > 0) {
-                userId = manager.id;
-                userType = 2;
-                authenticated = true;
-            }
-        }
-    }
-
-    if (!authenticated) {
-        qDebug() << "Checking admin...";
-        if (dm.adminLoginByEmail(email, password)) {
-            Admin admin = dm.getAdminByEmail(email);
-            qDebug() << "Admin found:" << admin.id << admin.email;
-            if (admin.id > 0) {
-                userId = admin.id;
-                userType = 3;
-                authenticated = true;
-            }
-        }
-    }
+    DataManager& dm = DataManager::shared();
+    // One lookup in the cross-role credential index
+    Credential account = dm.authenticate(email, password);
 
-    if (authenticated && userId > 0 && userType >= 0) {
+    if (account.id > 0) {
+        qDebug() << "Authenticated as role" << account.role << "id" << account.id;
         showSuccess("Успешный вход!");
-        emit loginSuccess(userId, userType);
+        emit loginSuccess(account.id, account.role);
     } else {
         showError("Неверные учетные данные");
         qDebug() << "Authentication failed";
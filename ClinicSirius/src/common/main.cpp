@@ -1,7 +1,11 @@
 #include <QApplication>
 #include <QFile>
 #include <QStyleFactory>
+#include <QMessageBox>
+#include <QTimer>
 #include "authwindow.h"
+#include "datamanager.h"
+#include "dataservice.h"
 
 int main(int argc, char *argv[])
 {
@@ -38,6 +42,52 @@ int main(int argc, char *argv[])
         styleFile.close();
     }
     
+    // Client mode: share the tables of a running clinicsiriusd
+    // (--service [name], or CLINICSIRIUS_SERVICE=name) instead of reading
+    // the data directory; without it the directory is used as before
+    QString serviceName = qEnvironmentVariable("CLINICSIRIUS_SERVICE");
+    const QStringList args = app.arguments();
+    const int serviceArg = args.indexOf("--service");
+    if (serviceArg >= 0) {
+        const QString next = args.value(serviceArg + 1);
+        serviceName = next.isEmpty() || next.startsWith('-') ? QString(DataProtocol::kDefaultServerName) : next;
+    }
+    if (!serviceName.isEmpty()) {
+        DataManager::shared().connectToService(serviceName);
+    }
+
+    // Writes go to disk on the storage thread: show a busy cursor while
+    // they drain, and tell the user if one did not make it
+    DataEvents *events = DataManager::shared().events();
+    QObject::connect(events, &DataEvents::writesPendingChanged, [](bool pending) {
+        if (pending) {
+            QApplication::setOverrideCursor(Qt::BusyCursor);
+        } else {
+            QApplication::restoreOverrideCursor();
+        }
+    });
+    QObject::connect(events, &DataEvents::writeFailed, []() {
+        QMessageBox::warning(QApplication::activeWindow(), "Ошибка",
+                             "Не удалось записать изменения на диск.");
+    });
+    QObject::connect(events, &DataEvents::writeConflict, []() {
+        QMessageBox::warning(QApplication::activeWindow(), "Изменения не сохранены",
+                             "Эти данные уже изменены на другом рабочем месте. "
+                             "Ваши изменения не сохранены, показаны актуальные данные.");
+    });
+
+    // Pick up what other processes sharing the data directory have written
+    QTimer *refreshTimer = new QTimer(&app);
+    QObject::connect(refreshTimer, &QTimer::timeout, []() {
+        DataManager::shared().refresh();
+    });
+    refreshTimer->start(2000);
+
+    // Fold the mutation journal back into the JSON snapshots on exit
+    QObject::connect(&app, &QCoreApplication::aboutToQuit, []() {
+        DataManager::compactAll();
+    });
+
     AuthWindow window;
     window.showMaximized();
     
@@ -689,7 +689,7 @@ void MainPage::showUpcomingAppointments() {
         return;
     }
 
-    DataManager dataManager;
+    DataManager& dataManager = DataManager::shared();
     QList<Appointment> appointments = dataManager.getPatientAppointments(currentUser.id);
     QList<Appointment> upcoming;
     QDateTime now = QDateTime::currentDateTime();
@@ -779,7 +779,7 @@ void MainPage::showUpcomingAppointments() {
         int apId = item->data(Qt::UserRole).toInt();
         if (apId <= 0) return;
 
-        DataManager dm;
+        DataManager& dm = DataManager::shared();
         Appointment ap = dm.getAppointmentById(apId);
         if (ap.id_ap <= 0) {
             QMessageBox::warning(this, "Отмена приёма", "Приём не найден.");
@@ -201,8 +201,8 @@ void RegistrationWindow::onRegisterClicked() {
     QString username = usernameInput->text().trimmed();
     QString password = passwordInput->text();
 
-    // Регистрация пациента через DataManager (путь определяется автоматически)
-    DataManager dm;
+    // Регистрация пациента через общий DataManager
+    DataManager& dm = DataManager::shared();
     
     // Проверка, не существует ли уже пользователь с таким email
     if (dm.emailExists(email)) {
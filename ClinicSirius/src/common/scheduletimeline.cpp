@@ -0,0 +1,427 @@
+#include "scheduletimeline.h"
+#include <QPainter>
+#include <QScrollBar>
+#include <QMouseEvent>
+#include <QWheelEvent>
+#include <QContextMenuEvent>
+#include <QHelpEvent>
+#include <QToolTip>
+#include <QtMath>
+#include <algorithm>
+#include <climits>
+
+static const int kGutterWidth = 52;
+static const int kHeaderHeight = 40;
+static const int kLaneHeaderHeight = 18;
+static const int kMinDayWidth = 16;
+static const int kMinRowHeight = 12;
+static const int kMaxRowHeight = 160;
+static const int kMaxVisibleDays = 31;
+
+static QDate mondayOf(const QDate &date) {
+    return date.addDays(1 - date.dayOfWeek());
+}
+
+static QString dayName(const QDate &date) {
+    static const char *names[] = {"Пн", "Вт", "Ср", "Чт", "Пт", "Сб", "Вс"};
+    return QString::fromUtf8(names[date.dayOfWeek() - 1]);
+}
+
+ScheduleTimeline::ScheduleTimeline(QWidget *parent)
+    : QAbstractScrollArea(parent) {
+    rangeStart = mondayOf(QDate::currentDate()).addDays(-28);
+    rangeDays = 12 * 7;
+    viewport()->setMouseTracking(true);
+    setHorizontalScrollBarPolicy(Qt::ScrollBarAlwaysOn);
+    updateScrollBars();
+    scrollToDate(mondayOf(QDate::currentDate()));
+}
+
+ScheduleBlock ScheduleTimeline::blockFor(const AppointmentSchedule &schedule, int lane) {
+    ScheduleBlock block;
+    block.scheduleId = schedule.id_ap_sch;
+    block.lane = lane;
+    block.from = schedule.time_from;
+    block.to = schedule.time_to;
+    QString st = schedule.status.trimmed().toLower();
+    if (st == "booked" || st == "busy") {
+        block.text = "Занято";
+        block.color = QColor(255, 165, 0);
+    } else if (st == "done") {
+        block.text = "Завершено";
+        block.color = QColor(96, 165, 250);
+    } else {
+        block.text = "Свободен";
+        block.color = QColor(144, 190, 109);
+    }
+    return block;
+}
+
+void ScheduleTimeline::setBlocks(QVector<ScheduleBlock> newBlocks) {
+    blocks = std::move(newBlocks);
+
+    QDate first = QDate::currentDate().addDays(-28);
+    QDate last = QDate::currentDate().addDays(8 * 7);
+    for (const ScheduleBlock &b : blocks) {
+        if (!b.from.isValid()) continue;
+        first = qMin(first, b.from.date());
+        last = qMax(last, b.from.date());
+    }
+    extendRange(first, last.addDays(7));
+
+    cells.clear();
+    cells.reserve(blocks.size());
+    longestBlockMinutes = 0;
+    bool selectionKept = false;
+    for (int i = 0; i < blocks.size(); ++i) {
+        const ScheduleBlock &b = blocks[i];
+        if (!b.from.isValid() || !b.to.isValid()) continue;
+        Cell c;
+        c.day = int(rangeStart.daysTo(b.from.date()));
+        c.lane = qBound(0, b.lane, laneCount() - 1);
+        c.start = b.from.time().hour() * 60 + b.from.time().minute();
+        // A block running past midnight is cut at the end of its first day
+        c.end = b.to.date() > b.from.date() ? 24 * 60 : b.to.time().hour() * 60 + b.to.time().minute();
+        c.end = qMax(c.end, c.start + 1);
+        c.index = i;
+        cells.append(c);
+        longestBlockMinutes = qMax(longestBlockMinutes, c.end - c.start);
+        selectionKept = selectionKept || b.scheduleId == selectedId;
+    }
+    std::sort(cells.begin(), cells.end(), [](const Cell &a, const Cell &b) {
+        if (a.day != b.day) return a.day < b.day;
+        if (a.lane != b.lane) return a.lane < b.lane;
+        return a.start < b.start;
+    });
+    if (!selectionKept) selectedId = -1;
+    viewport()->update();
+}
+
+void ScheduleTimeline::setLanes(const QStringList &names) {
+    laneNames = names;
+    // Lanes are clamped when the blocks are placed
+    setBlocks(blocks);
+    viewport()->update();
+}
+
+void ScheduleTimeline::setPlaceholderText(const QString &text) {
+    placeholder = text;
+    viewport()->update();
+}
+
+void ScheduleTimeline::setToolTipProvider(const std::function<QString(int)> &provider) {
+    toolTipProvider = provider;
+}
+
+void ScheduleTimeline::setMinutesPerRow(int minutes) {
+    minutesPerRow = qBound(5, minutes, 120);
+    updateScrollBars();
+    viewport()->update();
+}
+
+void ScheduleTimeline::setVisibleDays(int days) {
+    const QDate first = firstVisibleDate();
+    daysVisible = qBound(1, days, kMaxVisibleDays);
+    updateScrollBars();
+    scrollToDate(first);
+    viewport()->update();
+}
+
+void ScheduleTimeline::scrollToDate(const QDate &date) {
+    if (!date.isValid()) return;
+    extendRange(date, date.addDays(daysVisible));
+    horizontalScrollBar()->setValue(int(rangeStart.daysTo(date)) * dayWidth());
+    notifyFirstVisibleDate();
+}
+
+QDate ScheduleTimeline::firstVisibleDate() const {
+    return rangeStart.addDays(horizontalScrollBar()->value() / dayWidth());
+}
+
+QRect ScheduleTimeline::gridRect() const {
+    const int header = kHeaderHeight + (laneNames.size() > 1 ? kLaneHeaderHeight : 0);
+    return viewport()->rect().adjusted(kGutterWidth, header, 0, 0);
+}
+
+int ScheduleTimeline::dayWidth() const {
+    return qMax(kMinDayWidth, gridRect().width() / daysVisible);
+}
+
+int ScheduleTimeline::yForMinute(int minute) const {
+    return gridRect().top() + qRound((minute - dayStartMinute) * minuteHeight()) - verticalScrollBar()->value();
+}
+
+void ScheduleTimeline::extendRange(const QDate &first, const QDate &last) {
+    const QDate oldStart = rangeStart;
+    const QDate oldEnd = rangeStart.addDays(rangeDays);
+    const QDate newStart = qMin(oldStart, mondayOf(first));
+    const QDate newEnd = qMax(oldEnd, last.addDays(1));
+    if (newStart == oldStart && newEnd == oldEnd) return;
+
+    const int shift = int(newStart.daysTo(oldStart));
+    const int value = horizontalScrollBar()->value();
+    rangeStart = newStart;
+    rangeDays = int(newStart.daysTo(newEnd));
+    for (Cell &c : cells) c.day += shift;
+    updateScrollBars();
+    // Keep the same dates on screen
+    horizontalScrollBar()->setValue(value + shift * dayWidth());
+}
+
+void ScheduleTimeline::updateScrollBars() {
+    const QRect grid = gridRect();
+    const int dw = dayWidth();
+    QScrollBar *h = horizontalScrollBar();
+    h->setRange(0, qMax(0, rangeDays * dw - grid.width()));
+    h->setPageStep(qMax(1, grid.width()));
+    h->setSingleStep(dw);
+
+    const int contentHeight = qCeil((dayEndMinute - dayStartMinute) * minuteHeight());
+    QScrollBar *v = verticalScrollBar();
+    v->setRange(0, qMax(0, contentHeight - grid.height()));
+    v->setPageStep(qMax(1, grid.height()));
+    v->setSingleStep(rowHeight);
+}
+
+void ScheduleTimeline::notifyFirstVisibleDate() {
+    const QDate first = firstVisibleDate();
+    if (first == lastNotifiedDate) return;
+    lastNotifiedDate = first;
+    emit firstVisibleDateChanged(first);
+}
+
+void ScheduleTimeline::cellRange(int day, int lane, const Cell *&first, const Cell *&last) const {
+    auto before = [](const Cell &c, const QPair<int, int> &key) {
+        return c.day < key.first || (c.day == key.first && c.lane < key.second);
+    };
+    auto after = [](const QPair<int, int> &key, const Cell &c) {
+        return key.first < c.day || (key.first == c.day && key.second < c.lane);
+    };
+    const QPair<int, int> key(day, lane);
+    const Cell *end = cells.constData() + cells.size();
+    first = std::lower_bound(cells.constData(), end, key, before);
+    last = std::upper_bound(first, end, key, after);
+}
+
+int ScheduleTimeline::blockAt(const QPoint &pos) const {
+    const QRect grid = gridRect();
+    if (!placeholder.isEmpty() || !grid.contains(pos)) return -1;
+    const int dw = dayWidth();
+    const int x = pos.x() - grid.left() + horizontalScrollBar()->value();
+    const int day = x / dw;
+    const int lane = qMin(laneCount() - 1, (x % dw) * laneCount() / dw);
+    const double minute = dayStartMinute + (pos.y() - grid.top() + verticalScrollBar()->value()) / minuteHeight();
+
+    const Cell *first = nullptr;
+    const Cell *last = nullptr;
+    cellRange(day, lane, first, last);
+    // Last block starting at or before the minute, then back over any
+    // earlier blocks long enough to still cover it
+    const Cell *it = std::upper_bound(first, last, minute,
+                                      [](double m, const Cell &c) { return m < c.start; });
+    while (it != first) {
+        --it;
+        if (minute < it->end) return it->index;
+        if (it->start < minute - longestBlockMinutes) break;
+    }
+    return -1;
+}
+
+void ScheduleTimeline::paintEvent(QPaintEvent *) {
+    QPainter p(viewport());
+    const QRect all = viewport()->rect();
+    p.fillRect(all, palette().base());
+    if (!placeholder.isEmpty()) {
+        p.setPen(palette().color(QPalette::PlaceholderText));
+        p.drawText(all, Qt::AlignCenter | Qt::TextWordWrap, placeholder);
+        return;
+    }
+
+    const QRect grid = gridRect();
+    const int dw = dayWidth();
+    const int lanes = laneCount();
+    const int hv = horizontalScrollBar()->value();
+    const int firstDay = hv / dw;
+    const int lastDay = qMin(rangeDays - 1, (hv + grid.width()) / dw);
+    const int todayIndex = int(rangeStart.daysTo(QDate::currentDate()));
+    const int firstMinute = dayStartMinute + int(verticalScrollBar()->value() / minuteHeight());
+    const int lastMinute = qMin(dayEndMinute, firstMinute + int(grid.height() / minuteHeight()) + 1);
+    const QFontMetrics fm(font());
+    auto dayX = [&](int day) { return grid.left() + day * dw - hv; };
+    auto laneX = [&](int day, int lane) { return dayX(day) + lane * dw / lanes; };
+
+    // Grid: today's column, row lines, day and lane separators
+    p.save();
+    p.setClipRect(grid);
+    if (todayIndex >= firstDay && todayIndex <= lastDay) {
+        p.fillRect(QRect(dayX(todayIndex), grid.top(), dw, grid.height()), QColor(230, 240, 255));
+    }
+    p.setPen(QColor(225, 225, 225));
+    for (int m = dayStartMinute + (firstMinute - dayStartMinute) / minutesPerRow * minutesPerRow;
+         m <= lastMinute; m += minutesPerRow) {
+        const int y = yForMinute(m);
+        p.drawLine(grid.left(), y, grid.right(), y);
+    }
+    for (int day = firstDay; day <= lastDay + 1; ++day) {
+        p.setPen(QColor(200, 200, 200));
+        p.drawLine(dayX(day), grid.top(), dayX(day), grid.bottom());
+        p.setPen(QColor(235, 235, 235));
+        for (int lane = 1; lane < lanes && day <= lastDay; ++lane) {
+            p.drawLine(laneX(day, lane), grid.top(), laneX(day, lane), grid.bottom());
+        }
+    }
+
+    // Blocks of the visible days, starting from the first one that can
+    // still reach the top of the view
+    for (int day = firstDay; day <= lastDay; ++day) {
+        for (int lane = 0; lane < lanes; ++lane) {
+            const Cell *first = nullptr;
+            const Cell *last = nullptr;
+            cellRange(day, lane, first, last);
+            const int fromStart = firstMinute - longestBlockMinutes;
+            const Cell *it = std::lower_bound(first, last, fromStart,
+                                              [](const Cell &c, int m) { return c.start < m; });
+            const int left = laneX(day, lane);
+            const int width = laneX(day, lane + 1) - left;
+            for (; it != last && it->start <= lastMinute; ++it) {
+                if (it->end <= firstMinute) continue;
+                const ScheduleBlock &b = blocks[it->index];
+                const QRect r(left + 1, yForMinute(it->start) + 1, width - 2,
+                              qMax(2, yForMinute(it->end) - yForMinute(it->start) - 2));
+                p.fillRect(r, day == todayIndex ? b.color.darker(110) : b.color);
+                if (b.scheduleId == selectedId) {
+                    p.setPen(QPen(palette().color(QPalette::Highlight), 2));
+                    p.drawRect(r.adjusted(1, 1, -1, -1));
+                }
+                if (r.height() >= fm.height() && r.width() > 24) {
+                    p.setPen(Qt::white);
+                    p.drawText(r, Qt::AlignCenter, fm.elidedText(b.text, Qt::ElideRight, r.width() - 4));
+                }
+            }
+        }
+    }
+    p.restore();
+
+    // Day header, with lane names when there are several
+    const QRect header(grid.left(), 0, grid.width(), grid.top());
+    p.save();
+    p.setClipRect(header);
+    p.fillRect(header, palette().button());
+    QFont bold = font();
+    bold.setBold(true);
+    for (int day = firstDay; day <= lastDay; ++day) {
+        const QDate date = rangeStart.addDays(day);
+        const QRect cell(dayX(day), 0, dw, kHeaderHeight);
+        if (day == todayIndex) p.fillRect(cell, QColor(200, 220, 255));
+        p.setFont(day == todayIndex ? bold : font());
+        p.setPen(palette().color(QPalette::ButtonText));
+        const QString label = dw >= 40 ? QString("%1\n%2").arg(date.toString("dd.MM"), dayName(date))
+                                       : date.toString("dd");
+        p.drawText(cell, Qt::AlignCenter, label);
+        p.setFont(font());
+        if (lanes > 1 && dw / lanes >= 30) {
+            for (int lane = 0; lane < lanes; ++lane) {
+                const QRect laneCell(laneX(day, lane), kHeaderHeight, laneX(day, lane + 1) - laneX(day, lane),
+                                     kLaneHeaderHeight);
+                p.drawText(laneCell, Qt::AlignCenter,
+                           fm.elidedText(laneNames.value(lane), Qt::ElideRight, laneCell.width() - 4));
+            }
+        }
+        p.setPen(QColor(200, 200, 200));
+        p.drawLine(dayX(day), 0, dayX(day), header.bottom());
+    }
+    p.restore();
+
+    // Time labels; every row while they fit, otherwise every few rows
+    const QRect gutter(0, grid.top(), grid.left(), grid.height());
+    p.save();
+    p.setClipRect(gutter);
+    p.fillRect(gutter, palette().button());
+    p.setPen(palette().color(QPalette::ButtonText));
+    const int rowsPerLabel = qMax(1, (fm.height() + rowHeight - 1) / rowHeight);
+    const int labelStep = minutesPerRow * rowsPerLabel;
+    for (int m = dayStartMinute + (firstMinute - dayStartMinute) / labelStep * labelStep;
+         m <= lastMinute; m += labelStep) {
+        const QRect label(0, yForMinute(m), grid.left() - 6, fm.height());
+        p.drawText(label, Qt::AlignRight | Qt::AlignTop,
+                   QString("%1:%2").arg(m / 60, 2, 10, QChar('0')).arg(m % 60, 2, 10, QChar('0')));
+    }
+    p.restore();
+    p.fillRect(QRect(0, 0, grid.left(), grid.top()), palette().button());
+}
+
+void ScheduleTimeline::resizeEvent(QResizeEvent *event) {
+    // The day width follows the viewport width, and the viewport is already
+    // resized here: stay on the dates last reported
+    const QDate first = lastNotifiedDate.isValid() ? lastNotifiedDate : firstVisibleDate();
+    QAbstractScrollArea::resizeEvent(event);
+    updateScrollBars();
+    scrollToDate(first);
+}
+
+void ScheduleTimeline::scrollContentsBy(int, int) {
+    notifyFirstVisibleDate();
+    viewport()->update();
+}
+
+void ScheduleTimeline::mousePressEvent(QMouseEvent *event) {
+    const int index = blockAt(event->position().toPoint());
+    selectedId = index >= 0 ? blocks[index].scheduleId : -1;
+    viewport()->update();
+    if (index >= 0 && event->button() == Qt::LeftButton) emit blockClicked(selectedId);
+}
+
+void ScheduleTimeline::mouseDoubleClickEvent(QMouseEvent *event) {
+    const int index = blockAt(event->position().toPoint());
+    if (index >= 0 && event->button() == Qt::LeftButton) emit blockDoubleClicked(blocks[index].scheduleId);
+}
+
+void ScheduleTimeline::contextMenuEvent(QContextMenuEvent *event) {
+    const int index = blockAt(event->pos());
+    if (index < 0) return;
+    selectedId = blocks[index].scheduleId;
+    viewport()->update();
+    emit blockContextMenuRequested(selectedId, event->globalPos());
+}
+
+void ScheduleTimeline::wheelEvent(QWheelEvent *event) {
+    if (!(event->modifiers() & Qt::ControlModifier)) {
+        QAbstractScrollArea::wheelEvent(event);
+        return;
+    }
+    const int steps = event->angleDelta().y() > 0 ? 1 : (event->angleDelta().y() < 0 ? -1 : 0);
+    if (steps == 0) return;
+    if (event->modifiers() & Qt::ShiftModifier) {
+        // Fewer days when zooming in, up to a month when zooming out
+        setVisibleDays(daysVisible + (steps > 0 ? -1 : 1) * qMax(1, daysVisible / 4));
+    } else {
+        // Keep the minute under the cursor in place
+        const QRect grid = gridRect();
+        const int cursorY = qBound(0, int(event->position().y()) - grid.top(), grid.height());
+        const double minute = (verticalScrollBar()->value() + cursorY) / minuteHeight();
+        rowHeight = qBound(kMinRowHeight, steps > 0 ? rowHeight * 5 / 4 : rowHeight * 4 / 5, kMaxRowHeight);
+        updateScrollBars();
+        verticalScrollBar()->setValue(qRound(minute * minuteHeight()) - cursorY);
+        viewport()->update();
+    }
+    event->accept();
+}
+
+bool ScheduleTimeline::viewportEvent(QEvent *event) {
+    if (event->type() == QEvent::ToolTip) {
+        QHelpEvent *help = static_cast<QHelpEvent *>(event);
+        const int index = blockAt(help->pos());
+        if (index < 0) {
+            QToolTip::hideText();
+            return true;
+        }
+        const ScheduleBlock &b = blocks[index];
+        QString text = toolTipProvider ? toolTipProvider(b.scheduleId) : QString();
+        if (text.isEmpty()) {
+            text = QString("%1 - %2\n%3").arg(b.from.toString("HH:mm"), b.to.toString("HH:mm"), b.text);
+        }
+        QToolTip::showText(help->globalPos(), text, viewport());
+        return true;
+    }
+    return QAbstractScrollArea::viewportEvent(event);
+}
@@ -0,0 +1,229 @@
+#include "textsearchindex.h"
+#include <algorithm>
+#include <string_view>
+
+static const QChar kFieldSeparator = QLatin1Char('\n');
+
+static quint64 gramKey(QChar a, QChar b, QChar c) {
+    return (quint64(a.unicode()) << 32) | (quint64(b.unicode()) << 16) | c.unicode();
+}
+
+// Grams are hashed rather than stored: two grams sharing a bucket only make
+// the candidate list longer, candidates are checked on the text.
+static int keyBucket(quint64 key, int bits) {
+    return int((key * 0x9E3779B97F4A7C15ull) >> (64 - bits));
+}
+
+// Gram keys use 48 bits, so these never collide with one
+static const quint64 kNoGram = ~quint64(0);
+static const quint64 kSharedBucket = ~quint64(0) - 1;
+
+// Calls visit(key) for every one-, two- and three-character gram of the text
+// that does not cross a field boundary. Shorter grams are padded with U+FFFF,
+// a noncharacter that never occurs in the text.
+template <typename Visit>
+static void forEachGram(const QString &text, Visit visit) {
+    const QChar pad(0xFFFF);
+    for (int i = 0; i < text.size(); ++i) {
+        const QChar a = text.at(i);
+        if (a == kFieldSeparator) continue;
+        visit(gramKey(a, pad, pad));
+        if (i + 1 == text.size() || text.at(i + 1) == kFieldSeparator) continue;
+        const QChar b = text.at(i + 1);
+        visit(gramKey(a, b, pad));
+        if (i + 2 == text.size() || text.at(i + 2) == kFieldSeparator) continue;
+        visit(gramKey(a, b, text.at(i + 2)));
+    }
+}
+
+// The grams a query is looked up by: its trigrams, or the whole query when it
+// is shorter than three characters.
+template <typename Visit>
+static void forEachQueryGram(const QString &query, Visit visit) {
+    const QChar pad(0xFFFF);
+    if (query.size() == 1) {
+        visit(gramKey(query.at(0), pad, pad));
+    } else if (query.size() == 2) {
+        visit(gramKey(query.at(0), query.at(1), pad));
+    } else {
+        for (int i = 0; i + 2 < query.size(); ++i) {
+            visit(gramKey(query.at(i), query.at(i + 1), query.at(i + 2)));
+        }
+    }
+}
+
+static int varintSize(quint32 value) {
+    int size = 1;
+    while (value >= 0x80) { value >>= 7; ++size; }
+    return size;
+}
+
+static char *writeVarint(char *out, quint32 value) {
+    while (value >= 0x80) {
+        *out++ = char((value & 0x7F) | 0x80);
+        value >>= 7;
+    }
+    *out++ = char(value);
+    return out;
+}
+
+// Walks one posting list; next() returns -1 past the end.
+struct PostingReader {
+    const uchar *pos;
+    const uchar *end;
+    int doc = -1;
+
+    int next() {
+        if (pos == end) return -1;
+        quint32 gap = 0;
+        int shift = 0;
+        uchar byte;
+        do {
+            byte = *pos++;
+            gap |= quint32(byte & 0x7F) << shift;
+            shift += 7;
+        } while (byte & 0x80);
+        doc += int(gap);
+        return doc;
+    }
+};
+
+QString TextSearchIndex::fold(const QString &text) {
+    QString folded = text.toCaseFolded();
+    folded.replace(QChar(0x0451), QChar(0x0435));  // ё -> е
+    return folded;
+}
+
+void TextSearchIndex::clear() {
+    texts.clear();
+    textStarts.clear();
+    bucketBits = 0;
+    postingStarts.clear();
+    bucketKeys.clear();
+    postings.clear();
+    lastQuery.clear();
+    lastMatches.clear();
+}
+
+void TextSearchIndex::build(int count, const std::function<QStringList(int)> &fieldsOf) {
+    clear();
+    textStarts.reserve(count + 1);
+    textStarts.append(0);
+    qint64 totalChars = 0;
+    for (int i = 0; i < count; ++i) {
+        const QString text = fold(fieldsOf(i).join(kFieldSeparator));
+        texts.append(text.toUtf8());
+        textStarts.append(texts.size());
+        totalChars += text.size();
+    }
+
+    // About 16 gram occurrences (three per character) per bucket, between
+    // 2^10 and 2^20 buckets
+    bucketBits = 10;
+    while (bucketBits < 20 && (qint64(1) << (bucketBits + 4)) < 3 * totalChars) ++bucketBits;
+    const int buckets = 1 << bucketBits;
+
+    // Two passes over the folded text: size every posting list, then fill
+    // them in place. lastDoc both drops repeated grams within a document
+    // and gives the gap to the previous document of the list.
+    QVector<int> lastDoc(buckets, -1);
+    postingStarts.fill(0, buckets + 1);
+    bucketKeys.fill(kNoGram, buckets);
+    for (int i = 0; i < count; ++i) {
+        forEachGram(QString::fromUtf8(texts.constData() + textStarts[i], textStarts[i + 1] - textStarts[i]),
+                    [&](quint64 key) {
+            const int bucket = keyBucket(key, bucketBits);
+            if (bucketKeys[bucket] != key) bucketKeys[bucket] = bucketKeys[bucket] == kNoGram ? key : kSharedBucket;
+            if (lastDoc[bucket] == i) return;
+            postingStarts[bucket + 1] += varintSize(quint32(i - lastDoc[bucket]));
+            lastDoc[bucket] = i;
+        });
+    }
+    for (int b = 0; b < buckets; ++b) postingStarts[b + 1] += postingStarts[b];
+
+    postings.resize(postingStarts[buckets]);
+    QVector<int> cursor = postingStarts;
+    lastDoc.fill(-1);
+    char *data = postings.data();
+    for (int i = 0; i < count; ++i) {
+        forEachGram(QString::fromUtf8(texts.constData() + textStarts[i], textStarts[i + 1] - textStarts[i]),
+                    [&](quint64 key) {
+            const int bucket = keyBucket(key, bucketBits);
+            if (lastDoc[bucket] == i) return;
+            cursor[bucket] = int(writeVarint(data + cursor[bucket], quint32(i - lastDoc[bucket])) - data);
+            lastDoc[bucket] = i;
+        });
+    }
+}
+
+QVector<int> TextSearchIndex::decodePostings(int bucket) const {
+    const uchar *base = reinterpret_cast<const uchar *>(postings.constData());
+    PostingReader reader{base + postingStarts[bucket], base + postingStarts[bucket + 1]};
+    QVector<int> docs;
+    for (int doc = reader.next(); doc >= 0; doc = reader.next()) docs.append(doc);
+    return docs;
+}
+
+void TextSearchIndex::intersectPostings(QVector<int> &candidates, int bucket) const {
+    const uchar *base = reinterpret_cast<const uchar *>(postings.constData());
+    PostingReader reader{base + postingStarts[bucket], base + postingStarts[bucket + 1]};
+    int kept = 0;
+    int doc = reader.next();
+    for (int i = 0; i < candidates.size() && doc >= 0; ++i) {
+        while (doc >= 0 && doc < candidates[i]) doc = reader.next();
+        if (doc == candidates[i]) candidates[kept++] = doc;
+    }
+    candidates.resize(kept);
+}
+
+bool TextSearchIndex::documentContains(int doc, const QByteArray &needle) const {
+    const std::string_view text(texts.constData() + textStarts[doc], std::size_t(textStarts[doc + 1] - textStarts[doc]));
+    return text.find(std::string_view(needle.constData(), std::size_t(needle.size()))) != std::string_view::npos;
+}
+
+QVector<int> TextSearchIndex::search(const QString &query) {
+    const QString folded = fold(query);
+    if (folded.isEmpty() || bucketBits == 0) {
+        lastQuery.clear();
+        lastMatches.clear();
+        QVector<int> all(size());
+        for (int i = 0; i < all.size(); ++i) all[i] = i;
+        return all;
+    }
+    const QByteArray needle = folded.toUtf8();
+    // Every match of the new query also matched the previous one
+    const bool narrowing = !lastQuery.isEmpty() && folded.contains(lastQuery);
+
+    QVector<int> buckets;
+    quint64 queryKey = kNoGram;
+    forEachQueryGram(folded, [&](quint64 key) {
+        queryKey = key;
+        buckets.append(keyBucket(key, bucketBits));
+    });
+    std::sort(buckets.begin(), buckets.end());
+    buckets.erase(std::unique(buckets.begin(), buckets.end()), buckets.end());
+    std::sort(buckets.begin(), buckets.end(),
+              [this](int a, int b) { return postingBytes(a) < postingBytes(b); });
+
+    QVector<int> matches;
+    if (folded.size() <= 3 && bucketKeys[buckets.first()] == queryKey) {
+        // The query is a single gram and alone in its bucket: the posting
+        // list is the answer
+        matches = decodePostings(buckets.first());
+    } else if (narrowing && lastMatches.size() <= postingBytes(buckets.first())) {
+        for (int doc : lastMatches) {
+            if (documentContains(doc, needle)) matches.append(doc);
+        }
+    } else {
+        QVector<int> candidates = decodePostings(buckets.first());
+        for (int i = 1; i < buckets.size() && !candidates.isEmpty(); ++i) {
+            intersectPostings(candidates, buckets[i]);
+        }
+        for (int doc : candidates) {
+            if (documentContains(doc, needle)) matches.append(doc);
+        }
+    }
+    lastQuery = folded;
+    lastMatches = matches;
+    return matches;
+}
@@ -0,0 +1,92 @@
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QTimer>
+#include <QDebug>
+#include "datamanager.h"
+#include "dataservice.h"
+#include "dataserver.h"
+
+#ifdef Q_OS_UNIX
+#include <QSocketNotifier>
+#include <csignal>
+#include <cerrno>
+#include <cstring>
+#include <sys/socket.h>
+#include <unistd.h>
+
+// SIGTERM and SIGINT end the event loop like quit() does, so the journal is
+// still compacted on the way out. A handler may do next to nothing, so it
+// only writes a byte into a socket pair; a notifier on the other end quits
+// from the event loop.
+static int signalFds[2] = {-1, -1};
+
+static void onQuitSignal(int) {
+    const char byte = 1;
+    const ssize_t written = ::write(signalFds[0], &byte, 1);
+    Q_UNUSED(written)
+}
+
+static void quitOnSignals(QCoreApplication& app) {
+    if (::socketpair(AF_UNIX, SOCK_STREAM, 0, signalFds) != 0) {
+        qWarning() << "Cannot watch for SIGTERM and SIGINT:" << std::strerror(errno);
+        return;
+    }
+    QSocketNotifier* notifier = new QSocketNotifier(signalFds[1], QSocketNotifier::Read, &app);
+    QObject::connect(notifier, &QSocketNotifier::activated, &app, [notifier]() {
+        notifier->setEnabled(false);
+        char byte;
+        const ssize_t got = ::read(signalFds[1], &byte, 1);
+        Q_UNUSED(got)
+        QCoreApplication::quit();
+    });
+    struct sigaction action = {};
+    action.sa_handler = onQuitSignal;
+    sigemptyset(&action.sa_mask);
+    action.sa_flags = SA_RESTART;
+    sigaction(SIGTERM, &action, nullptr);
+    sigaction(SIGINT, &action, nullptr);
+}
+#endif
+
+// clinicsiriusd: keeps one DataManager over a data directory and serves it
+// to ClinicSirius clients started with --service, so that the workstations
+// on this host share one parsed copy of the tables.
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("clinicsiriusd");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("ClinicSirius data service");
+    parser.addHelpOption();
+    QCommandLineOption dataOption("data", "Data directory.", "dir");
+    QCommandLineOption nameOption("name", "Local socket name.", "name", DataProtocol::kDefaultServerName);
+    parser.addOption(dataOption);
+    parser.addOption(nameOption);
+    parser.process(app);
+
+    DataManager data(parser.value(dataOption));
+    // Parse every table now rather than on the first client's request
+    data.snapshot();
+
+    DataServer server(data);
+    if (!server.listen(parser.value(nameOption))) {
+        return 1;
+    }
+
+    // Processes still working on the directory directly are picked up too
+    QTimer refreshTimer;
+    QObject::connect(&refreshTimer, &QTimer::timeout, [&data]() { data.refresh(); });
+    refreshTimer.start(2000);
+
+#ifdef Q_OS_UNIX
+    quitOnSignals(app);
+#endif
+
+    // Fold the journal back into the JSON snapshots on exit
+    QObject::connect(&app, &QCoreApplication::aboutToQuit, [&data]() {
+        data.compact();
+    });
+
+    return app.exec();
+}
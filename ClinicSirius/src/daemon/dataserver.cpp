@@ -0,0 +1,129 @@
+#include "dataserver.h"
+#include "dataservice.h"
+#include <QCborMap>
+#include <QFutureWatcher>
+#include <QPointer>
+#include <QDebug>
+
+DataServer::DataServer(DataManager& data, QObject* parent) : QObject(parent), data(data) {
+    connect(&server, &QLocalServer::newConnection, this, &DataServer::onNewConnection);
+    // Rows written by clients, and by processes still working on the
+    // directory itself (picked up by refresh()), go out to the clients
+    connect(data.events(), &DataEvents::rowChanged, this, &DataServer::broadcast);
+}
+
+bool DataServer::listen(const QString& name) {
+    // A server that crashed leaves its socket file behind. Remove it only if
+    // nothing answers on it: removing a live server's socket would leave its
+    // clients connected to a process no new client can reach
+    QLocalSocket probe;
+    probe.connectToServer(name);
+    if (probe.waitForConnected(500)) {
+        qWarning() << "A data service is already listening on" << name;
+        return false;
+    }
+    QLocalServer::removeServer(name);
+    server.setSocketOptions(QLocalServer::UserAccessOption);
+    if (!server.listen(name)) {
+        qWarning() << "Cannot listen on" << name << server.errorString();
+        return false;
+    }
+    qDebug() << "Data service listening on" << server.fullServerName();
+    return true;
+}
+
+void DataServer::onNewConnection() {
+    while (QLocalSocket* client = server.nextPendingConnection()) {
+        buffers.insert(client, QByteArray());
+        connect(client, &QLocalSocket::readyRead, this, [this, client]() { readMessages(client); });
+        connect(client, &QLocalSocket::disconnected, this, [this, client]() {
+            buffers.remove(client);
+            client->deleteLater();
+        });
+    }
+}
+
+void DataServer::readMessages(QLocalSocket* client) {
+    QByteArray& buffer = buffers[client];
+    buffer += client->readAll();
+    QCborArray message;
+    while (DataProtocol::takeFrame(buffer, message)) {
+        handle(client, message);
+    }
+}
+
+void DataServer::handle(QLocalSocket* client, const QCborArray& message) {
+    const int type = int(message.at(0).toInteger());
+    const int request = int(message.at(1).toInteger());
+    switch (type) {
+    case DataProtocol::FetchTable: {
+        QJsonArray records;
+        const bool found = data.tableRecords(message.at(2).toString(), records);
+        reply(client, request, {found, QCborArray::fromJsonArray(records)});
+        break;
+    }
+    case DataProtocol::ClaimIds:
+        reply(client, request, {data.claimTableIds(message.at(2).toString(), int(message.at(3).toInteger(1)))});
+        break;
+    case DataProtocol::Write: {
+        const QList<StagedRow> rows = DataProtocol::decodeRows(message.at(2).toArray());
+        writer = client;
+        for (const StagedRow& row : rows) {
+            writerRows.insert(qMakePair(row.table, row.id));
+        }
+        QFuture<bool> written;
+        const JournalWrite::Status status = data.applyRows(rows, written);
+        writer = nullptr;
+        writerRows.clear();
+        if (status != JournalWrite::Queued) {
+            reply(client, request, {int(status)});
+            break;
+        }
+        // Answered once the storage thread has appended the batch; other
+        // clients are served meanwhile
+        QPointer<QLocalSocket> target(client);
+        QFutureWatcher<bool>* watcher = new QFutureWatcher<bool>(this);
+        connect(watcher, &QFutureWatcherBase::finished, this, [this, watcher, target, request, rows]() {
+            watcher->deleteLater();
+            const JournalWrite::Status outcome = watcher->result() ? JournalWrite::Written : data.failedWriteStatus(rows);
+            if (target) reply(target, request, {int(outcome)});
+        });
+        watcher->setFuture(written);
+        break;
+    }
+    default:
+        qWarning() << "Data service: unexpected message" << type;
+        break;
+    }
+}
+
+void DataServer::reply(QLocalSocket* client, int request, const QCborArray& args) {
+    QCborArray message;
+    message.append(int(DataProtocol::Reply));
+    message.append(request);
+    for (const QCborValue& arg : args) {
+        message.append(arg);
+    }
+    QByteArray frame;
+    DataProtocol::appendFrame(frame, message);
+    client->write(frame);
+    client->flush();
+}
+
+void DataServer::broadcast(const QString& table, int id) {
+    QCborArray message;
+    message.append(int(DataProtocol::Changed));
+    message.append(0);
+    message.append(table);
+    message.append(id);
+    message.append(QCborMap::fromJsonObject(data.currentRecord(table, id)));
+    QByteArray frame;
+    DataProtocol::appendFrame(frame, message);
+
+    const bool fromWriter = writerRows.contains(qMakePair(table, id));
+    for (auto it = buffers.constBegin(); it != buffers.constEnd(); ++it) {
+        if (fromWriter && it.key() == writer) continue;
+        it.key()->write(frame);
+        it.key()->flush();
+    }
+}
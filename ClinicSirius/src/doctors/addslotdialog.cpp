@@ -9,7 +9,7 @@
 
 AddSlotDialog::AddSlotDialog(int doctorId, QWidget *parent)
     : QDialog(parent), doctorId(doctorId),
-      dataManager(QCoreApplication::applicationDirPath() + "/../data"),
+      dataManager(DataManager::shared()),
       _defaultStartTime(QTime(10, 0)), _defaultDurationMin(20)
 {
     setWindowTitle("Добавить окно для приема");
@@ -20,7 +20,7 @@ AddSlotDialog::AddSlotDialog(int doctorId, QWidget *parent)
 
 AddSlotDialog::AddSlotDialog(int doctorId_, QTime defaultStartTime, int defaultDurationMin, QWidget *parent)
     : QDialog(parent), doctorId(doctorId_),
-      dataManager(QCoreApplication::applicationDirPath() + "/../data"),
+      dataManager(DataManager::shared()),
       _defaultStartTime(defaultStartTime), _defaultDurationMin(defaultDurationMin)
 {
     setWindowTitle("Добавить окно для приема");
@@ -155,26 +155,15 @@ void AddSlotDialog::onAddSlot() {
 
     // Валидация: проверяем пересечения с существующими окнами
     // 1) У врача — нельзя добавлять пересекающиеся окна
-    QList<AppointmentSchedule> doctorSchedules = dataManager.getDoctorSchedules(doctorId);
-    for (const AppointmentSchedule &s : doctorSchedules) {
-        if (s.time_from.isValid() && s.time_to.isValid()) {
-            // Пересечение интервалов: [from, to) пересекается с [s.time_from, s.time_to)
-            if (from < s.time_to && s.time_from < to) {
-                QMessageBox::warning(this, "Ошибка", "Новое окно пересекается с уже существующим окном врача.");
-                return;
-            }
-        }
+    if (dataManager.doctorHasOverlap(doctorId, from, to)) {
+        QMessageBox::warning(this, "Ошибка", "Новое окно пересекается с уже существующим окном врача.");
+        return;
     }
 
     // 2) Тот же кабинет — нельзя добавлять пересекающиеся окна в одном кабинете
-    QList<AppointmentSchedule> allSchedules = dataManager.getAllSchedules();
-    for (const AppointmentSchedule &s : allSchedules) {
-        if (s.id_room == schedule.id_room && s.time_from.isValid() && s.time_to.isValid()) {
-            if (from < s.time_to && s.time_from < to) {
-                QMessageBox::warning(this, "Ошибка", "Новое окно пересекается с уже существующим окном в выбранном кабинете.");
-                return;
-            }
-        }
+    if (dataManager.roomHasOverlap(schedule.id_room, from, to)) {
+        QMessageBox::warning(this, "Ошибка", "Новое окно пересекается с уже существующим окном в выбранном кабинете.");
+        return;
     }
 
     // Если проверка пройдена — добавить
@@ -9,7 +9,7 @@
 
 DoctorProfileWidget::DoctorProfileWidget(QWidget *parent)
     : QWidget(parent),
-      dataManager(QCoreApplication::applicationDirPath() + "/../data") {
+      dataManager(DataManager::shared()) {
     buildUI();
 }
 
@@ -12,7 +12,7 @@
 
 DoctorVisitDialog::DoctorVisitDialog(int doctorId_, int scheduleId_, int mode_, QWidget *parent)
     : QDialog(parent), doctorId(doctorId_), scheduleId(scheduleId_), mode(mode_),
-      dataManager(QCoreApplication::applicationDirPath() + "/../data") {
+      dataManager(DataManager::shared()) {
     setWindowTitle("Окно приема");
     setMinimumWidth(500);
     
@@ -395,6 +395,24 @@ void DoctorVisitDialog::onSaveAppointment() {
         }
     }
 
+    // Новая запись на слот: проверка и занятие слота одним шагом, чтобы
+    // слот, занятый за это время на другом рабочем месте, не заняли дважды
+    if (existingApptId < 0 && scheduleIdUsed > 0) {
+        BookingResult result = dataManager.bookSlot(scheduleIdUsed, patientId);
+        if (result.status == BookingResult::SlotTaken || result.status == BookingResult::NoSuchSlot) {
+            QMessageBox::warning(this, "Слот занят", "Этот слот уже занят или удалён.");
+            return;
+        }
+        if (!result.ok()) {
+            QMessageBox::warning(this, "Ошибка", "Не удалось сохранить запись.");
+            return;
+        }
+        QMessageBox::information(this, "Готово", mode == 0 ? "Пациент записан на прием" : "Пациент успешно записан");
+        emit appointmentSaved();
+        accept();
+        return;
+    }
+
     Appointment ap;
     bool isUpdate = false;
     if (existingApptId > 0) {
@@ -411,20 +429,23 @@ void DoctorVisitDialog::onSaveAppointment() {
     ap.date = appointmentTime;
     ap.id_ap_sch = scheduleIdUsed;  // Привязать встречу к расписанию
 
-    if (isUpdate) {
-        dataManager.updateAppointment(ap);
-    } else {
-        dataManager.addAppointment(ap);
-    }
-    
-    // Установить статус "занято" для использованного слота расписания
-    if (scheduleIdUsed > 0) {
-        AppointmentSchedule sch = dataManager.getScheduleById(scheduleIdUsed);
-        if (sch.id_ap_sch > 0) {
-            sch.status = "booked";
-            dataManager.updateSchedule(sch);
+    // Запись и слот сохраняются одной транзакцией, на диск - в фоне
+    dataManager.writeAsync([&]() {
+        if (isUpdate) {
+            dataManager.updateAppointment(ap);
+        } else {
+            dataManager.addAppointment(ap);
         }
-    }
+
+        // Установить статус "занято" для использованного слота расписания
+        if (scheduleIdUsed > 0) {
+            AppointmentSchedule sch = dataManager.getScheduleById(scheduleIdUsed);
+            if (sch.id_ap_sch > 0) {
+                sch.status = "booked";
+                dataManager.updateSchedule(sch);
+            }
+        }
+    });
     
     QString msg = (mode == 0 ? "Пациент записан на прием" : "Пациент успешно записан");
     if (isUpdate) msg = "Запись обновлена";
@@ -455,6 +476,7 @@ void DoctorVisitDialog::onFinishVisit() {
     }
     
     if (appointmentIdToFinish > 0) {
+        DataTransaction tx(dataManager);
         Appointment ap = dataManager.getAppointmentById(appointmentIdToFinish);
         ap.completed = true;
         dataManager.updateAppointment(ap);
@@ -487,6 +509,8 @@ void DoctorVisitDialog::onFinishVisit() {
                 dataManager.updateSchedule(sch);
             }
         }
+        // Приём, рецепт и слот пишутся на диск в фоне
+        tx.commitAsync();
     }
     
     QMessageBox::information(this, "Готово", "Прием завершён");
@@ -1,11 +1,9 @@
 #include "doctorwidget.h"
 #include "doctorvisitdialog.h"
 #include "addslotdialog.h"
-#include <QHeaderView>
 #include <QDate>
 #include <QDateTime>
 #include <QCoreApplication>
-#include <QTableWidgetItem>
 #include <QMap>
 #include <QColor>
 #include <QHBoxLayout>
@@ -15,12 +13,18 @@
 #include <QSpinBox>
 #include <QIcon>
 #include <QPixmap>
+#include <QTimer>
 #include <numeric>
 
 DoctorWidget::DoctorWidget(QWidget *parent)
-    : QWidget(parent), dataManager(QCoreApplication::applicationDirPath() + "/../data") {
-    scheduleStartDate = QDate::currentDate();
+    : QWidget(parent), dataManager(DataManager::shared()) {
     buildUI();
+
+    // Keep the open schedule in sync with changes made from other widgets
+    connect(dataManager.events(), &DataEvents::scheduleChanged, this, &DoctorWidget::onScheduleChanged);
+    connect(dataManager.events(), &DataEvents::appointmentChanged, this, [this](int appointmentId) {
+        onScheduleChanged(dataManager.getAppointmentById(appointmentId).id_ap_sch);
+    });
 }
 
 void DoctorWidget::buildUI() {
@@ -123,19 +127,14 @@ void DoctorWidget::buildSchedulePage() {
     timeSlotDurationSpinBox->setValue(20);
     timeSlotDurationSpinBox->setSuffix(" мин");
     timeSlotDurationSpinBox->setMaximumWidth(100);
-    selectedIntervalMinutes = 20;
     timeSlotLayout->addWidget(timeSlotIcon);
     timeSlotLayout->addWidget(timeSlotLabel);
     timeSlotLayout->addWidget(timeSlotDurationSpinBox);
     layout->addLayout(timeSlotLayout);
     
-    scheduleTable = new QTableWidget();
-    scheduleTable->setColumnCount(8);
-    scheduleTable->horizontalHeader()->setSectionResizeMode(QHeaderView::Stretch);
-    scheduleTable->verticalHeader()->setVisible(false);
-    scheduleTable->setEditTriggers(QTableWidget::NoEditTriggers);
-    scheduleTable->setSelectionMode(QTableWidget::SingleSelection);
-    layout->addWidget(scheduleTable);
+    scheduleTimeline = new ScheduleTimeline();
+    scheduleTimeline->setMinutesPerRow(timeSlotDurationSpinBox->value());
+    layout->addWidget(scheduleTimeline);
     
     // Кнопки действий
     QHBoxLayout *actionsLayout = new QHBoxLayout();
@@ -164,24 +163,18 @@ void DoctorWidget::buildSchedulePage() {
     connect(prevWeekButton, &QPushButton::clicked, this, &DoctorWidget::onPrevWeek);
     connect(nextWeekButton, &QPushButton::clicked, this, &DoctorWidget::onNextWeek);
     connect(todayButton, &QPushButton::clicked, this, &DoctorWidget::onToday);
+    connect(scheduleTimeline, &ScheduleTimeline::firstVisibleDateChanged, this, &DoctorWidget::onFirstVisibleDateChanged);
+    onFirstVisibleDateChanged(scheduleTimeline->firstVisibleDate());
     
-    // Connect time slot duration spin box to reload schedule with new duration
-    connect(timeSlotDurationSpinBox, QOverload<int>::of(&QSpinBox::valueChanged), this, [this](int value) {
-        selectedIntervalMinutes = value;
-        loadSchedule();
-    });
+    // The slot duration only changes the grid step, the slots are not reloaded
+    connect(timeSlotDurationSpinBox, QOverload<int>::of(&QSpinBox::valueChanged), scheduleTimeline, &ScheduleTimeline::setMinutesPerRow);
     
-    connect(scheduleTable, &QTableWidget::cellClicked, this, &DoctorWidget::onCellClicked);
-    connect(scheduleTable, &QTableWidget::cellDoubleClicked, this, &DoctorWidget::onCellDoubleClicked);
+    connect(scheduleTimeline, &ScheduleTimeline::blockClicked, this, &DoctorWidget::onBlockClicked);
+    connect(scheduleTimeline, &ScheduleTimeline::blockDoubleClicked, this, &DoctorWidget::onBlockDoubleClicked);
     connect(deleteSlotButton, &QPushButton::clicked, this, [this]() {
-        QTableWidgetItem *item = scheduleTable->currentItem();
-        if (!item) {
-            QMessageBox::warning(this, "Ошибка", "Пожалуйста, выберите слот для удаления");
-            return;
-        }
-        int schId = item->data(Qt::UserRole).toInt();
+        int schId = scheduleTimeline->selectedScheduleId();
         if (schId <= 0) {
-            QMessageBox::warning(this, "Ошибка", "Выберите существующий слот");
+            QMessageBox::warning(this, "Ошибка", "Пожалуйста, выберите слот для удаления");
             return;
         }
 
@@ -201,14 +194,9 @@ void DoctorWidget::buildSchedulePage() {
         loadSchedule();
     });
     connect(bookFromScheduleButton, &QPushButton::clicked, this, [this]() {
-        QTableWidgetItem *item = scheduleTable->currentItem();
-        if (!item) {
-            QMessageBox::warning(this, "Ошибка", "Пожалуйста, выберите слот");
-            return;
-        }
-        int schId = item->data(Qt::UserRole).toInt();
+        int schId = scheduleTimeline->selectedScheduleId();
         if (schId <= 0) {
-            QMessageBox::warning(this, "Ошибка", "Выберите свободный слот");
+            QMessageBox::warning(this, "Ошибка", "Пожалуйста, выберите слот");
             return;
         }
         AppointmentSchedule sch = dataManager.getScheduleById(schId);
@@ -247,24 +235,30 @@ void DoctorWidget::refreshHeader() {
 }
 
 void DoctorWidget::onViewSchedule() {
-    scheduleStartDate = QDate::currentDate();
     loadSchedule();
+    onToday();
     stackedWidget->setCurrentIndex(schedulePageIndex);
 }
 
+// Navigation only scrolls the timeline; all slots of the doctor are loaded
 void DoctorWidget::onPrevWeek() {
-    scheduleStartDate = scheduleStartDate.addDays(-7);
-    loadSchedule();
+    QDate first = scheduleTimeline->firstVisibleDate();
+    scheduleTimeline->scrollToDate(first.addDays(1 - first.dayOfWeek() - 7));
 }
 
 void DoctorWidget::onNextWeek() {
-    scheduleStartDate = scheduleStartDate.addDays(7);
-    loadSchedule();
+    QDate first = scheduleTimeline->firstVisibleDate();
+    scheduleTimeline->scrollToDate(first.addDays(1 - first.dayOfWeek() + 7));
 }
 
 void DoctorWidget::onToday() {
-    scheduleStartDate = QDate::currentDate();
-    loadSchedule();
+    QDate today = QDate::currentDate();
+    scheduleTimeline->scrollToDate(today.addDays(1 - today.dayOfWeek()));
+}
+
+void DoctorWidget::onFirstVisibleDateChanged(const QDate &date) {
+    QDate last = date.addDays(scheduleTimeline->visibleDays() - 1);
+    weekLabel->setText(QString("%1 — %2").arg(date.toString("dd.MM.yyyy"), last.toString("dd.MM.yyyy")));
 }
 
 void DoctorWidget::onAddSlot() {
@@ -285,160 +279,30 @@ void DoctorWidget::onBookAppointment() {
     dlg.exec();
 }
 
-void DoctorWidget::loadSchedule() {
-    scheduleTable->clear();
-    scheduleTable->setRowCount(0);
-    scheduleTable->setColumnCount(1);
-
-    // Setup headers: time column + 7 days
-    QStringList headers;
-    headers << "Время";
-    QDate start = scheduleStartDate;
-    
-    // Calculate start date to be Monday
-    int dayOfWeek = start.dayOfWeek(); // 1 = Monday, 7 = Sunday (Qt default)
-    if (dayOfWeek != 1) {
-        start = start.addDays(1 - dayOfWeek); // Move to Monday of the same week
-    }
-    // Normalize internal pointer to the week start so navigation is consistent
-    scheduleStartDate = start;
-    
-    // Update week label showing range
-    if (weekLabel) {
-        QString label = QString("%1 — %2").arg(start.toString("dd.MM.yyyy"), start.addDays(6).toString("dd.MM.yyyy"));
-        weekLabel->setText(label);
-    }
-    QDate today = QDate::currentDate();
-    
-    for (int i = 0; i < 7; ++i) {
-        QDate dt = start.addDays(i);
-        QString dayName;
-        switch (dt.dayOfWeek()) {
-            case 1: dayName = "Пн"; break;
-            case 2: dayName = "Вт"; break;
-            case 3: dayName = "Ср"; break;
-            case 4: dayName = "Чт"; break;
-            case 5: dayName = "Пт"; break;
-            case 6: dayName = "Сб"; break;
-            case 7: dayName = "Вс"; break;
-            default: dayName = ""; break;
-        }
-        headers << QString("%1\n%2").arg(dt.toString("dd.MM"), dayName);
-    }
-    scheduleTable->setColumnCount(headers.size());
-    scheduleTable->setHorizontalHeaderLabels(headers);
-
-    // Collect all schedules for the doctor
-    QList<AppointmentSchedule> schedules = dataManager.getDoctorSchedules(currentUser.id);
-
-    // Use the interval selected by the user in the combo box
-    int minimalInterval = selectedIntervalMinutes;
-
-    // Build rows from 6:00 to 22:00 with step = minimalInterval minutes
-    const int dayStartMin = 6 * 60;
-    const int dayEndMin = 22 * 60; // exclusive end
-    int totalMinutes = dayEndMin - dayStartMin;
-    int rowsCount = (totalMinutes + minimalInterval - 1) / minimalInterval;
-    scheduleTable->setRowCount(rowsCount);
-
-    for (int r = 0; r < rowsCount; ++r) {
-        int minutes = dayStartMin + r * minimalInterval;
-        int hour = minutes / 60;
-        int minute = minutes % 60;
-        QTableWidgetItem *timeItem = new QTableWidgetItem(QString("%1:%2").arg(hour, 2, 10, QChar('0')).arg(minute, 2, 10, QChar('0')));
-        timeItem->setFlags(timeItem->flags() & ~Qt::ItemIsSelectable);
-        scheduleTable->setItem(r, 0, timeItem);
-    }
-
-    // Populate cells with schedule blocks using minute granularity
-    for (const AppointmentSchedule &s : schedules) {
-        int dayOffset = start.daysTo(s.time_from.date());
-        int column = 1 + dayOffset;
-        if (column < 1 || column >= scheduleTable->columnCount()) continue;
-
-        int startMinOfDay = s.time_from.time().hour() * 60 + s.time_from.time().minute();
-        int endMinOfDay = s.time_to.time().hour() * 60 + s.time_to.time().minute();
-
-        if (startMinOfDay < dayStartMin || endMinOfDay > dayEndMin) continue;
-
-        int startIndex = (startMinOfDay - dayStartMin) / minimalInterval;
-        int durationMin = endMinOfDay - startMinOfDay;
-        int rowSpan = (durationMin + minimalInterval - 1) / minimalInterval;
-        if (rowSpan <= 0) rowSpan = 1;
+void DoctorWidget::onScheduleChanged(int scheduleId) {
+    if (stackedWidget->currentIndex() != schedulePageIndex || scheduleReloadQueued) return;
+    AppointmentSchedule sch = dataManager.getScheduleById(scheduleId);
+    if (sch.id_ap_sch > 0 && sch.id_doctor != currentUser.id) return;
 
-        // Determine status and color based on schedule status (case-insensitive)
-        QString st = s.status.trimmed().toLower();
-        QString statusText = "Свободен";
-        QColor bgColor = QColor(144, 190, 109);
-        if (st == "booked" || st == "busy") {
-            statusText = "Занято";
-            bgColor = QColor(255, 165, 0);
-        } else if (st == "done") {
-            statusText = "Завершено";
-            bgColor = QColor(96, 165, 250); // blue
-        }
-
-        // Remove any existing widgets in the spanned area
-        for (int r = startIndex; r < startIndex + rowSpan && r < scheduleTable->rowCount(); ++r) {
-            QWidget *w = scheduleTable->cellWidget(r, column);
-            if (w) { delete w; }
-            scheduleTable->setItem(r, column, nullptr);
-        }
+    scheduleReloadQueued = true;
+    QTimer::singleShot(0, this, [this]() {
+        scheduleReloadQueued = false;
+        loadSchedule();
+    });
+}
 
-        // Create item for the slot and place at the start index
-        QTableWidgetItem *cell = new QTableWidgetItem(statusText);
-        cell->setBackground(bgColor);
-        cell->setForeground(Qt::white);
-        cell->setTextAlignment(Qt::AlignCenter);
-        cell->setData(Qt::UserRole, s.id_ap_sch);
-        cell->setData(Qt::UserRole + 1, rowSpan);
-        scheduleTable->setItem(startIndex, column, cell);
-
-        if (rowSpan > 1) {
-            scheduleTable->setSpan(startIndex, column, rowSpan, 1);
-        }
-    }
-    
-    // Highlight today's column with a light background color
-    int todayColumn = -1;
-    for (int i = 0; i < 7; ++i) {
-        QDate dt = start.addDays(i);
-        if (dt == today) {
-            todayColumn = 1 + i;
-            break;
-        }
-    }
-    
-    if (todayColumn >= 0) {
-        QColor todayBgColor = QColor(200, 220, 255); // Light blue
-        for (int r = 0; r < scheduleTable->rowCount(); ++r) {
-            QTableWidgetItem *item = scheduleTable->item(r, todayColumn);
-            if (!item) {
-                item = new QTableWidgetItem();
-                scheduleTable->setItem(r, todayColumn, item);
-            }
-            // Only apply background if no other content (to avoid overwriting schedule blocks)
-            if (item->data(Qt::UserRole).toInt() <= 0) {
-                item->setBackground(todayBgColor);
-                item->setFlags(item->flags() & ~Qt::ItemIsSelectable);
-            }
-        }
+void DoctorWidget::loadSchedule() {
+    // All slots of the doctor; the timeline shows the weeks scrolled to
+    const QList<AppointmentSchedule> schedules = dataManager.getDoctorSchedules(currentUser.id);
+    QVector<ScheduleBlock> blocks;
+    blocks.reserve(schedules.size());
+    for (const AppointmentSchedule &s : schedules) {
+        blocks.append(ScheduleTimeline::blockFor(s));
     }
+    scheduleTimeline->setBlocks(blocks);
 }
 
-void DoctorWidget::onCellClicked(int row, int column) {
-    if (column == 0) return; // time column
-    // Try to get the item at the clicked coordinates. If null (because of span), walk upwards to find top cell.
-    QTableWidgetItem *it = scheduleTable->item(row, column);
-    int probeRow = row;
-    while (!it && probeRow >= 0) {
-        --probeRow;
-        it = scheduleTable->item(probeRow, column);
-    }
-    if (!it) return;
-    // Ensure the clicked (or spanned) cell becomes the current selection
-    scheduleTable->setCurrentCell(probeRow, column);
-    int schId = it->data(Qt::UserRole).toInt();
+void DoctorWidget::onBlockClicked(int schId) {
     if (schId <= 0) return;
     
     AppointmentSchedule sch = dataManager.getScheduleById(schId);
@@ -457,16 +321,7 @@ void DoctorWidget::onCellClicked(int row, int column) {
     }
 }
 
-void DoctorWidget::onCellDoubleClicked(int row, int column) {
-    if (column == 0) return;
-    QTableWidgetItem *it = scheduleTable->item(row, column);
-    int probeRow = row;
-    while (!it && probeRow >= 0) {
-        --probeRow;
-        it = scheduleTable->item(probeRow, column);
-    }
-    if (!it) return;
-    int schId = it->data(Qt::UserRole).toInt();
+void DoctorWidget::onBlockDoubleClicked(int schId) {
     if (schId <= 0) return;
 
     AppointmentSchedule sch = dataManager.getScheduleById(schId);
@@ -474,11 +329,7 @@ void DoctorWidget::onCellDoubleClicked(int row, int column) {
     if (st != "done") return; // только для завершённых
 
     // найти приём по расписанию
-    QList<Appointment> appts = dataManager.getAppointmentsByDoctor(currentUser.id);
-    Appointment ap;
-    for (const Appointment &a : appts) {
-        if (a.id_ap_sch == schId) { ap = a; break; }
-    }
+    Appointment ap = dataManager.getAppointmentByScheduleId(schId);
     Patient p = dataManager.getPatientById(ap.id_patient);
     Recipe r = dataManager.getRecipeByAppointmentId(ap.id_ap);
     Diagnosis diag = dataManager.getDiagnosisById(r.id_diagnosis);
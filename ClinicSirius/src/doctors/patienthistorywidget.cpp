@@ -12,7 +12,7 @@
 #include "../common/datamanager.h"
 
 PatientHistoryWidget::PatientHistoryWidget(QWidget *parent)
-    : QWidget(parent), m_dataManager(QString()) {
+    : QWidget(parent), m_dataManager(DataManager::shared()) {
     QVBoxLayout *mainLayout = new QVBoxLayout(this);
     mainLayout->setContentsMargins(20,20,20,20);
 
@@ -9,7 +9,7 @@
 #include <algorithm>
 
 BulkOperationsDialog::BulkOperationsDialog(QWidget* parent)
-    : QDialog(parent), m_dataManager(QString()) {
+    : QDialog(parent), m_dataManager(DataManager::shared()) {
     setWindowTitle("Массовые операции — создать окна приема");
     resize(600, 300);
     loadDoctors();
@@ -174,8 +174,8 @@ void BulkOperationsDialog::onApply() {
     if (hasLunch && lunchFrom >= lunchTo) { QMessageBox::warning(this, "Ошибка", "Некорректное время обеда"); return; }
 
     // Create slots in the selected period skipping lunch by interval
+    QList<AppointmentSchedule> requested;
     QTime t = start;
-    int created = 0;
     while (t.addSecs(interval * 60) <= end) {
         QTime slotEnd = t.addSecs(interval * 60);
         // skip lunch range (only if lunch is enabled)
@@ -185,20 +185,43 @@ void BulkOperationsDialog::onApply() {
         }
 
         AppointmentSchedule sch;
-        sch.id_ap_sch = m_dataManager.getNextScheduleId();
+        sch.id_ap_sch = -1;  // assigned by addSchedules()
         sch.id_doctor = docId;
         sch.id_room = roomId;
         sch.time_from = QDateTime(date, t);
         sch.time_to = QDateTime(date, slotEnd);
         sch.status = "free";
+        requested.append(sch);
+        t = slotEnd;
+    }
+
+    // Validate and save the whole batch at once
+    QList<ScheduleBatchResult> results = m_dataManager.addSchedules(requested);
 
-        if (m_dataManager.canAddSchedule(sch)) {
-            m_dataManager.addSchedule(sch);
-            created++;
+    int created = 0;
+    QStringList report;
+    for (const ScheduleBatchResult &r : results) {
+        QString reason;
+        switch (r.status) {
+            case ScheduleBatchResult::Accepted: reason = "создан"; ++created; break;
+            case ScheduleBatchResult::InvalidTime: reason = "некорректное время"; break;
+            case ScheduleBatchResult::DoctorOverlap: reason = "пересекается с окном врача"; break;
+            case ScheduleBatchResult::RoomOverlap: reason = "кабинет занят"; break;
+            case ScheduleBatchResult::BatchOverlap: reason = "пересекается с другим слотом пакета"; break;
         }
-        t = slotEnd;
+        report.append(QString("%1 — %2: %3")
+            .arg(r.schedule.time_from.toString("HH:mm"))
+            .arg(r.schedule.time_to.toString("HH:mm"))
+            .arg(reason));
     }
 
-    QMessageBox::information(this, "Готово", QString("Создано %1 слотов").arg(created));
+    QMessageBox box(this);
+    box.setWindowTitle("Готово");
+    box.setIcon(created == results.size() ? QMessageBox::Information : QMessageBox::Warning);
+    box.setText(QString("Создано %1 из %2 слотов").arg(created).arg(results.size()));
+    if (!report.isEmpty()) {
+        box.setDetailedText(report.join("\n"));
+    }
+    box.exec();
     accept();
 }
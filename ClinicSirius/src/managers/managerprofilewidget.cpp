@@ -6,7 +6,7 @@
 #include <QIcon>
 
 ManagerProfileWidget::ManagerProfileWidget(QWidget *parent)
-    : QWidget(parent), m_dataManager(QString()) {
+    : QWidget(parent), m_dataManager(DataManager::shared()) {
     buildUI();
 }
 
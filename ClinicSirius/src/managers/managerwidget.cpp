@@ -15,7 +15,7 @@
 #include "patients/familyviewerwidget.h"
 
 ManagerWidget::ManagerWidget(QWidget* parent)
-    : QWidget(parent), m_dataManager(QString()) {
+    : QWidget(parent), m_dataManager(DataManager::shared()) {
     buildUI();
 }
 
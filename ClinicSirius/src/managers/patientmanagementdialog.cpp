@@ -9,7 +9,7 @@
 #include <QIcon>
 
 PatientManagementDialog::PatientManagementDialog(QWidget* parent)
-    : QWidget(parent), m_dataManager(QString()) {
+    : QWidget(parent), m_dataManager(DataManager::shared()) {
     setWindowTitle("Управление пациентами");
     resize(900, 600);
 
@@ -170,7 +170,8 @@ void PatientManagementDialog::onDeletePatient() {
         return;
     }
     
-    m_dataManager.deletePatient(id);
+    // The patient is gone from memory at once; the files follow in the background
+    m_dataManager.writeAsync([this, id]() { m_dataManager.deletePatient(id); });
     refreshList(m_searchEdit->text());
     QMessageBox::information(this, "Успешно", "Пациент удален");
 }
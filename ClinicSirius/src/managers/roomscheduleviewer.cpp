@@ -1,7 +1,6 @@
 #include "managers/roomscheduleviewer.h"
 #include <QVBoxLayout>
 #include <QHBoxLayout>
-#include <QHeaderView>
 #include <algorithm>
 #include <QLabel>
 #include <QPushButton>
@@ -10,11 +9,11 @@
 #include <QMenu>
 #include <QIcon>
 #include <QSize>
+#include <QTimer>
 #include "patients/appointmentbookingwidget.h"
 
 RoomScheduleViewer::RoomScheduleViewer(QWidget *parent)
-    : QWidget(parent), m_dataManager(QString()) {
-    m_startDate = getMondayOfWeek(QDate::currentDate());
+    : QWidget(parent), m_dataManager(DataManager::shared()) {
     buildUI();
     loadRooms();
 }
@@ -67,131 +66,123 @@ void RoomScheduleViewer::buildUI() {
     nav->addWidget(m_nextBtn);
     main->addLayout(nav);
 
-    m_scheduleTable = new QTableWidget();
-    // Prevent in-place editing
-    m_scheduleTable->setEditTriggers(QAbstractItemView::NoEditTriggers);
-    m_scheduleTable->setColumnCount(8);
-    m_scheduleTable->horizontalHeader()->setSectionResizeMode(QHeaderView::Stretch);
-    // Set minimum row height to prevent text truncation
-    m_scheduleTable->verticalHeader()->setDefaultSectionSize(35);
-    m_scheduleTable->verticalHeader()->setVisible(false);
-    m_scheduleTable->setContextMenuPolicy(Qt::CustomContextMenu);
-    main->addWidget(m_scheduleTable, 1);
+    m_timeline = new ScheduleTimeline();
+    m_timeline->setMinutesPerRow(m_timeIntervalMinutes);
+    m_timeline->setToolTipProvider([this](int scheduleId) { return scheduleToolTip(scheduleId); });
+    m_timeline->setPlaceholderText("Выберите кабинет для просмотра расписания");
+    main->addWidget(m_timeline, 1);
 
     connect(m_filterEdit, &QLineEdit::textChanged, this, &RoomScheduleViewer::onRoomFilterChanged);
     connect(m_prevBtn, &QPushButton::clicked, this, &RoomScheduleViewer::onPrevWeek);
     connect(m_nextBtn, &QPushButton::clicked, this, &RoomScheduleViewer::onNextWeek);
     connect(m_todayBtn, &QPushButton::clicked, this, &RoomScheduleViewer::onToday);
     connect(m_intervalSpin, QOverload<int>::of(&QSpinBox::valueChanged), this, &RoomScheduleViewer::onIntervalChanged);
-    connect(m_scheduleTable, &QTableWidget::customContextMenuRequested, this, &RoomScheduleViewer::onTableContextMenu);
-    
-    // Cell click to open booking widget
-    connect(m_scheduleTable, &QTableWidget::cellClicked, this, [this](int row, int column){
-        if (column == 0) return; // time column
-        QTableWidgetItem *it = m_scheduleTable->item(row, column);
-        int probe = row;
-        while (!it && probe >= 0) { --probe; it = m_scheduleTable->item(probe, column); }
-        if (!it) return;
-        int schId = it->data(Qt::UserRole).toInt();
-        if (schId <= 0) return;
-        AppointmentSchedule sch = m_dataManager.getScheduleById(schId);
-        if (sch.id_ap_sch <= 0) return;
+    connect(m_timeline, &ScheduleTimeline::blockClicked, this, &RoomScheduleViewer::onBlockClicked);
+    connect(m_timeline, &ScheduleTimeline::blockContextMenuRequested, this, &RoomScheduleViewer::onBlockContextMenu);
+    connect(m_timeline, &ScheduleTimeline::firstVisibleDateChanged, this, &RoomScheduleViewer::onFirstVisibleDateChanged);
+    onFirstVisibleDateChanged(m_timeline->firstVisibleDate());
 
-        // Check if slot is booked and show options
-        QString status = sch.status.trimmed().toLower();
-        if (status == "booked" || status == "busy") {
-            // Find the appointment for detailed info
-            Appointment apt;
-            bool foundAppointment = false;
-            for (const Appointment &a : m_dataManager.getAllAppointments()) {
-                if (a.id_ap_sch == schId) {
-                    apt = a;
-                    foundAppointment = true;
-                    break;
-                }
-            }
+    // Refresh the visible week when its slots change anywhere in the app
+    DataEvents *events = m_dataManager.events();
+    connect(events, &DataEvents::scheduleChanged, this, &RoomScheduleViewer::onScheduleChanged);
+    connect(events, &DataEvents::appointmentChanged, this, [this](int appointmentId) {
+        onScheduleChanged(m_dataManager.getAppointmentById(appointmentId).id_ap_sch);
+    });
+}
+
+// Slot click opens the booking widget, or the options of a booked slot
+void RoomScheduleViewer::onBlockClicked(int schId) {
+    if (schId <= 0) return;
+    AppointmentSchedule sch = m_dataManager.getScheduleById(schId);
+    if (sch.id_ap_sch <= 0) return;
+
+    // Check if slot is booked and show options
+    QString status = sch.status.trimmed().toLower();
+    if (status == "booked" || status == "busy") {
+        // Find the appointment for detailed info
+        Appointment apt = m_dataManager.getAppointmentByScheduleId(schId);
+        bool foundAppointment = apt.id_ap > 0;
+        
+        // Build detail message
+        QString detailMsg = "Этот слот занят.";
+        if (foundAppointment) {
+            Patient patient = m_dataManager.getPatientById(apt.id_patient);
+            detailMsg = QString("Слот занят пациентом: %1\n\nВремя: %2 - %3")
+                .arg(patient.fullName())
+                .arg(sch.time_from.toString("HH:mm"))
+                .arg(sch.time_to.toString("HH:mm"));
+        }
+        
+        // Show options - Reschedule or Cancel
+        QMessageBox msgBox(this);
+        msgBox.setWindowTitle("Слот занят");
+        msgBox.setText(detailMsg);
+        msgBox.setIcon(QMessageBox::Information);
+        
+        QPushButton *rescheduleBtn = new QPushButton(QIcon(":/images/icon-refresh.svg"), "Перенести");
+        msgBox.addButton(rescheduleBtn, QMessageBox::ActionRole);
+        QPushButton *cancelBtn = msgBox.addButton("Отменить", QMessageBox::DestructiveRole);
+        QPushButton *closeBtn = msgBox.addButton("Закрыть", QMessageBox::RejectRole);
+        
+        msgBox.setDefaultButton(closeBtn);
+        msgBox.exec();
+        
+        if (msgBox.clickedButton() == cancelBtn) {
+            // Show confirmation for cancellation
+            QMessageBox::StandardButton confirmReply = QMessageBox::question(this, 
+                "Подтверждение отмены", 
+                "Вы уверены, что хотите отменить эту запись?",
+                QMessageBox::Yes | QMessageBox::No);
             
-            // Build detail message
-            QString detailMsg = "Этот слот занят.";
-            if (foundAppointment) {
-                Patient patient = m_dataManager.getPatientById(apt.id_patient);
-                detailMsg = QString("Слот занят пациентом: %1\n\nВремя: %2 - %3")
-                    .arg(patient.fullName())
-                    .arg(sch.time_from.toString("HH:mm"))
-                    .arg(sch.time_to.toString("HH:mm"));
+            if (confirmReply == QMessageBox::Yes) {
+                // Delete appointment and mark slot as free
+                if (foundAppointment) {
+                    m_dataManager.deleteAppointment(apt.id_ap);
+                }
+                
+                AppointmentSchedule updatedSch = sch;
+                updatedSch.status = "free";
+                m_dataManager.updateSchedule(updatedSch);
+                
+                // Reload schedule
+                loadScheduleForRoom(m_currentRoomId);
+                QMessageBox::information(this, "Успешно", "Запись отменена");
             }
-            
-            // Show options - Reschedule or Cancel
-            QMessageBox msgBox(this);
-            msgBox.setWindowTitle("Слот занят");
-            msgBox.setText(detailMsg);
-            msgBox.setIcon(QMessageBox::Information);
-            
-            QPushButton *rescheduleBtn = new QPushButton(QIcon(":/images/icon-refresh.svg"), "Перенести");
-            msgBox.addButton(rescheduleBtn, QMessageBox::ActionRole);
-            QPushButton *cancelBtn = msgBox.addButton("Отменить", QMessageBox::DestructiveRole);
-            QPushButton *closeBtn = msgBox.addButton("Закрыть", QMessageBox::RejectRole);
-            
-            msgBox.setDefaultButton(closeBtn);
-            msgBox.exec();
-            
-            if (msgBox.clickedButton() == cancelBtn) {
-                // Show confirmation for cancellation
-                QMessageBox::StandardButton confirmReply = QMessageBox::question(this, 
-                    "Подтверждение отмены", 
-                    "Вы уверены, что хотите отменить эту запись?",
-                    QMessageBox::Yes | QMessageBox::No);
+        } else if (msgBox.clickedButton() == rescheduleBtn) {
+            // Open reschedule widget for editing appointment
+            if (foundAppointment && apt.id_ap > 0) {
+                AppointmentBookingWidget *reschedule = new AppointmentBookingWidget();
+                reschedule->setAttribute(Qt::WA_DeleteOnClose);
+                LoginUser managerUser(LoginUser::MANAGER, -1, "Менеджер");
+                reschedule->setUser(managerUser);
+                reschedule->setRescheduleMode(apt.id_ap, sch.id_ap_sch);
+                reschedule->setWindowTitle("Перенос приема");
+                reschedule->resize(900, 700);
+                reschedule->show();
                 
-                if (confirmReply == QMessageBox::Yes) {
-                    // Delete appointment and mark slot as free
-                    if (foundAppointment) {
-                        m_dataManager.deleteAppointment(apt.id_ap);
-                    }
-                    
-                    AppointmentSchedule updatedSch = sch;
-                    updatedSch.status = "free";
-                    m_dataManager.updateSchedule(updatedSch);
-                    
-                    // Reload schedule
+                // Reload schedule when reschedule widget closes
+                connect(reschedule, &QObject::destroyed, this, [this](QObject*){
                     loadScheduleForRoom(m_currentRoomId);
-                    QMessageBox::information(this, "Успешно", "Запись отменена");
-                }
-            } else if (msgBox.clickedButton() == rescheduleBtn) {
-                // Open reschedule widget for editing appointment
-                if (foundAppointment && apt.id_ap > 0) {
-                    AppointmentBookingWidget *reschedule = new AppointmentBookingWidget();
-                    reschedule->setAttribute(Qt::WA_DeleteOnClose);
-                    LoginUser managerUser(LoginUser::MANAGER, -1, "Менеджер");
-                    reschedule->setUser(managerUser);
-                    reschedule->setRescheduleMode(apt.id_ap, sch.id_ap_sch);
-                    reschedule->setWindowTitle("Перенос приема");
-                    reschedule->resize(900, 700);
-                    reschedule->show();
-                    
-                    // Reload schedule when reschedule widget closes
-                    connect(reschedule, &QObject::destroyed, this, [this](QObject*){
-                        loadScheduleForRoom(m_currentRoomId);
-                    });
-                }
+                });
             }
-            
-            return;
         }
+        
+        return;
+    }
 
-        // Open booking widget directly (no extra modal wrapper)
-        AppointmentBookingWidget *booking = new AppointmentBookingWidget();
-        booking->setAttribute(Qt::WA_DeleteOnClose);
-        LoginUser managerUser(LoginUser::MANAGER, -1, "Менеджер");
-        booking->setUser(managerUser);
-        booking->setInitialSelection(sch.id_doctor, sch.id_ap_sch);
-        booking->setWindowTitle("Запись на слот — менеджер");
-        booking->resize(900, 700);
-        booking->show();
+    // Open booking widget directly (no extra modal wrapper)
+    AppointmentBookingWidget *booking = new AppointmentBookingWidget();
+    booking->setAttribute(Qt::WA_DeleteOnClose);
+    LoginUser managerUser(LoginUser::MANAGER, -1, "Менеджер");
+    booking->setUser(managerUser);
+    booking->setInitialSelection(sch.id_doctor, sch.id_ap_sch);
+    booking->setWindowTitle("Запись на слот — менеджер");
+    booking->resize(900, 700);
+    booking->show();
 
-        // When the booking widget closes, reload schedules in case it was booked
-        connect(booking, &QObject::destroyed, this, [this](QObject*){
-            loadScheduleForRoom(m_currentRoomId);
-        });
+    // When the booking widget closes, reload schedules in case it was booked
+    connect(booking, &QObject::destroyed, this, [this](QObject*){
+        loadScheduleForRoom(m_currentRoomId);
     });
 }
 
@@ -239,218 +230,82 @@ void RoomScheduleViewer::applyRoomFilter(const QString &text) {
 }
 
 void RoomScheduleViewer::onPrevWeek() {
-    m_startDate = m_startDate.addDays(-7);
-    loadScheduleForRoom(m_currentRoomId);
+    m_timeline->scrollToDate(getMondayOfWeek(m_timeline->firstVisibleDate()).addDays(-7));
 }
 
 void RoomScheduleViewer::onNextWeek() {
-    m_startDate = m_startDate.addDays(7);
-    loadScheduleForRoom(m_currentRoomId);
+    m_timeline->scrollToDate(getMondayOfWeek(m_timeline->firstVisibleDate()).addDays(7));
 }
 
 void RoomScheduleViewer::onToday() {
-    m_startDate = getMondayOfWeek(QDate::currentDate());
-    loadScheduleForRoom(m_currentRoomId);
+    m_timeline->scrollToDate(getMondayOfWeek(QDate::currentDate()));
 }
 
 void RoomScheduleViewer::onIntervalChanged(int value) {
+    // Only the grid step changes, the slots stay as they are
     m_timeIntervalMinutes = value;
-    loadScheduleForRoom(m_currentRoomId);
+    m_timeline->setMinutesPerRow(value);
 }
 
-void RoomScheduleViewer::loadScheduleForRoom(int roomId) {
-    m_scheduleTable->clear();
-    m_scheduleTable->setRowCount(0);
-    m_scheduleTable->setColumnCount(1);
-
-    // If no room is selected, show empty table with message
-    if (roomId <= 0) {
-        QStringList headers;
-        headers << "Выберите кабинет";
-        m_scheduleTable->setColumnCount(1);
-        m_scheduleTable->setHorizontalHeaderLabels(headers);
-        
-        QTableWidgetItem *msgItem = new QTableWidgetItem("Выберите кабинет для просмотра расписания");
-        msgItem->setTextAlignment(Qt::AlignCenter);
-        msgItem->setFlags(msgItem->flags() & ~Qt::ItemIsEditable & ~Qt::ItemIsSelectable);
-        m_scheduleTable->setRowCount(1);
-        m_scheduleTable->setItem(0, 0, msgItem);
-        return;
-    }
-
-    QStringList headers;
-    headers << "Время";
-    QDate start = m_startDate;
-    QDate today = QDate::currentDate();
-    int todayColumn = -1;  // Column for today's date
-    
-    if (m_weekLabel) {
-        QString label = QString("%1 — %2").arg(start.toString("dd.MM.yyyy"), start.addDays(6).toString("dd.MM.yyyy"));
-        m_weekLabel->setText(label);
-    }
-    for (int i = 0; i < 7; ++i) {
-        QDate dt = start.addDays(i);
-        if (dt == today) {
-            todayColumn = i + 1;  // +1 because column 0 is time
-        }
-        QString dayName;
-        switch (dt.dayOfWeek()) {
-            case 1: dayName = "Пн"; break;
-            case 2: dayName = "Вт"; break;
-            case 3: dayName = "Ср"; break;
-            case 4: dayName = "Чт"; break;
-            case 5: dayName = "Пт"; break;
-            case 6: dayName = "Сб"; break;
-            case 7: dayName = "Вс"; break;
-            default: dayName = ""; break;
-        }
-        headers << QString("%1\n%2").arg(dt.toString("dd.MM"), dayName);
-    }
-    m_scheduleTable->setColumnCount(headers.size());
-    m_scheduleTable->setHorizontalHeaderLabels(headers);
-    
-    // Highlight today's column if visible
-    if (todayColumn > 0 && todayColumn < m_scheduleTable->columnCount()) {
-        QTableWidgetItem *headerItem = m_scheduleTable->horizontalHeaderItem(todayColumn);
-        if (headerItem) {
-            headerItem->setBackground(QColor(200, 220, 255));  // Light blue background for today
-            headerItem->setFont([](){ QFont f; f.setBold(true); return f; }());
-        }
-    }
-
-    // For room view: collect schedules for this room
-    QList<AppointmentSchedule> schedules = m_dataManager.getSchedulesByRoom(roomId);
+void RoomScheduleViewer::onFirstVisibleDateChanged(const QDate &date) {
+    QDate last = date.addDays(m_timeline->visibleDays() - 1);
+    m_weekLabel->setText(QString("%1 — %2").arg(date.toString("dd.MM.yyyy"), last.toString("dd.MM.yyyy")));
+}
 
-    // Use m_timeIntervalMinutes instead of calculating GCD
-    int minimalInterval = m_timeIntervalMinutes;
-    if (minimalInterval < 5) minimalInterval = 5;
-    if (minimalInterval > 120) minimalInterval = 120;
+void RoomScheduleViewer::onScheduleChanged(int scheduleId) {
+    if (m_currentRoomId <= 0 || m_reloadQueued) return;
+    // Skip slots of other rooms; a deleted slot can no longer be checked
+    AppointmentSchedule sch = m_dataManager.getScheduleById(scheduleId);
+    if (sch.id_ap_sch > 0 && sch.id_room != m_currentRoomId) return;
 
-    const int dayStartMin = 6 * 60;
-    const int dayEndMin = 22 * 60;
-    int totalMinutes = dayEndMin - dayStartMin;
-    int rowsCount = (totalMinutes + minimalInterval - 1) / minimalInterval;
-    m_scheduleTable->setRowCount(rowsCount);
+    // Changes made by one operation are folded into a single reload
+    m_reloadQueued = true;
+    QTimer::singleShot(0, this, [this]() {
+        m_reloadQueued = false;
+        loadScheduleForRoom(m_currentRoomId);
+    });
+}
 
-    for (int r = 0; r < rowsCount; ++r) {
-        int minutes = dayStartMin + r * minimalInterval;
-        int hour = minutes / 60;
-        int minute = minutes % 60;
-        QTableWidgetItem *timeItem = new QTableWidgetItem(QString("%1:%2").arg(hour, 2, 10, QChar('0')).arg(minute, 2, 10, QChar('0')));
-        // Make time column non-editable and non-selectable
-        timeItem->setFlags(timeItem->flags() & ~Qt::ItemIsEditable & ~Qt::ItemIsSelectable);
-        m_scheduleTable->setItem(r, 0, timeItem);
+void RoomScheduleViewer::loadScheduleForRoom(int roomId) {
+    // If no room is selected, show a hint instead of the grid
+    if (roomId <= 0) {
+        m_timeline->setBlocks({});
+        m_timeline->setPlaceholderText("Выберите кабинет для просмотра расписания");
+        return;
     }
 
+    // All slots of the room at once: the timeline scrolls over weeks
+    // without asking for them again
+    const QList<AppointmentSchedule> schedules = m_dataManager.getSchedulesByRoom(roomId);
+    QVector<ScheduleBlock> blocks;
+    blocks.reserve(schedules.size());
     for (const AppointmentSchedule &s : schedules) {
-        int dayOffset = m_startDate.daysTo(s.time_from.date());
-        int column = 1 + dayOffset;
-        if (column < 1 || column >= m_scheduleTable->columnCount()) continue;
-
-        int startMinOfDay = s.time_from.time().hour() * 60 + s.time_from.time().minute();
-        int endMinOfDay = s.time_to.time().hour() * 60 + s.time_to.time().minute();
-        if (startMinOfDay < dayStartMin || endMinOfDay > dayEndMin) continue;
+        blocks.append(ScheduleTimeline::blockFor(s));
+    }
+    m_timeline->setPlaceholderText(QString());
+    m_timeline->setBlocks(blocks);
+}
 
-        int startIndex = (startMinOfDay - dayStartMin) / minimalInterval;
-        int durationMin = endMinOfDay - startMinOfDay;
-        int rowSpan = (durationMin + minimalInterval - 1) / minimalInterval;
-        if (rowSpan <= 0) rowSpan = 1;
+QString RoomScheduleViewer::scheduleToolTip(int scheduleId) const {
+    AppointmentSchedule s = m_dataManager.getScheduleById(scheduleId);
+    QString st = s.status.trimmed().toLower();
+    if (st != "booked" && st != "busy") return QString();
 
-        QString st = s.status.trimmed().toLower();
-        QString statusText = "Свободен";
-        QColor bgColor = QColor(144, 190, 109);
-        QString tooltipText = "";
-        
-        if (st == "booked" || st == "busy") {
-            statusText = "Занято";
-            bgColor = QColor(255, 165, 0);
-            
-            // Get appointment info for tooltip
-            Appointment apt;
-            bool found = false;
-            for (const Appointment &a : m_dataManager.getAllAppointments()) {
-                if (a.id_ap_sch == s.id_ap_sch) {
-                    apt = a;
-                    found = true;
-                    break;
-                }
-            }
-            if (found) {
-                Patient patient = m_dataManager.getPatientById(apt.id_patient);
-                Doctor doctor = m_dataManager.getDoctorById(apt.id_doctor);
-                tooltipText = QString("ID записи: %1\nПациент: %2\nВрач: %3\nВремя: %4 - %5\nСтатус: %6")
-                    .arg(apt.id_ap)
-                    .arg(patient.fullName())
-                    .arg(doctor.fullName())
-                    .arg(s.time_from.toString("HH:mm"))
-                    .arg(s.time_to.toString("HH:mm"))
-                    .arg(statusText);
-            }
-        }
-
-        QTableWidgetItem *cell = new QTableWidgetItem(statusText);
-        // Make schedule cells non-editable
-        cell->setFlags(cell->flags() & ~Qt::ItemIsEditable);
-        cell->setBackground(bgColor);
-        cell->setForeground(Qt::white);
-        cell->setTextAlignment(Qt::AlignCenter);
-        cell->setData(Qt::UserRole, s.id_ap_sch);
-        
-        // Slightly adjust background color for today's slots if visible
-        if (column == todayColumn && todayColumn > 0) {
-            // Make color slightly darker/brighter to indicate today
-            bgColor = bgColor.darker(110);
-            cell->setBackground(bgColor);
-        }
-        
-        // Add tooltip if appointment has info
-        if (!tooltipText.isEmpty()) {
-            cell->setToolTip(tooltipText);
-        }
-        
-        m_scheduleTable->setItem(startIndex, column, cell);
-        if (rowSpan > 1) {
-            m_scheduleTable->setSpan(startIndex, column, rowSpan, 1);
-        }
-    }
-    
-    // Highlight empty cells in today's column with light background
-    // Make all empty free slots non-selectable/non-clickable
-    if (todayColumn > 0) {
-        for (int r = 0; r < rowsCount; ++r) {
-            QTableWidgetItem *cell = m_scheduleTable->item(r, todayColumn);
-            if (!cell) {
-                // Create empty cell for today's column with light background
-                QTableWidgetItem *emptyCell = new QTableWidgetItem("");
-                emptyCell->setBackground(QColor(230, 240, 255));  // Very light blue
-                emptyCell->setFlags(emptyCell->flags() & ~Qt::ItemIsEditable & ~Qt::ItemIsSelectable);
-                emptyCell->setToolTip("Слот свободен");
-                m_scheduleTable->setItem(r, todayColumn, emptyCell);
-            }
-        }
-    }
-    
-    // Make all remaining empty cells non-selectable
-    for (int r = 0; r < rowsCount; ++r) {
-        for (int c = 1; c < m_scheduleTable->columnCount(); ++c) {
-            QTableWidgetItem *cell = m_scheduleTable->item(r, c);
-            if (!cell) {
-                // Create empty cell for free slots - non-selectable
-                QTableWidgetItem *emptyCell = new QTableWidgetItem("");
-                emptyCell->setBackground(QColor(240, 240, 240));  // Very light gray
-                emptyCell->setFlags(emptyCell->flags() & ~Qt::ItemIsEditable & ~Qt::ItemIsSelectable);
-                emptyCell->setToolTip("Слот свободен");
-                m_scheduleTable->setItem(r, c, emptyCell);
-            }
-        }
-    }
+    // Get appointment info for tooltip
+    Appointment apt = m_dataManager.getAppointmentByScheduleId(s.id_ap_sch);
+    if (apt.id_ap <= 0) return QString();
+    Patient patient = m_dataManager.getPatientById(apt.id_patient);
+    Doctor doctor = m_dataManager.getDoctorById(apt.id_doctor);
+    return QString("ID записи: %1\nПациент: %2\nВрач: %3\nВремя: %4 - %5\nСтатус: %6")
+        .arg(apt.id_ap)
+        .arg(patient.fullName())
+        .arg(doctor.fullName())
+        .arg(s.time_from.toString("HH:mm"))
+        .arg(s.time_to.toString("HH:mm"))
+        .arg("Занято");
 }
 
-void RoomScheduleViewer::onTableContextMenu(const QPoint &pos) {
-    QTableWidgetItem *item = m_scheduleTable->itemAt(pos);
-    if (!item) return;
-    
-    int schId = item->data(Qt::UserRole).toInt();
+void RoomScheduleViewer::onBlockContextMenu(int schId, const QPoint &globalPos) {
     if (schId <= 0) return;
     
     AppointmentSchedule sch = m_dataManager.getScheduleById(schId);
@@ -461,7 +316,7 @@ void RoomScheduleViewer::onTableContextMenu(const QPoint &pos) {
     QMenu contextMenu;
     QAction *cancelAction = contextMenu.addAction("Отменить запись");
     
-    QAction *selectedAction = contextMenu.exec(m_scheduleTable->mapToGlobal(pos));
+    QAction *selectedAction = contextMenu.exec(globalPos);
     
     if (selectedAction == cancelAction) {
         QMessageBox::StandardButton reply = QMessageBox::question(this, 
@@ -471,7 +326,7 @@ void RoomScheduleViewer::onTableContextMenu(const QPoint &pos) {
         
         if (reply == QMessageBox::Yes) {
             // Get appointment and delete it
-            for (const Appointment &apt : m_dataManager.getAllAppointments()) {
+            for (const Appointment &apt : m_dataManager.getAppointmentsByDoctor(sch.id_doctor)) {
                 if (apt.id_ap_sch == schId) {
                     m_dataManager.deleteAppointment(apt.id_ap);
                 }
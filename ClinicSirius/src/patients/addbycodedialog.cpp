@@ -9,7 +9,7 @@
 #include <QSize>
 
 AddByCodeDialog::AddByCodeDialog(int patientId, QWidget *parent)
-    : QDialog(parent), patientId(patientId), headPatientId(-1) {
+    : QDialog(parent), dataManager(DataManager::shared()), patientId(patientId), headPatientId(-1) {
     setWindowTitle("Присоединиться к семье");
     setMinimumWidth(400);
     setupUI();
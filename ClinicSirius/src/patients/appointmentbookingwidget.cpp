@@ -99,7 +99,7 @@ void DoctorCard::mouseReleaseEvent(QMouseEvent* event) {
 }
 
 AppointmentBookingWidget::AppointmentBookingWidget(QWidget* parent)
-    : QWidget(parent), m_dataManager(QString()) {
+    : QWidget(parent), m_dataManager(DataManager::shared()) {
     setupUI();
 }
 
@@ -133,7 +133,6 @@ void AppointmentBookingWidget::setRescheduleMode(int appointmentId, int doctorId
     Appointment apt = m_dataManager.getAppointmentById(appointmentId);
     if (apt.id_ap > 0) {
         m_selectedPatient = m_dataManager.getPatientById(apt.id_patient);
-        m_oldScheduleId = apt.id_ap_sch;
     }
     
     m_titleLabel->setText("Перенос приема");
@@ -484,12 +483,9 @@ void AppointmentBookingWidget::showSlotSelection() {
         return;
     }
 
-    QList<AppointmentSchedule> availableSchedules = m_dataManager.getAvailableSchedules(m_selectedDoctorId);
-    qDebug() << "showSlotSelection: Doctor" << m_selectedDoctorId << "has" << availableSchedules.size() << "available slots";
-    
-    QSet<QDate> datesWithSlots;
+    QSet<QDate> datesWithSlots = m_dataManager.getAvailableDays(m_selectedDoctorId);
 
-    if (availableSchedules.isEmpty()) {
+    if (datesWithSlots.isEmpty()) {
         QMessageBox::information(this, "Нет свободных слотов",
                                  "У выбранного врача сейчас нет доступных приёмов. "
                                  "Попробуйте выбрать другого врача или вернитесь позже.");
@@ -499,13 +495,6 @@ void AppointmentBookingWidget::showSlotSelection() {
         return;
     }
 
-    for (const auto& schedule : availableSchedules) {
-        datesWithSlots.insert(schedule.time_from.date());
-        qDebug() << "  Adding date:" << schedule.time_from.date().toString("yyyy-MM-dd") << "Time:" << schedule.time_from.toString("HH:mm");
-    }
-
-    qDebug() << "Total dates with slots:" << datesWithSlots.size();
-    
     calendar->reset();
     calendar->setMinimumDate(QDate::currentDate());
     calendar->setAvailableDates(datesWithSlots);
@@ -532,24 +521,11 @@ void AppointmentBookingWidget::showSlotSelection() {
         calendar->setSelectedDate(QDate::currentDate());
     }
 
-    auto loadSlots = [this, slotsList, availableSchedules](const QDate& date) {
+    auto loadSlots = [this, slotsList](const QDate& date) {
         slotsList->clear();
 
-        qDebug() << "Loading slots for date:" << date.toString("yyyy-MM-dd");
-        
-        QList<AppointmentSchedule> slotsForDate;
-        for (const auto& schedule : availableSchedules) {
-            if (schedule.time_from.date() == date) {
-                slotsForDate.append(schedule);
-            }
-        }
-
-        qDebug() << "Found" << slotsForDate.size() << "slots for this date";
-
-        std::sort(slotsForDate.begin(), slotsForDate.end(),
-                  [](const AppointmentSchedule& a, const AppointmentSchedule& b) {
-                      return a.time_from < b.time_from;
-                  });
+        // Already in start order
+        const QList<AppointmentSchedule> slotsForDate = m_dataManager.getAvailableSchedules(m_selectedDoctorId, date);
 
         QDateTime now = QDateTime::currentDateTime();
 
@@ -726,54 +702,35 @@ void AppointmentBookingWidget::showConfirmation() {
 }
 
 void AppointmentBookingWidget::onBookingConfirmed() {
+    // The slot is checked and taken in one step, so a slot booked meanwhile
+    // at another desk is reported instead of being booked twice
+    BookingResult result;
     if (m_isRescheduleMode) {
-        Appointment appointment = m_dataManager.getAppointmentById(m_rescheduleAppointmentId);
-        if (appointment.id_ap <= 0) {
-            QMessageBox::warning(this, "Ошибка", "Запись не найдена");
-            return;
-        }
-        
-        if (m_oldScheduleId > 0) {
-            AppointmentSchedule oldSch = m_dataManager.getScheduleById(m_oldScheduleId);
-            if (oldSch.id_ap_sch > 0) {
-                oldSch.status = "free";
-                m_dataManager.updateSchedule(oldSch);
-            }
-        }
-        
-        appointment.date = m_selectedDateTime;
-        appointment.id_ap_sch = m_selectedScheduleId;
-        m_dataManager.updateAppointment(appointment);
-        
-        if (m_selectedScheduleId > 0) {
-            AppointmentSchedule newSch = m_dataManager.getScheduleById(m_selectedScheduleId);
-            if (newSch.id_ap_sch > 0) {
-                newSch.status = "booked";
-                m_dataManager.updateSchedule(newSch);
-            }
-        }
-        
-        QMessageBox::information(this, "Успех", "Запись перенесена на новое время");
+        result = m_dataManager.moveToSlot(m_rescheduleAppointmentId, m_selectedScheduleId);
     } else {
-        Appointment appointment;
-        appointment.id_ap = m_dataManager.getNextAppointmentId();
-        appointment.id_patient = m_selectedPatient.id_patient;
-        appointment.id_doctor = m_selectedDoctorId;
-        appointment.date = m_selectedDateTime;
-        appointment.id_ap_sch = m_selectedScheduleId;
-
-        m_dataManager.addAppointment(appointment);
-
-        if (m_selectedScheduleId > 0) {
-            AppointmentSchedule sch = m_dataManager.getScheduleById(m_selectedScheduleId);
-            if (sch.id_ap_sch > 0) {
-                sch.status = "booked";
-                m_dataManager.updateSchedule(sch);
-            }
-        }
+        result = m_dataManager.bookSlot(m_selectedScheduleId, m_selectedPatient.id_patient);
+    }
 
-        QMessageBox::information(this, "Успех",
-            QString("Запись успешно создана!\n\nНомер приема: %1").arg(appointment.id_ap));
+    switch (result.status) {
+    case BookingResult::Booked:
+        if (m_isRescheduleMode) {
+            QMessageBox::information(this, "Успех", "Запись перенесена на новое время");
+        } else {
+            QMessageBox::information(this, "Успех",
+                QString("Запись успешно создана!\n\nНомер приема: %1").arg(result.appointment.id_ap));
+        }
+        break;
+    case BookingResult::NoSuchAppointment:
+        QMessageBox::warning(this, "Ошибка", "Запись не найдена");
+        return;
+    case BookingResult::SlotTaken:
+    case BookingResult::NoSuchSlot:
+        QMessageBox::warning(this, "Слот занят",
+            "Это время уже занято или удалено. Выберите другое время.");
+        return;
+    case BookingResult::WriteFailed:
+        QMessageBox::warning(this, "Ошибка", "Не удалось сохранить запись. Попробуйте ещё раз.");
+        return;
     }
 
     resetBooking();
@@ -803,7 +760,6 @@ void AppointmentBookingWidget::resetBooking() {
     m_selectedPatient = Patient();
     m_isRescheduleMode = false;
     m_rescheduleAppointmentId = -1;
-    m_oldScheduleId = -1;
     m_stackedWidget->setCurrentIndex(0);
     m_titleLabel->setText("Запись к врачу");
     m_progressLabel->setText("Шаг 1/5");
@@ -13,7 +13,7 @@
 
 CreatePatientDialog::CreatePatientDialog(QWidget *parent, const Patient *existing)
     : QDialog(parent),
-      dataManager(QCoreApplication::applicationDirPath() + "/../data") {
+      dataManager(DataManager::shared()) {
     setMinimumWidth(450);
     // If existing patient provided - open in edit mode
     if (existing) {
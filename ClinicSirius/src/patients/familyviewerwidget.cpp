@@ -16,7 +16,7 @@
 
 FamilyViewerWidget::FamilyViewerWidget(QWidget *parent)
     : QWidget(parent),
-      m_dataManager(QString()),
+      m_dataManager(DataManager::shared()),
       m_selectedPatientId(-1)
 {
     buildUI();
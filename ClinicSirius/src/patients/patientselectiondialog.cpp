@@ -8,7 +8,7 @@
 #include <algorithm>
 
 PatientSelectionDialog::PatientSelectionDialog(QWidget *parent, const QList<Patient> &availablePatients)
-    : QDialog(parent), m_dataManager(QString()) {
+    : QDialog(parent), m_dataManager(DataManager::shared()) {
     setWindowTitle("Выбор пациента");
     setMinimumWidth(500);
     setMinimumHeight(400);
@@ -18,7 +18,7 @@
 
 ProfileWidget::ProfileWidget(QWidget *parent)
     : QWidget(parent),
-      dataManager(QCoreApplication::applicationDirPath() + "/../data"),
+      dataManager(DataManager::shared()),
       familyCountBadge(nullptr) {
     buildUI();
 }
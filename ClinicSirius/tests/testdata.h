@@ -0,0 +1,47 @@
+#ifndef TESTDATA_H
+#define TESTDATA_H
+
+#include <QString>
+#include <QStringList>
+#include <QHash>
+#include <QFile>
+#include <QDir>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QCryptographicHash>
+
+// Helpers shared by the tests that run DataManager on a temporary data
+// directory.
+namespace TestData {
+
+inline QStringList tableFiles() {
+    return {"patient.json", "doctor.json", "specialization.json", "room.json", "appointment.json",
+            "appointment_schedule.json", "patient_group.json", "diagnosis.json", "recipe.json",
+            "manager.json", "admin.json", "invitation_code.json"};
+}
+
+inline bool writeFile(const QString& path, const QByteArray& data) {
+    QFile file(path);
+    return file.open(QIODevice::WriteOnly) && file.write(data) == data.size();
+}
+
+// Writes every table file into dir, empty unless given in rows. A missing
+// file would make DataManager look in the working directory instead.
+inline bool writeTables(const QString& dir, const QHash<QString, QJsonArray>& rows = {}) {
+    for (const QString& name : tableFiles()) {
+        if (!writeFile(QDir(dir).filePath(name), QJsonDocument(rows.value(name)).toJson(QJsonDocument::Compact))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// One journal.log line, as DataManager writes it.
+inline QByteArray journalLine(const QJsonObject& obj) {
+    const QByteArray payload = QJsonDocument(obj).toJson(QJsonDocument::Compact);
+    return QCryptographicHash::hash(payload, QCryptographicHash::Md5).toHex() + ' ' + payload + '\n';
+}
+
+}  // namespace TestData
+
+#endif // TESTDATA_H
@@ -0,0 +1,130 @@
+#include <QtTest>
+#include <QTemporaryDir>
+#include <QSignalSpy>
+#include <QSet>
+#include "datamanager.h"
+#include "testdata.h"
+
+// Writes on the storage thread: the futures resolve once the batch is on
+// disk, and writesPendingChanged brackets the time anything is queued.
+// Completions come back through the event loop, which QTRY_* runs.
+class AsyncWritesTest : public QObject {
+    Q_OBJECT
+
+private slots:
+    void writeAsyncResolves();
+    void transactionCommitAsyncResolves();
+    void emptyTransactionResolvesAtOnce();
+    void compactAsyncResolves();
+
+private:
+    static Patient patient(int id, const QString& fname);
+    static QSet<int> patientIdsOnDisk(const QString& dir);
+};
+
+Patient AsyncWritesTest::patient(int id, const QString& fname) {
+    Patient p;
+    p.id_patient = id;
+    p.fname = fname;
+    p.lname = "Иванов";
+    p.email = QString("p%1@example.com").arg(id);
+    return p;
+}
+
+// What a process starting on a copy of dir would read
+QSet<int> AsyncWritesTest::patientIdsOnDisk(const QString& dir) {
+    QTemporaryDir copy;
+    for (const QString& name : QDir(dir).entryList(QDir::Files)) {
+        if (name.endsWith(".lock")) continue;
+        QFile::copy(QDir(dir).filePath(name), QDir(copy.path()).filePath(name));
+    }
+    QSet<int> ids;
+    for (const Patient& p : DataManager(copy.path()).getAllPatients()) ids.insert(p.id_patient);
+    return ids;
+}
+
+void AsyncWritesTest::writeAsyncResolves() {
+    QTemporaryDir dir;
+    QVERIFY(TestData::writeTables(dir.path(), {{"patient.json", QJsonArray{patient(1, "Анна").toJson()}}}));
+    DataManager data(dir.path());
+    QSignalSpy pending(data.events(), &DataEvents::writesPendingChanged);
+    QSignalSpy changed(data.events(), &DataEvents::patientChanged);
+
+    QFuture<bool> written = data.writeAsync([&data]() {
+        data.addPatient(patient(2, "Борис"));
+        data.updatePatient(patient(1, "Алла"));
+    });
+    // In memory and announced before the disk write is done
+    QCOMPARE(data.getPatientById(2).fname, QString("Борис"));
+    QCOMPARE(int(changed.count()), 2);
+    QVERIFY(data.hasPendingWrites());
+    QCOMPARE(int(pending.count()), 1);
+    QCOMPARE(pending.at(0).at(0).toBool(), true);
+
+    QTRY_VERIFY(written.isFinished());
+    QVERIFY(written.result());
+    QTRY_VERIFY(!data.hasPendingWrites());
+    QCOMPARE(int(pending.count()), 2);
+    QCOMPARE(pending.at(1).at(0).toBool(), false);
+    QCOMPARE(patientIdsOnDisk(dir.path()), (QSet<int>{1, 2}));
+}
+
+void AsyncWritesTest::transactionCommitAsyncResolves() {
+    QTemporaryDir dir;
+    QVERIFY(TestData::writeTables(dir.path(), {{"patient.json", QJsonArray{patient(1, "Анна").toJson()}}}));
+    DataManager data(dir.path());
+    QSignalSpy pending(data.events(), &DataEvents::writesPendingChanged);
+
+    QFuture<bool> first;
+    {
+        DataTransaction transaction(data);
+        data.addPatient(patient(2, "Борис"));
+        data.addPatient(patient(3, "Вера"));
+        // Nothing queued until the transaction is committed
+        QVERIFY(!data.hasPendingWrites());
+        first = transaction.commitAsync();
+    }
+    data.beginTransaction();
+    data.deletePatient(1);
+    QFuture<bool> second = data.commitTransactionAsync();
+
+    QTRY_VERIFY(first.isFinished() && second.isFinished());
+    QVERIFY(first.result());
+    QVERIFY(second.result());
+    QTRY_VERIFY(!data.hasPendingWrites());
+    // One pending period for both batches
+    QCOMPARE(int(pending.count()), 2);
+    QCOMPARE(patientIdsOnDisk(dir.path()), (QSet<int>{2, 3}));
+}
+
+void AsyncWritesTest::emptyTransactionResolvesAtOnce() {
+    QTemporaryDir dir;
+    QVERIFY(TestData::writeTables(dir.path()));
+    DataManager data(dir.path());
+    QSignalSpy pending(data.events(), &DataEvents::writesPendingChanged);
+    QFuture<bool> written = data.writeAsync([]() {});
+    QVERIFY(written.isFinished());
+    QVERIFY(written.result());
+    QVERIFY(!data.hasPendingWrites());
+    QCOMPARE(int(pending.count()), 0);
+}
+
+void AsyncWritesTest::compactAsyncResolves() {
+    QTemporaryDir dir;
+    QVERIFY(TestData::writeTables(dir.path(), {{"patient.json", QJsonArray{patient(1, "Анна").toJson()}}}));
+    const QString journal = QDir(dir.path()).filePath("journal.log");
+    DataManager data(dir.path());
+    data.addPatient(patient(2, "Борис"));
+    QVERIFY(QFile::exists(journal));
+
+    QSignalSpy pending(data.events(), &DataEvents::writesPendingChanged);
+    QFuture<bool> compacted = data.compactAsync();
+    QTRY_VERIFY(compacted.isFinished());
+    QVERIFY(compacted.result());
+    QTRY_VERIFY(!data.hasPendingWrites());
+    QVERIFY(!QFile::exists(journal));
+    QCOMPARE(patientIdsOnDisk(dir.path()), (QSet<int>{1, 2}));
+}
+
+QTEST_GUILESS_MAIN(AsyncWritesTest)
+#include "tst_asyncwrites.moc"
@@ -0,0 +1,132 @@
+#include <QtTest>
+#include <QTemporaryDir>
+#include "binarysnapshot.h"
+#include "testdata.h"
+
+class BinarySnapshotTest : public QObject {
+    Q_OBJECT
+
+private slots:
+    void init();
+    void appointmentsRoundTrip();
+    void schedulesRoundTrip();
+    void rejectsTimestampsWithSeconds();
+    void followsTheJsonFile();
+
+private:
+    QString jsonPath(const QString& name) const { return QDir(dir->path()).filePath(name); }
+
+    QScopedPointer<QTemporaryDir> dir;
+};
+
+void BinarySnapshotTest::init() {
+    dir.reset(new QTemporaryDir);
+    QVERIFY(dir->isValid());
+}
+
+void BinarySnapshotTest::appointmentsRoundTrip() {
+    // The sidecar only has to match the JSON file's size and time
+    const QString path = jsonPath("appointment.json");
+    QVERIFY(TestData::writeFile(path, "[]"));
+    QList<Appointment> rows;
+    for (int i = 0; i < 100; ++i) {
+        Appointment a;
+        a.id_ap = i + 1;
+        a.id_patient = 1000 + i;
+        a.id_doctor = i % 7;
+        a.id_ap_sch = i % 5 == 0 ? -1 : 500 + i;
+        a.date = QDateTime(QDate(2024, 3, 1).addDays(i), QTime(9 + i % 8, (i * 5) % 60));
+        a.completed = i % 3 == 0;
+        rows.append(a);
+    }
+    rows[7].date = QDateTime();  // undated
+
+    QVERIFY(BinarySnapshot::save(path, rows));
+    QVERIFY(QFile::exists(BinarySnapshot::sidecarPath(path)));
+    QList<Appointment> loaded;
+    QVERIFY(BinarySnapshot::load(path, loaded));
+    QCOMPARE(loaded.size(), rows.size());
+    for (int i = 0; i < rows.size(); ++i) {
+        QCOMPARE(loaded[i].id_ap, rows[i].id_ap);
+        QCOMPARE(loaded[i].id_patient, rows[i].id_patient);
+        QCOMPARE(loaded[i].id_doctor, rows[i].id_doctor);
+        QCOMPARE(loaded[i].id_ap_sch, rows[i].id_ap_sch);
+        QCOMPARE(loaded[i].date, rows[i].date);
+        QCOMPARE(loaded[i].completed, rows[i].completed);
+    }
+    QVERIFY(!loaded[7].date.isValid());
+}
+
+void BinarySnapshotTest::schedulesRoundTrip() {
+    const QString path = jsonPath("appointment_schedule.json");
+    QVERIFY(TestData::writeFile(path, "[]"));
+    const QStringList statuses{"free", "booked", "отменён", ""};
+    QList<AppointmentSchedule> rows;
+    for (int i = 0; i < 50; ++i) {
+        AppointmentSchedule s;
+        s.id_ap_sch = i + 1;
+        s.id_doctor = i % 4;
+        s.id_room = 10 + i % 3;
+        s.time_from = QDateTime(QDate(2024, 3, 1), QTime(8, 0)).addSecs(qint64(i) * 1800);
+        s.time_to = s.time_from.addSecs(1800);
+        s.status = statuses[i % statuses.size()];
+        rows.append(s);
+    }
+
+    QVERIFY(BinarySnapshot::save(path, rows));
+    QList<AppointmentSchedule> loaded;
+    QVERIFY(BinarySnapshot::load(path, loaded));
+    QCOMPARE(loaded.size(), rows.size());
+    for (int i = 0; i < rows.size(); ++i) {
+        QCOMPARE(loaded[i].id_ap_sch, rows[i].id_ap_sch);
+        QCOMPARE(loaded[i].id_doctor, rows[i].id_doctor);
+        QCOMPARE(loaded[i].id_room, rows[i].id_room);
+        QCOMPARE(loaded[i].time_from, rows[i].time_from);
+        QCOMPARE(loaded[i].time_to, rows[i].time_to);
+        QCOMPARE(loaded[i].status, rows[i].status);
+    }
+}
+
+void BinarySnapshotTest::rejectsTimestampsWithSeconds() {
+    const QString path = jsonPath("appointment.json");
+    QVERIFY(TestData::writeFile(path, "[]"));
+    Appointment a;
+    a.id_ap = 1;
+    a.id_patient = 1;
+    a.id_doctor = 1;
+    a.date = QDateTime(QDate(2024, 3, 1), QTime(9, 0, 30));
+    QVERIFY(!BinarySnapshot::save(path, {a}));
+    QVERIFY(!QFile::exists(BinarySnapshot::sidecarPath(path)));
+}
+
+void BinarySnapshotTest::followsTheJsonFile() {
+    const QString path = jsonPath("appointment.json");
+    QVERIFY(TestData::writeFile(path, "[1]"));
+    Appointment a;
+    a.id_ap = 1;
+    a.id_patient = 2;
+    a.id_doctor = 3;
+    a.date = QDateTime(QDate(2024, 3, 1), QTime(9, 0));
+    QVERIFY(BinarySnapshot::save(path, {a}));
+    QList<Appointment> loaded;
+
+    // Touched but unchanged: the MD5 still matches
+    {
+        QFile json(path);
+        QVERIFY(json.open(QIODevice::ReadWrite));
+        QVERIFY(json.setFileTime(QDateTime::currentDateTime().addDays(1), QFileDevice::FileModificationTime));
+    }
+    QVERIFY(BinarySnapshot::load(path, loaded));
+    QCOMPARE(int(loaded.size()), 1);
+
+    // Same size, other content
+    QVERIFY(TestData::writeFile(path, "[2]"));
+    QVERIFY(!BinarySnapshot::load(path, loaded));
+
+    // Other size
+    QVERIFY(TestData::writeFile(path, "[1, 2]"));
+    QVERIFY(!BinarySnapshot::load(path, loaded));
+}
+
+QTEST_GUILESS_MAIN(BinarySnapshotTest)
+#include "tst_binarysnapshot.moc"
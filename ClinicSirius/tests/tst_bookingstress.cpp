@@ -0,0 +1,138 @@
+#include <QtTest>
+#include <QTemporaryDir>
+#include <QProcess>
+#include <QRandomGenerator>
+#include <QLoggingCategory>
+#include <QTextStream>
+#include <cstring>
+#include "datamanager.h"
+#include "testdata.h"
+
+// Several processes book and move appointments on the same few schedule
+// slots of one data directory. Run with --worker, this program is one of
+// them; otherwise it starts them and checks what they left behind: no slot
+// holds two appointments, and every booking that did not get its slot was
+// told SlotTaken.
+//
+// Processes rather than threads: a DataManager belongs to the thread that
+// made it, so threads of one process never race on the same rows, while
+// processes sharing the directory do, through the lock files and table
+// stamps.
+
+static const int kWorkers = 8;
+static const int kOperations = 400;  // per worker
+static const int kSlots = 40;        // few, so that most attempts collide
+
+// --worker <dir> <index>: one line per attempt on stdout,
+// "book <appointment id> <slot id> <status>" or "move <appointment id> <slot id> <status>"
+static int runWorker(const QStringList& args) {
+    QLoggingCategory::setFilterRules("default.debug=false");
+    const int worker = args.at(3).toInt();
+    DataManager data(args.at(2));
+    QRandomGenerator rng(quint32(worker) * 7919 + 1);
+    QList<int> mine;
+    QTextStream out(stdout);
+    for (int i = 0; i < kOperations; ++i) {
+        const int slot = 1 + rng.bounded(kSlots);
+        if (!mine.isEmpty() && rng.bounded(3) == 0) {
+            const int appointment = mine.at(rng.bounded(int(mine.size())));
+            const BookingResult result = data.moveToSlot(appointment, slot);
+            out << "move " << appointment << ' ' << slot << ' ' << int(result.status) << '\n';
+        } else {
+            const BookingResult result = data.bookSlot(slot, worker + 1);
+            if (result.ok()) mine.append(result.appointment.id_ap);
+            out << "book " << result.appointment.id_ap << ' ' << slot << ' ' << int(result.status) << '\n';
+        }
+        // Write completions are delivered through the event loop, as in the app
+        QCoreApplication::processEvents();
+    }
+    data.waitForWrites();
+    QCoreApplication::processEvents();
+    return 0;
+}
+
+class BookingStressTest : public QObject {
+    Q_OBJECT
+
+private slots:
+    void concurrentBookings();
+};
+
+void BookingStressTest::concurrentBookings() {
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    QJsonArray slots;
+    const QDateTime start(QDate::currentDate().addDays(7), QTime(9, 0));
+    for (int id = 1; id <= kSlots; ++id) {
+        AppointmentSchedule s;
+        s.id_ap_sch = id;
+        s.id_doctor = 1 + id % 3;
+        s.id_room = 1;
+        s.time_from = start.addSecs(qint64(id) * 1800);
+        s.time_to = s.time_from.addSecs(1800);
+        slots.append(s.toJson());
+    }
+    QVERIFY(TestData::writeTables(dir.path(), {{"appointment_schedule.json", slots}}));
+
+    QList<QProcess*> workers;
+    for (int i = 0; i < kWorkers; ++i) {
+        QProcess* worker = new QProcess(this);
+        worker->setProcessChannelMode(QProcess::ForwardedErrorChannel);
+        worker->start(QCoreApplication::applicationFilePath(), {"--worker", dir.path(), QString::number(i)});
+        workers.append(worker);
+    }
+
+    int booked = 0;
+    int taken = 0;
+    QHash<int, int> lastSlot;  // appointment -> slot of its last successful booking or move
+    for (QProcess* worker : workers) {
+        QVERIFY(worker->waitForFinished(540000));
+        QCOMPARE(worker->exitStatus(), QProcess::NormalExit);
+        QCOMPARE(worker->exitCode(), 0);
+        const QList<QByteArray> lines = worker->readAllStandardOutput().split('\n');
+        for (const QByteArray& line : lines) {
+            if (line.isEmpty()) continue;
+            const QList<QByteArray> fields = line.split(' ');
+            QCOMPARE(int(fields.size()), 4);
+            const int appointment = fields[1].toInt();
+            const int slot = fields[2].toInt();
+            const int status = fields[3].toInt();
+            QVERIFY2(status == BookingResult::Booked || status == BookingResult::SlotTaken, line.constData());
+            if (status == BookingResult::SlotTaken) {
+                ++taken;
+                continue;
+            }
+            if (fields[0] == "book") ++booked;
+            lastSlot.insert(appointment, slot);
+        }
+    }
+    // More attempts than slots: some must have lost
+    QVERIFY(taken > 0);
+
+    // A process that has not seen the directory yet reads what they wrote
+    DataManager data(dir.path());
+    const QList<Appointment> appointments = data.getAllAppointments();
+    QCOMPARE(int(appointments.size()), booked);
+    QHash<int, int> bySlot;
+    for (const Appointment& a : appointments) {
+        QVERIFY2(!bySlot.contains(a.id_ap_sch),
+                 qPrintable(QString("slot %1 holds appointments %2 and %3").arg(a.id_ap_sch).arg(bySlot.value(a.id_ap_sch)).arg(a.id_ap)));
+        bySlot.insert(a.id_ap_sch, a.id_ap);
+        QCOMPARE(a.id_ap_sch, lastSlot.value(a.id_ap, -1));
+    }
+    for (const AppointmentSchedule& s : data.getAllSchedules()) {
+        QCOMPARE(s.status == "booked", bySlot.contains(s.id_ap_sch));
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    if (argc > 1 && std::strcmp(argv[1], "--worker") == 0) {
+        return runWorker(app.arguments());
+    }
+    BookingStressTest test;
+    return QTest::qExec(&test, argc, argv);
+}
+
+#include "tst_bookingstress.moc"
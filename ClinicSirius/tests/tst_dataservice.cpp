@@ -0,0 +1,162 @@
+#include <QtTest>
+#include <QTemporaryDir>
+#include <QSignalSpy>
+#include "datamanager.h"
+#include "dataservice.h"
+#include "dataserver.h"
+#include "testdata.h"
+
+// The clinicsiriusd wire format, and a DataServer with two clients in this
+// process. Only the clients' non-blocking calls are used: their blocking
+// reads would wait for a server that is answered from this same event loop.
+class DataServiceTest : public QObject {
+    Q_OBJECT
+
+private slots:
+    void frameSplitAcrossReads();
+    void twoFramesInOneBuffer();
+    void rowsRoundTrip();
+    void serverAnswersWritesAndPushesChanges();
+
+private:
+    static Patient patient(int id, const QString& fname);
+};
+
+Patient DataServiceTest::patient(int id, const QString& fname) {
+    Patient p;
+    p.id_patient = id;
+    p.fname = fname;
+    p.lname = "Иванов";
+    p.email = QString("p%1@example.com").arg(id);
+    return p;
+}
+
+void DataServiceTest::frameSplitAcrossReads() {
+    const QCborArray sent{int(DataProtocol::FetchTable), 7, QString("patient.json")};
+    QByteArray frame;
+    DataProtocol::appendFrame(frame, sent);
+
+    QByteArray buffer;
+    QCborArray message;
+    // Not even the size yet, then the size but half the payload
+    buffer += frame.left(3);
+    QVERIFY(!DataProtocol::takeFrame(buffer, message));
+    buffer += frame.mid(3, frame.size() / 2);
+    QVERIFY(!DataProtocol::takeFrame(buffer, message));
+    QCOMPARE(buffer.size(), 3 + frame.size() / 2);
+    buffer += frame.mid(3 + frame.size() / 2);
+    QVERIFY(DataProtocol::takeFrame(buffer, message));
+    QCOMPARE(message, sent);
+    QVERIFY(buffer.isEmpty());
+}
+
+void DataServiceTest::twoFramesInOneBuffer() {
+    const QCborArray first{int(DataProtocol::ClaimIds), 1, QString("doctor.json"), 5};
+    const QCborArray second{int(DataProtocol::Reply), 1, 42};
+    QByteArray buffer;
+    DataProtocol::appendFrame(buffer, first);
+    DataProtocol::appendFrame(buffer, second);
+    QByteArray third;
+    DataProtocol::appendFrame(third, first);
+    buffer += third.left(2);
+
+    QCborArray message;
+    QVERIFY(DataProtocol::takeFrame(buffer, message));
+    QCOMPARE(message, first);
+    QVERIFY(DataProtocol::takeFrame(buffer, message));
+    QCOMPARE(message, second);
+    QVERIFY(!DataProtocol::takeFrame(buffer, message));
+    QCOMPARE(buffer, third.left(2));
+}
+
+void DataServiceTest::rowsRoundTrip() {
+    StagedRow put;
+    put.table = "patient.json";
+    put.op = "put";
+    put.id = 3;
+    put.record = patient(3, "Вера").toJson();
+    StagedRow update = put;
+    update.id = 1;
+    update.record = patient(1, "Алла").toJson();
+    update.base = patient(1, "Анна").toJson();
+    StagedRow del;
+    del.table = "appointment.json";
+    del.op = "del";
+    del.id = 12;
+    del.base = QJsonObject{{"id_ap", 12}, {"completed", true}, {"date", "2024-03-01T09:00:00"}};
+
+    const QList<StagedRow> rows{put, update, del};
+    QCborArray message{int(DataProtocol::Write), 1};
+    message.append(DataProtocol::encodeRows(rows));
+    QByteArray buffer;
+    DataProtocol::appendFrame(buffer, message);
+    QCborArray received;
+    QVERIFY(DataProtocol::takeFrame(buffer, received));
+
+    const QList<StagedRow> decoded = DataProtocol::decodeRows(received.at(2).toArray());
+    QCOMPARE(int(decoded.size()), int(rows.size()));
+    for (int i = 0; i < rows.size(); ++i) {
+        QCOMPARE(decoded[i].table, rows[i].table);
+        QCOMPARE(decoded[i].op, rows[i].op);
+        QCOMPARE(decoded[i].id, rows[i].id);
+        QCOMPARE(decoded[i].record, rows[i].record);
+        QCOMPARE(decoded[i].base, rows[i].base);
+    }
+}
+
+void DataServiceTest::serverAnswersWritesAndPushesChanges() {
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    QVERIFY(TestData::writeTables(dir.path(), {{"patient.json", QJsonArray{patient(1, "Анна").toJson(),
+                                                                           patient(2, "Борис").toJson()}}}));
+    DataManager data(dir.path());
+    DataServer server(data);
+    const QString name = QString("tst_dataservice_%1").arg(QCoreApplication::applicationPid());
+    QVERIFY(server.listen(name));
+
+    DataServiceClient writer;
+    DataServiceClient other;
+    QVERIFY(writer.connectToServer(name));
+    QVERIFY(other.connectToServer(name));
+    QSignalSpy pushed(&other, &DataServiceClient::changesAvailable);
+
+    // A new row: answered once it is in the journal
+    StagedRow added;
+    added.table = "patient.json";
+    added.op = "put";
+    added.id = 3;
+    added.record = patient(3, "Вера").toJson();
+    int status = -1;
+    writer.write({added}, [&status](int result) { status = result; });
+    QTRY_COMPARE(status, int(JournalWrite::Written));
+    QCOMPARE(data.getPatientById(3).fname, QString("Вера"));
+
+    // The other client is told, the writer is not: its push would have
+    // come before the reply on the same socket
+    QTRY_COMPARE(int(pushed.count()), 1);
+    const QList<ServiceChange> changes = other.takeChanges();
+    QCOMPARE(int(changes.size()), 1);
+    QCOMPARE(changes[0].table, QString("patient.json"));
+    QCOMPARE(changes[0].id, 3);
+    QCOMPARE(changes[0].record, added.record);
+    QVERIFY(writer.takeChanges().isEmpty());
+
+    // Based on a version of patient 1 the server no longer has
+    StagedRow stale;
+    stale.table = "patient.json";
+    stale.op = "put";
+    stale.id = 1;
+    stale.record = patient(1, "Алла").toJson();
+    stale.base = patient(1, "Аня").toJson();
+    status = -1;
+    other.write({stale}, [&status](int result) { status = result; });
+    QTRY_COMPARE(status, int(JournalWrite::Conflict));
+    QCOMPARE(data.getPatientById(1).fname, QString("Анна"));
+
+    // Nothing was pushed for the rejected write
+    QTest::qWait(50);
+    QVERIFY(writer.takeChanges().isEmpty());
+}
+
+QTEST_GUILESS_MAIN(DataServiceTest)
+#include "tst_dataservice.moc"
@@ -0,0 +1,151 @@
+#include <QtTest>
+#include <QRandomGenerator>
+#include <QMap>
+#include "datamanager.h"
+
+class DayFenwickTest : public QObject {
+    Q_OBJECT
+
+private slots:
+    void emptyCountsNothing();
+    void firstAddGrowsFromEmpty();
+    void growsOnBothSides();
+    void assignBuildsTheSameTree();
+    void farDaysStayOutsideTheTree();
+    void matchesBruteForce();
+    void rollupBuckets();
+};
+
+void DayFenwickTest::emptyCountsNothing() {
+    DayFenwick days;
+    QVERIFY(days.isEmpty());
+    QCOMPARE(days.prefix(2460000), 0);
+    QCOMPARE(days.count(0, 5000000), 0);
+}
+
+void DayFenwickTest::firstAddGrowsFromEmpty() {
+    DayFenwick days;
+    days.add(2460000, 3);
+    QVERIFY(!days.isEmpty());
+    QCOMPARE(days.count(2460000, 2460000), 3);
+    QCOMPARE(days.count(2459999, 2459999), 0);
+    QCOMPARE(days.prefix(2460000), 0);
+    QCOMPARE(days.prefix(2460001), 3);
+}
+
+void DayFenwickTest::growsOnBothSides() {
+    const qint64 day = 2460000;
+    DayFenwick days;
+    days.add(day, 1);
+    days.add(day + 500, 2);  // past the end
+    days.add(day - 700, 4);  // before the start
+    days.add(day - 700, -1);
+    QVERIFY(days.outside.isEmpty());
+    QCOMPARE(days.count(0, 5000000), 6);
+    QCOMPARE(days.count(day - 700, day - 700), 3);
+    QCOMPARE(days.count(day - 699, day + 499), 1);
+    QCOMPARE(days.count(day + 500, day + 500), 2);
+    QCOMPARE(days.count(day + 501, day + 400), 0);  // empty range
+}
+
+void DayFenwickTest::assignBuildsTheSameTree() {
+    QRandomGenerator rng(7);
+    QVector<int> counts(300);
+    const qint64 first = 2455000;
+    DayFenwick added;
+    for (int i = 0; i < counts.size(); ++i) {
+        counts[i] = rng.bounded(20);
+        if (counts[i] != 0) added.add(first + i, counts[i]);
+    }
+    DayFenwick assigned;
+    assigned.assign(first, counts);
+    for (qint64 from = first - 10; from < first + 310; from += 7) {
+        for (qint64 last = from; last < first + 320; last += 13) {
+            QCOMPARE(assigned.count(from, last), added.count(from, last));
+        }
+    }
+    // Adding after assign grows it like any other
+    assigned.add(first - 1000, 5);
+    QCOMPARE(assigned.count(first - 1000, first - 1), 5);
+}
+
+void DayFenwickTest::farDaysStayOutsideTheTree() {
+    // A year typed as 20224 or 0202 must not stretch the tree over centuries
+    const qint64 day = 2460000;
+    const qint64 far = QDate(20224, 3, 1).toJulianDay();
+    const qint64 early = QDate(202, 3, 1).toJulianDay();
+    DayFenwick days;
+    days.add(day, 2);
+    days.add(far, 1);
+    days.add(early, 4);
+    days.add(day + 30, 1);
+    QVERIFY(days.values.size() < 1000);
+    QCOMPARE(int(days.outside.size()), 2);
+    QCOMPARE(days.count(early, far), 8);
+    QCOMPARE(days.count(day, day + 30), 3);
+    QCOMPARE(days.count(day + 31, far), 1);
+    QCOMPARE(days.prefix(day), 4);
+    QCOMPARE(days.count(early, early), 4);
+    days.add(early, -4);
+    QCOMPARE(int(days.outside.size()), 1);
+
+    // Nothing but far days
+    DayFenwick only;
+    only.add(far, 1);
+    QVERIFY(!only.isEmpty());
+    QVERIFY(only.values.isEmpty());
+    QCOMPARE(only.count(far, far), 1);
+    QCOMPARE(only.count(day, day), 0);
+
+    // Growth stops at the limits
+    DayFenwick edge;
+    edge.add(DayFenwick::LastDenseDay, 1);
+    edge.add(DayFenwick::LastDenseDay - 100, 1);
+    QCOMPARE(edge.firstDay + edge.values.size() - 1, DayFenwick::LastDenseDay);
+    QCOMPARE(edge.count(DayFenwick::LastDenseDay - 100, DayFenwick::LastDenseDay), 2);
+}
+
+void DayFenwickTest::matchesBruteForce() {
+    QRandomGenerator rng(11);
+    DayFenwick days;
+    QMap<qint64, int> expected;
+    for (int i = 0; i < 3000; ++i) {
+        const qint64 day = 2450000 + rng.bounded(4000);
+        const int delta = rng.bounded(5) - 1;
+        days.add(day, delta);
+        expected[day] += delta;
+    }
+    for (int q = 0; q < 500; ++q) {
+        const qint64 from = 2449900 + rng.bounded(4200);
+        const qint64 last = from + rng.bounded(400);
+        int sum = 0;
+        for (auto it = expected.lowerBound(from); it != expected.constEnd() && it.key() <= last; ++it) {
+            sum += it.value();
+        }
+        QCOMPARE(days.count(from, last), sum);
+    }
+}
+
+void DayFenwickTest::rollupBuckets() {
+    StatisticsRollup rollup;
+    RollupKey a;
+    a.doctor = 1;
+    RollupKey b;
+    b.doctor = 2;
+    const qint64 monday = 2460000 - 2460000 % 7;
+    for (int i = 0; i < 21; ++i) {
+        rollup.add(monday + i, i % 2 ? a : b, 1);
+    }
+    QCOMPARE(rollup.perBucket(monday, 3, 7), (QVector<int>{7, 7, 7}));
+    QCOMPARE(rollup.perBucket(monday - 7, 2, 7), (QVector<int>{0, 7}));
+    QCOMPARE(rollup.count(monday, monday + 20), 21);
+    QCOMPARE(rollup.countForDoctor(1, monday, monday + 20), 10);
+    QCOMPARE(rollup.countByDoctor(monday, monday + 6), (QHash<int, int>{{1, 3}, {2, 4}}));
+
+    rollup.add(monday + 1, a, -1);
+    QCOMPARE(rollup.count(monday, monday + 6), 6);
+    QVERIFY(!rollup.days.contains(monday + 1));
+}
+
+QTEST_GUILESS_MAIN(DayFenwickTest)
+#include "tst_dayfenwick.moc"
@@ -0,0 +1,165 @@
+#include <QtTest>
+#include <QRandomGenerator>
+#include <QVector>
+#include "histogramkernels.h"
+#include "datamanager.h"
+
+// Each kernel path this CPU can run against plain loops, on lengths that
+// leave tails behind the vector loops, with undated values and values on
+// both sides of the counted span.
+class HistogramKernelsTest : public QObject {
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+    void countInRange_data();
+    void countInRange();
+    void fixedWidthHistogram_data();
+    void fixedWidthHistogram();
+    void calendarHistograms_data();
+    void calendarHistograms();
+
+private:
+    static void addPaths();
+    static bool selectPath(const QByteArray& path);
+    static QVector<qint64> values(int n, qint64 origin, qint64 span, quint32 seed);
+    static QVector<qint32> reference(const QVector<qint64>& v, qint64 origin, qint64 width, int buckets);
+
+    QByteArray detected;
+};
+
+static const int kLengths[] = {0, 1, 2, 3, 4, 5, 7, 8, 9, 15, 16, 17, 33, 1000};
+static const qint64 kFirstDay = 2459996;  // a Monday
+
+void HistogramKernelsTest::initTestCase() {
+    detected = HistogramKernels::activePath();
+    qDebug() << "Kernels detected:" << detected.constData();
+}
+
+void HistogramKernelsTest::cleanupTestCase() {
+    HistogramKernels::usePath(detected.constData());
+}
+
+void HistogramKernelsTest::addPaths() {
+    QTest::addColumn<QByteArray>("path");
+    QTest::newRow("scalar") << QByteArray("scalar");
+    QTest::newRow("sse4.2") << QByteArray("sse4.2");
+    QTest::newRow("avx2") << QByteArray("avx2");
+}
+
+bool HistogramKernelsTest::selectPath(const QByteArray& path) {
+    return HistogramKernels::usePath(path.constData()) && path == HistogramKernels::activePath();
+}
+
+// n values around [origin, origin + span): mostly inside, some NoDate,
+// some before or after, and the edges of the span themselves.
+QVector<qint64> HistogramKernelsTest::values(int n, qint64 origin, qint64 span, quint32 seed) {
+    QRandomGenerator rng(seed);
+    const qint64 edges[] = {origin - 1, origin, origin + span - 1, origin + span};
+    QVector<qint64> v(n);
+    for (int i = 0; i < n; ++i) {
+        switch (rng.bounded(8)) {
+        case 0: v[i] = AppointmentColumns::NoDate; break;
+        case 1: v[i] = origin - 1 - qint64(rng.bounded(100000)); break;
+        case 2: v[i] = origin + span + qint64(rng.bounded(100000)); break;
+        case 3: v[i] = edges[rng.bounded(4)]; break;
+        default: v[i] = origin + qint64(rng.generate64() % quint64(span)); break;
+        }
+    }
+    return v;
+}
+
+QVector<qint32> HistogramKernelsTest::reference(const QVector<qint64>& v, qint64 origin, qint64 width, int buckets) {
+    QVector<qint32> counts(buckets, 0);
+    for (qint64 x : v) {
+        for (int b = 0; b < buckets; ++b) {
+            if (x >= origin + b * width && x < origin + (b + 1) * width) ++counts[b];
+        }
+    }
+    return counts;
+}
+
+void HistogramKernelsTest::countInRange_data() {
+    addPaths();
+}
+
+void HistogramKernelsTest::countInRange() {
+    QFETCH(QByteArray, path);
+    if (!selectPath(path)) QSKIP("Path not available on this CPU or build");
+    const qint64 from = kFirstDay * HistogramKernels::MinutesPerDay;
+    const qint64 to = from + 30 * HistogramKernels::MinutesPerDay;
+    for (int n : kLengths) {
+        const QVector<qint64> v = values(n, from, to - from, quint32(n) + 1);
+        qint64 expected = 0;
+        for (qint64 x : v) expected += (x >= from && x < to) ? 1 : 0;
+        QCOMPARE(HistogramKernels::countInRange(v.constData(), n, from, to), expected);
+        // Empty and reversed ranges count nothing
+        QCOMPARE(HistogramKernels::countInRange(v.constData(), n, from, from), qint64(0));
+        QCOMPARE(HistogramKernels::countInRange(v.constData(), n, to, from), qint64(0));
+    }
+}
+
+void HistogramKernelsTest::fixedWidthHistogram_data() {
+    addPaths();
+}
+
+void HistogramKernelsTest::fixedWidthHistogram() {
+    QFETCH(QByteArray, path);
+    if (!selectPath(path)) QSKIP("Path not available on this CPU or build");
+    // Widths the reciprocal does not represent exactly, and a span close to
+    // the 32-bit limit of the AVX2 bucket arithmetic
+    struct Shape { qint64 width; int buckets; };
+    const Shape shapes[] = {{1, 5}, {3, 11}, {7, 9}, {HistogramKernels::MinutesPerDay, 40},
+                            {7 * HistogramKernels::MinutesPerDay, 12}, {1000003, 2000}};
+    const qint64 origin = kFirstDay * HistogramKernels::MinutesPerDay;
+    for (const Shape& shape : shapes) {
+        for (int n : kLengths) {
+            const QVector<qint64> v = values(n, origin, shape.width * shape.buckets, quint32(n * 31 + shape.buckets));
+            QVector<qint32> counts(shape.buckets, 0);
+            HistogramKernels::fixedWidthHistogram(v.constData(), n, origin, shape.width, counts.data(), shape.buckets);
+            QCOMPARE(counts, reference(v, origin, shape.width, shape.buckets));
+        }
+    }
+}
+
+void HistogramKernelsTest::calendarHistograms_data() {
+    addPaths();
+}
+
+void HistogramKernelsTest::calendarHistograms() {
+    QFETCH(QByteArray, path);
+    if (!selectPath(path)) QSKIP("Path not available on this CPU or build");
+    const qint64 day = HistogramKernels::MinutesPerDay;
+    const int days = 61;
+    // Three months of 28, 31 and 2 days
+    const qint64 monthStarts[] = {kFirstDay, kFirstDay + 28, kFirstDay + 59, kFirstDay + 61};
+    for (int n : kLengths) {
+        const QVector<qint64> v = values(n, kFirstDay * day, days * day, quint32(n) * 7 + 3);
+
+        QVector<qint32> perDay(days, 0);
+        HistogramKernels::dayHistogram(v.constData(), n, kFirstDay, days, perDay.data());
+        QCOMPARE(perDay, reference(v, kFirstDay * day, day, days));
+
+        QVector<qint32> perWeek(9, 0);
+        HistogramKernels::weekHistogram(v.constData(), n, kFirstDay, 9, perWeek.data());
+        QCOMPARE(perWeek, reference(v, kFirstDay * day, 7 * day, 9));
+
+        QVector<qint32> perMonth(3, 0);
+        HistogramKernels::monthHistogram(v.constData(), n, monthStarts, 3, perMonth.data());
+        QVector<qint32> expected(3, 0);
+        for (int m = 0; m < 3; ++m) {
+            for (qint64 d = monthStarts[m]; d < monthStarts[m + 1]; ++d) {
+                expected[m] += perDay[int(d - kFirstDay)];
+            }
+        }
+        QCOMPARE(perMonth, expected);
+
+        // Counts add to what is there already
+        HistogramKernels::dayHistogram(v.constData(), n, kFirstDay, days, perDay.data());
+        for (int d = 0; d < days; ++d) QCOMPARE(perDay[d] % 2, 0);
+    }
+}
+
+QTEST_GUILESS_MAIN(HistogramKernelsTest)
+#include "tst_histogramkernels.moc"
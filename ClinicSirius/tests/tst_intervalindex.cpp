@@ -0,0 +1,90 @@
+#include <QtTest>
+#include <QRandomGenerator>
+#include "datamanager.h"
+
+class IntervalIndexTest : public QObject {
+    Q_OBJECT
+
+private slots:
+    void touchingIntervalsDoNotOverlap();
+    void ignoresTheSlotBeingMoved();
+    void longIntervalStartingEarlier();
+    void removeDropsOnlyThatId();
+    void matchesBruteForce();
+};
+
+void IntervalIndexTest::touchingIntervalsDoNotOverlap() {
+    IntervalIndex index;
+    index.insert(100, 200, 1);
+    QVERIFY(!index.overlaps(200, 300));
+    QVERIFY(!index.overlaps(0, 100));
+    QVERIFY(index.overlaps(199, 300));
+    QVERIFY(index.overlaps(50, 101));
+    QVERIFY(index.overlaps(120, 130));
+    QVERIFY(index.overlaps(0, 1000));
+}
+
+void IntervalIndexTest::ignoresTheSlotBeingMoved() {
+    IntervalIndex index;
+    index.insert(100, 200, 1);
+    QVERIFY(!index.overlaps(150, 250, 1));
+    index.insert(220, 260, 2);
+    QVERIFY(index.overlaps(150, 250, 1));
+}
+
+void IntervalIndexTest::longIntervalStartingEarlier() {
+    // Many short entries between the long one and the window: the scan has
+    // to start far enough back to see it
+    IntervalIndex index;
+    index.insert(0, 10000, 1);
+    for (int i = 0; i < 50; ++i) {
+        index.insert(100 + i * 20, 110 + i * 20, 100 + i);
+    }
+    QCOMPARE(index.maxLength, qint64(10000));
+    QVERIFY(index.overlaps(9000, 9100));
+    QVERIFY(!index.overlaps(9000, 9100, 1));
+    QVERIFY(!index.overlaps(10000, 10100));
+}
+
+void IntervalIndexTest::removeDropsOnlyThatId() {
+    IntervalIndex index;
+    index.insert(100, 200, 1);
+    index.insert(100, 150, 2);
+    QCOMPARE(int(index.idsStartingAt(100).size()), 2);
+    index.remove(100, 1);
+    QCOMPARE(index.idsStartingAt(100), QList<int>{2});
+    QVERIFY(index.overlaps(120, 130));
+    QVERIFY(!index.overlaps(160, 190));
+    index.remove(100, 7);  // not there
+    QCOMPARE(int(index.entries.size()), 1);
+}
+
+void IntervalIndexTest::matchesBruteForce() {
+    QRandomGenerator rng(42);
+    IntervalIndex index;
+    QVector<IntervalIndex::Entry> all;
+    for (int id = 0; id < 400; ++id) {
+        qint64 from = rng.bounded(100000);
+        qint64 to = from + 1 + rng.bounded(id % 10 == 0 ? 5000 : 300);
+        index.insert(from, to, id);
+        all.append({from, to, id});
+    }
+    // Drop every third one again
+    for (int i = 0; i < all.size(); i += 3) {
+        index.remove(all[i].from, all[i].id);
+    }
+    for (int q = 0; q < 2000; ++q) {
+        const qint64 from = rng.bounded(105000);
+        const qint64 to = from + 1 + rng.bounded(600);
+        const int ignore = rng.bounded(400);
+        bool expected = false;
+        for (int i = 0; i < all.size(); ++i) {
+            if (i % 3 == 0 || all[i].id == ignore) continue;
+            expected = expected || (all[i].from < to && from < all[i].to);
+        }
+        QCOMPARE(index.overlaps(from, to, ignore), expected);
+    }
+}
+
+QTEST_GUILESS_MAIN(IntervalIndexTest)
+#include "tst_intervalindex.moc"
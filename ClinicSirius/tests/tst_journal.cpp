@@ -0,0 +1,172 @@
+#include <QtTest>
+#include <QTemporaryDir>
+#include <QSet>
+#include "datamanager.h"
+#include "testdata.h"
+
+// Journal replay on load: committed batches are applied over the JSON
+// snapshot, a batch with a bad checksum or a missing commit marker is
+// dropped as a whole. Every test uses a directory of its own, since
+// DataManagers on one directory share their tables.
+class JournalTest : public QObject {
+    Q_OBJECT
+
+private slots:
+    void replaysCommittedBatches();
+    void dropsBatchWithBadChecksum();
+    void ignoresUncommittedTail();
+    void replaysDeletesAndPutsOfOneId();
+    void writtenJournalReplaysElsewhere();
+
+private:
+    static Patient patient(int id, const QString& fname);
+    static QByteArray put(int id, const QString& fname);
+    static QByteArray del(int id);
+    static QByteArray commit(int count);
+    static bool setUpDirectory(const QString& dir, const QByteArray& journal);
+    static QSet<int> patientIds(const DataManager& data);
+};
+
+Patient JournalTest::patient(int id, const QString& fname) {
+    Patient p;
+    p.id_patient = id;
+    p.fname = fname;
+    p.lname = "Иванов";
+    p.email = QString("p%1@example.com").arg(id);
+    return p;
+}
+
+QByteArray JournalTest::put(int id, const QString& fname) {
+    QJsonObject obj;
+    obj["table"] = "patient.json";
+    obj["op"] = "put";
+    obj["id"] = id;
+    obj["record"] = patient(id, fname).toJson();
+    return TestData::journalLine(obj);
+}
+
+QByteArray JournalTest::del(int id) {
+    QJsonObject obj;
+    obj["table"] = "patient.json";
+    obj["op"] = "del";
+    obj["id"] = id;
+    return TestData::journalLine(obj);
+}
+
+QByteArray JournalTest::commit(int count) {
+    QJsonObject obj;
+    obj["op"] = "commit";
+    obj["writer"] = "test";
+    obj["count"] = count;
+    return TestData::journalLine(obj);
+}
+
+// Patients 1 and 2 in patient.json, plus the given journal
+bool JournalTest::setUpDirectory(const QString& dir, const QByteArray& journal) {
+    QJsonObject begin;
+    begin["op"] = "begin";
+    begin["generation"] = "test-generation";
+    return TestData::writeTables(dir, {{"patient.json", QJsonArray{patient(1, "Анна").toJson(), patient(2, "Борис").toJson()}}})
+        && TestData::writeFile(QDir(dir).filePath("journal.log"), TestData::journalLine(begin) + journal);
+}
+
+QSet<int> JournalTest::patientIds(const DataManager& data) {
+    QSet<int> ids;
+    for (const Patient& p : data.getAllPatients()) ids.insert(p.id_patient);
+    return ids;
+}
+
+void JournalTest::replaysCommittedBatches() {
+    QTemporaryDir dir;
+    QVERIFY(setUpDirectory(dir.path(), put(3, "Вера") + commit(1)
+                                       + del(1) + put(2, "Глеб") + commit(2)));
+    DataManager data(dir.path());
+    QCOMPARE(patientIds(data), (QSet<int>{2, 3}));
+    QCOMPARE(data.getPatientById(2).fname, QString("Глеб"));
+    QCOMPARE(data.getPatientById(3).fname, QString("Вера"));
+    // The sequence continues after the replayed ids
+    QVERIFY(data.getNextPatientId() > 3);
+}
+
+void JournalTest::dropsBatchWithBadChecksum() {
+    QByteArray corrupted = put(4, "Дина");
+    corrupted.replace("Дина", "Инна");  // payload changed, checksum kept
+    QTemporaryDir dir;
+    QVERIFY(setUpDirectory(dir.path(), put(3, "Вера") + commit(1)
+                                       + corrupted + put(5, "Ефим") + commit(2)
+                                       + put(6, "Жанна") + commit(1)));
+    DataManager data(dir.path());
+    // Patient 5 lost its batch with the corrupted line; the count no longer matches
+    QCOMPARE(patientIds(data), (QSet<int>{1, 2, 3, 6}));
+}
+
+void JournalTest::ignoresUncommittedTail() {
+    QByteArray torn = put(5, "Ефим");
+    torn.chop(10);
+    QTemporaryDir dir;
+    QVERIFY(setUpDirectory(dir.path(), put(3, "Вера") + commit(1) + put(4, "Дина") + torn));
+    DataManager data(dir.path());
+    QCOMPARE(patientIds(data), (QSet<int>{1, 2, 3}));
+}
+
+void JournalTest::replaysDeletesAndPutsOfOneId() {
+    // Deleted rows are dropped once the batch is replayed; a row put again
+    // after its delete, and the rows around it, must come out right
+    QByteArray journal;
+    for (int id = 3; id < 203; ++id) journal += put(id, QString("П%1").arg(id));
+    journal += commit(200);
+    for (int id = 1; id < 203; id += 2) journal += del(id);
+    journal += put(5, "Вновь") + del(5) + put(5, "Снова") + put(4, "Четыре") + commit(105);
+    QTemporaryDir dir;
+    QVERIFY(setUpDirectory(dir.path(), journal));
+    DataManager data(dir.path());
+    QSet<int> expected;
+    for (int id = 2; id < 203; id += 2) expected.insert(id);
+    expected.insert(5);
+    QCOMPARE(patientIds(data), expected);
+    QCOMPARE(data.getPatientById(5).fname, QString("Снова"));
+    QCOMPARE(data.getPatientById(4).fname, QString("Четыре"));
+    QCOMPARE(data.getPatientById(2).fname, QString("Борис"));
+    QCOMPARE(data.getPatientById(200).fname, QString("П200"));
+    QVERIFY(data.getPatientById(3).fname.isEmpty());
+}
+
+void JournalTest::writtenJournalReplaysElsewhere() {
+    QTemporaryDir source;
+    QVERIFY(setUpDirectory(source.path(), QByteArray()));
+    {
+        DataManager data(source.path());
+        data.addPatient(patient(3, "Вера"));
+        data.updatePatient(patient(1, "Алла"));
+        data.deletePatient(2);
+        data.waitForWrites();
+    }
+
+    // Every line carries a valid checksum, and each mutation is a batch
+    QFile log(QDir(source.path()).filePath("journal.log"));
+    QVERIFY(log.open(QIODevice::ReadOnly));
+    const QList<QByteArray> lines = log.readAll().split('\n');
+    int commits = 0;
+    for (const QByteArray& line : lines) {
+        if (line.isEmpty()) continue;
+        const int sep = line.indexOf(' ');
+        QVERIFY(sep > 0);
+        QCOMPARE(QCryptographicHash::hash(line.mid(sep + 1), QCryptographicHash::Md5).toHex(), line.left(sep));
+        if (QJsonDocument::fromJson(line.mid(sep + 1)).object()["op"].toString() == "commit") ++commits;
+    }
+    QCOMPARE(commits, 3);
+
+    // A directory with the same files, loaded fresh, replays all three
+    QTemporaryDir copy;
+    for (const QString& name : QDir(source.path()).entryList(QDir::Files)) {
+        if (name.endsWith(".lock")) continue;
+        QVERIFY(QFile::copy(QDir(source.path()).filePath(name), QDir(copy.path()).filePath(name)));
+    }
+    DataManager replayed(copy.path());
+    QCOMPARE(patientIds(replayed), (QSet<int>{1, 3}));
+    QCOMPARE(replayed.getPatientById(1).fname, QString("Алла"));
+    QCOMPARE(replayed.getPatientById(3).fname, QString("Вера"));
+}
+
+QTEST_GUILESS_MAIN(JournalTest)
+#include "tst_journal.moc"
@@ -0,0 +1,173 @@
+#include <QtTest>
+#include <QTemporaryDir>
+#include <QSignalSpy>
+#include <QSet>
+#include "datamanager.h"
+#include "testdata.h"
+
+// Coordination between processes sharing a data directory. The other
+// process is played by the test: it appends a committed batch to the
+// journal and moves its table's stamp, as appendBatch() does under the
+// locks.
+class TableStampsTest : public QObject {
+    Q_OBJECT
+
+private slots:
+    void staleStampForcesRetry();
+    void conflictingRowIsGivenUp();
+    void compactionPutOffWhenAnotherProcessWrote();
+
+private:
+    static Patient patient(int id, const QString& fname);
+    static bool setUpDirectory(const QString& dir);
+    static bool writeAsOtherProcess(const QString& dir, const Patient& p, quint64 stamp);
+    static QSet<int> patientIds(const DataManager& data);
+    static quint64 stampOf(const QString& dir, const QString& table);
+};
+
+Patient TableStampsTest::patient(int id, const QString& fname) {
+    Patient p;
+    p.id_patient = id;
+    p.fname = fname;
+    p.lname = "Иванов";
+    p.email = QString("p%1@example.com").arg(id);
+    return p;
+}
+
+// Patients 1 and 2 in patient.json, and a journal with only its header
+bool TableStampsTest::setUpDirectory(const QString& dir) {
+    QJsonObject begin;
+    begin["op"] = "begin";
+    begin["generation"] = "test-generation";
+    return TestData::writeTables(dir, {{"patient.json", QJsonArray{patient(1, "Анна").toJson(), patient(2, "Борис").toJson()}}})
+        && TestData::writeFile(QDir(dir).filePath("journal.log"), TestData::journalLine(begin));
+}
+
+bool TableStampsTest::writeAsOtherProcess(const QString& dir, const Patient& p, quint64 stamp) {
+    QJsonObject put;
+    put["table"] = "patient.json";
+    put["op"] = "put";
+    put["id"] = p.id_patient;
+    put["record"] = p.toJson();
+    QJsonObject marker;
+    marker["op"] = "commit";
+    marker["writer"] = "other";
+    marker["count"] = 1;
+    marker["stamps"] = QJsonObject{{"patient.json", QString::number(stamp)}};
+
+    QFile journal(QDir(dir).filePath("journal.log"));
+    const QByteArray batch = TestData::journalLine(put) + TestData::journalLine(marker);
+    if (!journal.open(QIODevice::WriteOnly | QIODevice::Append) || journal.write(batch) != batch.size()) {
+        return false;
+    }
+    return TestData::writeFile(QDir(dir).filePath("patient.json.version"), QByteArray::number(stamp) + '\n');
+}
+
+QSet<int> TableStampsTest::patientIds(const DataManager& data) {
+    QSet<int> ids;
+    for (const Patient& p : data.getAllPatients()) ids.insert(p.id_patient);
+    return ids;
+}
+
+quint64 TableStampsTest::stampOf(const QString& dir, const QString& table) {
+    QFile file(QDir(dir).filePath(table + ".version"));
+    return file.open(QIODevice::ReadOnly) ? file.readAll().trimmed().toULongLong() : 0;
+}
+
+void TableStampsTest::staleStampForcesRetry() {
+    QTemporaryDir dir;
+    QVERIFY(setUpDirectory(dir.path()));
+    DataManager data(dir.path());
+    QCOMPARE(patientIds(data), (QSet<int>{1, 2}));
+
+    // The other process adds patient 4 after this one read the table, so
+    // the first append of patient 3 finds the stamp moved
+    QVERIFY(writeAsOtherProcess(dir.path(), patient(4, "Дина"), 12345));
+    QSignalSpy conflicts(data.events(), &DataEvents::writeConflict);
+    QSignalSpy failures(data.events(), &DataEvents::writeFailed);
+    QSignalSpy changed(data.events(), &DataEvents::patientChanged);
+    data.addPatient(patient(3, "Вера"));
+    QCOMPARE(int(conflicts.count()), 0);
+    QCOMPARE(int(failures.count()), 0);
+    QCOMPARE(patientIds(data), (QSet<int>{1, 2, 3, 4}));
+
+    // Appended on top of the other batch, with a stamp of its own
+    const quint64 stamp = stampOf(dir.path(), "patient.json");
+    QVERIFY(stamp != 0);
+    QVERIFY(stamp != 12345);
+    QFile log(QDir(dir.path()).filePath("journal.log"));
+    QVERIFY(log.open(QIODevice::ReadOnly));
+    QStringList writers;
+    for (const QByteArray& line : log.readAll().split('\n')) {
+        const QJsonObject obj = QJsonDocument::fromJson(line.mid(line.indexOf(' ') + 1)).object();
+        if (obj["op"].toString() == "commit") writers.append(obj["writer"].toString());
+    }
+    QCOMPARE(int(writers.size()), 2);
+    QCOMPARE(writers[0], QString("other"));
+
+    // The other process's row is announced like this one's
+    QSet<int> announced;
+    for (const QList<QVariant>& args : changed) announced.insert(args.at(0).toInt());
+    QCOMPARE(announced, (QSet<int>{3, 4}));
+
+    QTemporaryDir copy;
+    for (const QString& name : QDir(dir.path()).entryList(QDir::Files)) {
+        if (name.endsWith(".lock")) continue;
+        QVERIFY(QFile::copy(QDir(dir.path()).filePath(name), QDir(copy.path()).filePath(name)));
+    }
+    DataManager replayed(copy.path());
+    QCOMPARE(patientIds(replayed), (QSet<int>{1, 2, 3, 4}));
+}
+
+void TableStampsTest::conflictingRowIsGivenUp() {
+    QTemporaryDir dir;
+    QVERIFY(setUpDirectory(dir.path()));
+    DataManager data(dir.path());
+    QCOMPARE(data.getPatientById(1).fname, QString("Анна"));
+
+    // Both processes change patient 1: the one that got there first keeps it
+    QVERIFY(writeAsOtherProcess(dir.path(), patient(1, "Алла"), 777));
+    QSignalSpy conflicts(data.events(), &DataEvents::writeConflict);
+    data.updatePatient(patient(1, "Ада"));
+    QCOMPARE(int(conflicts.count()), 1);
+    QCOMPARE(data.getPatientById(1).fname, QString("Алла"));
+    QCOMPARE(stampOf(dir.path(), "patient.json"), quint64(777));
+}
+
+void TableStampsTest::compactionPutOffWhenAnotherProcessWrote() {
+    QTemporaryDir dir;
+    QVERIFY(setUpDirectory(dir.path()));
+    const QString journal = QDir(dir.path()).filePath("journal.log");
+    const QString patients = QDir(dir.path()).filePath("patient.json");
+    DataManager data(dir.path());
+    data.addPatient(patient(3, "Вера"));
+    QCoreApplication::processEvents();
+
+    // Written after this process last read the journal: truncating it now
+    // would lose patient 4
+    QVERIFY(writeAsOtherProcess(dir.path(), patient(4, "Дина"), 4242));
+    data.compact();
+    QCoreApplication::processEvents();
+    QVERIFY(QFile::exists(journal));
+    QFile before(patients);
+    QVERIFY(before.open(QIODevice::ReadOnly));
+    QCOMPARE(int(QJsonDocument::fromJson(before.readAll()).array().size()), 2);
+    before.close();
+
+    // Once the batch is read in, the compaction goes ahead with every row
+    data.refresh();
+    QCOMPARE(patientIds(data), (QSet<int>{1, 2, 3, 4}));
+    data.compact();
+    QCoreApplication::processEvents();
+    QVERIFY(!QFile::exists(journal));
+    QFile after(patients);
+    QVERIFY(after.open(QIODevice::ReadOnly));
+    QSet<int> saved;
+    for (const QJsonValue& value : QJsonDocument::fromJson(after.readAll()).array()) {
+        saved.insert(value.toObject()["id_patient"].toInt());
+    }
+    QCOMPARE(saved, (QSet<int>{1, 2, 3, 4}));
+}
+
+QTEST_GUILESS_MAIN(TableStampsTest)
+#include "tst_tablestamps.moc"
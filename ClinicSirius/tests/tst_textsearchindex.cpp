@@ -0,0 +1,120 @@
+#include <QtTest>
+#include <QRandomGenerator>
+#include "textsearchindex.h"
+
+class TextSearchIndexTest : public QObject {
+    Q_OBJECT
+
+private slots:
+    void foldsCaseAndYo();
+    void emptyQueryMatchesAll();
+    void shortQueries();
+    void doesNotMatchAcrossFields();
+    void narrowingAndWidening();
+    void matchesBruteForce();
+
+private:
+    static QVector<QStringList> people();
+    static void build(TextSearchIndex& index, const QVector<QStringList>& docs);
+};
+
+QVector<QStringList> TextSearchIndexTest::people() {
+    return {
+        {"Петров", "Пётр", "Ильич", "petrov@example.com", "+79001234567"},
+        {"Иванова", "Анна", "Сергеевна", "anna@example.com", "+79007654321"},
+        {"Ёлкин", "Семён", "", "elkin@example.com", "+79005550000"},
+        {"Смирнов", "Олег", "Петрович", "oleg@example.com", "+79001112233"},
+    };
+}
+
+void TextSearchIndexTest::build(TextSearchIndex& index, const QVector<QStringList>& docs) {
+    index.build(docs.size(), [&docs](int i) { return docs[i]; });
+}
+
+void TextSearchIndexTest::foldsCaseAndYo() {
+    TextSearchIndex index;
+    build(index, people());
+    QCOMPARE(index.search("ПЕТР"), (QVector<int>{0, 3}));
+    QCOMPARE(index.search("пётр"), (QVector<int>{0, 3}));
+    QCOMPARE(index.search("елкин"), QVector<int>{2});
+    QCOMPARE(index.search("СЕМЁН"), QVector<int>{2});
+    QCOMPARE(index.search("EXAMPLE.COM").size(), people().size());
+}
+
+void TextSearchIndexTest::emptyQueryMatchesAll() {
+    TextSearchIndex index;
+    build(index, people());
+    QCOMPARE(index.search(QString()), (QVector<int>{0, 1, 2, 3}));
+
+    TextSearchIndex empty;
+    QVERIFY(empty.search("a").isEmpty());
+    build(empty, {});
+    QCOMPARE(empty.size(), 0);
+    QVERIFY(empty.search("a").isEmpty());
+}
+
+void TextSearchIndexTest::shortQueries() {
+    TextSearchIndex index;
+    build(index, people());
+    QCOMPARE(index.search("ё"), (QVector<int>{0, 1, 2, 3}));  // е everywhere once folded
+    QCOMPARE(index.search("ан"), QVector<int>{1});
+    QCOMPARE(index.search("55"), QVector<int>{2});
+    QVERIFY(index.search("ъ").isEmpty());
+}
+
+void TextSearchIndexTest::doesNotMatchAcrossFields() {
+    TextSearchIndex index;
+    build(index, {{"Иванов", "Петр"}, {"Иванов Петр"}});
+    // "овпе" only exists where the two fields meet
+    QVERIFY(index.search("овпе").isEmpty());
+    QCOMPARE(index.search("ов пе"), QVector<int>{1});
+    QCOMPARE(index.search("иванов"), (QVector<int>{0, 1}));
+}
+
+void TextSearchIndexTest::narrowingAndWidening() {
+    TextSearchIndex index;
+    build(index, people());
+    // As typed into the search box, then erased again
+    QCOMPARE(index.search("п"), (QVector<int>{0, 3}));
+    QCOMPARE(index.search("пе"), (QVector<int>{0, 3}));
+    QCOMPARE(index.search("пет"), (QVector<int>{0, 3}));
+    QCOMPARE(index.search("петро"), (QVector<int>{0, 3}));
+    QCOMPARE(index.search("петров"), (QVector<int>{0, 3}));
+    QCOMPARE(index.search("петрови"), QVector<int>{3});
+    QCOMPARE(index.search("петро"), (QVector<int>{0, 3}));
+    QCOMPARE(index.search("о"), (QVector<int>{0, 1, 3}));
+}
+
+void TextSearchIndexTest::matchesBruteForce() {
+    // A small alphabet so that queries have matches and grams collide
+    const QString alphabet = QString::fromUtf8("абвгдеёАБВ 12");
+    QRandomGenerator rng(3);
+    auto randomText = [&](int length) {
+        QString text;
+        for (int i = 0; i < length; ++i) text += alphabet.at(rng.bounded(alphabet.size()));
+        return text;
+    };
+    QVector<QStringList> docs;
+    for (int i = 0; i < 500; ++i) {
+        docs.append({randomText(1 + rng.bounded(12)), randomText(rng.bounded(8))});
+    }
+    TextSearchIndex index;
+    build(index, docs);
+    for (int q = 0; q < 400; ++q) {
+        const QString query = randomText(1 + rng.bounded(5));
+        const QString folded = TextSearchIndex::fold(query);
+        QVector<int> expected;
+        for (int i = 0; i < docs.size(); ++i) {
+            for (const QString& field : docs[i]) {
+                if (TextSearchIndex::fold(field).contains(folded)) {
+                    expected.append(i);
+                    break;
+                }
+            }
+        }
+        QCOMPARE(index.search(query), expected);
+    }
+}
+
+QTEST_GUILESS_MAIN(TextSearchIndexTest)
+#include "tst_textsearchindex.moc"